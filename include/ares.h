@@ -228,43 +228,48 @@ typedef enum {
 } ares_evsys_t;
 
 /* Flag values */
-#define ARES_FLAG_USEVC       (1 << 0)
-#define ARES_FLAG_PRIMARY     (1 << 1)
-#define ARES_FLAG_IGNTC       (1 << 2)
-#define ARES_FLAG_NORECURSE   (1 << 3)
-#define ARES_FLAG_STAYOPEN    (1 << 4)
-#define ARES_FLAG_NOSEARCH    (1 << 5)
-#define ARES_FLAG_NOALIASES   (1 << 6)
-#define ARES_FLAG_NOCHECKRESP (1 << 7)
-#define ARES_FLAG_EDNS        (1 << 8)
-#define ARES_FLAG_NO_DFLT_SVR (1 << 9)
-#define ARES_FLAG_DNS0x20     (1 << 10)
+#define ARES_FLAG_USEVC           (1 << 0)
+#define ARES_FLAG_PRIMARY         (1 << 1)
+#define ARES_FLAG_IGNTC           (1 << 2)
+#define ARES_FLAG_NORECURSE       (1 << 3)
+#define ARES_FLAG_STAYOPEN        (1 << 4)
+#define ARES_FLAG_NOSEARCH        (1 << 5)
+#define ARES_FLAG_NOALIASES       (1 << 6)
+#define ARES_FLAG_NOCHECKRESP     (1 << 7)
+#define ARES_FLAG_EDNS            (1 << 8)
+#define ARES_FLAG_NO_DFLT_SVR     (1 << 9)
+#define ARES_FLAG_DNS0x20         (1 << 10)
+#define ARES_FLAG_PARALLEL_SEARCH (1 << 11)
+#define ARES_FLAG_SEARCH_NEGCACHE (1 << 12)
+#define ARES_FLAG_SERVICES_CACHE  (1 << 13)
 
 /* Option mask values */
-#define ARES_OPT_FLAGS           (1 << 0)
-#define ARES_OPT_TIMEOUT         (1 << 1)
-#define ARES_OPT_TRIES           (1 << 2)
-#define ARES_OPT_NDOTS           (1 << 3)
-#define ARES_OPT_UDP_PORT        (1 << 4)
-#define ARES_OPT_TCP_PORT        (1 << 5)
-#define ARES_OPT_SERVERS         (1 << 6)
-#define ARES_OPT_DOMAINS         (1 << 7)
-#define ARES_OPT_LOOKUPS         (1 << 8)
-#define ARES_OPT_SOCK_STATE_CB   (1 << 9)
-#define ARES_OPT_SORTLIST        (1 << 10)
-#define ARES_OPT_SOCK_SNDBUF     (1 << 11)
-#define ARES_OPT_SOCK_RCVBUF     (1 << 12)
-#define ARES_OPT_TIMEOUTMS       (1 << 13)
-#define ARES_OPT_ROTATE          (1 << 14)
-#define ARES_OPT_EDNSPSZ         (1 << 15)
-#define ARES_OPT_NOROTATE        (1 << 16)
-#define ARES_OPT_RESOLVCONF      (1 << 17)
-#define ARES_OPT_HOSTS_FILE      (1 << 18)
-#define ARES_OPT_UDP_MAX_QUERIES (1 << 19)
-#define ARES_OPT_MAXTIMEOUTMS    (1 << 20)
-#define ARES_OPT_QUERY_CACHE     (1 << 21)
-#define ARES_OPT_EVENT_THREAD    (1 << 22)
-#define ARES_OPT_SERVER_FAILOVER (1 << 23)
+#define ARES_OPT_FLAGS            (1 << 0)
+#define ARES_OPT_TIMEOUT          (1 << 1)
+#define ARES_OPT_TRIES            (1 << 2)
+#define ARES_OPT_NDOTS            (1 << 3)
+#define ARES_OPT_UDP_PORT         (1 << 4)
+#define ARES_OPT_TCP_PORT         (1 << 5)
+#define ARES_OPT_SERVERS          (1 << 6)
+#define ARES_OPT_DOMAINS          (1 << 7)
+#define ARES_OPT_LOOKUPS          (1 << 8)
+#define ARES_OPT_SOCK_STATE_CB    (1 << 9)
+#define ARES_OPT_SORTLIST         (1 << 10)
+#define ARES_OPT_SOCK_SNDBUF      (1 << 11)
+#define ARES_OPT_SOCK_RCVBUF      (1 << 12)
+#define ARES_OPT_TIMEOUTMS        (1 << 13)
+#define ARES_OPT_ROTATE           (1 << 14)
+#define ARES_OPT_EDNSPSZ          (1 << 15)
+#define ARES_OPT_NOROTATE         (1 << 16)
+#define ARES_OPT_RESOLVCONF       (1 << 17)
+#define ARES_OPT_HOSTS_FILE       (1 << 18)
+#define ARES_OPT_UDP_MAX_QUERIES  (1 << 19)
+#define ARES_OPT_MAXTIMEOUTMS     (1 << 20)
+#define ARES_OPT_QUERY_CACHE      (1 << 21)
+#define ARES_OPT_EVENT_THREAD     (1 << 22)
+#define ARES_OPT_SERVER_FAILOVER  (1 << 23)
+#define ARES_OPT_EVENT_THREAD_CNT (1 << 24)
+#define ARES_OPT_CALLBACK_WORKERS (1 << 25)
 
 /* Nameinfo flag values */
 #define ARES_NI_NOFQDN        (1 << 0)
@@ -351,6 +356,23 @@ struct ares_server_failover_options {
   size_t         retry_delay;
 };
 
+/* Callback worker options.
+ *
+ * When enabled, completion callbacks are delivered from a pool of worker
+ * threads rather than inline from the thread processing the response, so
+ * slow callbacks do not stall I/O processing.
+ *
+ * num_workers is the number of worker threads to spawn, 0 means 1.
+ *
+ * max_pending is the maximum number of completions waiting to be delivered
+ * by the workers.  Once reached, completions are delivered inline until the
+ * workers catch up.  0 means the default of 4096.
+ */
+struct ares_callback_worker_options {
+  size_t num_workers;
+  size_t max_pending;
+};
+
 /* NOTE about the ares_options struct to users and developers.
 
    This struct will remain looking like this. It will not be extended nor
@@ -394,6 +416,9 @@ struct ares_options {
   unsigned int qcache_max_ttl;   /* Maximum TTL for query cache, 0=disabled */
   ares_evsys_t evsys;
   struct ares_server_failover_options server_failover_opts;
+  size_t event_thread_cnt; /* Number of event threads, requires
+                            * ARES_OPT_EVENT_THREAD */
+  struct ares_callback_worker_options callback_worker_opts;
 };
 
 struct hostent;
@@ -464,6 +489,11 @@ typedef int (*ares_sock_config_callback)(ares_socket_t socket_fd, int type,
 typedef void (*ares_addrinfo_callback)(void *arg, int status, int timeouts,
                                        struct ares_addrinfo *res);
 
+typedef void (*ares_addrinfo_stream_callback)(void *arg, int status,
+                                              int                   timeouts,
+                                              struct ares_addrinfo *res,
+                                              ares_bool_t           more);
+
 typedef void (*ares_server_state_callback)(const char *server_string,
                                            ares_bool_t success, int flags,
                                            void *data);
@@ -554,11 +584,35 @@ CARES_EXTERN void ares_process_pending_write(ares_channel_t *channel);
 CARES_EXTERN int ares_set_sortlist(ares_channel_t *channel,
                                    const char     *sortstr);
 
+/* Back the query cache with a shared file so it can be used across channels
+ * and processes.  path of NULL detaches from the shared cache. */
+CARES_EXTERN ares_status_t ares_set_query_cache_shm(ares_channel_t *channel,
+                                                    const char     *path,
+                                                    size_t          size);
+
+/* Save the query cache to a file, and load a previously saved cache, so a
+ * restarted process doesn't start with a cold cache.  Only entries that are
+ * still valid when loaded are used. */
+CARES_EXTERN ares_status_t ares_query_cache_save(ares_channel_t *channel,
+                                                 const char     *path);
+
+CARES_EXTERN ares_status_t ares_query_cache_load(ares_channel_t *channel,
+                                                 const char     *path);
+
 CARES_EXTERN void ares_getaddrinfo(ares_channel_t *channel, const char *node,
                                    const char                       *service,
                                    const struct ares_addrinfo_hints *hints,
                                    ares_addrinfo_callback callback, void *arg);
 
+/* Same as ares_getaddrinfo() but for AF_UNSPEC lookups the addresses of the
+ * first address family to answer are delivered immediately with more set,
+ * the callback is then invoked once more with the remaining results. */
+CARES_EXTERN void
+  ares_getaddrinfo_stream(ares_channel_t *channel, const char *node,
+                          const char                       *service,
+                          const struct ares_addrinfo_hints *hints,
+                          ares_addrinfo_stream_callback callback, void *arg);
+
 CARES_EXTERN void ares_freeaddrinfo(struct ares_addrinfo *ai);
 
 /*
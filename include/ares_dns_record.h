@@ -574,7 +574,20 @@ typedef enum {
   /*! Parse Authority from later RFCs (no name compression) as RAW */
   ARES_DNS_PARSE_NS_EXT_RAW = 1 << 4,
   /*! Parse Additional from later RFCs (no name compression) as RAW */
-  ARES_DNS_PARSE_AR_EXT_RAW = 1 << 5
+  ARES_DNS_PARSE_AR_EXT_RAW = 1 << 5,
+  /*! Allocate all memory for the record from a single block that is freed
+   *  at once, rather than separately for each value.  The record may still
+   *  be modified, but memory for replaced or removed values isn't reclaimed
+   *  until it is destroyed. */
+  ARES_DNS_PARSE_ARENA = 1 << 6,
+  /*! Only check the structure of resource records when parsing, decoding
+   *  each one the first time it is retrieved with ares_dns_record_rr_get().
+   *  A resource record with malformed contents is then returned as NULL.
+   *  ares_dns_record_rr_cnt() decodes the whole section and drops any
+   *  malformed resource records, so every one counted can be retrieved.
+   *  As decoding modifies the record, even the const accessors must not be
+   *  used on it from multiple threads at once. */
+  ARES_DNS_PARSE_LAZY = 1 << 7
 } ares_dns_parse_flags_t;
 
 /*! String representation of DNS Record Type
@@ -63,60 +63,65 @@ static ares_bool_t ares_ai_has_family(int                              aftype,
   return ARES_FALSE;
 }
 
-ares_status_t ares_append_ai_node(int aftype, unsigned short port,
-                                  unsigned int ttl, const void *adata,
-                                  struct ares_addrinfo_node **nodes)
+void ares_addrinfo_set_addr(struct ares_addrinfo_node *node, void *sa,
+                            int aftype, unsigned short port, unsigned int ttl,
+                            const void *adata)
 {
-  struct ares_addrinfo_node *node;
-  struct sockaddr           *sa;
-  socklen_t                  salen;
-
   if (aftype == AF_INET) {
-    struct sockaddr_in *sin = ares_malloc(sizeof(*sin));
-    if (!sin) {
-      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
-    }
+    struct sockaddr_in *sin = sa;
 
     memset(sin, 0, sizeof(*sin));
     memcpy(&sin->sin_addr.s_addr, adata, sizeof(sin->sin_addr.s_addr));
-    sin->sin_family = AF_INET;
-    sin->sin_port   = htons(port);
-
-    sa    = (struct sockaddr *)sin;
-    salen = sizeof(*sin);
-  } else if (aftype == AF_INET6) {
-    struct sockaddr_in6 *sin6 = ares_malloc(sizeof(*sin6));
-    if (!sin6) {
-      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
-    }
+    sin->sin_family  = AF_INET;
+    sin->sin_port    = htons(port);
+    node->ai_addrlen = sizeof(*sin);
+  } else {
+    struct sockaddr_in6 *sin6 = sa;
 
     memset(sin6, 0, sizeof(*sin6));
     memcpy(&sin6->sin6_addr.s6_addr, adata, sizeof(sin6->sin6_addr.s6_addr));
     sin6->sin6_family = AF_INET6;
     sin6->sin6_port   = htons(port);
+    node->ai_addrlen  = sizeof(*sin6);
+  }
+
+  node->ai_addr   = sa;
+  node->ai_family = aftype;
+  node->ai_ttl    = (int)ttl;
+}
 
-    sa    = (struct sockaddr *)sin6;
-    salen = sizeof(*sin6);
+ares_status_t ares_append_ai_node(int aftype, unsigned short port,
+                                  unsigned int ttl, const void *adata,
+                                  ares_arena_t               *arena,
+                                  struct ares_addrinfo_node **nodes)
+{
+  struct ares_addrinfo_node *node;
+  void                      *sa;
+
+  if (aftype == AF_INET) {
+    sa = ares_arena_alloc(arena, sizeof(struct sockaddr_in));
+  } else if (aftype == AF_INET6) {
+    sa = ares_arena_alloc(arena, sizeof(struct sockaddr_in6));
   } else {
     return ARES_EFORMERR;
   }
 
-  node = ares_append_addrinfo_node(nodes);
-  if (!node) {
-    ares_free(sa);      /* LCOV_EXCL_LINE: OutOfMemory */
+  if (sa == NULL) {
     return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
   }
 
-  node->ai_addr    = sa;
-  node->ai_family  = aftype;
-  node->ai_addrlen = salen;
-  node->ai_ttl     = (int)ttl;
+  node = ares_append_addrinfo_node(arena, nodes);
+  if (!node) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
 
+  ares_addrinfo_set_addr(node, sa, aftype, port, ttl, adata);
   return ARES_SUCCESS;
 }
 
 static ares_status_t
   ares_default_loopback_addrs(int aftype, unsigned short port,
+                              ares_arena_t               *arena,
                               struct ares_addrinfo_node **nodes)
 {
   ares_status_t status = ARES_SUCCESS;
@@ -125,7 +130,7 @@ static ares_status_t
       !ares_ai_has_family(AF_INET6, *nodes)) {
     struct ares_in6_addr addr6;
     ares_inet_pton(AF_INET6, "::1", &addr6);
-    status = ares_append_ai_node(AF_INET6, port, 0, &addr6, nodes);
+    status = ares_append_ai_node(AF_INET6, port, 0, &addr6, arena, nodes);
     if (status != ARES_SUCCESS) {
       return status; /* LCOV_EXCL_LINE: OutOfMemory */
     }
@@ -135,7 +140,7 @@ static ares_status_t
       !ares_ai_has_family(AF_INET, *nodes)) {
     struct in_addr addr4;
     ares_inet_pton(AF_INET, "127.0.0.1", &addr4);
-    status = ares_append_ai_node(AF_INET, port, 0, &addr4, nodes);
+    status = ares_append_ai_node(AF_INET, port, 0, &addr4, arena, nodes);
     if (status != ARES_SUCCESS) {
       return status; /* LCOV_EXCL_LINE: OutOfMemory */
     }
@@ -146,6 +151,7 @@ static ares_status_t
 
 static ares_status_t
   ares_system_loopback_addrs(int aftype, unsigned short port,
+                             ares_arena_t               *arena,
                              struct ares_addrinfo_node **nodes)
 {
 #if defined(USE_WINSOCK) && defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0600 && \
@@ -170,12 +176,14 @@ static ares_status_t
         !ares_ai_has_family(AF_INET, *nodes)) {
       status =
         ares_append_ai_node(table->Table[i].Address.si_family, port, 0,
-                            &table->Table[i].Address.Ipv4.sin_addr, nodes);
+                            &table->Table[i].Address.Ipv4.sin_addr, arena,
+                            nodes);
     } else if (table->Table[i].Address.si_family == AF_INET6 &&
                !ares_ai_has_family(AF_INET6, *nodes)) {
       status =
         ares_append_ai_node(table->Table[i].Address.si_family, port, 0,
-                            &table->Table[i].Address.Ipv6.sin6_addr, nodes);
+                            &table->Table[i].Address.Ipv6.sin6_addr, arena,
+                            nodes);
     } else {
       /* Ignore any others */
       continue;
@@ -194,7 +202,6 @@ fail:
   FreeMibTable(table);
 
   if (status != ARES_SUCCESS) {
-    ares_freeaddrinfo_nodes(*nodes);
     *nodes = NULL;
   }
 
@@ -203,6 +210,7 @@ fail:
 #else
   (void)aftype;
   (void)port;
+  (void)arena;
   (void)nodes;
   /* Not supported on any other OS at this time */
   return ARES_ENOTFOUND;
@@ -211,6 +219,7 @@ fail:
 
 ares_status_t ares_addrinfo_localhost(const char *name, unsigned short port,
                                       const struct ares_addrinfo_hints *hints,
+                                      ares_arena_t                     *arena,
                                       struct ares_addrinfo             *ai)
 {
   ares_status_t status;
@@ -225,21 +234,20 @@ ares_status_t ares_addrinfo_localhost(const char *name, unsigned short port,
       return ARES_EBADFAMILY; /* LCOV_EXCL_LINE: DefensiveCoding */
   }
 
-  if (ai->name != NULL) {
-    ares_free(ai->name);
-  }
-  ai->name = ares_strdup(name);
+  ai->name = ares_arena_strdup(arena, name);
   if (ai->name == NULL) {
     status = ARES_ENOMEM;
     goto done; /* LCOV_EXCL_LINE: OutOfMemory */
   }
 
-  status = ares_system_loopback_addrs(hints->ai_family, port, &ai->nodes);
+  status = ares_system_loopback_addrs(hints->ai_family, port, arena,
+                                      &ai->nodes);
   if (status != ARES_SUCCESS && status != ARES_ENOTFOUND) {
     goto done;
   }
 
-  status = ares_default_loopback_addrs(hints->ai_family, port, &ai->nodes);
+  status = ares_default_loopback_addrs(hints->ai_family, port, arena,
+                                       &ai->nodes);
 
 done:
   return status;
@@ -0,0 +1,143 @@
+/* MIT License
+ *
+ * Copyright (c) The c-ares project and its contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ares_private.h"
+
+#ifdef HAVE_NETDB_H
+#  include <netdb.h>
+#endif
+
+/* Results handed out by c-ares are copied into a single allocation so the
+ * caller's ares_freeaddrinfo() is a single free.  The struct comes first,
+ * followed by the nodes with their addresses, the cnames with their strings
+ * and finally the name. */
+
+/* Keep each member of a packed result suitably aligned for pointers */
+#define ARES_AI_PACK_ALIGN(len) \
+  (((len) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+struct ares_addrinfo *ares_addrinfo_create(ares_arena_t *arena)
+{
+  return ares_arena_alloc_zero(arena, sizeof(struct ares_addrinfo));
+}
+
+static void *ares_addrinfo_pack_take(unsigned char **ptr, size_t len)
+{
+  void *out = *ptr;
+  *ptr     += ARES_AI_PACK_ALIGN(len);
+  return out;
+}
+
+static size_t ares_addrinfo_pack_strlen(const char *str)
+{
+  if (str == NULL) {
+    return 0;
+  }
+  return ARES_AI_PACK_ALIGN(ares_strlen(str) + 1);
+}
+
+static char *ares_addrinfo_pack_str(unsigned char **ptr, const char *str)
+{
+  char  *out;
+  size_t len;
+
+  if (str == NULL) {
+    return NULL;
+  }
+
+  len = ares_strlen(str) + 1;
+  out = ares_addrinfo_pack_take(ptr, len);
+  memcpy(out, str, len);
+  return out;
+}
+
+struct ares_addrinfo *ares_addrinfo_pack(const struct ares_addrinfo *ai)
+{
+  const struct ares_addrinfo_node  *node;
+  const struct ares_addrinfo_cname *cname;
+  struct ares_addrinfo_node       **next_node;
+  struct ares_addrinfo_cname      **next_cname;
+  struct ares_addrinfo             *packed;
+  unsigned char                    *ptr;
+  size_t len = ARES_AI_PACK_ALIGN(sizeof(*packed));
+
+  if (ai == NULL) {
+    return NULL;
+  }
+
+  /* Counting pass to size the single allocation */
+  for (node = ai->nodes; node != NULL; node = node->ai_next) {
+    len += ARES_AI_PACK_ALIGN(sizeof(*node));
+    if (node->ai_addr != NULL) {
+      len += ARES_AI_PACK_ALIGN((size_t)node->ai_addrlen);
+    }
+  }
+  for (cname = ai->cnames; cname != NULL; cname = cname->next) {
+    len += ARES_AI_PACK_ALIGN(sizeof(*cname));
+    len += ares_addrinfo_pack_strlen(cname->alias);
+    len += ares_addrinfo_pack_strlen(cname->name);
+  }
+  len += ares_addrinfo_pack_strlen(ai->name);
+
+  packed = ares_malloc_zero(len);
+  if (packed == NULL) {
+    return NULL; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+  ptr = (unsigned char *)packed + ARES_AI_PACK_ALIGN(sizeof(*packed));
+
+  next_node = &packed->nodes;
+  for (node = ai->nodes; node != NULL; node = node->ai_next) {
+    struct ares_addrinfo_node *copy =
+      ares_addrinfo_pack_take(&ptr, sizeof(*copy));
+
+    *copy         = *node;
+    copy->ai_next = NULL;
+    if (node->ai_addr != NULL) {
+      copy->ai_addr =
+        ares_addrinfo_pack_take(&ptr, (size_t)node->ai_addrlen);
+      memcpy(copy->ai_addr, node->ai_addr, (size_t)node->ai_addrlen);
+    }
+    *next_node = copy;
+    next_node  = &copy->ai_next;
+  }
+
+  next_cname = &packed->cnames;
+  for (cname = ai->cnames; cname != NULL; cname = cname->next) {
+    struct ares_addrinfo_cname *copy =
+      ares_addrinfo_pack_take(&ptr, sizeof(*copy));
+
+    copy->ttl   = cname->ttl;
+    copy->alias = ares_addrinfo_pack_str(&ptr, cname->alias);
+    copy->name  = ares_addrinfo_pack_str(&ptr, cname->name);
+    copy->next  = NULL;
+    *next_cname = copy;
+    next_cname  = &copy->next;
+  }
+
+  packed->name = ares_addrinfo_pack_str(&ptr, ai->name);
+
+  return packed;
+}
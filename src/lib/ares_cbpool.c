@@ -0,0 +1,368 @@
+/* MIT License
+ *
+ * Copyright (c) The c-ares project and its contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "ares_private.h"
+
+/* IMPLEMENTATION NOTES
+ * ====================
+ *
+ * User callbacks are normally invoked inline, on whatever thread completed the
+ * query, while the channel lock is held.  When the event thread is in use,
+ * a slow user callback therefore stalls all socket processing for the
+ * channel.
+ *
+ * When callback offloading is enabled, the public entrypoints wrap the user
+ * callback with one of the trampolines below.  When the trampoline is invoked
+ * it takes ownership of (or duplicates) the result and enqueues a job to a
+ * small pool of worker threads which then invoke the user callback without
+ * the channel lock held.
+ *
+ * Offloaded completions are still considered in-flight for the purposes of
+ * ares_queue_active_queries() and ares_queue_wait_empty(), the pending count
+ * is protected by the channel lock and is only decremented once the user
+ * callback has returned.
+ *
+ * The pool is bounded.  If the number of pending completions reaches the
+ * configured maximum, the completion is delivered inline instead so there is
+ * never any unbounded memory growth nor any blocking of the thread delivering
+ * the completion.
+ */
+
+typedef void (*ares_cbpool_job_cb_t)(void *data);
+
+typedef struct {
+  ares_cbpool_job_cb_t cb;
+  void                *data;
+} ares_cbpool_job_t;
+
+struct ares_cbpool {
+  ares_channel_t      *channel;
+  ares_thread_mutex_t *mutex;
+  ares_thread_cond_t  *cond;
+  /*! FIFO of ares_cbpool_job_t waiting to be run */
+  ares_array_t        *jobs;
+  /*! Number of jobs enqueued or running, protected by the channel lock */
+  size_t               pending;
+  /*! Maximum number of pending jobs before falling back to inline delivery */
+  size_t               max_pending;
+  ares_thread_t      **threads;
+  size_t               nthreads;
+  ares_bool_t          isup;
+};
+
+static void *ares_cbpool_thread(void *arg)
+{
+  ares_cbpool_t *pool = arg;
+
+  ares_thread_mutex_lock(pool->mutex);
+  while (1) {
+    ares_cbpool_job_t job;
+
+    if (ares_array_len(pool->jobs) == 0) {
+      /* Only exit once the queue has been drained so every completion is
+       * delivered before the channel is destroyed */
+      if (!pool->isup) {
+        break;
+      }
+      ares_thread_cond_wait(pool->cond, pool->mutex);
+      continue;
+    }
+
+    if (ares_array_claim_at(&job, sizeof(job), pool->jobs, 0) !=
+        ARES_SUCCESS) {
+      continue; /* LCOV_EXCL_LINE: DefensiveCoding */
+    }
+    ares_thread_mutex_unlock(pool->mutex);
+
+    job.cb(job.data);
+
+    ares_channel_lock(pool->channel);
+    pool->pending--;
+    ares_queue_notify_empty(pool->channel);
+    ares_channel_unlock(pool->channel);
+
+    ares_thread_mutex_lock(pool->mutex);
+  }
+  ares_thread_mutex_unlock(pool->mutex);
+
+  return NULL;
+}
+
+void ares_cbpool_drain(ares_cbpool_t *pool)
+{
+  size_t i;
+
+  if (pool == NULL) {
+    return;
+  }
+
+  /* Tell the workers to shut down once the queue is drained, enqueuing fails
+   * from here on */
+  ares_thread_mutex_lock(pool->mutex);
+  pool->isup = ARES_FALSE;
+  ares_thread_cond_broadcast(pool->cond);
+  ares_thread_mutex_unlock(pool->mutex);
+
+  for (i = 0; i < pool->nthreads; i++) {
+    void *rv = NULL;
+    ares_thread_join(pool->threads[i], &rv);
+  }
+  pool->nthreads = 0;
+}
+
+void ares_cbpool_destroy(ares_cbpool_t *pool)
+{
+  if (pool == NULL) {
+    return;
+  }
+
+  ares_cbpool_drain(pool);
+  ares_free(pool->threads);
+
+  ares_array_destroy(pool->jobs);
+  ares_thread_cond_destroy(pool->cond);
+  ares_thread_mutex_destroy(pool->mutex);
+  ares_free(pool);
+}
+
+ares_status_t ares_cbpool_create(ares_channel_t *channel, size_t nthreads,
+                                 size_t max_pending, ares_cbpool_t **pool_out)
+{
+  ares_cbpool_t *pool;
+  ares_status_t  status = ARES_SUCCESS;
+
+  *pool_out = NULL;
+
+  if (!ares_threadsafety()) {
+    return ARES_ENOTIMP;
+  }
+
+  pool = ares_malloc_zero(sizeof(*pool));
+  if (pool == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  pool->channel     = channel;
+  pool->max_pending = max_pending;
+  pool->isup        = ARES_TRUE;
+
+  pool->mutex = ares_thread_mutex_create();
+  pool->cond  = ares_thread_cond_create();
+  pool->jobs  = ares_array_create(sizeof(ares_cbpool_job_t), NULL);
+  pool->threads =
+    ares_malloc_zero((nthreads == 0 ? 1 : nthreads) * sizeof(*pool->threads));
+  if (pool->mutex == NULL || pool->cond == NULL || pool->jobs == NULL ||
+      pool->threads == NULL) {
+    status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  if (nthreads == 0) {
+    nthreads = 1;
+  }
+
+  while (pool->nthreads < nthreads) {
+    status = ares_thread_create(&pool->threads[pool->nthreads],
+                                ares_cbpool_thread, pool);
+    if (status != ARES_SUCCESS) {
+      goto done; /* LCOV_EXCL_LINE: UntestablePath */
+    }
+    pool->nthreads++;
+  }
+
+done:
+  if (status != ARES_SUCCESS) {
+    ares_cbpool_destroy(pool);
+    return status;
+  }
+
+  *pool_out = pool;
+  return ARES_SUCCESS;
+}
+
+size_t ares_cbpool_pending(const ares_cbpool_t *pool)
+{
+  if (pool == NULL) {
+    return 0;
+  }
+  return pool->pending;
+}
+
+/* Returns ARES_FALSE if the job could not be enqueued, in which case the
+ * caller must deliver the completion itself */
+static ares_bool_t ares_cbpool_enqueue(ares_cbpool_t *pool,
+                                       ares_cbpool_job_cb_t cb, void *data)
+{
+  ares_cbpool_job_t job;
+  ares_bool_t       rv = ARES_FALSE;
+
+  job.cb   = cb;
+  job.data = data;
+
+  ares_channel_lock(pool->channel);
+
+  if (pool->max_pending && pool->pending >= pool->max_pending) {
+    goto done;
+  }
+
+  ares_thread_mutex_lock(pool->mutex);
+  if (pool->isup &&
+      ares_array_insertdata_last(pool->jobs, &job) == ARES_SUCCESS) {
+    ares_thread_cond_signal(pool->cond);
+    rv = ARES_TRUE;
+  }
+  ares_thread_mutex_unlock(pool->mutex);
+
+  if (rv) {
+    pool->pending++;
+  }
+
+done:
+  ares_channel_unlock(pool->channel);
+  return rv;
+}
+
+typedef struct {
+  ares_cbpool_t       *pool;
+  ares_callback_dnsrec callback;
+  void                *arg;
+  ares_status_t        status;
+  size_t               timeouts;
+  ares_dns_record_t   *dnsrec;
+} ares_cbpool_dnsrec_t;
+
+static void ares_cbpool_dnsrec_run(void *data)
+{
+  ares_cbpool_dnsrec_t *w = data;
+
+  w->callback(w->arg, w->status, w->timeouts, w->dnsrec);
+  ares_dns_record_destroy(w->dnsrec);
+  ares_free(w);
+}
+
+static void ares_cbpool_dnsrec_cb(void *arg, ares_status_t status,
+                                  size_t                   timeouts,
+                                  const ares_dns_record_t *dnsrec)
+{
+  ares_cbpool_dnsrec_t *w = arg;
+
+  w->status   = status;
+  w->timeouts = timeouts;
+
+  /* The record is only valid for the duration of the callback */
+  if (dnsrec != NULL) {
+    w->dnsrec = ares_dns_record_duplicate(dnsrec);
+  }
+
+  if ((dnsrec == NULL || w->dnsrec != NULL) &&
+      ares_cbpool_enqueue(w->pool, ares_cbpool_dnsrec_run, w)) {
+    return;
+  }
+
+  /* Deliver inline */
+  w->callback(w->arg, status, timeouts, dnsrec);
+  ares_dns_record_destroy(w->dnsrec);
+  ares_free(w);
+}
+
+ares_status_t ares_cbpool_wrap_dnsrec(const ares_channel_t *channel,
+                                      ares_callback_dnsrec *callback,
+                                      void                **arg)
+{
+  ares_cbpool_dnsrec_t *w;
+
+  if (channel->cbpool == NULL || *callback == NULL) {
+    return ARES_SUCCESS;
+  }
+
+  w = ares_malloc_zero(sizeof(*w));
+  if (w == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  w->pool     = channel->cbpool;
+  w->callback = *callback;
+  w->arg      = *arg;
+  *callback   = ares_cbpool_dnsrec_cb;
+  *arg        = w;
+  return ARES_SUCCESS;
+}
+
+typedef struct {
+  ares_cbpool_t         *pool;
+  ares_addrinfo_callback callback;
+  void                  *arg;
+  int                    status;
+  int                    timeouts;
+  struct ares_addrinfo  *ai;
+} ares_cbpool_addrinfo_t;
+
+static void ares_cbpool_addrinfo_run(void *data)
+{
+  ares_cbpool_addrinfo_t *w = data;
+
+  w->callback(w->arg, w->status, w->timeouts, w->ai);
+  ares_free(w);
+}
+
+static void ares_cbpool_addrinfo_cb(void *arg, int status, int timeouts,
+                                    struct ares_addrinfo *res)
+{
+  ares_cbpool_addrinfo_t *w = arg;
+
+  /* Ownership of the result is passed to the callback, so no copy needed */
+  w->status   = status;
+  w->timeouts = timeouts;
+  w->ai       = res;
+
+  if (ares_cbpool_enqueue(w->pool, ares_cbpool_addrinfo_run, w)) {
+    return;
+  }
+
+  ares_cbpool_addrinfo_run(w);
+}
+
+ares_status_t ares_cbpool_wrap_addrinfo(const ares_channel_t   *channel,
+                                        ares_addrinfo_callback *callback,
+                                        void                  **arg)
+{
+  ares_cbpool_addrinfo_t *w;
+
+  if (channel->cbpool == NULL || *callback == NULL) {
+    return ARES_SUCCESS;
+  }
+
+  w = ares_malloc_zero(sizeof(*w));
+  if (w == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  w->pool     = channel->cbpool;
+  w->callback = *callback;
+  w->arg      = *arg;
+  *callback   = ares_cbpool_addrinfo_cb;
+  *arg        = w;
+  return ARES_SUCCESS;
+}
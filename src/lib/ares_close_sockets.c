@@ -68,6 +68,7 @@ void ares_close_connection(ares_conn_t *conn, ares_status_t requeue_status)
   ares_socket_close(channel, conn->fd);
 
   ares_free(conn);
+  channel->conn_generation++;
 }
 
 void ares_close_sockets(ares_server_t *server)
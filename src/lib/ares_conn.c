@@ -364,6 +364,7 @@ ares_status_t ares_open_connection(ares_conn_t   **conn_out,
   conn->flags           = is_tcp ? ARES_CONN_FLAG_TCP : ARES_CONN_FLAG_NONE;
   conn->out_buf         = ares_buf_create();
   conn->in_buf          = ares_buf_create();
+  conn->generation      = channel->conn_generation;
 
   if (conn->queries_to_conn == NULL || conn->out_buf == NULL ||
       conn->in_buf == NULL) {
@@ -509,3 +510,16 @@ ares_conn_t *ares_conn_from_fd(const ares_channel_t *channel, ares_socket_t fd)
 
   return ares_llist_node_val(node);
 }
+
+ares_conn_t *ares_conn_revalidate(const ares_channel_t *channel,
+                                  ares_socket_t fd, const ares_conn_t *conn,
+                                  size_t generation)
+{
+  ares_conn_t *found = ares_conn_from_fd(channel, fd);
+
+  if (found == NULL || found != conn || found->generation != generation) {
+    return NULL;
+  }
+
+  return found;
+}
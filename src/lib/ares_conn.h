@@ -84,6 +84,9 @@ struct ares_conn {
 
   /* list of outstanding queries to this connection */
   ares_llist_t           *queries_to_conn;
+
+  /*! Channel's conn_generation when this connection was opened */
+  size_t                  generation;
 };
 
 /*! Various buckets for grouping history */
@@ -185,6 +188,11 @@ ares_status_t ares_conn_flush(ares_conn_t *conn);
 ares_conn_err_t ares_conn_read(ares_conn_t *conn, void *data, size_t len,
                                size_t *read_bytes);
 ares_conn_t *ares_conn_from_fd(const ares_channel_t *channel, ares_socket_t fd);
+/*! Look up the connection for fd, as long as it is still the connection conn
+ *  of the given generation and not another one reusing its memory or fd */
+ares_conn_t *ares_conn_revalidate(const ares_channel_t *channel,
+                                  ares_socket_t fd, const ares_conn_t *conn,
+                                  size_t generation);
 void ares_conn_sock_state_cb_update(ares_conn_t            *conn,
                                     ares_conn_state_flags_t flags);
 ares_conn_err_t ares_socket_recv(ares_channel_t *channel, ares_socket_t s,
@@ -29,10 +29,27 @@
 #include "event/ares_event.h"
 #include <assert.h>
 
+/* Fail every outstanding query with ARES_EDESTRUCTION.  Must be called with
+ * the channel lock held. */
+static void ares_destroy_queries(ares_channel_t *channel)
+{
+  ares_llist_node_t *node = ares_llist_node_first(channel->all_queries);
+
+  while (node != NULL) {
+    ares_llist_node_t *next  = ares_llist_node_next(node);
+    ares_query_t      *query = ares_llist_node_claim(node);
+
+    query->node_all_queries = NULL;
+    query->callback(query->arg, ARES_EDESTRUCTION, 0, NULL);
+    ares_free_query(query);
+
+    node = next;
+  }
+}
+
 void ares_destroy(ares_channel_t *channel)
 {
-  size_t             i;
-  ares_llist_node_t *node = NULL;
+  size_t i;
 
   if (channel == NULL) {
     return;
@@ -54,6 +71,7 @@ void ares_destroy(ares_channel_t *channel)
     if (e && e->configchg) {
       ares_event_configchg_destroy(e->configchg);
       e->configchg = NULL;
+      ares_sysconfig_watch_stop();
     }
   }
 
@@ -68,19 +86,18 @@ void ares_destroy(ares_channel_t *channel)
   /* Lock because callbacks will be triggered, and any system-generated
    * callbacks need to hold a channel lock. */
   ares_channel_lock(channel);
+  ares_destroy_queries(channel);
+  ares_channel_unlock(channel);
 
-  /* Destroy all queries */
-  node = ares_llist_node_first(channel->all_queries);
-  while (node != NULL) {
-    ares_llist_node_t *next  = ares_llist_node_next(node);
-    ares_query_t      *query = ares_llist_node_claim(node);
+  /* Deliver any outstanding offloaded callbacks and shut down the workers
+   * while the servers and event thread are still around, as the callbacks may
+   * still use the channel.  Anything they queued is failed below, with the
+   * completions delivered inline, and nothing new is accepted from here on. */
+  ares_cbpool_drain(channel->cbpool);
 
-    query->node_all_queries = NULL;
-    query->callback(query->arg, ARES_EDESTRUCTION, 0, NULL);
-    ares_free_query(query);
-
-    node = next;
-  }
+  ares_channel_lock(channel);
+  channel->destroying = ARES_TRUE;
+  ares_destroy_queries(channel);
 
   ares_queue_notify_empty(channel);
 
@@ -107,6 +124,10 @@ void ares_destroy(ares_channel_t *channel)
     ares_event_thread_destroy(channel);
   }
 
+  /* Only now is nothing left referring to the pool */
+  ares_cbpool_destroy(channel->cbpool);
+  channel->cbpool = NULL;
+
   if (channel->domains) {
     for (i = 0; i < channel->ndomains; i++) {
       ares_free(channel->domains[i]);
@@ -123,11 +144,14 @@ void ares_destroy(ares_channel_t *channel)
   ares_free(channel->lookups);
   ares_free(channel->resolvconf_path);
   ares_free(channel->hosts_path);
+  ares_free(channel->qcache_shm_path);
   ares_destroy_rand_state(channel->rand_state);
 
   ares_hosts_file_destroy(channel->hf);
 
   ares_qcache_destroy(channel->qcache);
+  ares_srcaddr_cache_flush(channel);
+  ares_search_negcache_flush(channel);
 
   ares_channel_threading_destroy(channel);
 
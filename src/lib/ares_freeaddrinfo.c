@@ -31,37 +31,9 @@
 #  include <netdb.h>
 #endif
 
-void ares_freeaddrinfo_cnames(struct ares_addrinfo_cname *head)
-{
-  struct ares_addrinfo_cname *current;
-  while (head) {
-    current = head;
-    head    = head->next;
-    ares_free(current->alias);
-    ares_free(current->name);
-    ares_free(current);
-  }
-}
-
-void ares_freeaddrinfo_nodes(struct ares_addrinfo_node *head)
-{
-  struct ares_addrinfo_node *current;
-  while (head) {
-    current = head;
-    head    = head->ai_next;
-    ares_free(current->ai_addr);
-    ares_free(current);
-  }
-}
-
 void ares_freeaddrinfo(struct ares_addrinfo *ai)
 {
-  if (ai == NULL) {
-    return;
-  }
-  ares_freeaddrinfo_cnames(ai->cnames);
-  ares_freeaddrinfo_nodes(ai->nodes);
-
-  ares_free(ai->name);
+  /* Results are always handed out by ares_addrinfo_pack(), so everything
+   * lives in the one allocation */
   ares_free(ai);
 }
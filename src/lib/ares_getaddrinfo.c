@@ -58,6 +58,27 @@
 
 #include "ares_dns.h"
 
+typedef struct {
+  ares_addrinfo_stream_callback callback;
+  void                         *arg;
+} ares_addrinfo_stream_t;
+
+struct host_query;
+
+/* State of a single candidate name when searching in parallel */
+typedef struct {
+  struct host_query    *hquery;
+  ares_arena_t         *arena;     /* backs ai */
+  struct ares_addrinfo *ai;        /* results for this name only */
+  unsigned short        qid_a;
+  unsigned short        qid_aaaa;
+  size_t                remaining; /* number of DNS answers waiting for */
+  ares_bool_t           done;
+  ares_bool_t           is_final;  /* result ends the search */
+  ares_bool_t           partial_sent; /* streamed addresses from ai */
+  ares_status_t         status;
+} host_candidate_t;
+
 struct host_query {
   ares_channel_t            *channel;
   char                      *name;
@@ -76,6 +97,7 @@ struct host_query {
   size_t      names_cnt;
   size_t      next_name_idx;       /* next name index being attempted */
 
+  ares_arena_t         *arena;     /* backs ai */
   struct ares_addrinfo *ai;        /* store results between lookups */
   unsigned short        qid_a;     /* qid for A request */
   unsigned short        qid_aaaa;  /* qid for AAAA request */
@@ -84,6 +106,17 @@ struct host_query {
 
   /* Track nodata responses to possibly override final result */
   size_t                nodata_cnt;
+
+  /* Set by ares_getaddrinfo_stream() to deliver the first address family to
+   * answer without waiting on the other */
+  ares_addrinfo_stream_t *stream;
+  ares_bool_t             partial_sent;
+
+  /* ARES_FLAG_PARALLEL_SEARCH state, one candidate per name */
+  host_candidate_t *candidates;
+  size_t            refcnt;        /* outstanding queries plus active caller */
+  ares_bool_t       parallel_done; /* result of parallel lookup determined */
+  ares_bool_t       ended;         /* user callback has been invoked */
 };
 
 static const struct ares_addrinfo_hints default_hints = {
@@ -95,11 +128,14 @@ static const struct ares_addrinfo_hints default_hints = {
 
 /* forward declarations */
 static ares_bool_t next_dns_lookup(struct host_query *hquery);
+static void        next_lookup(struct host_query *hquery, ares_status_t status);
 
 struct ares_addrinfo_cname *
-  ares_append_addrinfo_cname(struct ares_addrinfo_cname **head)
+  ares_append_addrinfo_cname(ares_arena_t                *arena,
+                             struct ares_addrinfo_cname **head)
 {
-  struct ares_addrinfo_cname *tail = ares_malloc_zero(sizeof(*tail));
+  struct ares_addrinfo_cname *tail =
+    ares_arena_alloc_zero(arena, sizeof(*tail));
   struct ares_addrinfo_cname *last = *head;
 
   if (tail == NULL) {
@@ -137,9 +173,11 @@ void ares_addrinfo_cat_cnames(struct ares_addrinfo_cname **head,
 
 /* Allocate new addrinfo and append to the tail. */
 struct ares_addrinfo_node *
-  ares_append_addrinfo_node(struct ares_addrinfo_node **head)
+  ares_append_addrinfo_node(ares_arena_t               *arena,
+                            struct ares_addrinfo_node **head)
 {
-  struct ares_addrinfo_node *tail = ares_malloc_zero(sizeof(*tail));
+  struct ares_addrinfo_node *tail =
+    ares_arena_alloc_zero(arena, sizeof(*tail));
   struct ares_addrinfo_node *last = *head;
 
   if (tail == NULL) {
@@ -178,7 +216,8 @@ void ares_addrinfo_cat_nodes(struct ares_addrinfo_node **head,
 /* Resolve service name into port number given in host byte order.
  * If not resolved, return 0.
  */
-static unsigned short lookup_service(const char *service, int flags)
+static unsigned short lookup_service(const ares_channel_t *channel,
+                                     const char *service, int flags)
 {
   const char     *proto;
   struct servent *sep;
@@ -197,6 +236,17 @@ static unsigned short lookup_service(const char *service, int flags)
     } else {
       proto = "tcp";
     }
+
+    if (channel->flags & ARES_FLAG_SERVICES_CACHE) {
+      unsigned short port = 0;
+      ares_status_t  status;
+
+      status = ares_services_port(service, proto, &port);
+      if (status != ARES_ENOTIMP) {
+        return port;
+      }
+    }
+
 #ifdef HAVE_GETSERVBYNAME_R
     memset(&se, 0, sizeof(se));
     sep = &se;
@@ -235,6 +285,7 @@ static unsigned short lookup_service(const char *service, int flags)
  */
 static ares_bool_t fake_addrinfo(const char *name, unsigned short port,
                                  const struct ares_addrinfo_hints *hints,
+                                 ares_arena_t                     *arena,
                                  struct ares_addrinfo             *ai,
                                  ares_addrinfo_callback callback, void *arg)
 {
@@ -271,9 +322,9 @@ static ares_bool_t fake_addrinfo(const char *name, unsigned short port,
       result =
         ares_inet_pton(AF_INET, name, &addr4) < 1 ? ARES_FALSE : ARES_TRUE;
       if (result) {
-        status = ares_append_ai_node(AF_INET, port, 0, &addr4, &ai->nodes);
+        status =
+          ares_append_ai_node(AF_INET, port, 0, &addr4, arena, &ai->nodes);
         if (status != ARES_SUCCESS) {
-          ares_freeaddrinfo(ai);
           callback(arg, (int)status, 0, NULL); /* LCOV_EXCL_LINE: OutOfMemory */
           return ARES_TRUE;                    /* LCOV_EXCL_LINE: OutOfMemory */
         }
@@ -286,9 +337,9 @@ static ares_bool_t fake_addrinfo(const char *name, unsigned short port,
     result =
       ares_inet_pton(AF_INET6, name, &addr6) < 1 ? ARES_FALSE : ARES_TRUE;
     if (result) {
-      status = ares_append_ai_node(AF_INET6, port, 0, &addr6, &ai->nodes);
+      status =
+        ares_append_ai_node(AF_INET6, port, 0, &addr6, arena, &ai->nodes);
       if (status != ARES_SUCCESS) {
-        ares_freeaddrinfo(ai);
         callback(arg, (int)status, 0, NULL); /* LCOV_EXCL_LINE: OutOfMemory */
         return ARES_TRUE;                    /* LCOV_EXCL_LINE: OutOfMemory */
       }
@@ -300,19 +351,17 @@ static ares_bool_t fake_addrinfo(const char *name, unsigned short port,
   }
 
   if (hints->ai_flags & ARES_AI_CANONNAME) {
-    cname = ares_append_addrinfo_cname(&ai->cnames);
+    cname = ares_append_addrinfo_cname(arena, &ai->cnames);
     if (!cname) {
       /* LCOV_EXCL_START: OutOfMemory */
-      ares_freeaddrinfo(ai);
       callback(arg, ARES_ENOMEM, 0, NULL);
       return ARES_TRUE;
       /* LCOV_EXCL_STOP */
     }
 
     /* Duplicate the name, to avoid a constness violation. */
-    cname->name = ares_strdup(name);
+    cname->name = ares_arena_strdup(arena, name);
     if (!cname->name) {
-      ares_freeaddrinfo(ai);
       callback(arg, ARES_ENOMEM, 0, NULL);
       return ARES_TRUE;
     }
@@ -321,47 +370,103 @@ static ares_bool_t fake_addrinfo(const char *name, unsigned short port,
   ai->nodes->ai_socktype = hints->ai_socktype;
   ai->nodes->ai_protocol = hints->ai_protocol;
 
-  callback(arg, ARES_SUCCESS, 0, ai);
+  ai = ares_addrinfo_pack(ai);
+  callback(arg, ai == NULL ? ARES_ENOMEM : ARES_SUCCESS, 0, ai);
   return ARES_TRUE;
 }
 
-static void hquery_free(struct host_query *hquery, ares_bool_t cleanup_ai)
+static void hquery_free_candidates(struct host_query *hquery)
 {
-  if (cleanup_ai) {
-    ares_freeaddrinfo(hquery->ai);
+  size_t i;
+
+  if (hquery->candidates == NULL) {
+    return;
   }
+  for (i = 0; i < hquery->names_cnt; i++) {
+    ares_arena_destroy(hquery->candidates[i].arena);
+  }
+  ares_free(hquery->candidates);
+  hquery->candidates = NULL;
+}
+
+static void hquery_free(struct host_query *hquery)
+{
+  /* Anything delivered was a packed copy */
+  ares_arena_destroy(hquery->arena);
+  hquery_free_candidates(hquery);
   ares_strsplit_free(hquery->names, hquery->names_cnt);
   ares_free(hquery->name);
   ares_free(hquery->lookups);
   ares_free(hquery);
 }
 
-static void end_hquery(struct host_query *hquery, ares_status_t status)
+static void hquery_finalize_nodes(const struct host_query *hquery,
+                                  struct ares_addrinfo     *ai)
 {
   struct ares_addrinfo_node  sentinel;
   struct ares_addrinfo_node *next;
 
+  if (!(hquery->hints.ai_flags & ARES_AI_NOSORT) && ai->nodes) {
+    ares_timeval_t now;
+
+    ares_tvnow(&now);
+    sentinel.ai_next = ai->nodes;
+    ares_sortaddrinfo(hquery->channel, &sentinel, &now);
+    ai->nodes = sentinel.ai_next;
+  }
+
+  for (next = ai->nodes; next != NULL; next = next->ai_next) {
+    next->ai_socktype = hquery->hints.ai_socktype;
+    next->ai_protocol = hquery->hints.ai_protocol;
+  }
+}
+
+static void end_hquery(struct host_query *hquery, ares_status_t status)
+{
+  struct ares_addrinfo *ai = NULL;
+
   if (status == ARES_SUCCESS) {
-    if (!(hquery->hints.ai_flags & ARES_AI_NOSORT) && hquery->ai->nodes) {
-      sentinel.ai_next = hquery->ai->nodes;
-      ares_sortaddrinfo(hquery->channel, &sentinel);
-      hquery->ai->nodes = sentinel.ai_next;
+    hquery_finalize_nodes(hquery, hquery->ai);
+    ai = ares_addrinfo_pack(hquery->ai);
+    if (ai == NULL) {
+      status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
     }
-    next = hquery->ai->nodes;
+  }
 
-    while (next) {
-      next->ai_socktype = hquery->hints.ai_socktype;
-      next->ai_protocol = hquery->hints.ai_protocol;
-      next              = next->ai_next;
-    }
-  } else {
-    /* Clean up what we have collected by so far. */
-    ares_freeaddrinfo(hquery->ai);
-    hquery->ai = NULL;
+  hquery->callback(hquery->arg, (int)status, (int)hquery->timeouts, ai);
+
+  /* Outstanding parallel candidates still reference the query, the last one
+   * to complete releases it */
+  if (hquery->candidates != NULL) {
+    hquery->ended = ARES_TRUE;
+    return;
   }
+  hquery_free(hquery);
+}
 
-  hquery->callback(hquery->arg, (int)status, (int)hquery->timeouts, hquery->ai);
-  hquery_free(hquery, ARES_FALSE);
+/* Hand the addresses collected so far in src to a streaming caller while the
+ * other address family is still outstanding.  Returns ARES_FALSE if nothing
+ * was delivered. */
+static ares_bool_t send_partial(struct host_query    *hquery,
+                                struct ares_addrinfo *src)
+{
+  struct ares_addrinfo *ai;
+
+  hquery_finalize_nodes(hquery, src);
+  ai = ares_addrinfo_pack(src);
+  if (ai == NULL) {
+    return ARES_FALSE; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  /* Only what arrives from here on goes in the final result, what was
+   * delivered is left behind in the arena */
+  src->nodes  = NULL;
+  src->cnames = NULL;
+
+  hquery->partial_sent = ARES_TRUE;
+  hquery->stream->callback(hquery->stream->arg, ARES_SUCCESS,
+                           (int)hquery->timeouts, ai, ARES_TRUE);
+  return ARES_TRUE;
 }
 
 ares_bool_t ares_is_localhost(const char *name)
@@ -413,7 +518,7 @@ static ares_status_t file_lookup(struct host_query *hquery)
   status = ares_hosts_entry_to_addrinfo(
     entry, hquery->name, hquery->hints.ai_family, hquery->port,
     (hquery->hints.ai_flags & ARES_AI_CANONNAME) ? ARES_TRUE : ARES_FALSE,
-    hquery->ai);
+    hquery->arena, hquery->ai);
 
   if (status != ARES_SUCCESS) {
     goto done; /* LCOV_EXCL_LINE: OutOfMemory */
@@ -433,7 +538,7 @@ done:
    * condition pass it through to fill in any other address classes. */
   if (status != ARES_ENOMEM && ares_is_localhost(hquery->name)) {
     return ares_addrinfo_localhost(hquery->name, hquery->port, &hquery->hints,
-                                   hquery->ai);
+                                   hquery->arena, hquery->ai);
   }
 
   return status;
@@ -512,12 +617,14 @@ static void host_callback(void *arg, ares_status_t status, size_t timeouts,
   hquery->timeouts                 += timeouts;
   hquery->remaining--;
 
+  ares_search_negcache_update(hquery->channel, hquery->name, dnsrec);
+
   if (status == ARES_SUCCESS) {
     if (dnsrec == NULL) {
       addinfostatus = ARES_EBADRESP; /* LCOV_EXCL_LINE: DefensiveCoding */
     } else {
-      addinfostatus =
-        ares_parse_into_addrinfo(dnsrec, ARES_TRUE, hquery->port, hquery->ai);
+      addinfostatus = ares_parse_into_addrinfo(dnsrec, ARES_TRUE, hquery->port,
+                                               hquery->arena, hquery->ai);
     }
 
     /* We sent out ipv4 and ipv6 requests simultaneously.  If we got a
@@ -542,6 +649,16 @@ static void host_callback(void *arg, ares_status_t status, size_t timeouts,
     if (addinfostatus == ARES_SUCCESS && ai_has_ipv4(hquery->ai)) {
       terminate_retries(hquery, ares_dns_record_get_id(dnsrec));
     }
+
+    /* Streaming callers get this address family right away rather than
+     * waiting on the other one (RFC 8305 Section 3).  The callback may cancel
+     * or destroy, which would free hquery, so it must not be touched after
+     * this point. */
+    if (addinfostatus == ARES_SUCCESS && hquery->stream != NULL &&
+        hquery->remaining && hquery->ai->nodes != NULL &&
+        send_partial(hquery, hquery->ai)) {
+      return;
+    }
   }
 
   if (!hquery->remaining) {
@@ -550,6 +667,15 @@ static void host_callback(void *arg, ares_status_t status, size_t timeouts,
        * and return the appropriate status.  We won't return a partial
        * result in this case. */
       end_hquery(hquery, status);
+    } else if (hquery->partial_sent) {
+      /* Addresses were already delivered for this name, so don't move on to
+       * the next search domain, just report how the remaining query went */
+      if (hquery->ai->nodes) {
+        end_hquery(hquery, ARES_SUCCESS);
+      } else {
+        end_hquery(hquery,
+                   addinfostatus != ARES_SUCCESS ? addinfostatus : status);
+      }
     } else if (addinfostatus != ARES_SUCCESS && addinfostatus != ARES_ENODATA) {
       /* error in parsing result e.g. no memory */
       if (addinfostatus == ARES_EBADRESP && hquery->ai->nodes) {
@@ -582,6 +708,229 @@ static void host_callback(void *arg, ares_status_t status, size_t timeouts,
   /* at this point we keep on waiting for the next query to finish */
 }
 
+static void hquery_release(struct host_query *hquery)
+{
+  hquery->refcnt--;
+  if (hquery->refcnt == 0 && hquery->ended) {
+    hquery_free(hquery);
+  }
+}
+
+/* Mirrors the decisions host_callback() makes once all answers for a name are
+ * in, but records them for host_parallel_check() to act on in order */
+static void host_candidate_finish(host_candidate_t *cand, const char *name,
+                                  ares_status_t status,
+                                  ares_status_t addinfostatus)
+{
+  cand->done     = ARES_TRUE;
+  cand->is_final = ARES_TRUE;
+
+  if (status == ARES_EDESTRUCTION || status == ARES_ECANCELLED) {
+    cand->status = status;
+  } else if (cand->partial_sent) {
+    /* Addresses were already delivered for this name, so it ends the search
+     * whatever the remaining query returned */
+    if (cand->ai->nodes) {
+      cand->status = ARES_SUCCESS;
+    } else {
+      cand->status = addinfostatus != ARES_SUCCESS ? addinfostatus : status;
+    }
+  } else if (addinfostatus != ARES_SUCCESS && addinfostatus != ARES_ENODATA) {
+    if (addinfostatus == ARES_EBADRESP && cand->ai->nodes) {
+      cand->status = ARES_SUCCESS;
+    } else {
+      cand->status = addinfostatus;
+    }
+  } else if (cand->ai->nodes) {
+    cand->status = ARES_SUCCESS;
+  } else if (status == ARES_ENOTFOUND || status == ARES_ENODATA ||
+             addinfostatus == ARES_ENODATA) {
+    cand->is_final = ARES_FALSE;
+    cand->status   = addinfostatus == ARES_ENODATA ? ARES_ENODATA : status;
+  } else if ((status == ARES_ESERVFAIL || status == ARES_EREFUSED) &&
+             ares_name_label_cnt(name) == 1) {
+    cand->is_final = ARES_FALSE;
+    cand->status   = status;
+  } else {
+    cand->status = status;
+  }
+}
+
+static void host_query_no_retries(const ares_channel_t *channel,
+                                  unsigned short qid, const void *arg)
+{
+  ares_query_t *query =
+    ares_htable_szvp_get_direct(channel->queries_by_qid, qid);
+
+  if (query != NULL && query->arg == arg) {
+    query->no_retries = ARES_TRUE;
+  }
+}
+
+/* Once every candidate ahead of one with a final result has failed, act on
+ * that result exactly like a sequential lookup would have */
+static void host_parallel_check(struct host_query *hquery)
+{
+  ares_status_t status = ARES_ENOTFOUND;
+  size_t        idx;
+  size_t        i;
+
+  if (hquery->parallel_done) {
+    return;
+  }
+
+  for (idx = 0; idx < hquery->names_cnt; idx++) {
+    host_candidate_t *cand = &hquery->candidates[idx];
+
+    if (!cand->done) {
+      /* Every name ahead of this one failed, so its addresses are the result.
+       * Streaming callers get the first address family to answer right away,
+       * as from host_callback().  The caller holds a reference, but the user
+       * callback may end the lookup, so nothing more is done here. */
+      if (hquery->stream != NULL && !cand->partial_sent &&
+          cand->ai->nodes != NULL) {
+        cand->partial_sent = ARES_TRUE;
+        send_partial(hquery, cand->ai);
+      }
+      return;
+    }
+
+    status = cand->status;
+    if (cand->is_final) {
+      break;
+    }
+
+    if (status == ARES_ENODATA) {
+      hquery->nodata_cnt++;
+    }
+  }
+
+  hquery->parallel_done = ARES_TRUE;
+
+  /* The remaining queries can no longer change the result */
+  for (i = 0; i < hquery->names_cnt; i++) {
+    const host_candidate_t *cand = &hquery->candidates[i];
+
+    if (cand->done || cand->hquery == NULL) {
+      continue;
+    }
+    host_query_no_retries(hquery->channel, cand->qid_a, cand);
+    host_query_no_retries(hquery->channel, cand->qid_aaaa, cand);
+  }
+
+  if (idx < hquery->names_cnt) {
+    if (status == ARES_SUCCESS) {
+      ares_arena_destroy(hquery->arena);
+      hquery->arena                 = hquery->candidates[idx].arena;
+      hquery->ai                    = hquery->candidates[idx].ai;
+      hquery->candidates[idx].arena = NULL;
+      hquery->candidates[idx].ai    = NULL;
+    }
+    end_hquery(hquery, status);
+    return;
+  }
+
+  next_lookup(hquery, hquery->nodata_cnt ? ARES_ENODATA : status);
+}
+
+static void host_parallel_callback(void *arg, ares_status_t status,
+                                   size_t                   timeouts,
+                                   const ares_dns_record_t *dnsrec)
+{
+  host_candidate_t  *cand          = arg;
+  struct host_query *hquery        = cand->hquery;
+  size_t             idx           = (size_t)(cand - hquery->candidates);
+  ares_status_t      addinfostatus = ARES_SUCCESS;
+
+  ares_search_negcache_update(hquery->channel, hquery->name, dnsrec);
+
+  hquery->timeouts += timeouts;
+  cand->remaining--;
+
+  if (status == ARES_SUCCESS && !hquery->parallel_done) {
+    if (dnsrec == NULL) {
+      addinfostatus = ARES_EBADRESP; /* LCOV_EXCL_LINE: DefensiveCoding */
+    } else {
+      addinfostatus = ares_parse_into_addrinfo(dnsrec, ARES_TRUE, hquery->port,
+                                               cand->arena, cand->ai);
+    }
+
+    /* See host_callback() on why this is only done for ipv4 */
+    if (addinfostatus == ARES_SUCCESS && cand->remaining &&
+        ai_has_ipv4(cand->ai)) {
+      host_query_no_retries(hquery->channel, cand->qid_aaaa, cand);
+    }
+  }
+
+  if (!cand->remaining) {
+    host_candidate_finish(cand, hquery->names[idx], status, addinfostatus);
+  }
+
+  /* Our reference is held until after the check, as the user callback may
+   * cause the remaining candidates to complete.  This is also needed while
+   * one address family is outstanding, as it may have a partial result. */
+  host_parallel_check(hquery);
+
+  hquery_release(hquery);
+}
+
+/* Issue the queries for every candidate name at once, as used when
+ * ARES_FLAG_PARALLEL_SEARCH is set */
+static ares_bool_t parallel_dns_lookup(struct host_query *hquery)
+{
+  size_t i;
+
+  hquery->candidates =
+    ares_malloc_zero(sizeof(*hquery->candidates) * hquery->names_cnt);
+  if (hquery->candidates == NULL) {
+    return ARES_FALSE; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  for (i = 0; i < hquery->names_cnt; i++) {
+    host_candidate_t *cand = &hquery->candidates[i];
+
+    cand->arena = ares_arena_create(0);
+    cand->ai    = ares_addrinfo_create(cand->arena);
+    if (cand->ai == NULL) {
+      /* LCOV_EXCL_START: OutOfMemory */
+      hquery_free_candidates(hquery);
+      return ARES_FALSE;
+      /* LCOV_EXCL_STOP */
+    }
+  }
+
+  /* Reference held by ourselves while queries are being enqueued, as some
+   * may complete immediately (e.g. from the query cache) */
+  hquery->refcnt        = 1;
+  hquery->next_name_idx = hquery->names_cnt;
+
+  for (i = 0; i < hquery->names_cnt && !hquery->parallel_done; i++) {
+    host_candidate_t *cand = &hquery->candidates[i];
+    const char       *name = hquery->names[i];
+
+    cand->hquery = hquery;
+
+    /* Account for all answers up front, as the first may complete before the
+     * second is sent */
+    cand->remaining = hquery->hints.ai_family == AF_UNSPEC ? 2 : 1;
+    hquery->refcnt += cand->remaining;
+
+    if (hquery->hints.ai_family != AF_INET6) {
+      ares_query_nolock(hquery->channel, name, ARES_CLASS_IN, ARES_REC_TYPE_A,
+                        host_parallel_callback, cand, &cand->qid_a);
+    }
+    if (hquery->hints.ai_family != AF_INET) {
+      ares_query_nolock(hquery->channel, name, ARES_CLASS_IN,
+                        ARES_REC_TYPE_AAAA, host_parallel_callback, cand,
+                        &cand->qid_aaaa);
+    }
+  }
+
+  host_parallel_check(hquery);
+  hquery_release(hquery);
+  return ARES_TRUE;
+}
+
 /* Per POSIX getaddrinfo(), when no node/hostname is provided the returned
  * addresses are synthesized from the service: the wildcard address when
  * ARES_AI_PASSIVE is set (suitable for bind()ing a listening socket),
@@ -590,6 +939,7 @@ static void host_callback(void *arg, ares_status_t status, size_t timeouts,
 static ares_status_t
   ares_append_nulladdr(unsigned short                    port,
                        const struct ares_addrinfo_hints *hints,
+                       ares_arena_t                     *arena,
                        struct ares_addrinfo             *ai)
 {
   int                        family  = hints->ai_family;
@@ -607,7 +957,7 @@ static ares_status_t
     if (!passive) {
       ares_inet_pton(AF_INET6, "::1", &addr6);
     }
-    status = ares_append_ai_node(AF_INET6, port, 0, &addr6, &ai->nodes);
+    status = ares_append_ai_node(AF_INET6, port, 0, &addr6, arena, &ai->nodes);
     if (status != ARES_SUCCESS) {
       return status; /* LCOV_EXCL_LINE: OutOfMemory */
     }
@@ -619,7 +969,7 @@ static ares_status_t
     if (!passive) {
       ares_inet_pton(AF_INET, "127.0.0.1", &addr4);
     }
-    status = ares_append_ai_node(AF_INET, port, 0, &addr4, &ai->nodes);
+    status = ares_append_ai_node(AF_INET, port, 0, &addr4, arena, &ai->nodes);
     if (status != ARES_SUCCESS) {
       return status; /* LCOV_EXCL_LINE: OutOfMemory */
     }
@@ -636,11 +986,13 @@ static ares_status_t
 static void ares_getaddrinfo_int(ares_channel_t *channel, const char *name,
                                  const char                       *service,
                                  const struct ares_addrinfo_hints *hints,
-                                 ares_addrinfo_callback callback, void *arg)
+                                 ares_addrinfo_callback callback, void *arg,
+                                 ares_addrinfo_stream_t *stream)
 {
   struct host_query    *hquery;
   unsigned short        port = 0;
   int                   family;
+  ares_arena_t         *arena;
   struct ares_addrinfo *ai;
   ares_status_t         status;
 
@@ -676,7 +1028,7 @@ static void ares_getaddrinfo_int(ares_channel_t *channel, const char *name,
         return;
       }
     } else {
-      port = lookup_service(service, 0);
+      port = lookup_service(channel, service, 0);
       if (!port) {
         if (!ares_parse_port(service, &port, ARES_TRUE)) {
           callback(arg, ARES_ESERVICE, 0, NULL);
@@ -686,8 +1038,12 @@ static void ares_getaddrinfo_int(ares_channel_t *channel, const char *name,
     }
   }
 
-  ai = ares_malloc_zero(sizeof(*ai));
+  /* The result is assembled in an arena, and only a packed copy is handed
+   * out */
+  arena = ares_arena_create(0);
+  ai    = ares_addrinfo_create(arena);
   if (!ai) {
+    ares_arena_destroy(arena);
     callback(arg, ARES_ENOMEM, 0, NULL);
     return;
   }
@@ -695,24 +1051,27 @@ static void ares_getaddrinfo_int(ares_channel_t *channel, const char *name,
   /* No node/hostname was provided (service-only lookup): synthesize wildcard
    * or loopback addresses from the resolved port instead of issuing a query. */
   if (name == NULL) {
-    status = ares_append_nulladdr(port, hints, ai);
+    status = ares_append_nulladdr(port, hints, arena, ai);
     if (status != ARES_SUCCESS) {
-      ares_freeaddrinfo(ai);               /* LCOV_EXCL_LINE: OutOfMemory */
+      ares_arena_destroy(arena);           /* LCOV_EXCL_LINE: OutOfMemory */
       callback(arg, (int)status, 0, NULL); /* LCOV_EXCL_LINE: OutOfMemory */
       return;                              /* LCOV_EXCL_LINE: OutOfMemory */
     }
-    callback(arg, ARES_SUCCESS, 0, ai);
+    ai = ares_addrinfo_pack(ai);
+    ares_arena_destroy(arena);
+    callback(arg, ai == NULL ? ARES_ENOMEM : ARES_SUCCESS, 0, ai);
     return;
   }
 
-  if (fake_addrinfo(name, port, hints, ai, callback, arg)) {
+  if (fake_addrinfo(name, port, hints, arena, ai, callback, arg)) {
+    ares_arena_destroy(arena);
     return;
   }
 
   /* Allocate and fill in the host query structure. */
   hquery = ares_malloc_zero(sizeof(*hquery));
   if (!hquery) {
-    ares_freeaddrinfo(ai);
+    ares_arena_destroy(arena);
     callback(arg, ARES_ENOMEM, 0, NULL);
     return;
   }
@@ -721,12 +1080,24 @@ static void ares_getaddrinfo_int(ares_channel_t *channel, const char *name,
   hquery->channel     = channel;
   hquery->hints       = *hints;
   hquery->sent_family = -1; /* nothing is sent yet */
+  if (hints->ai_flags & ARES_AI_ADDRCONFIG && hints->ai_family == AF_UNSPEC) {
+    /* Only ask for families the host has a non-loopback address for.  This
+     * comes from a per-process snapshot, so is normally free. */
+    ares_iface_ip_flags_t families = ares_iface_ips_families();
+    if (families == ARES_IFACE_IP_V4) {
+      hquery->hints.ai_family = AF_INET;
+    } else if (families == ARES_IFACE_IP_V6) {
+      hquery->hints.ai_family = AF_INET6;
+    }
+  }
   hquery->callback    = callback;
   hquery->arg         = arg;
+  hquery->arena       = arena;
   hquery->ai          = ai;
+  hquery->stream      = stream;
   hquery->name        = ares_strdup(name);
   if (hquery->name == NULL) {
-    hquery_free(hquery, ARES_TRUE);
+    hquery_free(hquery);
     callback(arg, ARES_ENOMEM, 0, NULL);
     return;
   }
@@ -734,7 +1105,7 @@ static void ares_getaddrinfo_int(ares_channel_t *channel, const char *name,
   status =
     ares_search_name_list(channel, name, &hquery->names, &hquery->names_cnt);
   if (status != ARES_SUCCESS) {
-    hquery_free(hquery, ARES_TRUE);
+    hquery_free(hquery);
     callback(arg, (int)status, 0, NULL);
     return;
   }
@@ -743,7 +1114,7 @@ static void ares_getaddrinfo_int(ares_channel_t *channel, const char *name,
 
   hquery->lookups = ares_strdup(channel->lookups);
   if (hquery->lookups == NULL) {
-    hquery_free(hquery, ARES_TRUE);
+    hquery_free(hquery);
     callback(arg, ARES_ENOMEM, 0, NULL);
     return;
   }
@@ -761,8 +1132,50 @@ void ares_getaddrinfo(ares_channel_t *channel, const char *name,
   if (channel == NULL) {
     return;
   }
+  if (ares_cbpool_wrap_addrinfo(channel, &callback, &arg) != ARES_SUCCESS) {
+    callback(arg, ARES_ENOMEM, 0, NULL); /* LCOV_EXCL_LINE: OutOfMemory */
+    return;                              /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+  ares_channel_lock(channel);
+  ares_getaddrinfo_int(channel, name, service, hints, callback, arg, NULL);
+  ares_channel_unlock(channel);
+}
+
+static void ares_getaddrinfo_stream_cb(void *arg, int status, int timeouts,
+                                       struct ares_addrinfo *res)
+{
+  ares_addrinfo_stream_t *stream = arg;
+
+  stream->callback(stream->arg, status, timeouts, res, ARES_FALSE);
+  ares_free(stream);
+}
+
+void ares_getaddrinfo_stream(ares_channel_t *channel, const char *name,
+                             const char                       *service,
+                             const struct ares_addrinfo_hints *hints,
+                             ares_addrinfo_stream_callback callback, void *arg)
+{
+  ares_addrinfo_stream_t *stream;
+
+  if (channel == NULL || callback == NULL) {
+    return;
+  }
+
+  /* Not offloaded to callback workers, as partial and final results could
+   * then be delivered out of order */
+  stream = ares_malloc_zero(sizeof(*stream));
+  if (stream == NULL) {
+    /* LCOV_EXCL_START: OutOfMemory */
+    callback(arg, ARES_ENOMEM, 0, NULL, ARES_FALSE);
+    return;
+    /* LCOV_EXCL_STOP */
+  }
+  stream->callback = callback;
+  stream->arg      = arg;
+
   ares_channel_lock(channel);
-  ares_getaddrinfo_int(channel, name, service, hints, callback, arg);
+  ares_getaddrinfo_int(channel, name, service, hints,
+                       ares_getaddrinfo_stream_cb, stream, stream);
   ares_channel_unlock(channel);
 }
 
@@ -774,6 +1187,12 @@ static ares_bool_t next_dns_lookup(struct host_query *hquery)
     return ARES_FALSE;
   }
 
+  if (hquery->channel->flags & ARES_FLAG_PARALLEL_SEARCH &&
+      hquery->next_name_idx == 0 && hquery->names_cnt > 1 &&
+      parallel_dns_lookup(hquery)) {
+    return ARES_TRUE;
+  }
+
   name = hquery->names[hquery->next_name_idx++];
 
   /* NOTE: hquery may be invalidated during the call to ares_query_qid(),
@@ -78,6 +78,9 @@ static void ares_gethostbyname_callback(void *arg, int status, int timeouts,
     status = ARES_ENODATA;
   }
 
+  /* This may be invoked from a callback worker without the channel lock held
+   * so we need to lock to access the sortlist */
+  ares_channel_lock(ghbn_arg->channel);
   if (status == ARES_SUCCESS && ghbn_arg->channel->nsort && hostent) {
     if (hostent->h_addrtype == AF_INET6) {
       sort6_addresses(hostent, ghbn_arg->channel->sortlist,
@@ -88,6 +91,7 @@ static void ares_gethostbyname_callback(void *arg, int status, int timeouts,
                      ghbn_arg->channel->nsort);
     }
   }
+  ares_channel_unlock(ghbn_arg->channel);
 
   ghbn_arg->callback(ghbn_arg->arg, status, timeouts, hostent);
 
@@ -255,19 +259,21 @@ static ares_status_t ares_hostent_localhost(const char *name, int family,
                                             struct hostent **host_out)
 {
   ares_status_t              status;
-  struct ares_addrinfo      *ai = NULL;
+  ares_arena_t              *arena;
+  struct ares_addrinfo      *ai;
   struct ares_addrinfo_hints hints;
 
   memset(&hints, 0, sizeof(hints));
   hints.ai_family = family;
 
-  ai = ares_malloc_zero(sizeof(*ai));
+  arena = ares_arena_create(0);
+  ai    = ares_addrinfo_create(arena);
   if (ai == NULL) {
     status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
     goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
   }
 
-  status = ares_addrinfo_localhost(name, 0, &hints, ai);
+  status = ares_addrinfo_localhost(name, 0, &hints, arena, ai);
   if (status != ARES_SUCCESS) {
     goto done; /* LCOV_EXCL_LINE: OutOfMemory */
   }
@@ -278,7 +284,7 @@ static ares_status_t ares_hostent_localhost(const char *name, int family,
   }
 
 done:
-  ares_freeaddrinfo(ai);
+  ares_arena_destroy(arena);
   return status;
 }
 
@@ -64,6 +64,7 @@ struct nameinfo_query {
 
   int          family;
   unsigned int flags;
+  ares_bool_t  services_cache;
   size_t       timeouts;
 };
 
@@ -76,7 +77,8 @@ struct nameinfo_query {
 
 static void nameinfo_callback(void *arg, int status, int timeouts,
                               struct hostent *host);
-static char *lookup_service(unsigned short port, unsigned int flags, char *buf,
+static char *lookup_service(unsigned short port, unsigned int flags,
+                            ares_bool_t services_cache, char *buf,
                             size_t buflen);
 #ifdef HAVE_STRUCT_SOCKADDR_IN6_SIN6_SCOPE_ID
 static void append_scopeid(const struct sockaddr_in6 *addr6, unsigned int flags,
@@ -94,6 +96,8 @@ static void ares_getnameinfo_int(ares_channel_t        *channel,
   struct nameinfo_query     *niquery;
   unsigned short             port  = 0;
   unsigned int               flags = (unsigned int)flags_int;
+  ares_bool_t                services_cache =
+    (channel->flags & ARES_FLAG_SERVICES_CACHE) ? ARES_TRUE : ARES_FALSE;
 
   /* Validate socket address family and length */
   if (sa && sa->sa_family == AF_INET &&
@@ -119,8 +123,8 @@ static void ares_getnameinfo_int(ares_channel_t        *channel,
     char  buf[33];
     char *service;
 
-    service =
-      lookup_service((unsigned short)(port & 0xffff), flags, buf, sizeof(buf));
+    service = lookup_service((unsigned short)(port & 0xffff), flags,
+                             services_cache, buf, sizeof(buf));
     callback(arg, ARES_SUCCESS, 0, NULL, service);
     return;
   }
@@ -152,8 +156,8 @@ static void ares_getnameinfo_int(ares_channel_t        *channel,
       }
       /* They also want a service */
       if (flags & ARES_NI_LOOKUPSERVICE) {
-        service = lookup_service((unsigned short)(port & 0xffff), flags, srvbuf,
-                                 sizeof(srvbuf));
+        service = lookup_service((unsigned short)(port & 0xffff), flags,
+                                 services_cache, srvbuf, sizeof(srvbuf));
       }
       callback(arg, ARES_SUCCESS, 0, ipbuf, service);
       return;
@@ -164,10 +168,11 @@ static void ares_getnameinfo_int(ares_channel_t        *channel,
         callback(arg, ARES_ENOMEM, 0, NULL, NULL);
         return;
       }
-      niquery->callback = callback;
-      niquery->arg      = arg;
-      niquery->flags    = flags;
-      niquery->timeouts = 0;
+      niquery->callback       = callback;
+      niquery->arg            = arg;
+      niquery->flags          = flags;
+      niquery->services_cache = services_cache;
+      niquery->timeouts       = 0;
       if (sa->sa_family == AF_INET) {
         niquery->family = AF_INET;
         memcpy(&niquery->addr.addr4, addr, sizeof(niquery->addr.addr4));
@@ -211,10 +216,12 @@ static void nameinfo_callback(void *arg, int status, int timeouts,
     if (niquery->flags & ARES_NI_LOOKUPSERVICE) {
       if (niquery->family == AF_INET) {
         service = lookup_service(niquery->addr.addr4.sin_port, niquery->flags,
-                                 srvbuf, sizeof(srvbuf));
+                                 niquery->services_cache, srvbuf,
+                                 sizeof(srvbuf));
       } else {
         service = lookup_service(niquery->addr.addr6.sin6_port, niquery->flags,
-                                 srvbuf, sizeof(srvbuf));
+                                 niquery->services_cache, srvbuf,
+                                 sizeof(srvbuf));
       }
     }
     /* NOFQDN means we have to strip off the domain name portion.  We do
@@ -255,10 +262,12 @@ static void nameinfo_callback(void *arg, int status, int timeouts,
     if (niquery->flags & ARES_NI_LOOKUPSERVICE) {
       if (niquery->family == AF_INET) {
         service = lookup_service(niquery->addr.addr4.sin_port, niquery->flags,
-                                 srvbuf, sizeof(srvbuf));
+                                 niquery->services_cache, srvbuf,
+                                 sizeof(srvbuf));
       } else {
         service = lookup_service(niquery->addr.addr6.sin6_port, niquery->flags,
-                                 srvbuf, sizeof(srvbuf));
+                                 niquery->services_cache, srvbuf,
+                                 sizeof(srvbuf));
       }
     }
     niquery->callback(niquery->arg, ARES_SUCCESS, (int)niquery->timeouts, ipbuf,
@@ -270,22 +279,62 @@ static void nameinfo_callback(void *arg, int status, int timeouts,
   ares_free(niquery);
 }
 
-static char *lookup_service(unsigned short port, unsigned int flags, char *buf,
-                            size_t buflen)
+/* Returns the service name from the system services database, which may be
+ * stored in tmpbuf */
+static const char *lookup_service_system(unsigned short port, const char *proto,
+                                         char *tmpbuf, size_t tmpbuf_len)
 {
-  const char     *proto;
   struct servent *sep;
 #ifdef HAVE_GETSERVBYPORT_R
   struct servent se;
+
+  memset(&se, 0, sizeof(se));
+  sep = &se;
+  memset(tmpbuf, 0, tmpbuf_len);
+#  if GETSERVBYPORT_R_ARGS == 6
+  if (getservbyport_r(port, proto, &se, (void *)tmpbuf, tmpbuf_len, &sep) !=
+      0) {
+    sep = NULL; /* LCOV_EXCL_LINE: buffer large so this never fails */
+  }
+#  elif GETSERVBYPORT_R_ARGS == 5
+  sep = getservbyport_r(port, proto, &se, (void *)tmpbuf, tmpbuf_len);
+#  elif GETSERVBYPORT_R_ARGS == 4
+  if (getservbyport_r(port, proto, &se, (void *)tmpbuf) != 0) {
+    sep = NULL;
+  }
+#  else
+  /* Lets just hope the OS uses TLS! */
+  sep = getservbyport(port, proto);
+#  endif
+#else
+  (void)tmpbuf;
+  (void)tmpbuf_len;
+  /* Lets just hope the OS uses TLS! */
+#  if (defined(NETWARE) && !defined(__NOVELL_LIBC__))
+  sep = getservbyport(port, (char *)proto);
+#  else
+  sep = getservbyport(port, proto);
+#  endif
 #endif
+  if (sep == NULL) {
+    return NULL;
+  }
+  return sep->s_name;
+}
+
+static char *lookup_service(unsigned short port, unsigned int flags,
+                            ares_bool_t services_cache, char *buf,
+                            size_t buflen)
+{
+  const char *proto;
   char        tmpbuf[4096];
-  const char *name;
+  const char *name = NULL;
   size_t      name_len;
 
   if (port) {
-    if (flags & ARES_NI_NUMERICSERV) {
-      sep = NULL;
-    } else {
+    if (!(flags & ARES_NI_NUMERICSERV)) {
+      ares_status_t status = ARES_ENOTIMP;
+
       if (flags & ARES_NI_UDP) {
         proto = "udp";
       } else if (flags & ARES_NI_SCTP) {
@@ -295,38 +344,20 @@ static char *lookup_service(unsigned short port, unsigned int flags, char *buf,
       } else {
         proto = "tcp";
       }
-#ifdef HAVE_GETSERVBYPORT_R
-      memset(&se, 0, sizeof(se));
-      sep = &se;
-      memset(tmpbuf, 0, sizeof(tmpbuf));
-#  if GETSERVBYPORT_R_ARGS == 6
-      if (getservbyport_r(port, proto, &se, (void *)tmpbuf, sizeof(tmpbuf),
-                          &sep) != 0) {
-        sep = NULL; /* LCOV_EXCL_LINE: buffer large so this never fails */
+
+      if (services_cache) {
+        status =
+          ares_services_name(ntohs(port), proto, tmpbuf, sizeof(tmpbuf));
+        if (status == ARES_SUCCESS) {
+          name = tmpbuf;
+        }
       }
-#  elif GETSERVBYPORT_R_ARGS == 5
-      sep = getservbyport_r(port, proto, &se, (void *)tmpbuf, sizeof(tmpbuf));
-#  elif GETSERVBYPORT_R_ARGS == 4
-      if (getservbyport_r(port, proto, &se, (void *)tmpbuf) != 0) {
-        sep = NULL;
+
+      if (status == ARES_ENOTIMP) {
+        name = lookup_service_system(port, proto, tmpbuf, sizeof(tmpbuf));
       }
-#  else
-      /* Lets just hope the OS uses TLS! */
-      sep = getservbyport(port, proto);
-#  endif
-#else
-      /* Lets just hope the OS uses TLS! */
-#  if (defined(NETWARE) && !defined(__NOVELL_LIBC__))
-      sep = getservbyport(port, (char *)proto);
-#  else
-      sep = getservbyport(port, proto);
-#  endif
-#endif
     }
-    if (sep && sep->s_name) {
-      /* get service name */
-      name = sep->s_name;
-    } else {
+    if (name == NULL) {
       /* get port as a string */
       snprintf(tmpbuf, sizeof(tmpbuf), "%u", (unsigned int)ntohs(port));
       name = tmpbuf;
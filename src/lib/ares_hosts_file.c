@@ -24,6 +24,7 @@
  * SPDX-License-Identifier: MIT
  */
 #include "ares_private.h"
+#include "dsa/ares_htable.h"
 #ifdef HAVE_SYS_TYPES_H
 #  include <sys/types.h>
 #endif
@@ -54,11 +55,12 @@
  * for both forward and reverse lookups.
  *
  * We are caching the entire parsed hosts file for performance reasons.  Some
- * files may be quite sizable and as per Issue #458 can approach 1/2MB in size,
- * and the parse overhead on a rapid succession of queries can be quite large.
- * The entries are stored in forwards and backwards hashtables so we can get
- * O(1) performance on lookup.  The file is cached until the file modification
- * timestamp changes.
+ * files may be quite sizable, blocklists such as StevenBlack/hosts can carry
+ * hundreds of thousands of names, up to a million or so, and the parse
+ * overhead on a rapid succession of queries can be quite large.  The parsed
+ * file is cached until the file's modification time or size changes, and is
+ * shared by every channel in the process using the same file (see SHARING
+ * below).
  *
  * The hosts file processing is quite unique. It has to merge all related hosts
  * and ips into a single entry due to file formatting requirements.  For
@@ -77,16 +79,16 @@
  * hostname belongs to another) is dropped -- that dropping was Issue #1049.
  *
  * Both lookup directions return a CACHED, fully address-scoped entry directly
- * from a hashtable (no per-lookup allocation, callers do not free):
+ * from an index (no per-lookup allocation, callers do not free):
  *   - iphash:   address  -> reverse entry E_r { ips=[address],
  *               hosts=[the names that appeared on a line with that address,
  *               file-ordered] }
  *   - hosthash: hostname -> the entry to return for a forward lookup of that
  *               name.  For a single-address hostname this is simply that
- *               address's reverse entry E_r (shared, and reference counted so
- *               it is freed exactly once).  Only a multi-address hostname gets
- *               a dedicated forward entry E_f { ips=[its addresses, file
- *               order], hosts=[canonical + up to 100 address-scoped aliases] }.
+ *               address's reverse entry E_r (shared).  Only a multi-address
+ *               hostname gets a dedicated forward entry E_f { ips=[its
+ *               addresses, file order], hosts=[canonical + up to 100
+ *               address-scoped aliases] }.
  *
  * The common case -- a hostname that appears with a single address -- is wired
  * up INCREMENTALLY during the parse: the first time a hostname is seen it is
@@ -100,6 +102,25 @@
  *
  * Aliases are address-scoped: exactly the hostnames that share an address with
  * the queried name, canonical first (the first such name in file order).
+ *
+ * COMPACT REPRESENTATION
+ * ----------------------
+ * Names and addresses are interned: each is copied once into an arena of large
+ * blocks, and everything else refers to that copy.  Entries hold arrays of
+ * pointers into the arena, and iphash/hosthash are flat open addressing
+ * indexes whose slots point at those same copies, so a name costs its string
+ * plus an index slot and an array member rather than several allocations.
+ * A name seen again with different case on a later line keeps that line's
+ * spelling in the reverse entry, as it was written.
+ *
+ * SHARING
+ * -------
+ * The parsed file (ares_hosts_db_t) is immutable once built.  Every parsed
+ * file is kept in a process-wide registry keyed by filename, modification time
+ * and size, and reference counted by the channels using it, so channels
+ * loading the same unchanged file share one copy rather than each parsing
+ * their own.  Lookups read it without locking, only the registry is protected
+ * by the global lock.
  */
 
 /*! Maximum number of address-scoped aliases (beyond the canonical name) that we
@@ -108,28 +129,86 @@
  *  names. */
 #define ARES_HOSTS_MAX_ALIASES 100
 
+/*! Minimum interval between checks of the hosts file for modification, so
+ *  that lookups don't need to touch the filesystem every time */
+#define ARES_HOSTS_CHECK_INTERVAL_MS 1000
+
+/*! Size of the first arena block, each further block doubles in size up to
+ *  ARES_HOSTS_ARENA_MAX.  Small hosts files stay small. */
+#define ARES_HOSTS_ARENA_MIN 4096
+#define ARES_HOSTS_ARENA_MAX 262144
+
+/*! Initial number of slots in an index, always a power of 2 */
+#define ARES_HOSTS_INDEX_MIN 16
+
+typedef struct {
+  /*! interned key, NULL if the slot is empty */
+  const char         *key;
+  unsigned int        hash;
+  ares_hosts_entry_t *entry;
+} ares_hosts_slot_t;
+
+/*! Open addressing (linear probing) index of interned string -> entry */
+typedef struct {
+  ares_hosts_slot_t *slots;
+  size_t             size;
+  size_t             cnt;
+} ares_hosts_index_t;
+
+typedef struct ares_hosts_db ares_hosts_db_t;
+
+struct ares_hosts_db {
+  /*! file this was parsed from */
+  char               *filename;
+  /*! wall clock time the file was loaded */
+  time_t              ts;
+  /*! modification time and size of the file when it was loaded */
+  time_t              mtime;
+  size_t              size;
+  /*! ARES_TRUE if mtime and size could be determined, required for sharing */
+  ares_bool_t         have_stat;
+  /*! number of channels referencing this, protected by the global lock */
+  size_t              refcnt;
+  /*! next in the registry of shared files, protected by the global lock */
+  ares_hosts_db_t    *next;
+  /*! seed for hashing keys */
+  unsigned int        seed;
+  /*! arena blocks (char *) holding interned names and addresses */
+  ares_llist_t       *arena;
+  char               *arena_cur;
+  size_t              arena_used;
+  size_t              arena_size;
+  /*! every entry (ares_hosts_entry_t *), owned */
+  ares_array_t       *entries;
+  /*! normalized address -> reverse entry */
+  ares_hosts_index_t  iphash;
+  /*! hostname (case insensitive) -> entry to return for a forward lookup */
+  ares_hosts_index_t  hosthash;
+};
+
+/*! Per-channel view of the hosts file */
 struct ares_hosts_file {
-  time_t               ts;
-  /*! cache the filename so we know if the filename changes it automatically
-   *  invalidates the cache */
-  char                *filename;
-  /*! address (normalized str) -> cached reverse entry (ares_hosts_entry_t).
-   *  Owns the entry via ares_hosts_entry_destroy_cb (reference counted). */
-  ares_htable_strvp_t *iphash;
-  /*! hostname (str) -> cached entry to return for a forward lookup of that name
-   *  (ares_hosts_entry_t).  May be the same object as an iphash reverse entry
-   *  (single-address hostname) or a dedicated forward entry (multi-address).
-   *  Owns the entry via ares_hosts_entry_destroy_cb (reference counted). */
-  ares_htable_strvp_t *hosthash;
+  /*! resolved path of the hosts file when not taken from the environment,
+   *  NULL until first needed */
+  char               *path;
+  /*! shared parsed file, NULL if it couldn't be loaded */
+  ares_hosts_db_t    *db;
+  /*! when the file was last checked for modification */
+  ares_timeval_t      checked;
+  /*! check for modification on next use regardless of checked */
+  ares_bool_t         stale;
 };
 
 struct ares_hosts_entry {
-  size_t        refcnt; /*! Entries may be shared between iphash and hosthash,
-                         *  so they are reference counted. */
-  ares_llist_t *ips;
-  ares_llist_t *hosts;
+  /*! interned addresses (const char *) */
+  ares_array_t *ips;
+  /*! interned hostnames (const char *) */
+  ares_array_t *hosts;
 };
 
+/*! Registry of parsed files shared between channels */
+static ares_hosts_db_t *ares_hosts_dbs = NULL;
+
 const void *ares_dns_pton(const char *ipaddr, struct ares_addr *addr,
                           size_t *out_len)
 {
@@ -188,333 +267,438 @@ static ares_bool_t ares_normalize_ipaddr(const char *ipaddr, char *out,
   return ARES_TRUE;
 }
 
-static void ares_hosts_entry_destroy(ares_hosts_entry_t *entry)
+/* Fetch a string from an array of interned strings */
+static const char *ares_hosts_str_at(const ares_array_t *arr, size_t idx)
 {
-  if (entry == NULL) {
-    return;
+  const char * const *str = ares_array_at_const(arr, idx);
+  if (str == NULL) {
+    return NULL;
   }
+  return *str;
+}
+
+/* Case-insensitive membership test for an array of interned strings */
+static ares_bool_t ares_hosts_strs_contains(const ares_array_t *arr,
+                                            const char         *str)
+{
+  size_t i;
 
-  /* Honor reference counting: only free once the last reference goes away */
-  if (entry->refcnt > 0) {
-    entry->refcnt--;
+  for (i = 0; i < ares_array_len(arr); i++) {
+    if (ares_strcaseeq(ares_hosts_str_at(arr, i), str)) {
+      return ARES_TRUE;
+    }
   }
-  if (entry->refcnt > 0) {
+
+  return ARES_FALSE;
+}
+
+static void ares_hosts_entry_destroy(ares_hosts_entry_t *entry)
+{
+  if (entry == NULL) {
     return;
   }
 
-  ares_llist_destroy(entry->hosts);
-  ares_llist_destroy(entry->ips);
+  ares_array_destroy(entry->hosts);
+  ares_array_destroy(entry->ips);
   ares_free(entry);
 }
 
-/* iphash/hosthash value destructor: values are (refcounted) entries */
+/* entries array member destructor: members are entry pointers */
 static void ares_hosts_entry_destroy_cb(void *e)
 {
-  ares_hosts_entry_destroy(e);
+  ares_hosts_entry_destroy(*(ares_hosts_entry_t **)e);
 }
 
-/* Temporary forward-adjacency htable value destructor: each value is an
- * ares_llist_t of ip strings */
-static void ares_hosts_list_destroy_cb(void *arg)
+/* Temporary multi-address htable value destructor: each value is an
+ * ares_array_t of interned ip strings */
+static void ares_hosts_array_destroy_cb(void *arg)
 {
-  ares_llist_destroy(arg);
+  ares_array_destroy(arg);
 }
 
-void ares_hosts_file_destroy(ares_hosts_file_t *hf)
+/* Create an entry and hand ownership to the db */
+static ares_hosts_entry_t *ares_hosts_entry_create(ares_hosts_db_t *db)
 {
-  if (hf == NULL) {
-    return;
+  ares_hosts_entry_t *entry = ares_malloc_zero(sizeof(*entry));
+
+  if (entry == NULL) {
+    return NULL; /* LCOV_EXCL_LINE: OutOfMemory */
   }
 
-  ares_free(hf->filename);
-  ares_htable_strvp_destroy(hf->hosthash);
-  ares_htable_strvp_destroy(hf->iphash);
-  ares_free(hf);
+  entry->ips   = ares_array_create(sizeof(const char *), NULL);
+  entry->hosts = ares_array_create(sizeof(const char *), NULL);
+  if (entry->ips == NULL || entry->hosts == NULL) {
+    ares_hosts_entry_destroy(entry); /* LCOV_EXCL_LINE: OutOfMemory */
+    return NULL;                     /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  if (ares_array_insertdata_last(db->entries, &entry) != ARES_SUCCESS) {
+    ares_hosts_entry_destroy(entry); /* LCOV_EXCL_LINE: OutOfMemory */
+    return NULL;                     /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  return entry;
 }
 
-static ares_hosts_file_t *ares_hosts_file_create(const char *filename)
+/* Copy a string into the arena, returning the interned copy */
+static const char *ares_hosts_intern(ares_hosts_db_t *db, const char *str)
 {
-  ares_hosts_file_t *hf = ares_malloc_zero(sizeof(*hf));
-  if (hf == NULL) {
-    goto fail;
-  }
+  size_t len = ares_strlen(str) + 1;
+  char  *ptr;
 
-  hf->ts = time(NULL);
+  if (db->arena_cur == NULL || len > db->arena_size - db->arena_used) {
+    size_t size = db->arena_size * 2;
 
-  hf->filename = ares_strdup(filename);
-  if (hf->filename == NULL) {
-    goto fail;
-  }
+    if (size < ARES_HOSTS_ARENA_MIN) {
+      size = ARES_HOSTS_ARENA_MIN;
+    }
+    if (size > ARES_HOSTS_ARENA_MAX) {
+      size = ARES_HOSTS_ARENA_MAX;
+    }
+    /* Strings are hostnames and addresses, always far smaller than a block */
+    if (len > size) {
+      return NULL; /* LCOV_EXCL_LINE: DefensiveCoding */
+    }
 
-  hf->iphash = ares_htable_strvp_create(ares_hosts_entry_destroy_cb);
-  if (hf->iphash == NULL) {
-    goto fail;
+    ptr = ares_malloc(size);
+    if (ptr == NULL) {
+      return NULL; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+    if (ares_llist_insert_last(db->arena, ptr) == NULL) {
+      ares_free(ptr); /* LCOV_EXCL_LINE: OutOfMemory */
+      return NULL;    /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+    db->arena_cur  = ptr;
+    db->arena_used = 0;
+    db->arena_size = size;
   }
 
-  hf->hosthash = ares_htable_strvp_create(ares_hosts_entry_destroy_cb);
-  if (hf->hosthash == NULL) {
-    goto fail;
+  ptr = db->arena_cur + db->arena_used;
+  memcpy(ptr, str, len);
+  db->arena_used += len;
+  return ptr;
+}
+
+static unsigned int ares_hosts_hash(const ares_hosts_db_t *db, const char *key)
+{
+  return ares_htable_hash_FNV1a_casecmp((const unsigned char *)key,
+                                        ares_strlen(key), db->seed);
+}
+
+static ares_status_t ares_hosts_index_init(ares_hosts_index_t *idx, size_t size)
+{
+  idx->slots = ares_malloc_zero(sizeof(*idx->slots) * size);
+  if (idx->slots == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
   }
+  idx->size = size;
+  idx->cnt  = 0;
+  return ARES_SUCCESS;
+}
 
-  return hf;
+/* Returns the slot holding key, or the empty slot where it would be inserted.
+ * The index always has free slots so this terminates. */
+static ares_hosts_slot_t *ares_hosts_index_find(const ares_hosts_index_t *idx,
+                                                const char               *key,
+                                                unsigned int              hash)
+{
+  size_t i = hash & (idx->size - 1);
 
-fail:
-  ares_hosts_file_destroy(hf);
-  return NULL;
+  while (1) {
+    ares_hosts_slot_t *slot = &idx->slots[i];
+
+    if (slot->key == NULL ||
+        (slot->hash == hash && ares_strcaseeq(slot->key, key))) {
+      return slot;
+    }
+
+    i = (i + 1) & (idx->size - 1);
+  }
 }
 
-/* Case-insensitive membership test for an ip/host string list */
-static ares_bool_t ares_hosts_strlist_contains(ares_llist_t *list,
-                                               const char   *ipaddr)
+/* Insert key, which must not already be present.  The key must be interned. */
+static ares_status_t ares_hosts_index_insert(ares_hosts_index_t *idx,
+                                             const char *key, unsigned int hash,
+                                             ares_hosts_entry_t *entry)
 {
-  ares_llist_node_t *node;
+  ares_hosts_slot_t *slot;
 
-  for (node = ares_llist_node_first(list); node != NULL;
-       node = ares_llist_node_next(node)) {
-    if (ares_strcaseeq(ares_llist_node_val(node), ipaddr)) {
-      return ARES_TRUE;
+  /* Keep the load factor at or below 75% */
+  if ((idx->cnt + 1) * 4 > idx->size * 3) {
+    ares_hosts_index_t grown;
+    size_t             i;
+
+    if (ares_hosts_index_init(&grown, idx->size * 2) != ARES_SUCCESS) {
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+
+    for (i = 0; i < idx->size; i++) {
+      if (idx->slots[i].key == NULL) {
+        continue;
+      }
+      slot  = ares_hosts_index_find(&grown, idx->slots[i].key,
+                                    idx->slots[i].hash);
+      *slot = idx->slots[i];
     }
+    grown.cnt = idx->cnt;
+
+    ares_free(idx->slots);
+    *idx = grown;
   }
 
-  return ARES_FALSE;
+  slot        = ares_hosts_index_find(idx, key, hash);
+  slot->key   = key;
+  slot->hash  = hash;
+  slot->entry = entry;
+  idx->cnt++;
+  return ARES_SUCCESS;
 }
 
-/* Append a string copy to a list, returning the stored copy (or NULL on OOM) */
-static char *ares_hosts_list_append_strdup(ares_llist_t *list, const char *str)
+static ares_hosts_entry_t *ares_hosts_index_get(const ares_hosts_db_t    *db,
+                                                const ares_hosts_index_t *idx,
+                                                const char               *key)
 {
-  char *tmp = ares_strdup(str);
-  if (tmp == NULL) {
-    return NULL; /* LCOV_EXCL_LINE: OutOfMemory */
+  return ares_hosts_index_find(idx, key, ares_hosts_hash(db, key))->entry;
+}
+
+static void ares_hosts_db_destroy(ares_hosts_db_t *db)
+{
+  if (db == NULL) {
+    return;
+  }
+
+  ares_free(db->filename);
+  ares_free(db->hosthash.slots);
+  ares_free(db->iphash.slots);
+  ares_array_destroy(db->entries);
+  ares_llist_destroy(db->arena);
+  ares_free(db);
+}
+
+static ares_hosts_db_t *ares_hosts_db_create(const char *filename)
+{
+  ares_hosts_db_t *db = ares_malloc_zero(sizeof(*db));
+  if (db == NULL) {
+    goto fail;
+  }
+
+  db->filename = ares_strdup(filename);
+  if (db->filename == NULL) {
+    goto fail;
+  }
+
+  /* Mix heap address and time for the seed like ares_htable does, it doesn't
+   * need to be secure */
+  db->seed = (unsigned int)((size_t)db & 0xFFFFFFFF) |
+             (unsigned int)(((ares_uint64_t)time(NULL)) & 0xFFFFFFFF);
+
+  db->arena = ares_llist_create(ares_free);
+  if (db->arena == NULL) {
+    goto fail;
   }
-  if (ares_llist_insert_last(list, tmp) == NULL) {
-    ares_free(tmp); /* LCOV_EXCL_LINE: OutOfMemory */
-    return NULL;    /* LCOV_EXCL_LINE: OutOfMemory */
+
+  db->entries = ares_array_create(sizeof(ares_hosts_entry_t *),
+                                  ares_hosts_entry_destroy_cb);
+  if (db->entries == NULL) {
+    goto fail;
+  }
+
+  if (ares_hosts_index_init(&db->iphash, ARES_HOSTS_INDEX_MIN) !=
+        ARES_SUCCESS ||
+      ares_hosts_index_init(&db->hosthash, ARES_HOSTS_INDEX_MIN) !=
+        ARES_SUCCESS) {
+    goto fail;
   }
-  return tmp;
+
+  return db;
+
+fail:
+  ares_hosts_db_destroy(db);
+  return NULL;
 }
 
 /* Fetch (creating if needed) the cached reverse entry for 'ipaddr'.  A reverse
- * entry is { refcnt=1, ips=[ipaddr], hosts=[] } and is owned by iphash. */
-static ares_status_t ares_hosts_reverse_entry(ares_hosts_file_t   *hosts,
+ * entry is { ips=[ipaddr], hosts=[] } and is indexed by iphash. */
+static ares_status_t ares_hosts_reverse_entry(ares_hosts_db_t     *db,
                                               const char          *ipaddr,
                                               ares_hosts_entry_t **out)
 {
-  ares_hosts_entry_t *rev = ares_htable_strvp_get_direct(hosts->iphash, ipaddr);
+  unsigned int        hash = ares_hosts_hash(db, ipaddr);
+  ares_hosts_slot_t  *slot = ares_hosts_index_find(&db->iphash, ipaddr, hash);
+  ares_hosts_entry_t *rev;
+  const char         *ip;
 
-  if (rev != NULL) {
-    *out = rev;
+  if (slot->key != NULL) {
+    *out = slot->entry;
     return ARES_SUCCESS;
   }
 
-  rev = ares_malloc_zero(sizeof(*rev));
+  rev = ares_hosts_entry_create(db);
   if (rev == NULL) {
     return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
   }
-  rev->refcnt = 1;
-  rev->ips    = ares_llist_create(ares_free);
-  rev->hosts  = ares_llist_create(ares_free);
-  if (rev->ips == NULL || rev->hosts == NULL) {
-    ares_hosts_entry_destroy(rev); /* LCOV_EXCL_LINE: OutOfMemory */
-    return ARES_ENOMEM;            /* LCOV_EXCL_LINE: OutOfMemory */
+
+  ip = ares_hosts_intern(db, ipaddr);
+  if (ip == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
   }
 
-  if (ares_hosts_list_append_strdup(rev->ips, ipaddr) == NULL) {
-    ares_hosts_entry_destroy(rev); /* LCOV_EXCL_LINE: OutOfMemory */
-    return ARES_ENOMEM;            /* LCOV_EXCL_LINE: OutOfMemory */
+  if (ares_array_insertdata_last(rev->ips, &ip) != ARES_SUCCESS) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
   }
 
-  if (!ares_htable_strvp_insert(hosts->iphash, ipaddr, rev)) {
-    ares_hosts_entry_destroy(rev); /* LCOV_EXCL_LINE: OutOfMemory */
-    return ARES_ENOMEM;            /* LCOV_EXCL_LINE: OutOfMemory */
+  if (ares_hosts_index_insert(&db->iphash, ip, hash, rev) != ARES_SUCCESS) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
   }
 
   *out = rev;
   return ARES_SUCCESS;
 }
 
-/*! entry represents a single parsed line (one ip, its hostnames).  It is always
- *  invalidated (destroyed) upon calling this function, even on error.
+/*! Record the (host, ipaddr) edge of a parsed line, rev is the reverse entry
+ *  for ipaddr.
  *
- *  Each new (hostname, ipaddress) edge is appended to the address's reverse
- *  entry in iphash.  A hostname's first sighting is wired directly into
- *  hosthash as a shared reference to that reverse entry (the single-address
- *  fast path).  Only when a hostname is later found on a SECOND address is it
- *  tracked in the small temporary 'multi' map (hostname -> its ip strings) and
- *  appended to 'multi_names'; hosthash keeps pointing at the shared reverse
- *  entry until the finalize pass replaces it. */
-static ares_status_t ares_hosts_file_add(ares_hosts_file_t   *hosts,
-                                         ares_htable_strvp_t *multi,
-                                         ares_llist_t        *multi_names,
-                                         ares_hosts_entry_t  *entry)
+ *  Each new edge is appended to the address's reverse entry in iphash.  A
+ *  hostname's first sighting is wired directly into hosthash as a shared
+ *  reference to that reverse entry (the single-address fast path).  Only when
+ *  a hostname is later found on a SECOND address is it tracked in the small
+ *  temporary 'multi' map (hostname -> its interned ip strings) and appended to
+ *  'multi_names'; hosthash keeps pointing at the shared reverse entry until
+ *  the finalize pass replaces it. */
+static ares_status_t ares_hosts_db_add(ares_hosts_db_t     *db,
+                                       ares_htable_strvp_t *multi,
+                                       ares_llist_t        *multi_names,
+                                       ares_hosts_entry_t  *rev,
+                                       const char          *host)
 {
-  const char        *ipaddr = ares_llist_first_val(entry->ips);
-  ares_llist_node_t *node;
-  ares_status_t      status = ARES_SUCCESS;
-
-  for (node = ares_llist_node_first(entry->hosts); node != NULL;
-       node = ares_llist_node_next(node)) {
-    const char         *host = ares_llist_node_val(node);
-    ares_hosts_entry_t *rev;
-    ares_hosts_entry_t *cur;
-    ares_llist_t       *m;
-
-    /* Reverse entry for this line's ip */
-    status = ares_hosts_reverse_entry(hosts, ipaddr, &rev);
-    if (status != ARES_SUCCESS) {
-      goto done; /* LCOV_EXCL_LINE: OutOfMemory */
+  const char         *ipaddr = ares_hosts_str_at(rev->ips, 0);
+  unsigned int        hash   = ares_hosts_hash(db, host);
+  ares_hosts_slot_t  *slot   = ares_hosts_index_find(&db->hosthash, host, hash);
+  ares_hosts_entry_t *cur;
+  const char         *name;
+  ares_array_t       *m;
+  size_t              i;
+
+  if (slot->key == NULL) {
+    /* First sighting of host: assume single-address, share this reverse
+     * entry.  The (host, ip) edge is new. */
+    name = ares_hosts_intern(db, host);
+    if (name == NULL) {
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
     }
-
-    cur = ares_htable_strvp_get_direct(hosts->hosthash, host);
-
-    if (cur == NULL) {
-      /* First sighting of host: assume single-address, share this reverse
-       * entry.  The (host, ip) edge is new. */
-      if (!ares_htable_strvp_insert(hosts->hosthash, host, rev)) {
-        status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
-        goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
-      }
-      rev->refcnt++;
-      if (ares_hosts_list_append_strdup(rev->hosts, host) == NULL) {
-        status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
-        goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
-      }
-      continue;
+    if (ares_hosts_index_insert(&db->hosthash, name, hash, rev) !=
+        ARES_SUCCESS) {
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
     }
+    return ares_array_insertdata_last(rev->hosts, &name);
+  }
 
-    if (cur == rev) {
-      /* host already recorded on this same ip -> duplicate edge, skip */
-      continue;
-    }
+  cur = slot->entry;
 
-    /* host is (or is becoming) multi-address: cur is the reverse entry of its
-     * first address, which differs from this line's ip. */
-    m = ares_htable_strvp_get_direct(multi, host);
-    if (m == NULL) {
-      /* Second distinct address: start tracking host's address list.  Seed it
-       * with its existing first address followed by this one. */
-      const char *first_ip = ares_llist_first_val(cur->ips);
-      char       *hostcopy;
-
-      m = ares_llist_create(ares_free);
-      if (m == NULL) {
-        status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
-        goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
-      }
-      if (ares_hosts_list_append_strdup(m, first_ip) == NULL ||
-          ares_hosts_list_append_strdup(m, ipaddr) == NULL) {
-        ares_llist_destroy(m); /* LCOV_EXCL_LINE: OutOfMemory */
-        status = ARES_ENOMEM;  /* LCOV_EXCL_LINE: OutOfMemory */
-        goto done;             /* LCOV_EXCL_LINE: OutOfMemory */
-      }
-      if (!ares_htable_strvp_insert(multi, host, m)) {
-        ares_llist_destroy(m); /* LCOV_EXCL_LINE: OutOfMemory */
-        status = ARES_ENOMEM;  /* LCOV_EXCL_LINE: OutOfMemory */
-        goto done;             /* LCOV_EXCL_LINE: OutOfMemory */
-      }
+  if (cur == rev) {
+    /* host already recorded on this same ip -> duplicate edge, skip */
+    return ARES_SUCCESS;
+  }
 
-      /* The (host, ip) edge is new; append to this ip's reverse entry and
-       * remember host (by reference to the persistent copy) for finalize. */
-      hostcopy = ares_hosts_list_append_strdup(rev->hosts, host);
-      if (hostcopy == NULL) {
-        status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
-        goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
+  /* host is (or is becoming) multi-address: cur is the reverse entry of its
+   * first address, which differs from this line's ip.  Keep the key for
+   * finalize, but this line's spelling for the reverse entry. */
+  name = slot->key;
+  m    = ares_htable_strvp_get_direct(multi, name);
+  if (m != NULL) {
+    /* Already multi-address.  Record the edge if this ip is new for host.
+     * Addresses are interned once, so comparing pointers is enough. */
+    for (i = 0; i < ares_array_len(m); i++) {
+      if (ares_hosts_str_at(m, i) == ipaddr) {
+        return ARES_SUCCESS;
       }
-      if (ares_llist_insert_last(multi_names, hostcopy) == NULL) {
-        status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
-        goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
-      }
-      continue;
     }
+  } else {
+    /* Second distinct address: start tracking host's address list.  Seed it
+     * with its existing first address, and remember host for finalize. */
+    const char *first_ip = ares_hosts_str_at(cur->ips, 0);
 
-    /* Already multi-address.  Record the edge if this ip is new for host. */
-    if (ares_hosts_strlist_contains(m, ipaddr)) {
-      continue;
+    m = ares_array_create(sizeof(const char *), NULL);
+    if (m == NULL) {
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
     }
-    if (ares_hosts_list_append_strdup(m, ipaddr) == NULL) {
-      status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
-      goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
+    if (ares_array_insertdata_last(m, &first_ip) != ARES_SUCCESS) {
+      ares_array_destroy(m); /* LCOV_EXCL_LINE: OutOfMemory */
+      return ARES_ENOMEM;    /* LCOV_EXCL_LINE: OutOfMemory */
     }
-    if (ares_hosts_list_append_strdup(rev->hosts, host) == NULL) {
-      status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
-      goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
+    if (!ares_htable_strvp_insert(multi, name, m)) {
+      ares_array_destroy(m); /* LCOV_EXCL_LINE: OutOfMemory */
+      return ARES_ENOMEM;    /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+    if (ares_llist_insert_last(multi_names, (void *)((size_t)name)) == NULL) {
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
     }
   }
 
-done:
-  ares_hosts_entry_destroy(entry);
-  return status;
+  if (ares_array_insertdata_last(m, &ipaddr) != ARES_SUCCESS) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  if (!ares_streq(name, host)) {
+    name = ares_hosts_intern(db, host);
+    if (name == NULL) {
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+  return ares_array_insertdata_last(rev->hosts, &name);
 }
 
 /* Build the forward entry for a hostname that appeared with 2+ addresses:
- * { refcnt=1, ips=[its addresses, file order],
+ * { ips=[its addresses, file order],
  *   hosts=[canonical + up to 100 address-scoped aliases] }. */
-static ares_status_t ares_hosts_build_forward_entry(ares_hosts_file_t   *hosts,
-                                                    ares_llist_t        *flist,
+static ares_status_t ares_hosts_build_forward_entry(ares_hosts_db_t     *db,
+                                                    const ares_array_t  *ips,
                                                     ares_hosts_entry_t **out)
 {
   ares_hosts_entry_t *ent;
-  ares_llist_node_t  *ipnode;
+  size_t              i;
 
   *out = NULL;
 
-  ent = ares_malloc_zero(sizeof(*ent));
+  ent = ares_hosts_entry_create(db);
   if (ent == NULL) {
     return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
   }
-  ent->refcnt = 1;
-  ent->ips    = ares_llist_create(ares_free);
-  ent->hosts  = ares_llist_create(ares_free);
-  if (ent->ips == NULL || ent->hosts == NULL) {
-    ares_hosts_entry_destroy(ent); /* LCOV_EXCL_LINE: OutOfMemory */
-    return ARES_ENOMEM;            /* LCOV_EXCL_LINE: OutOfMemory */
-  }
-
-  /* ips = this hostname's addresses, in file order */
-  for (ipnode = ares_llist_node_first(flist); ipnode != NULL;
-       ipnode = ares_llist_node_next(ipnode)) {
-    if (ares_hosts_list_append_strdup(ent->ips, ares_llist_node_val(ipnode)) ==
-        NULL) {
-      ares_hosts_entry_destroy(ent); /* LCOV_EXCL_LINE: OutOfMemory */
-      return ARES_ENOMEM;            /* LCOV_EXCL_LINE: OutOfMemory */
-    }
-  }
 
   /* hosts = address-scoped alias list, canonical first.  Iterate the addresses
    * in order; for each, iterate the reverse entry's hostnames in order,
    * appending each name not already present (case-insensitive).  Cap at 101
    * (canonical + 100 aliases) to bound the StevenBlack blocklist case. */
-  for (ipnode = ares_llist_node_first(ent->ips); ipnode != NULL;
-       ipnode = ares_llist_node_next(ipnode)) {
-    const char         *ip  = ares_llist_node_val(ipnode);
-    ares_hosts_entry_t *rev = ares_htable_strvp_get_direct(hosts->iphash, ip);
-    ares_llist_node_t  *nnode;
-
-    /* Every ip in ent->ips was recorded during parse and so has an iphash
-     * entry; nothing removes from iphash.  Guard anyway so a future change that
-     * could drop an entry degrades to a lookup miss rather than a NULL deref.
-     */
+  for (i = 0; i < ares_array_len(ips); i++) {
+    const char         *ip  = ares_hosts_str_at(ips, i);
+    ares_hosts_entry_t *rev = ares_hosts_index_get(db, &db->iphash, ip);
+    size_t              j;
+
+    /* ips = this hostname's addresses, in file order */
+    if (ares_array_insertdata_last(ent->ips, &ip) != ARES_SUCCESS) {
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+
+    /* Every ip was recorded during parse and so has an iphash entry; nothing
+     * removes from iphash.  Guard anyway so a future change that could drop
+     * an entry degrades to a lookup miss rather than a NULL deref. */
     if (rev == NULL) {
       continue; /* LCOV_EXCL_LINE: DefensiveCoding */
     }
 
-    if (ares_llist_len(ent->hosts) >= ARES_HOSTS_MAX_ALIASES + 1) {
-      break; /* LCOV_EXCL_LINE: FallbackCode */
-    }
+    for (j = 0; j < ares_array_len(rev->hosts); j++) {
+      const char *nm = ares_hosts_str_at(rev->hosts, j);
 
-    for (nnode = ares_llist_node_first(rev->hosts); nnode != NULL;
-         nnode = ares_llist_node_next(nnode)) {
-      const char *nm = ares_llist_node_val(nnode);
+      if (ares_array_len(ent->hosts) >= ARES_HOSTS_MAX_ALIASES + 1) {
+        break; /* LCOV_EXCL_LINE: FallbackCode */
+      }
 
-      if (ares_hosts_strlist_contains(ent->hosts, nm)) {
+      if (ares_hosts_strs_contains(ent->hosts, nm)) {
         continue;
       }
-      if (ares_llist_len(ent->hosts) >= ARES_HOSTS_MAX_ALIASES + 1) {
-        break; /* LCOV_EXCL_LINE: FallbackCode */
-      }
 
-      if (ares_hosts_list_append_strdup(ent->hosts, nm) == NULL) {
-        ares_hosts_entry_destroy(ent); /* LCOV_EXCL_LINE: OutOfMemory */
-        return ARES_ENOMEM;            /* LCOV_EXCL_LINE: OutOfMemory */
+      if (ares_array_insertdata_last(ent->hosts, &nm) != ARES_SUCCESS) {
+        return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
       }
     }
   }
@@ -525,10 +709,9 @@ static ares_status_t ares_hosts_build_forward_entry(ares_hosts_file_t   *hosts,
 
 /* After all lines are parsed, give each multi-address hostname its own
  * dedicated forward entry.  During the parse hosthash[name] was left pointing
- * at the shared reverse entry of the name's first address; inserting the
- * forward entry over that key invokes the value destructor on the old shared
- * entry (dropping its reference), cleanly un-sharing it. */
-static ares_status_t ares_hosts_finalize(ares_hosts_file_t   *hosts,
+ * at the shared reverse entry of the name's first address; the slot is simply
+ * repointed, the reverse entry stays owned by the db. */
+static ares_status_t ares_hosts_finalize(ares_hosts_db_t     *db,
                                          ares_htable_strvp_t *multi,
                                          ares_llist_t        *multi_names)
 {
@@ -537,52 +720,34 @@ static ares_status_t ares_hosts_finalize(ares_hosts_file_t   *hosts,
   for (node = ares_llist_node_first(multi_names); node != NULL;
        node = ares_llist_node_next(node)) {
     const char         *name = ares_llist_node_val(node);
-    ares_llist_t       *m    = ares_htable_strvp_get_direct(multi, name);
+    ares_array_t       *m    = ares_htable_strvp_get_direct(multi, name);
     ares_hosts_entry_t *ent;
     ares_status_t       status;
 
-    status = ares_hosts_build_forward_entry(hosts, m, &ent);
+    status = ares_hosts_build_forward_entry(db, m, &ent);
     if (status != ARES_SUCCESS) {
       return status; /* LCOV_EXCL_LINE: OutOfMemory */
     }
 
-    if (!ares_htable_strvp_insert(hosts->hosthash, name, ent)) {
-      ares_hosts_entry_destroy(ent); /* LCOV_EXCL_LINE: OutOfMemory */
-      return ARES_ENOMEM;            /* LCOV_EXCL_LINE: OutOfMemory */
-    }
+    ares_hosts_index_find(&db->hosthash, name, ares_hosts_hash(db, name))
+      ->entry = ent;
   }
 
   return ARES_SUCCESS;
 }
 
-static ares_bool_t ares_hosts_entry_isdup(ares_hosts_entry_t *entry,
-                                          const char         *host)
-{
-  ares_llist_node_t *node;
-
-  for (node = ares_llist_node_first(entry->hosts); node != NULL;
-       node = ares_llist_node_next(node)) {
-    const char *myhost = ares_llist_node_val(node);
-    if (ares_strcaseeq(myhost, host)) {
-      return ARES_TRUE;
-    }
-  }
-
-  return ARES_FALSE;
-}
-
-static ares_status_t ares_parse_hosts_hostnames(ares_buf_t         *buf,
-                                                ares_hosts_entry_t *entry)
+static ares_status_t ares_parse_hosts_hostnames(ares_buf_t          *buf,
+                                                ares_hosts_db_t     *db,
+                                                ares_htable_strvp_t *multi,
+                                                ares_llist_t  *multi_names,
+                                                const char    *ipaddr)
 {
-  entry->hosts = ares_llist_create(ares_free);
-  if (entry->hosts == NULL) {
-    return ARES_ENOMEM;
-  }
+  ares_hosts_entry_t *rev = NULL;
+  size_t              cnt = 0;
 
   /* Parse hostnames and aliases */
   while (ares_buf_len(buf)) {
     char          hostname[256];
-    char         *temp;
     ares_status_t status;
     unsigned char comment = '#';
 
@@ -609,7 +774,7 @@ static ares_status_t ares_parse_hosts_hostnames(ares_buf_t         *buf,
     if (status != ARES_SUCCESS) {
       /* Bad entry, just ignore as long as its not the first.  If its the first,
        * it must be valid */
-      if (ares_llist_len(entry->hosts) == 0) {
+      if (cnt == 0) {
         return ARES_EBADSTR;
       }
 
@@ -621,98 +786,86 @@ static ares_status_t ares_parse_hosts_hostnames(ares_buf_t         *buf,
       continue;
     }
 
-    /* Don't add a duplicate to the same entry */
-    if (ares_hosts_entry_isdup(entry, hostname)) {
-      continue;
-    }
-
-    /* Add to list */
-    temp = ares_strdup(hostname);
-    if (temp == NULL) {
-      return ARES_ENOMEM;
+    /* Reverse entry for this line's ip, only once the line has a name */
+    if (rev == NULL) {
+      status = ares_hosts_reverse_entry(db, ipaddr, &rev);
+      if (status != ARES_SUCCESS) {
+        return status; /* LCOV_EXCL_LINE: OutOfMemory */
+      }
     }
 
-    if (ares_llist_insert_last(entry->hosts, temp) == NULL) {
-      ares_free(temp);
-      return ARES_ENOMEM;
+    /* Duplicates on the same line are the same edge, and skipped */
+    status = ares_hosts_db_add(db, multi, multi_names, rev, hostname);
+    if (status != ARES_SUCCESS) {
+      return status; /* LCOV_EXCL_LINE: OutOfMemory */
     }
+    cnt++;
   }
 
   /* Must have at least 1 entry */
-  if (ares_llist_len(entry->hosts) == 0) {
+  if (cnt == 0) {
     return ARES_EBADSTR;
   }
 
   return ARES_SUCCESS;
 }
 
-static ares_status_t ares_parse_hosts_ipaddr(ares_buf_t          *buf,
-                                             ares_hosts_entry_t **entry_out)
+static ares_status_t ares_parse_hosts_ipaddr(ares_buf_t *buf, char *addr,
+                                             size_t addr_len)
 {
-  char                addr[INET6_ADDRSTRLEN];
-  char               *temp;
-  ares_hosts_entry_t *entry = NULL;
-  ares_status_t       status;
-
-  *entry_out = NULL;
+  ares_status_t status;
 
   ares_buf_tag(buf);
   ares_buf_consume_nonwhitespace(buf);
-  status =
-    ares_buf_tag_fetch_string(buf, addr, sizeof(addr), ARES_BUF_CHARSET_ASCII);
+  status = ares_buf_tag_fetch_string(buf, addr, addr_len,
+                                     ARES_BUF_CHARSET_ASCII);
   if (status != ARES_SUCCESS) {
     return status;
   }
 
   /* Validate and normalize the ip address format */
-  if (!ares_normalize_ipaddr(addr, addr, sizeof(addr))) {
+  if (!ares_normalize_ipaddr(addr, addr, addr_len)) {
     return ARES_EBADSTR;
   }
 
-  entry = ares_malloc_zero(sizeof(*entry));
-  if (entry == NULL) {
-    return ARES_ENOMEM;
-  }
-
-  entry->ips = ares_llist_create(ares_free);
-  if (entry->ips == NULL) {
-    ares_hosts_entry_destroy(entry);
-    return ARES_ENOMEM;
-  }
+  return ARES_SUCCESS;
+}
 
-  temp = ares_strdup(addr);
-  if (temp == NULL) {
-    ares_hosts_entry_destroy(entry);
-    return ARES_ENOMEM;
+ares_bool_t ares_file_stat(const char *filename, time_t *mtime, size_t *size)
+{
+#ifdef HAVE_STAT
+  struct stat st;
+  if (stat(filename, &st) == 0) {
+    *mtime = st.st_mtime;
+    *size  = (size_t)st.st_size;
+    return ARES_TRUE;
   }
-
-  if (ares_llist_insert_first(entry->ips, temp) == NULL) {
-    ares_free(temp);
-    ares_hosts_entry_destroy(entry);
-    return ARES_ENOMEM;
+#elif defined(_WIN32)
+  struct _stat st;
+  if (_stat(filename, &st) == 0) {
+    *mtime = st.st_mtime;
+    *size  = (size_t)st.st_size;
+    return ARES_TRUE;
   }
-
-  *entry_out = entry;
-
-  return ARES_SUCCESS;
+#else
+  (void)filename;
+  (void)mtime;
+  (void)size;
+#endif
+  return ARES_FALSE;
 }
 
-static ares_status_t ares_parse_hosts(const char         *filename,
-                                      ares_hosts_file_t **out)
+static ares_status_t ares_parse_hosts(const char *filename, ares_hosts_db_t *db)
 {
   ares_buf_t          *buf    = NULL;
   ares_status_t        status = ARES_EBADRESP;
-  ares_hosts_file_t   *hf     = NULL;
-  ares_hosts_entry_t  *entry  = NULL;
   /* Small temporaries tracking ONLY multi-address hostnames: their ip lists
-   * (multi) and the order they became multi (multi_names, holding references,
-   * not owned, to hostname copies that live in the reverse entries).  For a
-   * single-address file these stay empty.  Discarded before returning. */
+   * (multi) and the order they became multi (multi_names, holding interned
+   * hostnames).  For a single-address file these stay empty.  Discarded
+   * before returning. */
   ares_htable_strvp_t *multi       = NULL;
   ares_llist_t        *multi_names = NULL;
 
-  *out = NULL;
-
   buf = ares_buf_create();
   if (buf == NULL) {
     status = ARES_ENOMEM;
@@ -724,13 +877,7 @@ static ares_status_t ares_parse_hosts(const char         *filename,
     goto done;
   }
 
-  hf = ares_hosts_file_create(filename);
-  if (hf == NULL) {
-    status = ARES_ENOMEM;
-    goto done;
-  }
-
-  multi       = ares_htable_strvp_create(ares_hosts_list_destroy_cb);
+  multi       = ares_htable_strvp_create(ares_hosts_array_destroy_cb);
   multi_names = ares_llist_create(NULL);
   if (multi == NULL || multi_names == NULL) {
     status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
@@ -738,6 +885,7 @@ static ares_status_t ares_parse_hosts(const char         *filename,
   }
 
   while (ares_buf_len(buf)) {
+    char          addr[INET6_ADDRSTRLEN];
     unsigned char comment = '#';
 
     /* -- Start of new line here -- */
@@ -756,7 +904,7 @@ static ares_status_t ares_parse_hosts(const char         *filename,
     }
 
     /* Pull off ip address */
-    status = ares_parse_hosts_ipaddr(buf, &entry);
+    status = ares_parse_hosts_ipaddr(buf, addr, sizeof(addr));
     if (status == ARES_ENOMEM) {
       goto done;
     }
@@ -766,24 +914,12 @@ static ares_status_t ares_parse_hosts(const char         *filename,
       continue;
     }
 
-    /* Parse of the hostnames */
-    status = ares_parse_hosts_hostnames(buf, entry);
+    /* Parse of the hostnames, recording each line's edges as we go (reverse
+     * entries + single-address sharing; multi-address names accumulate in
+     * multi/multi_names).  A bad line records nothing. */
+    status = ares_parse_hosts_hostnames(buf, db, multi, multi_names, addr);
     if (status == ARES_ENOMEM) {
       goto done;
-    } else if (status != ARES_SUCCESS) {
-      /* Bad line, consume and go onto next */
-      ares_hosts_entry_destroy(entry);
-      entry = NULL;
-      ares_buf_consume_line(buf, ARES_TRUE);
-      continue;
-    }
-
-    /* Record this line's edges (reverse entries + single-address sharing;
-     * multi-address names accumulate in multi/multi_names) */
-    status = ares_hosts_file_add(hf, multi, multi_names, entry);
-    entry  = NULL; /* is always invalidated by this function, even on error */
-    if (status != ARES_SUCCESS) {
-      goto done;
     }
 
     /* Go to next line */
@@ -791,7 +927,7 @@ static ares_status_t ares_parse_hosts(const char         *filename,
   }
 
   /* Give each multi-address hostname its dedicated forward entry */
-  status = ares_hosts_finalize(hf, multi, multi_names);
+  status = ares_hosts_finalize(db, multi, multi_names);
   if (status != ARES_SUCCESS) {
     goto done; /* LCOV_EXCL_LINE: OutOfMemory */
   }
@@ -799,79 +935,205 @@ static ares_status_t ares_parse_hosts(const char         *filename,
   status = ARES_SUCCESS;
 
 done:
-  ares_hosts_entry_destroy(entry);
   ares_llist_destroy(multi_names);
   ares_htable_strvp_destroy(multi);
   ares_buf_destroy(buf);
+  return status;
+}
+
+/* Take a reference to the parsed hosts file, reusing one already loaded by
+ * another channel if the file hasn't changed since. */
+static ares_status_t ares_hosts_db_acquire(const char       *filename,
+                                           ares_hosts_db_t **out)
+{
+  ares_hosts_db_t *db;
+  ares_status_t    status;
+  time_t           ts        = time(NULL);
+  time_t           mtime     = 0;
+  size_t           size      = 0;
+  ares_bool_t      have_stat = ARES_FALSE;
+
+  *out = NULL;
+
+  /* Record what is being loaded before reading it, so a modification while
+   * reading is seen as a modification afterwards */
+  have_stat = ares_file_stat(filename, &mtime, &size);
+
+  if (have_stat) {
+    ares_thread_global_lock();
+    for (db = ares_hosts_dbs; db != NULL; db = db->next) {
+      /* A file loaded within the same second it was modified may have missed
+       * a later modification within that second, so isn't reused */
+      if (db->have_stat && db->mtime == mtime && db->size == size &&
+          db->ts > db->mtime && ares_strcaseeq(db->filename, filename)) {
+        db->refcnt++;
+        *out = db;
+        break;
+      }
+    }
+    ares_thread_global_unlock();
+
+    if (*out != NULL) {
+      return ARES_SUCCESS;
+    }
+  }
+
+  db = ares_hosts_db_create(filename);
+  if (db == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+  db->ts        = ts;
+  db->mtime     = mtime;
+  db->size      = size;
+  db->have_stat = have_stat;
+
+  /* Parsed without holding the global lock, if another channel is parsing the
+   * same file at the same time we'll each end up with our own copy, which is
+   * harmless */
+  status = ares_parse_hosts(filename, db);
   if (status != ARES_SUCCESS) {
-    ares_hosts_file_destroy(hf);
-  } else {
-    *out = hf;
+    ares_hosts_db_destroy(db);
+    return status;
   }
-  return status;
+
+  ares_thread_global_lock();
+  db->refcnt     = 1;
+  db->next       = ares_hosts_dbs;
+  ares_hosts_dbs = db;
+  ares_thread_global_unlock();
+
+  *out = db;
+  return ARES_SUCCESS;
 }
 
-static ares_bool_t ares_hosts_expired(const char              *filename,
-                                      const ares_hosts_file_t *hf)
+static void ares_hosts_db_release(ares_hosts_db_t *db)
 {
-  time_t mod_ts = 0;
+  ares_hosts_db_t **ptr;
 
-#ifdef HAVE_STAT
-  struct stat st;
-  if (stat(filename, &st) == 0) {
-    mod_ts = st.st_mtime;
+  if (db == NULL) {
+    return;
   }
-#elif defined(_WIN32)
-  struct _stat st;
-  if (_stat(filename, &st) == 0) {
-    mod_ts = st.st_mtime;
+
+  ares_thread_global_lock();
+  db->refcnt--;
+  if (db->refcnt > 0) {
+    ares_thread_global_unlock();
+    return;
   }
-#else
-  (void)filename;
-#endif
 
+  for (ptr = &ares_hosts_dbs; *ptr != NULL; ptr = &(*ptr)->next) {
+    if (*ptr == db) {
+      *ptr = db->next;
+      break;
+    }
+  }
+  ares_thread_global_unlock();
+
+  ares_hosts_db_destroy(db);
+}
+
+void ares_hosts_file_destroy(ares_hosts_file_t *hf)
+{
   if (hf == NULL) {
-    return ARES_TRUE;
+    return;
   }
 
-  /* Expire every 60s if we can't get a time */
-  if (mod_ts == 0) {
-    mod_ts =
-      time(NULL) - 60; /* LCOV_EXCL_LINE: only on systems without stat() */
+  ares_hosts_db_release(hf->db);
+  ares_free(hf->path);
+  ares_free(hf);
+}
+
+ares_status_t ares_hosts_file_duplicate(ares_hosts_file_t      **dest,
+                                        const ares_hosts_file_t *src)
+{
+  ares_hosts_file_t *hf;
+
+  *dest = NULL;
+
+  if (src == NULL) {
+    return ARES_SUCCESS;
   }
 
-  /* If filenames are different, its expired */
-  if (!ares_strcaseeq(hf->filename, filename)) {
+  hf = ares_malloc_zero(sizeof(*hf));
+  if (hf == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  if (src->path != NULL) {
+    hf->path = ares_strdup(src->path);
+    if (hf->path == NULL) {
+      ares_free(hf);      /* LCOV_EXCL_LINE: OutOfMemory */
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  /* The parsed file is immutable once loaded, so it is shared by reference.
+   * A later modification loads a new one for whichever channel notices
+   * first, leaving the other with the old one until it checks too. */
+  if (src->db != NULL) {
+    ares_thread_global_lock();
+    src->db->refcnt++;
+    ares_thread_global_unlock();
+  }
+
+  hf->db      = src->db;
+  hf->checked = src->checked;
+  hf->stale   = src->stale;
+
+  *dest = hf;
+  return ARES_SUCCESS;
+}
+
+static ares_bool_t ares_hosts_modified(const char            *filename,
+                                       const ares_hosts_db_t *db)
+{
+  time_t mtime = 0;
+  size_t size  = 0;
+
+  /* Reload every 60s if we can't get a time */
+  if (!ares_file_stat(filename, &mtime, &size)) {
+    return time(NULL) - db->ts >= 60 ? ARES_TRUE : ARES_FALSE;
+  }
+
+  if (mtime != db->mtime || size != db->size) {
     return ARES_TRUE;
   }
 
-  if (hf->ts <= mod_ts) {
+  /* The modification time only has a resolution of a second.  If the file was
+   * loaded within the same second it was last modified, a further modification
+   * within that second would go unnoticed, so load it again. */
+  if (db->ts <= db->mtime) {
     return ARES_TRUE;
   }
 
   return ARES_FALSE;
 }
 
+/* The path from the environment is looked up each time as it may change, any
+ * other path is resolved once and kept until the next reinit. */
 static ares_status_t ares_hosts_path(const ares_channel_t *channel,
-                                     ares_bool_t use_env, char **path)
+                                     ares_hosts_file_t *hf, ares_bool_t use_env,
+                                     const char **path)
 {
   char *path_hosts = NULL;
 
   *path = NULL;
 
-  if (channel->hosts_path) {
-    path_hosts = ares_strdup(channel->hosts_path);
-    if (!path_hosts) {
-      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  if (use_env) {
+    *path = getenv("CARES_HOSTS");
+    if (*path == NULL) {
+      return ARES_ENOMEM;
     }
+    return ARES_SUCCESS;
   }
 
-  if (use_env) {
-    if (path_hosts) {
-      ares_free(path_hosts);
-    }
+  if (hf->path != NULL) {
+    *path = hf->path;
+    return ARES_SUCCESS;
+  }
 
-    path_hosts = ares_strdup(getenv("CARES_HOSTS"));
+  if (channel->hosts_path) {
+    path_hosts = ares_strdup(channel->hosts_path);
     if (!path_hosts) {
       return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
     }
@@ -908,40 +1170,91 @@ static ares_status_t ares_hosts_path(const ares_channel_t *channel,
     }
   }
 
-  *path = path_hosts;
+  hf->path = path_hosts;
+  *path    = path_hosts;
   return ARES_SUCCESS;
 }
 
 static ares_status_t ares_hosts_update(ares_channel_t *channel,
-                                       ares_bool_t     use_env)
+                                      ares_bool_t     use_env)
 {
-  ares_status_t status;
-  char         *filename = NULL;
+  ares_status_t      status;
+  const char        *filename = NULL;
+  ares_timeval_t     now;
+  ares_hosts_file_t *hf;
+  ares_hosts_db_t   *db = NULL;
 
-  status = ares_hosts_path(channel, use_env, &filename);
+  if (channel->hf == NULL) {
+    channel->hf = ares_malloc_zero(sizeof(*channel->hf));
+    if (channel->hf == NULL) {
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+  hf = channel->hf;
+
+  status = ares_hosts_path(channel, hf, use_env, &filename);
   if (status != ARES_SUCCESS) {
     return status;
   }
 
-  if (!ares_hosts_expired(filename, channel->hf)) {
-    ares_free(filename);
-    return ARES_SUCCESS;
+  ares_tvnow(&now);
+
+  /* If filenames are different, its expired */
+  if (hf->db != NULL && ares_strcaseeq(hf->db->filename, filename)) {
+    ares_timeval_t next = hf->checked;
+
+    /* Rate limit how often the file is checked for modification */
+    ares_timeval_add(&next, ARES_HOSTS_CHECK_INTERVAL_MS);
+    if (!hf->stale && !ares_timedout(&now, &next)) {
+      return ARES_SUCCESS;
+    }
+
+    hf->checked = now;
+    hf->stale   = ARES_FALSE;
+    if (!ares_hosts_modified(filename, hf->db)) {
+      return ARES_SUCCESS;
+    }
   }
 
-  ares_hosts_file_destroy(channel->hf);
-  channel->hf = NULL;
+  ares_hosts_db_release(hf->db);
+  hf->db = NULL;
 
-  status = ares_parse_hosts(filename, &channel->hf);
-  ares_free(filename);
+  status = ares_hosts_db_acquire(filename, &db);
+  if (status == ARES_SUCCESS) {
+    hf->db      = db;
+    hf->checked = now;
+    hf->stale   = ARES_FALSE;
+  }
   return status;
 }
 
+void ares_hosts_file_expire(ares_hosts_file_t *hf)
+{
+  if (hf == NULL) {
+    return;
+  }
+  hf->stale = ARES_TRUE;
+  /* The system path may have changed along with the rest of the
+   * configuration, so resolve it again too */
+  ares_free(hf->path);
+  hf->path = NULL;
+}
+
+const void *ares_hosts_file_id(const ares_channel_t *channel)
+{
+  if (channel == NULL || channel->hf == NULL) {
+    return NULL;
+  }
+  return channel->hf->db;
+}
+
 ares_status_t ares_hosts_search_ipaddr(ares_channel_t *channel,
                                        ares_bool_t use_env, const char *ipaddr,
                                        const ares_hosts_entry_t **entry)
 {
-  ares_status_t status;
-  char          addr[INET6_ADDRSTRLEN];
+  ares_status_t          status;
+  char                   addr[INET6_ADDRSTRLEN];
+  const ares_hosts_db_t *db;
 
   *entry = NULL;
 
@@ -950,7 +1263,8 @@ ares_status_t ares_hosts_search_ipaddr(ares_channel_t *channel,
     return status;
   }
 
-  if (channel->hf == NULL) {
+  db = channel->hf->db;
+  if (db == NULL) {
     return ARES_ENOTFOUND; /* LCOV_EXCL_LINE: DefensiveCoding */
   }
 
@@ -959,7 +1273,7 @@ ares_status_t ares_hosts_search_ipaddr(ares_channel_t *channel,
   }
 
   /* Cached, address-scoped reverse entry (caller does not free) */
-  *entry = ares_htable_strvp_get_direct(channel->hf->iphash, addr);
+  *entry = ares_hosts_index_get(db, &db->iphash, addr);
   if (*entry == NULL) {
     return ARES_ENOTFOUND;
   }
@@ -971,7 +1285,8 @@ ares_status_t ares_hosts_search_host(ares_channel_t *channel,
                                      ares_bool_t use_env, const char *host,
                                      const ares_hosts_entry_t **entry)
 {
-  ares_status_t status;
+  ares_status_t          status;
+  const ares_hosts_db_t *db;
 
   *entry = NULL;
 
@@ -980,12 +1295,13 @@ ares_status_t ares_hosts_search_host(ares_channel_t *channel,
     return status;
   }
 
-  if (channel->hf == NULL) {
+  db = channel->hf->db;
+  if (db == NULL) {
     return ARES_ENOTFOUND; /* LCOV_EXCL_LINE: DefensiveCoding */
   }
 
   /* Cached, address-scoped forward entry (caller does not free) */
-  *entry = ares_htable_strvp_get_direct(channel->hf->hosthash, host);
+  *entry = ares_hosts_index_get(db, &db->hosthash, host);
   if (*entry == NULL) {
     return ARES_ENOTFOUND;
   }
@@ -995,58 +1311,53 @@ ares_status_t ares_hosts_search_host(ares_channel_t *channel,
 
 static ares_status_t
   ares_hosts_ai_append_cnames(const ares_hosts_entry_t    *entry,
+                              ares_arena_t                *arena,
                               struct ares_addrinfo_cname **cnames_out)
 {
   struct ares_addrinfo_cname *cname       = NULL;
   struct ares_addrinfo_cname *cnames      = NULL;
-  const char                 *primaryhost = ares_llist_first_val(entry->hosts);
-  ares_llist_node_t          *node;
+  const char                 *primaryhost = ares_hosts_str_at(entry->hosts, 0);
   ares_status_t               status;
-  size_t                      cnt = 0;
+  size_t                      i;
 
   /* Canonical name is the first host (in file order); aliases are the rest. */
-  node = ares_llist_node_next(ares_llist_node_first(entry->hosts));
-
-  while (node != NULL) {
-    const char *host = ares_llist_node_val(node);
+  for (i = 1; i < ares_array_len(entry->hosts); i++) {
+    const char *host = ares_hosts_str_at(entry->hosts, i);
 
     /* Cap aliases (ARES_HOSTS_MAX_ALIASES); some people use
      * https://github.com/StevenBlack/hosts and we don't need 200k+ aliases */
-    cnt++;
-    if (cnt > ARES_HOSTS_MAX_ALIASES) {
+    if (i > ARES_HOSTS_MAX_ALIASES) {
       break; /* LCOV_EXCL_LINE: FallbackCode */
     }
 
-    cname = ares_append_addrinfo_cname(&cnames);
+    cname = ares_append_addrinfo_cname(arena, &cnames);
     if (cname == NULL) {
       status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
       goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
     }
 
-    cname->alias = ares_strdup(host);
+    cname->alias = ares_arena_strdup(arena, host);
     if (cname->alias == NULL) {
       status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
       goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
     }
 
-    cname->name = ares_strdup(primaryhost);
+    cname->name = ares_arena_strdup(arena, primaryhost);
     if (cname->name == NULL) {
       status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
       goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
     }
-
-    node = ares_llist_node_next(node);
   }
 
   /* No entries, add only primary */
   if (cnames == NULL) {
-    cname = ares_append_addrinfo_cname(&cnames);
+    cname = ares_append_addrinfo_cname(arena, &cnames);
     if (cname == NULL) {
       status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
       goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
     }
 
-    cname->name = ares_strdup(primaryhost);
+    cname->name = ares_arena_strdup(arena, primaryhost);
     if (cname->name == NULL) {
       status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
       goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
@@ -1056,8 +1367,7 @@ static ares_status_t
 
 done:
   if (status != ARES_SUCCESS) {
-    ares_freeaddrinfo_cnames(cnames); /* LCOV_EXCL_LINE: DefensiveCoding */
-    return status;                    /* LCOV_EXCL_LINE: DefensiveCoding */
+    return status; /* LCOV_EXCL_LINE: DefensiveCoding */
   }
 
   *cnames_out = cnames;
@@ -1068,12 +1378,13 @@ ares_status_t ares_hosts_entry_to_addrinfo(const ares_hosts_entry_t *entry,
                                            const char *name, int family,
                                            unsigned short        port,
                                            ares_bool_t           want_cnames,
+                                           ares_arena_t         *arena,
                                            struct ares_addrinfo *ai)
 {
   ares_status_t               status  = ARES_ENOTFOUND;
   struct ares_addrinfo_cname *cnames  = NULL;
   struct ares_addrinfo_node  *ainodes = NULL;
-  ares_llist_node_t          *node;
+  size_t                      i;
 
   switch (family) {
     case AF_INET:
@@ -1085,20 +1396,18 @@ ares_status_t ares_hosts_entry_to_addrinfo(const ares_hosts_entry_t *entry,
   }
 
   if (name != NULL) {
-    ares_free(ai->name);
-    ai->name = ares_strdup(name);
+    ai->name = ares_arena_strdup(arena, name);
     if (ai->name == NULL) {
       status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
       goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
     }
   }
 
-  for (node = ares_llist_node_first(entry->ips); node != NULL;
-       node = ares_llist_node_next(node)) {
+  for (i = 0; i < ares_array_len(entry->ips); i++) {
     struct ares_addr addr;
     const void      *ptr     = NULL;
     size_t           ptr_len = 0;
-    const char      *ipaddr  = ares_llist_node_val(node);
+    const char      *ipaddr  = ares_hosts_str_at(entry->ips, i);
 
     memset(&addr, 0, sizeof(addr));
     addr.family = family;
@@ -1108,7 +1417,7 @@ ares_status_t ares_hosts_entry_to_addrinfo(const ares_hosts_entry_t *entry,
       continue;
     }
 
-    status = ares_append_ai_node(addr.family, port, 0, ptr, &ainodes);
+    status = ares_append_ai_node(addr.family, port, 0, ptr, arena, &ainodes);
     if (status != ARES_SUCCESS) {
       goto done; /* LCOV_EXCL_LINE: DefensiveCoding */
     }
@@ -1120,7 +1429,7 @@ ares_status_t ares_hosts_entry_to_addrinfo(const ares_hosts_entry_t *entry,
   }
 
   if (want_cnames) {
-    status = ares_hosts_ai_append_cnames(entry, &cnames);
+    status = ares_hosts_ai_append_cnames(entry, arena, &cnames);
     if (status != ARES_SUCCESS) {
       goto done; /* LCOV_EXCL_LINE: DefensiveCoding */
     }
@@ -1131,9 +1440,6 @@ ares_status_t ares_hosts_entry_to_addrinfo(const ares_hosts_entry_t *entry,
 done:
   if (status != ARES_SUCCESS) {
     /* LCOV_EXCL_START: defensive coding */
-    ares_freeaddrinfo_cnames(cnames);
-    ares_freeaddrinfo_nodes(ainodes);
-    ares_free(ai->name);
     ai->name = NULL;
     return status;
     /* LCOV_EXCL_STOP */
@@ -1148,15 +1454,18 @@ ares_status_t ares_hosts_entry_to_hostent(const ares_hosts_entry_t *entry,
                                           int family, struct hostent **hostent)
 {
   ares_status_t         status;
-  struct ares_addrinfo *ai = ares_malloc_zero(sizeof(*ai));
+  ares_arena_t         *arena = ares_arena_create(0);
+  struct ares_addrinfo *ai    = ares_addrinfo_create(arena);
 
   *hostent = NULL;
 
   if (ai == NULL) {
+    ares_arena_destroy(arena);
     return ARES_ENOMEM;
   }
 
-  status = ares_hosts_entry_to_addrinfo(entry, NULL, family, 0, ARES_TRUE, ai);
+  status = ares_hosts_entry_to_addrinfo(entry, NULL, family, 0, ARES_TRUE,
+                                        arena, ai);
   if (status != ARES_SUCCESS) {
     goto done;
   }
@@ -1167,7 +1476,7 @@ ares_status_t ares_hosts_entry_to_hostent(const ares_hosts_entry_t *entry,
   }
 
 done:
-  ares_freeaddrinfo(ai);
+  ares_arena_destroy(arena);
   if (status != ARES_SUCCESS) {
     ares_free_hostent(*hostent);
     *hostent = NULL;
@@ -362,6 +362,15 @@ int ares_init_options(ares_channel_t           **channelptr,
     goto done;
   }
 
+  /* Initialize the callback worker pool */
+  if (channel->optmask & ARES_OPT_CALLBACK_WORKERS) {
+    status = ares_cbpool_create(channel, channel->cbpool_workers,
+                                channel->cbpool_max_pending, &channel->cbpool);
+    if (status != ARES_SUCCESS) {
+      goto done; /* LCOV_EXCL_LINE: UntestablePath */
+    }
+  }
+
   /* Initialize the event thread */
   if (channel->optmask & ARES_OPT_EVENT_THREAD) {
     ares_event_thread_t *e = NULL;
@@ -379,6 +388,9 @@ int ares_init_options(ares_channel_t           **channelptr,
       DEBUGF(fprintf(stderr, "Error: ares_event_configchg_init failed: %s\n",
                      ares_strerror(status)));
     }
+    if (e->configchg != NULL) {
+      ares_sysconfig_watch_start();
+    }
     status = ARES_SUCCESS;
   }
 
@@ -412,6 +424,13 @@ static void *ares_reinit_thread(void *arg)
     ares_qcache_flush(channel->qcache);
   }
 
+  /* Network configuration may have changed, so may have routes */
+  ares_srcaddr_cache_flush(channel);
+  /* Search domains may have changed */
+  ares_search_negcache_flush(channel);
+  /* Don't wait for the rate limit to pick up hosts file changes */
+  ares_hosts_file_expire(channel->hf);
+
   channel->reinit_pending = ARES_FALSE;
   ares_channel_unlock(channel);
 
@@ -437,6 +456,11 @@ ares_status_t ares_reinit(ares_channel_t *channel)
   channel->reinit_pending = ARES_TRUE;
   ares_channel_unlock(channel);
 
+  /* The system configuration cached for creating channels is likely out of
+   * date too, as may be interface addresses */
+  ares_sysconfig_cache_invalidate();
+  ares_iface_ips_cache_invalidate();
+
   if (ares_threadsafety()) {
     /* clean up the prior reinit process's thread.  We know the thread isn't
      * running since reinit_pending was false */
@@ -471,6 +495,7 @@ int ares_dup(ares_channel_t **dest, const ares_channel_t *src)
   struct ares_options opts;
   ares_status_t       rc;
   int                 optmask;
+  ares_llist_t       *sconfig = NULL;
 
   if (dest == NULL || src == NULL) {
     return ARES_EFORMERR;
@@ -518,7 +543,11 @@ int ares_dup(ares_channel_t **dest, const ares_channel_t *src)
               sizeof((*dest)->local_dev_name));
   (*dest)->local_ip4 = src->local_ip4;
   memcpy((*dest)->local_ip6, src->local_ip6, sizeof(src->local_ip6));
-  ares_channel_unlock(src);
+
+  if (src->qcache_shm_path != NULL) {
+    rc = ares_set_query_cache_shm(*dest, src->qcache_shm_path,
+                                  src->qcache_shm_size);
+  }
 
   /* Servers are a bit unique as ares_init_options() only allows ipv4 servers
    * and not a port per server, but there are other user specified ways, that
@@ -527,29 +556,35 @@ int ares_dup(ares_channel_t **dest, const ares_channel_t *src)
    *
    * We don't want to clone system-configuration servers though.
    *
-   * We must use the "csv" format to get things like link-local address support
-   */
+   * The configuration is copied straight from the source servers, which
+   * preserves things like link-local scopes without formatting and
+   * re-parsing them.  Only the configuration is copied, each channel has its
+   * own connections and metrics. */
+  if (rc == ARES_SUCCESS && optmask & ARES_OPT_SERVERS) {
+    rc = ares_servers_to_sconfig_llist(src, &sconfig);
+  }
 
-  if (optmask & ARES_OPT_SERVERS) {
-    char *csv = ares_get_servers_csv(src);
-    if (csv == NULL) {
-      /* LCOV_EXCL_START: OutOfMemory */
-      ares_destroy(*dest);
-      *dest = NULL;
-      rc    = ARES_ENOMEM;
-      goto done;
-      /* LCOV_EXCL_STOP */
-    }
+  /* The parsed hosts file is read-only, so rather than loading it again the
+   * copy shares it with the source until either notices a modification */
+  if (rc == ARES_SUCCESS) {
+    ares_hosts_file_destroy((*dest)->hf);
+    rc = ares_hosts_file_duplicate(&(*dest)->hf, src->hf);
+  }
+  ares_channel_unlock(src);
 
-    rc = (ares_status_t)ares_set_servers_ports_csv(*dest, csv);
-    ares_free_string(csv);
-    if (rc != ARES_SUCCESS) {
-      /* LCOV_EXCL_START: OutOfMemory */
-      ares_destroy(*dest);
-      *dest = NULL;
-      goto done;
-      /* LCOV_EXCL_STOP */
-    }
+  if (rc == ARES_SUCCESS && sconfig != NULL) {
+    ares_channel_lock(*dest);
+    rc = ares_servers_update(*dest, sconfig, ARES_TRUE);
+    ares_channel_unlock(*dest);
+  }
+  ares_llist_destroy(sconfig);
+
+  if (rc != ARES_SUCCESS) {
+    /* LCOV_EXCL_START: UntestablePath */
+    ares_destroy(*dest);
+    *dest = NULL;
+    goto done;
+    /* LCOV_EXCL_STOP */
   }
 
   rc = ARES_SUCCESS;
@@ -592,6 +627,49 @@ void ares_set_local_dev(ares_channel_t *channel, const char *local_dev_name)
   ares_channel_unlock(channel);
 }
 
+ares_status_t ares_set_query_cache_shm(ares_channel_t *channel,
+                                       const char *path, size_t size)
+{
+  ares_status_t status;
+  char         *path_copy = NULL;
+
+  if (channel == NULL) {
+    return ARES_EFORMERR;
+  }
+
+  if (path != NULL) {
+    path_copy = ares_strdup(path);
+    if (path_copy == NULL) {
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  ares_channel_lock(channel);
+
+  /* Sharing a disabled cache would serve hits we'd never have cached */
+  if (channel->qcache_max_ttl == 0) {
+    ares_free(path_copy);
+    path_copy = NULL;
+    status    = ARES_ENOTIMP;
+    goto done;
+  }
+
+  status = ares_qcache_attach_shm(channel->qcache, path_copy, size);
+  if (status != ARES_SUCCESS) {
+    ares_free(path_copy);
+    goto done;
+  }
+
+  /* Remember so ares_dup() can attach the copy to the same cache */
+  ares_free(channel->qcache_shm_path);
+  channel->qcache_shm_path = path_copy;
+  channel->qcache_shm_size = size;
+
+done:
+  ares_channel_unlock(channel);
+  return status;
+}
+
 int ares_set_sortlist(ares_channel_t *channel, const char *sortstr)
 {
   size_t           nsort    = 0;
@@ -145,6 +145,13 @@ int ares_library_init_mem(int flags, void *(*amalloc)(size_t size),
                           void (*afree)(void *ptr),
                           void *(*arealloc)(void *ptr, size_t size))
 {
+  /* Anything cached must be freed with the allocator it was allocated with */
+  if (amalloc || afree || arealloc) {
+    ares_sysconfig_cache_invalidate();
+    ares_services_cleanup();
+    ares_iface_ips_cache_invalidate();
+  }
+
   if (amalloc) {
     __ares_malloc = amalloc;
   }
@@ -173,6 +180,11 @@ void ares_library_cleanup(void)
   ares_library_cleanup_android();
 #endif
 
+  /* Anything cached must be freed with the allocator it was allocated with */
+  ares_sysconfig_cache_invalidate();
+  ares_services_cleanup();
+  ares_iface_ips_cache_invalidate();
+
   ares_init_flags = ARES_LIB_INIT_NONE;
   __ares_malloc   = default_malloc;
   __ares_realloc  = default_realloc;
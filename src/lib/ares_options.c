@@ -227,6 +227,15 @@ int ares_save_options(const ares_channel_t *channel,
     options->evsys = channel->evsys;
   }
 
+  if (channel->optmask & ARES_OPT_EVENT_THREAD_CNT) {
+    options->event_thread_cnt = channel->event_thread_cnt;
+  }
+
+  if (channel->optmask & ARES_OPT_CALLBACK_WORKERS) {
+    options->callback_worker_opts.num_workers = channel->cbpool_workers;
+    options->callback_worker_opts.max_pending = channel->cbpool_max_pending;
+  }
+
   /* Set options for server failover behavior */
   if (channel->optmask & ARES_OPT_SERVER_FAILOVER) {
     options->server_failover_opts.retry_chance = channel->server_retry_chance;
@@ -288,6 +297,34 @@ ares_status_t ares_init_by_options(ares_channel_t            *channel,
     channel->evsys = options->evsys;
   }
 
+  /* The number of event threads is only meaningful if the event thread is
+   * enabled, a count of 0 means the default of a single thread */
+  if (optmask & ARES_OPT_EVENT_THREAD_CNT) {
+    if (!(optmask & ARES_OPT_EVENT_THREAD)) {
+      return ARES_EFORMERR;
+    }
+    if (options->event_thread_cnt == 0) {
+      optmask &= ~(ARES_OPT_EVENT_THREAD_CNT);
+    } else {
+      channel->event_thread_cnt = options->event_thread_cnt;
+    }
+  }
+
+  /* Callback workers require threading support */
+  if (optmask & ARES_OPT_CALLBACK_WORKERS) {
+    if (!ares_threadsafety()) {
+      return ARES_ENOTIMP;
+    }
+    channel->cbpool_workers = options->callback_worker_opts.num_workers;
+    if (channel->cbpool_workers == 0) {
+      channel->cbpool_workers = 1;
+    }
+    channel->cbpool_max_pending = options->callback_worker_opts.max_pending;
+    if (channel->cbpool_max_pending == 0) {
+      channel->cbpool_max_pending = DEFAULT_CBPOOL_MAX_PENDING;
+    }
+  }
+
   if (optmask & ARES_OPT_FLAGS) {
     channel->flags = (unsigned int)options->flags;
   }
@@ -45,20 +45,51 @@
 #endif
 
 
+/* Room a string takes up once copied into the result */
+static size_t ares_ai_strsize(const char *str)
+{
+  if (str == NULL) {
+    return 0;
+  }
+  return ares_strlen(str) + 1;
+}
+
+static char *ares_ai_take_str(char **buf, const char *str)
+{
+  char  *out = *buf;
+  size_t len = ares_ai_strsize(str);
+
+  if (len == 0) {
+    return NULL;
+  }
+
+  memcpy(out, str, len);
+  *buf += len;
+  return out;
+}
+
 ares_status_t ares_parse_into_addrinfo(const ares_dns_record_t *dnsrec,
                                        ares_bool_t    cname_only_is_enodata,
                                        unsigned short port,
+                                       ares_arena_t  *arena,
                                        struct ares_addrinfo *ai)
 {
-  ares_status_t               status;
-  size_t                      i;
-  size_t                      ancount;
-  const char                 *hostname  = NULL;
-  ares_bool_t                 got_a     = ARES_FALSE;
-  ares_bool_t                 got_aaaa  = ARES_FALSE;
-  ares_bool_t                 got_cname = ARES_FALSE;
-  struct ares_addrinfo_cname *cnames    = NULL;
-  struct ares_addrinfo_node  *nodes     = NULL;
+  ares_status_t                status;
+  size_t                       i;
+  size_t                       ancount;
+  size_t                       naddr4   = 0;
+  size_t                       naddr6   = 0;
+  size_t                       ncnames  = 0;
+  size_t                       strsize  = 0;
+  const char                  *hostname = NULL;
+  ares_bool_t                  set_name;
+  struct ares_addrinfo_node   *nodes;
+  struct ares_addrinfo_cname  *cnames;
+  struct sockaddr_in6         *sin6s;
+  struct sockaddr_in          *sins;
+  char                        *strs;
+  struct ares_addrinfo_node  **next_node;
+  struct ares_addrinfo_cname **next_cname;
 
   /* Save question hostname */
   status = ares_dns_record_query_get(dnsrec, 0, &hostname, NULL, NULL);
@@ -72,6 +103,8 @@ ares_status_t ares_parse_into_addrinfo(const ares_dns_record_t *dnsrec,
     goto done;
   }
 
+  /* Count everything the answers add to the result so it can all come from
+   * a single allocation */
   for (i = 0; i < ancount; i++) {
     ares_dns_rec_type_t  rtype;
     const ares_dns_rr_t *rr =
@@ -96,79 +129,97 @@ ares_status_t ares_parse_into_addrinfo(const ares_dns_record_t *dnsrec,
      */
 
     if (rtype == ARES_REC_TYPE_CNAME) {
-      struct ares_addrinfo_cname *cname;
-
-      got_cname = ARES_TRUE;
+      ncnames++;
+      strsize += ares_ai_strsize(ares_dns_rr_get_name(rr));
       /* replace hostname with data from cname */
       hostname = ares_dns_rr_get_str(rr, ARES_RR_CNAME_CNAME);
-
-      cname = ares_append_addrinfo_cname(&cnames);
-      if (cname == NULL) {
-        status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
-        goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
-      }
-      cname->ttl   = (int)ares_dns_rr_get_ttl(rr);
-      cname->alias = ares_strdup(ares_dns_rr_get_name(rr));
-      if (cname->alias == NULL) {
-        status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
-        goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
-      }
-      cname->name = ares_strdup(hostname);
-      if (cname->name == NULL) {
-        status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
-        goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
-      }
+      strsize += ares_ai_strsize(hostname);
     } else if (rtype == ARES_REC_TYPE_A) {
-      got_a = ARES_TRUE;
-      status =
-        ares_append_ai_node(AF_INET, port, ares_dns_rr_get_ttl(rr),
-                            ares_dns_rr_get_addr(rr, ARES_RR_A_ADDR), &nodes);
-      if (status != ARES_SUCCESS) {
-        goto done; /* LCOV_EXCL_LINE: OutOfMemory */
-      }
+      naddr4++;
     } else if (rtype == ARES_REC_TYPE_AAAA) {
-      got_aaaa = ARES_TRUE;
-      status = ares_append_ai_node(AF_INET6, port, ares_dns_rr_get_ttl(rr),
-                                   ares_dns_rr_get_addr6(rr, ARES_RR_AAAA_ADDR),
-                                   &nodes);
-      if (status != ARES_SUCCESS) {
-        goto done; /* LCOV_EXCL_LINE: OutOfMemory */
-      }
-    } else {
-      continue;
+      naddr6++;
     }
   }
 
-  if (!got_a && !got_aaaa &&
-      (!got_cname || (got_cname && cname_only_is_enodata))) {
+  if (naddr4 == 0 && naddr6 == 0 && (ncnames == 0 || cname_only_is_enodata)) {
     status = ARES_ENODATA;
     goto done;
   }
 
   /* save the hostname as ai->name */
-  if (ai->name == NULL || !ares_strcaseeq(ai->name, hostname)) {
-    ares_free(ai->name);
-    ai->name = ares_strdup(hostname);
-    if (ai->name == NULL) {
-      status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
-      goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
-    }
+  set_name = (ai->name == NULL || !ares_strcaseeq(ai->name, hostname))
+               ? ARES_TRUE
+               : ARES_FALSE;
+  if (set_name) {
+    strsize += ares_ai_strsize(hostname);
   }
 
-  if (got_a || got_aaaa) {
-    ares_addrinfo_cat_nodes(&ai->nodes, nodes);
-    nodes = NULL;
+  nodes = ares_arena_alloc_zero(
+    arena, (naddr4 + naddr6) * sizeof(*nodes) + ncnames * sizeof(*cnames) +
+             naddr6 * sizeof(*sin6s) + naddr4 * sizeof(*sins) + strsize);
+  if (nodes == NULL) {
+    status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
   }
+  cnames = (void *)(nodes + naddr4 + naddr6);
+  sin6s  = (void *)(cnames + ncnames);
+  sins   = (void *)(sin6s + naddr6);
+  strs   = (void *)(sins + naddr4);
 
-  if (got_cname) {
-    ares_addrinfo_cat_cnames(&ai->cnames, cnames);
-    cnames = NULL;
+  if (set_name) {
+    ai->name = ares_ai_take_str(&strs, hostname);
   }
 
-done:
-  ares_freeaddrinfo_cnames(cnames);
-  ares_freeaddrinfo_nodes(nodes);
+  /* Append in answer order */
+  next_node = &ai->nodes;
+  while (*next_node != NULL) {
+    next_node = &(*next_node)->ai_next;
+  }
+  next_cname = &ai->cnames;
+  while (*next_cname != NULL) {
+    next_cname = &(*next_cname)->next;
+  }
+
+  for (i = 0; i < ancount; i++) {
+    ares_dns_rec_type_t  rtype;
+    const ares_dns_rr_t *rr =
+      ares_dns_record_rr_get_const(dnsrec, ARES_SECTION_ANSWER, i);
+
+    if (ares_dns_rr_get_class(rr) != ARES_CLASS_IN) {
+      continue;
+    }
+
+    rtype = ares_dns_rr_get_type(rr);
+
+    if (rtype == ARES_REC_TYPE_CNAME) {
+      struct ares_addrinfo_cname *cname = cnames++;
+
+      cname->ttl   = (int)ares_dns_rr_get_ttl(rr);
+      cname->alias = ares_ai_take_str(&strs, ares_dns_rr_get_name(rr));
+      cname->name =
+        ares_ai_take_str(&strs, ares_dns_rr_get_str(rr, ARES_RR_CNAME_CNAME));
+      *next_cname = cname;
+      next_cname  = &cname->next;
+    } else if (rtype == ARES_REC_TYPE_A) {
+      struct ares_addrinfo_node *node = nodes++;
+
+      ares_addrinfo_set_addr(node, sins++, AF_INET, port,
+                             ares_dns_rr_get_ttl(rr),
+                             ares_dns_rr_get_addr(rr, ARES_RR_A_ADDR));
+      *next_node = node;
+      next_node  = &node->ai_next;
+    } else if (rtype == ARES_REC_TYPE_AAAA) {
+      struct ares_addrinfo_node *node = nodes++;
 
+      ares_addrinfo_set_addr(node, sin6s++, AF_INET6, port,
+                             ares_dns_rr_get_ttl(rr),
+                             ares_dns_rr_get_addr6(rr, ARES_RR_AAAA_ADDR));
+      *next_node = node;
+      next_node  = &node->ai_next;
+    }
+  }
+
+done:
   /* compatibility */
   if (status == ARES_EBADNAME) {
     status = ARES_EBADRESP;
@@ -48,6 +48,8 @@
 #include "ares_array.h"
 #include "ares_llist.h"
 #include "dsa/ares_slist.h"
+#include "dsa/ares_arena.h"
+#include "dsa/ares_htable.h"
 #include "ares_htable_strvp.h"
 #include "ares_htable_szvp.h"
 #include "ares_htable_asvp.h"
@@ -110,9 +112,11 @@ W32_FUNC const char *_w32_GetHostsFile(void);
 
 #  define PATH_RESOLV_CONF "/etc/resolv.conf"
 #  ifdef ETC_INET
-#    define PATH_HOSTS "/etc/inet/hosts"
+#    define PATH_HOSTS    "/etc/inet/hosts"
+#    define PATH_SERVICES "/etc/inet/services"
 #  else
-#    define PATH_HOSTS "/etc/hosts"
+#    define PATH_HOSTS    "/etc/hosts"
+#    define PATH_SERVICES "/etc/services"
 #  endif
 
 #endif
@@ -126,6 +130,15 @@ W32_FUNC const char *_w32_GetHostsFile(void);
 
 /********* EDNS defines section ******/
 
+/* Default bound on the number of completions waiting on the callback worker
+ * pool before they are delivered inline instead */
+#define DEFAULT_CBPOOL_MAX_PENDING 4096
+#define DEFAULT_QCACHE_SHM_SIZE    (4 * 1024 * 1024)
+
+/* Source address selection cache for RFC 6724 sorting */
+#define ARES_SRCADDR_CACHE_TTL 30 /* seconds */
+#define ARES_SRCADDR_CACHE_MAX 1024
+
 /* Default values for server failover behavior. We retry failed servers with
  * a 10% probability and a minimum delay of 5 seconds between retries.
  */
@@ -188,6 +201,14 @@ typedef struct ares_qcache ares_qcache_t;
 struct ares_hosts_file;
 typedef struct ares_hosts_file ares_hosts_file_t;
 
+struct ares_cbpool;
+typedef struct ares_cbpool ares_cbpool_t;
+struct ares_qcache_shm;
+typedef struct ares_qcache_shm ares_qcache_shm_t;
+
+struct ares_search_negcache;
+typedef struct ares_search_negcache ares_search_negcache_t;
+
 struct ares_channeldata {
   /* Configuration data */
   unsigned int         flags;
@@ -208,6 +229,7 @@ struct ares_channeldata {
   size_t               ednspsz;
   unsigned int         qcache_max_ttl;
   ares_evsys_t         evsys;
+  size_t               event_thread_cnt;
   unsigned int         optmask;
 
   /* For binding to local devices and/or IP addresses.  Leave
@@ -245,6 +267,11 @@ struct ares_channeldata {
    * scan all connections) */
   ares_htable_asvp_t  *connnode_by_socket;
 
+  /* Bumped every time a connection is closed.  A connection pointer along
+   * with the generation it was opened in identifies it, even once its memory
+   * or file descriptor may have been reused */
+  size_t               conn_generation;
+
   ares_sock_state_cb   sock_state_cb;
   void                *sock_state_cb_data;
 
@@ -281,6 +308,22 @@ struct ares_channeldata {
   /* Query Cache */
   ares_qcache_t                      *qcache;
 
+  /* Cache of source addresses by destination address used for sorting
+   * ares_getaddrinfo() results, created on first use */
+  ares_htable_strvp_t                *srcaddr_cache;
+
+  /* Knowledge of search list candidates that can't exist, see
+   * ARES_FLAG_SEARCH_NEGCACHE, created on first use */
+  ares_search_negcache_t             *search_negcache;
+
+  /* Worker pool for delivering callbacks, NULL if callbacks are delivered
+   * inline */
+  ares_cbpool_t                      *cbpool;
+  size_t                              cbpool_workers;
+  size_t                              cbpool_max_pending;
+  char                               *qcache_shm_path;
+  size_t                              qcache_shm_size;
+
   /* Fields controlling server failover behavior.
    * The retry chance is the probability (1/N) by which we will retry a failed
    * server instead of the best server when selecting a server to send queries
@@ -307,6 +350,10 @@ struct ares_channeldata {
    * system config changes might get triggered and we need a flag to make
    * sure we don't take action. */
   ares_bool_t                         sys_up;
+
+  /* Set by ares_destroy() once the callback pool has been drained, from then
+   * on new queries fail with ARES_EDESTRUCTION */
+  ares_bool_t                         destroying;
 };
 
 /* Does the domain end in ".onion" or ".onion."? Case-insensitive. */
@@ -335,9 +382,25 @@ size_t ares_name_label_cnt(const char *name);
  *  \param[out] names_len number of names in array
  *  \return ARES_SUCCESS on success, otherwise one of the other error codes.
  */
-ares_status_t ares_search_name_list(const ares_channel_t *channel,
-                                    const char *name, char ***names,
-                                    size_t *names_len);
+ares_status_t ares_search_name_list(ares_channel_t *channel, const char *name,
+                                    char ***names, size_t *names_len);
+
+/*! Whether the search candidate formed from name and domain is known to not
+ *  exist, see ARES_FLAG_SEARCH_NEGCACHE.  Updates the learned state, expired
+ *  entries are dropped and a suffix whose learning period has passed is
+ *  re-armed for probing. */
+ares_bool_t   ares_search_negcache_skip(ares_channel_t *channel,
+                                        const char *name, const char *domain,
+                                        const char           *candidate,
+                                        const ares_timeval_t *now);
+
+/*! Learn from the response to a search candidate for name */
+void          ares_search_negcache_update(ares_channel_t          *channel,
+                                          const char              *name,
+                                          const ares_dns_record_t *dnsrec);
+
+/*! Forget everything learned about search candidates */
+void          ares_search_negcache_flush(ares_channel_t *channel);
 
 /*! Function to create callback arg for converting from ares_callback_dnsrec
  *  to ares_calback */
@@ -365,6 +428,14 @@ ares_status_t ares_init_by_options(ares_channel_t            *channel,
                                    const struct ares_options *options,
                                    int                        optmask);
 ares_status_t ares_init_by_sysconfig(ares_channel_t *channel);
+/*! Discard the system configuration cached for creating channels, so the next
+ *  channel reads it again */
+void          ares_sysconfig_cache_invalidate(void);
+/*! A configuration change monitor started or stopped.  Where the system
+ *  configuration isn't read from files, the cached copy is only reused while
+ *  one is running and until it reports a change */
+void          ares_sysconfig_watch_start(void);
+void          ares_sysconfig_watch_stop(void);
 void ares_set_socket_functions_def(ares_channel_t *channel);
 
 typedef struct {
@@ -413,6 +484,10 @@ ares_status_t ares_sysconfig_process_buf(const ares_channel_t    *channel,
 ares_status_t ares_init_sysconfig_files(const ares_channel_t *channel,
                                         ares_sysconfig_t     *sysconfig,
                                         ares_bool_t process_resolvconf);
+/*! Path of the idx'th file ares_init_sysconfig_files() reads, starting with
+ *  resolv.conf, or NULL past the last one */
+const char   *ares_sysconfig_files_path(const ares_channel_t *channel,
+                                        size_t                idx);
 #ifdef __APPLE__
 ares_status_t ares_init_sysconfig_macos(const ares_channel_t *channel,
                                         ares_sysconfig_t     *sysconfig);
@@ -435,32 +510,65 @@ ares_bool_t ares_parse_port(const char *str, unsigned short *port,
                             ares_bool_t allow_zero);
 
 ares_status_t ares_cat_domain(const char *name, const char *domain, char **s);
+/*! Flush the source address selection cache used by ares_sortaddrinfo() */
+void          ares_srcaddr_cache_flush(ares_channel_t *channel);
 ares_status_t ares_sortaddrinfo(ares_channel_t            *channel,
-                                struct ares_addrinfo_node *ai_node);
+                                struct ares_addrinfo_node *ai_node,
+                                const ares_timeval_t      *now);
 
-void ares_freeaddrinfo_nodes(struct ares_addrinfo_node *ai_node);
 ares_bool_t ares_is_localhost(const char *name);
 
+/* Results are assembled in an arena, since they are merged across lookups
+ * and reordered before being handed out.  Nothing appended from an arena can
+ * be released on its own, only with ares_arena_destroy(). */
+
 struct ares_addrinfo_node *
-  ares_append_addrinfo_node(struct ares_addrinfo_node **ai_node);
+  ares_append_addrinfo_node(ares_arena_t               *arena,
+                            struct ares_addrinfo_node **ai_node);
 void ares_addrinfo_cat_nodes(struct ares_addrinfo_node **head,
                              struct ares_addrinfo_node  *tail);
 
-void ares_freeaddrinfo_cnames(struct ares_addrinfo_cname *ai_cname);
-
 struct ares_addrinfo_cname *
-  ares_append_addrinfo_cname(struct ares_addrinfo_cname **ai_cname);
+  ares_append_addrinfo_cname(ares_arena_t                *arena,
+                             struct ares_addrinfo_cname **ai_cname);
 
 ares_status_t ares_append_ai_node(int aftype, unsigned short port,
                                   unsigned int ttl, const void *adata,
+                                  ares_arena_t               *arena,
                                   struct ares_addrinfo_node **nodes);
 
+/*! Point a node at an AF_INET or AF_INET6 address, filling in \p sa which
+ *  must have room for the socket address of that family. */
+void ares_addrinfo_set_addr(struct ares_addrinfo_node *node, void *sa,
+                            int aftype, unsigned short port, unsigned int ttl,
+                            const void *adata);
+
 void ares_addrinfo_cat_cnames(struct ares_addrinfo_cname **head,
                               struct ares_addrinfo_cname  *tail);
 
+/*! Allocate an empty struct ares_addrinfo from an arena to assemble a result
+ *  in.  It goes away with the arena, so must never be passed to
+ *  ares_freeaddrinfo(); use ares_addrinfo_pack() to hand it out.
+ *
+ *  \param[in] arena  Arena to allocate from
+ *  \return new result or NULL on out of memory
+ */
+struct ares_addrinfo *ares_addrinfo_create(ares_arena_t *arena);
+
+/*! Copy a result into a single allocation holding its nodes, addresses,
+ *  cnames and names.  The linked lists are laid out the same as always, but
+ *  ares_freeaddrinfo() becomes a single free.  The packed result must not be
+ *  appended to or reordered.
+ *
+ *  \param[in] ai  Result to pack, left untouched
+ *  \return packed result, or NULL on out of memory
+ */
+struct ares_addrinfo *ares_addrinfo_pack(const struct ares_addrinfo *ai);
+
 ares_status_t ares_parse_into_addrinfo(const ares_dns_record_t *dnsrec,
                                        ares_bool_t    cname_only_is_enodata,
                                        unsigned short port,
+                                       ares_arena_t  *arena,
                                        struct ares_addrinfo *ai);
 ares_status_t ares_parse_ptr_reply_dnsrec(const ares_dns_record_t *dnsrec,
                                           const void *addr, int addrlen,
@@ -475,8 +583,35 @@ ares_status_t ares_addrinfo2addrttl(const struct ares_addrinfo *ai, int family,
                                     struct ares_addrttl  *addrttls,
                                     struct ares_addr6ttl *addr6ttls,
                                     size_t               *naddrttls);
+
+/*! Fill in the addresses and TTLs ares_addrinfo2addrttl() would produce for
+ *  the result of ares_parse_into_addrinfo(), straight from a DNS response in
+ *  wire format without parsing it into a DNS record or allocating memory.
+ *
+ *  Only responses made up of A, AAAA and CNAME records, plus an OPT record
+ *  in the additional section, are handled.  For anything else, including
+ *  malformed responses, ARES_ENOTIMP is returned and the caller must fall
+ *  back to a full parse, which also reports the appropriate error.
+ *
+ *  \param[in]  abuf          DNS response
+ *  \param[in]  alen          Length of the DNS response
+ *  \param[in]  family        AF_INET or AF_INET6
+ *  \param[in]  req_naddrttls Maximum number of addresses to return
+ *  \param[out] addrttls      Filled in for AF_INET, may be NULL otherwise
+ *  \param[out] addr6ttls     Filled in for AF_INET6, may be NULL otherwise
+ *  \param[out] naddrttls     Number of addresses returned
+ *  \return ARES_SUCCESS, ARES_ENODATA if there are neither addresses nor
+ *          CNAMEs in the answer, or ARES_ENOTIMP as described above.
+ */
+ares_status_t ares_scan_addrttl(const unsigned char *abuf, size_t alen,
+                                int family, size_t req_naddrttls,
+                                struct ares_addrttl  *addrttls,
+                                struct ares_addr6ttl *addr6ttls,
+                                size_t               *naddrttls);
+
 ares_status_t ares_addrinfo_localhost(const char *name, unsigned short port,
                                       const struct ares_addrinfo_hints *hints,
+                                      ares_arena_t                     *arena,
                                       struct ares_addrinfo             *ai);
 
 ares_status_t ares_servers_update(ares_channel_t *channel,
@@ -493,13 +628,47 @@ ares_status_t ares_sconfig_append_fromstr(const ares_channel_t *channel,
 ares_status_t ares_in_addr_to_sconfig_llist(const struct in_addr *servers,
                                             size_t                nservers,
                                             ares_llist_t        **llist);
+/*! Deep copy a server configuration list as built by ares_sconfig_append() */
+ares_status_t ares_sconfig_duplicate(ares_llist_t      **dest,
+                                    const ares_llist_t *src);
+/*! Build a server configuration list from the servers currently in use by
+ *  a channel */
+ares_status_t ares_servers_to_sconfig_llist(const ares_channel_t *channel,
+                                            ares_llist_t        **llist);
 ares_status_t ares_get_server_addr(const ares_server_t *server,
                                    ares_buf_t          *buf);
 
+/*! Look up the port, in host byte order, of a service in the services
+ *  database.  ARES_ENOTIMP if the database isn't available, in which case
+ *  the system should be asked instead. */
+ares_status_t ares_services_port(const char *name, const char *proto,
+                                 unsigned short *port);
+/*! Look up the name of a service by port, in host byte order, in the services
+ *  database.  ARES_ENOTIMP if the database isn't available. */
+ares_status_t ares_services_name(unsigned short port, const char *proto,
+                                 char *buf, size_t buf_len);
+/*! Use the given services file instead of the system one, or the system one
+ *  again if NULL.  For testing. */
+ares_status_t ares_services_set_path(const char *path);
+/*! Free the services database */
+void          ares_services_cleanup(void);
+
 struct ares_hosts_entry;
 typedef struct ares_hosts_entry ares_hosts_entry_t;
 
+/*! Retrieve the modification time and size of a file, ARES_FALSE if not
+ *  supported or the file doesn't exist */
+ares_bool_t ares_file_stat(const char *filename, time_t *mtime, size_t *size);
 void ares_hosts_file_destroy(ares_hosts_file_t *hf);
+/*! Duplicate a channel's view of the hosts file, sharing the parsed file */
+ares_status_t ares_hosts_file_duplicate(ares_hosts_file_t      **dest,
+                                        const ares_hosts_file_t *src);
+/*! Check the hosts file for modification on next use, rather than waiting
+ *  for the rate limit on checks to expire */
+void ares_hosts_file_expire(ares_hosts_file_t *hf);
+/*! Identity of the parsed hosts file the channel currently uses, channels
+ *  sharing a parsed copy return the same value.  NULL if none is loaded. */
+const void   *ares_hosts_file_id(const ares_channel_t *channel);
 ares_status_t ares_hosts_search_ipaddr(ares_channel_t *channel,
                                        ares_bool_t use_env, const char *ipaddr,
                                        const ares_hosts_entry_t **entry);
@@ -512,6 +681,7 @@ ares_status_t ares_hosts_entry_to_addrinfo(const ares_hosts_entry_t *entry,
                                            const char *name, int family,
                                            unsigned short        port,
                                            ares_bool_t           want_cnames,
+                                           ares_arena_t         *arena,
                                            struct ares_addrinfo *ai);
 
 /* Same as ares_query_dnsrec() except does not take a channel lock.  Use this
@@ -522,6 +692,13 @@ ares_status_t ares_query_nolock(ares_channel_t *channel, const char *name,
                                 ares_callback_dnsrec callback, void *arg,
                                 unsigned short *qid);
 
+/* Same as ares_process_fds(), but answers are parsed with the channel lock
+ * released so other threads can use the channel meanwhile.  Only for the
+ * event thread, which never calls this with the channel lock already held. */
+ares_status_t ares_process_fds_evthread(ares_channel_t         *channel,
+                                        const ares_fd_events_t *events,
+                                        size_t nevents, unsigned int flags);
+
 /*! Flags controlling behavior for ares_send_nolock() */
 typedef enum {
   ARES_SEND_FLAG_NOCACHE = 1 << 0, /*!< Do not query the cache */
@@ -537,6 +714,15 @@ ares_status_t ares_send_nolock(ares_channel_t *channel, ares_server_t *server,
                                ares_callback_dnsrec callback, void *arg,
                                unsigned short *qid);
 
+/* Answer a query from the query cache.  Only the query cache's own lock is
+ * taken, so public entry points call this before taking the channel lock to
+ * keep cache hits from being serialized behind it.  Returns ARES_ENOTFOUND if
+ * the query must be sent, otherwise the callback has been called with the
+ * returned status. */
+ares_status_t ares_send_cached(ares_channel_t          *channel,
+                               const ares_dns_record_t *dnsrec,
+                               ares_callback_dnsrec callback, void *arg);
+
 /* Same as ares_gethostbyaddr() except does not take a channel lock.  Use this
  * if a channel lock is already held */
 void ares_gethostbyaddr_nolock(ares_channel_t *channel, const void *addr,
@@ -565,24 +751,77 @@ ares_status_t ares_dns_name_parse(ares_buf_t *buf, char **name,
                                   ares_bool_t is_hostname,
                                   ares_bool_t allow_compression);
 
+/*! Destroy a memo created by ares_dns_name_parse_into()
+ *
+ *  \param[in] memo  Memo to destroy, may be NULL
+ */
+void ares_dns_name_memo_destroy(ares_dns_name_memo_t *memo);
+
+/*! Same as ares_dns_name_parse(), but the name is decoded into a caller
+ *  supplied buffer, replacing its contents, so it can be reused across
+ *  names without allocating.
+ *
+ *  \param[in]  buf        Initialized buffer object
+ *  \param[in]  namebuf    Initialized buffer object to decode the name into
+ *  \param[in,out] memo    Pointer passed by reference to maintain the names
+ *                         compression pointers in this message lead to.
+ *                         Pass NULL (not by reference) if not desired.
+ *                         Otherwise the memo will be automatically created
+ *                         upon first entry.  Must only be used with the
+ *                         same message.
+ *  \param[out] name       Pointer passed by reference to be filled in with
+ *                         the NULL-terminated name, valid until namebuf is
+ *                         next modified.
+ *  \param[in] is_hostname See ares_dns_name_parse()
+ *  \param[in] allow_compression See ares_dns_name_parse()
+ *  \return ARES_SUCCESS on success
+ */
+ares_status_t ares_dns_name_parse_into(ares_buf_t            *buf,
+                                       ares_buf_t            *namebuf,
+                                       ares_dns_name_memo_t **memo,
+                                       const char           **name,
+                                       ares_bool_t            is_hostname,
+                                       ares_bool_t allow_compression);
+
+/*! Skip over a DNS name in the buffer without decoding it.  Only the label
+ *  structure is checked, compression pointers are not followed.
+ *
+ *  \param[in] buf  Initialized buffer object
+ *  \return ARES_SUCCESS on success, ARES_EBADNAME if the name is malformed
+ */
+ares_status_t ares_dns_name_skip(ares_buf_t *buf);
+
+/*! Check a DNS name directly within a message without decoding it or
+ *  allocating memory, applying the same rules as ares_dns_name_parse() with
+ *  compression allowed.
+ *
+ *  \param[in]     msg      DNS message
+ *  \param[in]     msg_len  Length of the DNS message
+ *  \param[in,out] pos      Offset of the name, advanced past it on success
+ *  \return ARES_TRUE if the name is valid
+ */
+ares_bool_t ares_dns_name_isvalid_raw(const unsigned char *msg, size_t msg_len,
+                                      size_t *pos);
+
 /*! Write the DNS name to the buffer in the DNS domain-name syntax as a
  *  series of labels.  The maximum domain name length is 255 characters with
  *  each label being a maximum of 63 characters.  If the validate_hostname
  *  flag is set, it will strictly validate the character set.
  *
  *  \param[in,out]  buf   Initialized buffer object to write name to
- *  \param[in,out]  list  Pointer passed by reference to maintain a list of
+ *  \param[in,out]  list  Pointer passed by reference to maintain a table of
  *                        domain name to indexes used for name compression.
  *                        Pass NULL (not by reference) if name compression isn't
- *                        desired.  Otherwise the list will be automatically
- *                        created upon first entry.
+ *                        desired.  Otherwise the table will be automatically
+ *                        created upon first entry, and must be released with
+ *                        ares_htable_destroy().
  *  \param[in]      validate_hostname Validate the hostname character set.
  *  \param[in]      name              Name to write out, it may have escape
  *                                    sequences.
  *  \return ARES_SUCCESS on success, most likely ARES_EBADNAME if the name is
  *          bad.
  */
-ares_status_t ares_dns_name_write(ares_buf_t *buf, ares_llist_t **list,
+ares_status_t ares_dns_name_write(ares_buf_t *buf, ares_htable_t **list,
                                   ares_bool_t validate_hostname,
                                   const char *name);
 
@@ -609,14 +848,93 @@ ares_status_t ares_qcache_create(ares_rand_state *rand_state,
                                  unsigned int     max_ttl,
                                  ares_qcache_t  **cache_out);
 void ares_qcache_flush(ares_qcache_t *cache);
+/*! Negative caching TTL of an NXDOMAIN response per RFC 2308, 0 if none */
+unsigned int ares_qcache_soa_minimum(const ares_dns_record_t *dnsrec);
 ares_status_t ares_qcache_insert(ares_channel_t          *channel,
                                  const ares_timeval_t    *now,
                                  const ares_query_t      *query,
                                  const ares_dns_record_t *dnsrec);
-ares_status_t ares_qcache_fetch(ares_channel_t           *channel,
-                                const ares_timeval_t     *now,
-                                const ares_dns_record_t  *dnsrec,
-                                const ares_dns_record_t **dnsrec_resp);
+
+/*! Look up a response in the query cache.  Does not require the channel lock,
+ *  the query cache has its own.  On ARES_SUCCESS, dnsrec_resp is set to a copy
+ *  of the cached response which must be destroyed by the caller.  Returns
+ *  ARES_ENOTFOUND on a cache miss. */
+ares_status_t ares_qcache_fetch(ares_channel_t          *channel,
+                                const ares_timeval_t    *now,
+                                const ares_dns_record_t *dnsrec,
+                                ares_dns_record_t      **dnsrec_resp);
+
+/*! Attach a shared backing store to the query cache, replacing any existing
+ *  one.  A path of NULL detaches.  Responses that fit are stored in and served
+ *  from the shared store, others remain in the per-channel cache. */
+ares_status_t ares_qcache_attach_shm(ares_qcache_t *cache, const char *path,
+                                     size_t size);
+
+/*! Open (creating if necessary) a shared query cache backing file.  Returns
+ *  ARES_ENOTIMP if not supported on this platform. */
+ares_status_t ares_qcache_shm_open(const char *path, size_t size,
+                                   ares_qcache_shm_t **shm_out);
+void          ares_qcache_shm_close(ares_qcache_shm_t *shm);
+
+/*! Look up a key in the shared cache.  On success dnsrec_out is a newly
+ *  parsed copy of the response with the TTL decrement applied.  Does not
+ *  serialize threads, the caller must. */
+ares_status_t ares_qcache_shm_fetch(ares_qcache_shm_t  *shm,
+                                    const char         *key,
+                                    ares_dns_record_t **dnsrec_out);
+
+/*! Store a wire format response in the shared cache.  Returns ARES_ENOTIMP
+ *  if the response is too large to be stored, or if other writers kept every
+ *  candidate slot busy. */
+ares_status_t ares_qcache_shm_insert(ares_qcache_shm_t   *shm,
+                                     const char          *key,
+                                     const unsigned char *data,
+                                     size_t data_len, unsigned int ttl);
+void          ares_qcache_shm_flush(ares_qcache_shm_t *shm);
+
+typedef ares_status_t (*ares_qcache_shm_cb_t)(
+  void *arg, const char *key, size_t key_len, const unsigned char *data,
+  size_t data_len, ares_int64_t insert_ts, ares_int64_t expire_ts);
+
+/*! Call cb with a consistent copy of every unexpired entry in the shared
+ *  cache, timestamps are wall clock seconds.  Stops at the first callback
+ *  returning anything other than ARES_SUCCESS, and returns that. */
+ares_status_t ares_qcache_shm_foreach(ares_qcache_shm_t   *shm,
+                                      ares_qcache_shm_cb_t cb, void *arg);
+
+ares_status_t ares_cbpool_create(ares_channel_t *channel, size_t nthreads,
+                                 size_t max_pending, ares_cbpool_t **pool_out);
+
+/*! Deliver any pending completions and shut down the workers.  Completions
+ *  arriving afterwards are delivered inline.  Must not be holding the channel
+ *  lock. */
+void          ares_cbpool_drain(ares_cbpool_t *pool);
+
+/*! Destroy the callback worker pool, draining it first if that wasn't done
+ *  yet.  Must not be holding the channel lock. */
+void          ares_cbpool_destroy(ares_cbpool_t *pool);
+
+/*! Number of completions enqueued or being delivered.  Must be holding the
+ *  channel lock. */
+size_t        ares_cbpool_pending(const ares_cbpool_t *pool);
+
+/*! If callback offloading is enabled on the channel, replace the callback
+ *  and argument with a trampoline that will deliver the result via the
+ *  callback worker pool.  No-op otherwise.
+ *
+ *  \param[in]     channel  Initialized ares channel
+ *  \param[in,out] callback Callback to wrap
+ *  \param[in,out] arg      Argument to wrap
+ *  \return ARES_SUCCESS or ARES_ENOMEM
+ */
+ares_status_t ares_cbpool_wrap_dnsrec(const ares_channel_t *channel,
+                                      ares_callback_dnsrec *callback,
+                                      void                **arg);
+
+/*! Same as ares_cbpool_wrap_dnsrec() but for ares_getaddrinfo() callbacks */
+ares_status_t ares_cbpool_wrap_addrinfo(const ares_channel_t   *channel,
+                                        ares_addrinfo_callback *callback,
+                                        void                  **arg);
 
 void ares_metrics_record(const ares_query_t *query, ares_server_t *server,
                          ares_status_t status, const ares_dns_record_t *dnsrec);
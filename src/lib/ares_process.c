@@ -49,11 +49,12 @@ static ares_status_t process_write(ares_channel_t *channel,
                                    ares_socket_t   write_fd);
 static ares_status_t process_read(ares_channel_t       *channel,
                                   ares_socket_t         read_fd,
-                                  const ares_timeval_t *now);
+                                  const ares_timeval_t *now,
+                                  ares_bool_t           parse_unlocked);
 static ares_status_t process_timeouts(ares_channel_t       *channel,
                                       const ares_timeval_t *now);
-static ares_status_t process_answer(ares_channel_t      *channel,
-                                    const unsigned char *abuf, size_t alen,
+static ares_status_t process_answer(ares_channel_t       *channel,
+                                    ares_dns_record_t    *rdnsrec,
                                     ares_conn_t          *conn,
                                     const ares_timeval_t *now,
                                     ares_array_t        **requeue);
@@ -191,9 +192,13 @@ ares_bool_t ares_timedout(const ares_timeval_t *now,
            : ARES_FALSE;
 }
 
+/* parse_unlocked lets answers be parsed with the channel lock released, which
+ * is only safe when the caller holds the lock exactly once and keeps no
+ * references into the channel across the call */
 static ares_status_t ares_process_fds_nolock(ares_channel_t         *channel,
                                              const ares_fd_events_t *events,
-                                             size_t nevents, unsigned int flags)
+                                             size_t nevents, unsigned int flags,
+                                             ares_bool_t parse_unlocked)
 {
   ares_timeval_t now;
   size_t         i;
@@ -225,7 +230,7 @@ static ares_status_t ares_process_fds_nolock(ares_channel_t         *channel,
         !(events[i].events & ARES_FD_EVENT_READ)) {
       continue;
     }
-    status = process_read(channel, events[i].fd, &now);
+    status = process_read(channel, events[i].fd, &now, parse_unlocked);
     if (status == ARES_ENOMEM) {
       goto done;
     }
@@ -260,7 +265,19 @@ ares_status_t ares_process_fds(ares_channel_t         *channel,
   }
 
   ares_channel_lock(channel);
-  status = ares_process_fds_nolock(channel, events, nevents, flags);
+  status = ares_process_fds_nolock(channel, events, nevents, flags, ARES_FALSE);
+  ares_channel_unlock(channel);
+  return status;
+}
+
+ares_status_t ares_process_fds_evthread(ares_channel_t         *channel,
+                                        const ares_fd_events_t *events,
+                                        size_t nevents, unsigned int flags)
+{
+  ares_status_t status;
+
+  ares_channel_lock(channel);
+  status = ares_process_fds_nolock(channel, events, nevents, flags, ARES_TRUE);
   ares_channel_unlock(channel);
   return status;
 }
@@ -378,7 +395,8 @@ void ares_process(ares_channel_t *channel, fd_set *read_fds, fd_set *write_fds)
   }
 
 done:
-  ares_process_fds_nolock(channel, events, nevents, ARES_PROCESS_FLAG_NONE);
+  ares_process_fds_nolock(channel, events, nevents, ARES_PROCESS_FLAG_NONE,
+                          ARES_FALSE);
   ares_free(events);
   ares_free(socketlist);
   ares_channel_unlock(channel);
@@ -671,13 +689,12 @@ static ares_status_t ares_flush_requeue(ares_channel_t       *channel,
   return status;
 }
 
-static ares_status_t read_answers(ares_conn_t *conn, const ares_timeval_t *now)
+/* Move every complete answer buffered on a connection into msgs, keeping the
+ * length prefixes. */
+static ares_status_t fetch_answers(ares_conn_t *conn, ares_buf_t *msgs)
 {
-  ares_status_t   status;
-  ares_channel_t *channel = conn->server->channel;
-  ares_array_t   *requeue = NULL;
+  ares_status_t status;
 
-  /* Process all queued answers */
   while (1) {
     unsigned short       dns_len  = 0;
     const unsigned char *data     = NULL;
@@ -707,22 +724,136 @@ static ares_status_t read_answers(ares_conn_t *conn, const ares_timeval_t *now)
       break;
     }
 
-    /* Strip off 2 bytes length */
-    data     += 2;
-    data_len -= 2;
-
-    /* We finished reading this answer; process it */
-    status = process_answer(channel, data, data_len, conn, now, &requeue);
+    status = ares_buf_append(msgs, data, data_len);
     if (status != ARES_SUCCESS) {
-      handle_conn_error(conn, ARES_TRUE, status);
-      goto cleanup;
+      ares_buf_tag_rollback(conn->in_buf); /* LCOV_EXCL_LINE: OutOfMemory */
+      return status;                       /* LCOV_EXCL_LINE: OutOfMemory */
     }
 
-    /* Since we processed the answer, clear the tag so space can be reclaimed */
+    /* Clear the tag so space can be reclaimed */
     ares_buf_tag_clear(conn->in_buf);
   }
 
-cleanup:
+  return ARES_SUCCESS;
+}
+
+/* Parse every answer in msgs into answers.  This touches no channel state so
+ * the event thread calls it without the channel lock held, letting event
+ * threads parse the answers of their own connections concurrently. */
+static ares_status_t parse_answers(ares_buf_t *msgs, ares_array_t *answers)
+{
+  while (ares_buf_len(msgs) > 0) {
+    unsigned short       dns_len = 0;
+    const unsigned char *data;
+    size_t               data_len = 0;
+    ares_dns_record_t   *dnsrec   = NULL;
+    ares_status_t        status;
+
+    if (ares_buf_fetch_be16(msgs, &dns_len) != ARES_SUCCESS) {
+      break; /* LCOV_EXCL_LINE: DefensiveCoding */
+    }
+
+    /* UDP can have 0-byte messages, drop them to the ground */
+    if (dns_len == 0) {
+      continue;
+    }
+
+    data = ares_buf_peek(msgs, &data_len);
+    if (data == NULL || data_len < dns_len) {
+      break; /* LCOV_EXCL_LINE: DefensiveCoding */
+    }
+
+    /* Not ARES_DNS_PARSE_LAZY, every RR is validated so a reply with bad
+     * record data is rejected here and the query can move on to another
+     * server */
+    status = ares_dns_parse(data, dns_len, ARES_DNS_PARSE_ARENA, &dnsrec);
+    ares_buf_consume(msgs, dns_len);
+
+    /* A NULL record marks the malformed answer */
+    if (status != ARES_SUCCESS) {
+      dnsrec = NULL;
+    }
+
+    status = ares_array_insertdata_last(answers, &dnsrec);
+    if (status != ARES_SUCCESS) {
+      ares_dns_record_destroy(dnsrec); /* LCOV_EXCL_LINE: OutOfMemory */
+      return status;                   /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  return ARES_SUCCESS;
+}
+
+static void answer_free_cb(void *arg)
+{
+  ares_dns_record_t **dnsrec = arg;
+  ares_dns_record_destroy(*dnsrec);
+}
+
+static ares_status_t read_answers(ares_channel_t *channel, ares_conn_t *conn,
+                                  const ares_timeval_t *now,
+                                  ares_bool_t           parse_unlocked)
+{
+  ares_status_t status;
+  ares_socket_t fd         = conn->fd;
+  size_t        generation = conn->generation;
+  ares_array_t *requeue    = NULL;
+  ares_array_t *answers    = NULL;
+  ares_buf_t   *msgs       = NULL;
+
+  msgs    = ares_buf_create();
+  answers = ares_array_create(sizeof(ares_dns_record_t *), answer_free_cb);
+  if (msgs == NULL || answers == NULL) {
+    status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  status = fetch_answers(conn, msgs);
+  if (status != ARES_SUCCESS || ares_buf_len(msgs) == 0) {
+    goto done;
+  }
+
+  /* Parsing is the bulk of the work for an answer and needs no channel state,
+   * so when allowed let other threads use the channel meanwhile */
+  if (parse_unlocked) {
+    ares_channel_unlock(channel);
+  }
+  status = parse_answers(msgs, answers);
+  if (parse_unlocked) {
+    ares_channel_lock(channel);
+  }
+  if (status != ARES_SUCCESS) {
+    goto done; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  while (ares_array_len(answers) > 0) {
+    ares_dns_record_t *dnsrec = NULL;
+
+    /* The connection may have been closed, and its memory or fd reused by a
+     * new one, while the lock was released or by a previous answer.  Its
+     * queries have then been requeued, so the answers can be dropped. */
+    if (ares_conn_revalidate(channel, fd, conn, generation) == NULL) {
+      break;
+    }
+
+    ares_array_claim_at(&dnsrec, sizeof(dnsrec), answers, 0);
+    if (dnsrec == NULL) {
+      status = ARES_EBADRESP;
+    } else {
+      /* Takes ownership of the record */
+      status = process_answer(channel, dnsrec, conn, now, &requeue);
+    }
+
+    if (status != ARES_SUCCESS) {
+      handle_conn_error(conn, ARES_TRUE, status);
+      break;
+    }
+  }
+
+done:
+  ares_array_destroy(answers);
+  ares_buf_destroy(msgs);
+
   /* Flush requeue - re-dispatch retries and invoke deferred callbacks
    * iteratively and safely */
   if (ares_flush_requeue(channel, now, &requeue) == ARES_ENOMEM) {
@@ -734,9 +865,11 @@ cleanup:
 
 static ares_status_t process_read(ares_channel_t       *channel,
                                   ares_socket_t         read_fd,
-                                  const ares_timeval_t *now)
+                                  const ares_timeval_t *now,
+                                  ares_bool_t           parse_unlocked)
 {
   ares_conn_t  *conn = ares_conn_from_fd(channel, read_fd);
+  size_t        generation;
   ares_bool_t   conn_error;
   ares_status_t status;
 
@@ -744,19 +877,20 @@ static ares_status_t process_read(ares_channel_t       *channel,
     return ARES_SUCCESS;
   }
 
-  status = read_conn_packets(conn, &conn_error);
+  generation = conn->generation;
+  status     = read_conn_packets(conn, &conn_error);
 
   if (status != ARES_SUCCESS) {
     return status;
   }
 
-  status = read_answers(conn, now);
+  status = read_answers(channel, conn, now, parse_unlocked);
   if (status != ARES_SUCCESS) {
     return status;
   }
 
   if (conn_error) {
-    conn = ares_conn_from_fd(channel, read_fd);
+    conn = ares_conn_revalidate(channel, read_fd, conn, generation);
     if (conn != NULL) {
       handle_conn_error(conn, ARES_TRUE, ARES_ECONNREFUSED);
     }
@@ -890,32 +1024,17 @@ static ares_bool_t issue_might_be_edns(const ares_dns_record_t *req,
 /* Handle an answer from a server. This must NEVER cleanup the
  * server connection! Return something other than ARES_SUCCESS to cause
  * the connection to be terminated after this call. */
-static ares_status_t process_answer(ares_channel_t      *channel,
-                                    const unsigned char *abuf, size_t alen,
+static ares_status_t process_answer(ares_channel_t       *channel,
+                                    ares_dns_record_t    *rdnsrec,
                                     ares_conn_t          *conn,
                                     const ares_timeval_t *now,
                                     ares_array_t        **requeue)
 {
-  ares_query_t      *query;
+  ares_query_t  *query;
   /* Cache these as once ares_send_query() gets called, it may end up
    * invalidating the connection all-together */
-  ares_server_t     *server  = conn->server;
-  ares_dns_record_t *rdnsrec = NULL;
-  ares_status_t      status;
-  ares_bool_t        is_cached = ARES_FALSE;
-
-  /* UDP can have 0-byte messages, drop them to the ground */
-  if (alen == 0) {
-    return ARES_SUCCESS;
-  }
-
-  /* Parse the response */
-  status = ares_dns_parse(abuf, alen, 0, &rdnsrec);
-  if (status != ARES_SUCCESS) {
-    /* Malformations are never accepted */
-    status = ARES_EBADRESP;
-    goto cleanup;
-  }
+  ares_server_t *server = conn->server;
+  ares_status_t  status;
 
   /* Find the query corresponding to this packet. The queries are
    * hashed/bucketed by query id, so this lookup should be quick.
@@ -1027,10 +1146,7 @@ static ares_status_t process_answer(ares_channel_t      *channel,
   status = ARES_SUCCESS;
 
 cleanup:
-  /* Don't cleanup the cached pointer to the dns response */
-  if (!is_cached) {
-    ares_dns_record_destroy(rdnsrec);
-  }
+  ares_dns_record_destroy(rdnsrec);
 
   return status;
 }
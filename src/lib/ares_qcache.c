@@ -25,17 +25,35 @@
  */
 #include "ares_private.h"
 
+#ifdef _WIN32
+#  include <io.h>
+#endif
+
+/* The query cache is protected by its own lock so that it can be snapshotted
+ * and shared without the channel lock.  Responses are stored in wire format,
+ * which is both smaller than a parsed record and means a hit costs a single
+ * parse to produce the caller's private copy.  Entries are immutable once
+ * inserted; a hit takes a reference to the entry so it can be parsed outside
+ * of the lock, even if the entry expires or is flushed concurrently.
+ *
+ * If a shared backing store is attached, responses that fit are stored there
+ * instead of in the per-channel cache so they can be shared with other
+ * channels and processes. */
 struct ares_qcache {
+  ares_thread_mutex_t *lock;
   ares_htable_strvp_t *cache;
   ares_slist_t        *expire;
   unsigned int         max_ttl;
+  ares_qcache_shm_t   *shm;
 };
 
 typedef struct {
-  char              *key;
-  ares_dns_record_t *dnsrec;
-  time_t             expire_ts;
-  time_t             insert_ts;
+  char          *key;
+  unsigned char *data;
+  size_t         data_len;
+  time_t         expire_ts;
+  time_t         insert_ts;
+  size_t         refcnt;
 } ares_qcache_entry_t;
 
 static char *ares_qcache_calc_key(const ares_dns_record_t *dnsrec)
@@ -161,7 +179,14 @@ static void ares_qcache_expire(ares_qcache_t *cache, const ares_timeval_t *now)
 
 void ares_qcache_flush(ares_qcache_t *cache)
 {
+  if (cache == NULL) {
+    return;
+  }
+
+  ares_thread_mutex_lock(cache->lock);
   ares_qcache_expire(cache, NULL /* flush all */);
+  ares_qcache_shm_flush(cache->shm);
+  ares_thread_mutex_unlock(cache->lock);
 }
 
 void ares_qcache_destroy(ares_qcache_t *cache)
@@ -172,6 +197,8 @@ void ares_qcache_destroy(ares_qcache_t *cache)
 
   ares_htable_strvp_destroy(cache->cache);
   ares_slist_destroy(cache->expire);
+  ares_qcache_shm_close(cache->shm);
+  ares_thread_mutex_destroy(cache->lock);
   ares_free(cache);
 }
 
@@ -191,6 +218,7 @@ static int ares_qcache_entry_sort_cb(const void *arg1, const void *arg2)
   return 0;
 }
 
+/* Must be called with the cache lock held */
 static void ares_qcache_entry_destroy_cb(void *arg)
 {
   ares_qcache_entry_t *entry = arg;
@@ -198,8 +226,14 @@ static void ares_qcache_entry_destroy_cb(void *arg)
     return; /* LCOV_EXCL_LINE: DefensiveCoding */
   }
 
+  /* Still referenced by an in-flight fetch, last one out frees it */
+  entry->refcnt--;
+  if (entry->refcnt > 0) {
+    return;
+  }
+
   ares_free(entry->key);
-  ares_dns_record_destroy(entry->dnsrec);
+  ares_free(entry->data);
   ares_free(entry);
 }
 
@@ -216,6 +250,16 @@ ares_status_t ares_qcache_create(ares_rand_state *rand_state,
     goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
   }
 
+  /* Will be NULL if built without thread support, which is fine as the
+   * lock functions are then no-ops */
+  if (ares_threadsafety()) {
+    cache->lock = ares_thread_mutex_create();
+    if (cache->lock == NULL) {
+      status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+      goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
   cache->cache = ares_htable_strvp_create(NULL);
   if (cache->cache == NULL) {
     status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
@@ -242,7 +286,32 @@ done:
   return status;
 }
 
-static unsigned int ares_qcache_calc_minttl(ares_dns_record_t *dnsrec)
+ares_status_t ares_qcache_attach_shm(ares_qcache_t *cache, const char *path,
+                                     size_t size)
+{
+  ares_status_t      status = ARES_SUCCESS;
+  ares_qcache_shm_t *shm    = NULL;
+
+  if (cache == NULL) {
+    return ARES_EFORMERR; /* LCOV_EXCL_LINE: DefensiveCoding */
+  }
+
+  if (path != NULL) {
+    status = ares_qcache_shm_open(path, size, &shm);
+    if (status != ARES_SUCCESS) {
+      return status;
+    }
+  }
+
+  ares_thread_mutex_lock(cache->lock);
+  ares_qcache_shm_close(cache->shm);
+  cache->shm = shm;
+  ares_thread_mutex_unlock(cache->lock);
+
+  return status;
+}
+
+static unsigned int ares_qcache_calc_minttl(const ares_dns_record_t *dnsrec)
 {
   unsigned int minttl = 0xFFFFFFFF;
   size_t       sect;
@@ -252,7 +321,7 @@ static unsigned int ares_qcache_calc_minttl(ares_dns_record_t *dnsrec)
     for (i = 0; i < ares_dns_record_rr_cnt(dnsrec, (ares_dns_section_t)sect);
          i++) {
       const ares_dns_rr_t *rr =
-        ares_dns_record_rr_get(dnsrec, (ares_dns_section_t)sect, i);
+        ares_dns_record_rr_get_const(dnsrec, (ares_dns_section_t)sect, i);
       ares_dns_rec_type_t type = ares_dns_rr_get_type(rr);
       unsigned int        ttl  = ares_dns_rr_get_ttl(rr);
 
@@ -271,7 +340,7 @@ static unsigned int ares_qcache_calc_minttl(ares_dns_record_t *dnsrec)
   return minttl;
 }
 
-static unsigned int ares_qcache_soa_minimum(ares_dns_record_t *dnsrec)
+unsigned int ares_qcache_soa_minimum(const ares_dns_record_t *dnsrec)
 {
   size_t i;
 
@@ -279,7 +348,7 @@ static unsigned int ares_qcache_soa_minimum(ares_dns_record_t *dnsrec)
    * record. */
   for (i = 0; i < ares_dns_record_rr_cnt(dnsrec, ARES_SECTION_AUTHORITY); i++) {
     const ares_dns_rr_t *rr =
-      ares_dns_record_rr_get(dnsrec, ARES_SECTION_AUTHORITY, i);
+      ares_dns_record_rr_get_const(dnsrec, ARES_SECTION_AUTHORITY, i);
     ares_dns_rec_type_t type = ares_dns_rr_get_type(rr);
     unsigned int        ttl;
     unsigned int        minimum;
@@ -300,16 +369,58 @@ static unsigned int ares_qcache_soa_minimum(ares_dns_record_t *dnsrec)
   return 0;
 }
 
-/* On success, takes ownership of dnsrec */
+/* On success, takes ownership of key and data.  Must be called with the
+ * cache lock held. */
+static ares_status_t ares_qcache_insert_entry(ares_qcache_t *qcache, char *key,
+                                              unsigned char *data,
+                                              size_t         data_len,
+                                              time_t         insert_ts,
+                                              time_t         expire_ts)
+{
+  ares_qcache_entry_t *entry;
+
+  entry = ares_malloc_zero(sizeof(*entry));
+  if (entry == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  entry->key       = key;
+  entry->data      = data;
+  entry->data_len  = data_len;
+  entry->expire_ts = expire_ts;
+  entry->insert_ts = insert_ts;
+  entry->refcnt    = 1;
+
+  if (!ares_htable_strvp_insert(qcache->cache, entry->key, entry)) {
+    goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  if (ares_slist_insert(qcache->expire, entry) == NULL) {
+    goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  return ARES_SUCCESS;
+
+/* LCOV_EXCL_START: OutOfMemory */
+fail:
+  ares_htable_strvp_remove(qcache->cache, entry->key);
+  ares_free(entry);
+  return ARES_ENOMEM;
+  /* LCOV_EXCL_STOP */
+}
+
 static ares_status_t ares_qcache_insert_int(ares_qcache_t           *qcache,
-                                            ares_dns_record_t       *qresp,
+                                            const ares_dns_record_t *qresp,
                                             const ares_dns_record_t *qreq,
                                             const ares_timeval_t    *now)
 {
-  ares_qcache_entry_t *entry;
-  unsigned int         ttl;
-  ares_dns_rcode_t     rcode = ares_dns_record_get_rcode(qresp);
-  ares_dns_flags_t     flags = ares_dns_record_get_flags(qresp);
+  char            *key      = NULL;
+  unsigned char   *data     = NULL;
+  size_t           data_len = 0;
+  unsigned int     ttl;
+  ares_status_t    status;
+  ares_dns_rcode_t rcode = ares_dns_record_get_rcode(qresp);
+  ares_dns_flags_t flags = ares_dns_record_get_flags(qresp);
 
   if (qcache == NULL || qresp == NULL) {
     return ARES_EFORMERR;
@@ -341,52 +452,52 @@ static ares_status_t ares_qcache_insert_int(ares_qcache_t           *qcache,
     return ARES_EREFUSED;
   }
 
-  entry = ares_malloc_zero(sizeof(*entry));
-  if (entry == NULL) {
-    goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
-  }
-
-  entry->dnsrec    = qresp;
-  entry->expire_ts = (time_t)now->sec + (time_t)ttl;
-  entry->insert_ts = (time_t)now->sec;
-
   /* We can't guarantee the server responded with the same flags as the
    * request had, so we have to re-parse the request in order to generate the
    * key for caching, but we'll only do this once we know for sure we really
    * want to cache it */
-  entry->key = ares_qcache_calc_key(qreq);
-  if (entry->key == NULL) {
-    goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
-  }
-
-  if (!ares_htable_strvp_insert(qcache->cache, entry->key, entry)) {
-    goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+  key = ares_qcache_calc_key(qreq);
+  if (key == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
   }
 
-  if (ares_slist_insert(qcache->expire, entry) == NULL) {
-    goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+  status = ares_dns_write(qresp, &data, &data_len);
+  if (status != ARES_SUCCESS) {
+    goto done;
   }
 
-  return ARES_SUCCESS;
+  ares_thread_mutex_lock(qcache->lock);
 
-/* LCOV_EXCL_START: OutOfMemory */
-fail:
-  if (entry != NULL) {
-    if (entry->key != NULL) {
-      ares_htable_strvp_remove(qcache->cache, entry->key);
-      ares_free(entry->key);
+  /* Prefer the shared store if there is one, falling back to the local cache
+   * for responses it can't hold */
+  if (qcache->shm != NULL &&
+      ares_qcache_shm_insert(qcache->shm, key, data, data_len, ttl) ==
+        ARES_SUCCESS) {
+    status = ARES_SUCCESS;
+  } else {
+    status = ares_qcache_insert_entry(qcache, key, data, data_len,
+                                      (time_t)now->sec,
+                                      (time_t)now->sec + (time_t)ttl);
+    if (status == ARES_SUCCESS) {
+      key  = NULL;
+      data = NULL;
     }
-    ares_free(entry);
   }
-  return ARES_ENOMEM;
-  /* LCOV_EXCL_STOP */
+
+  ares_thread_mutex_unlock(qcache->lock);
+
+done:
+  ares_free(key);
+  ares_free(data);
+  return status;
 }
 
 ares_status_t ares_qcache_fetch(ares_channel_t           *channel,
                                 const ares_timeval_t     *now,
                                 const ares_dns_record_t  *dnsrec,
-                                const ares_dns_record_t **dnsrec_resp)
+                                ares_dns_record_t       **dnsrec_resp)
 {
+  ares_qcache_t       *qcache;
   char                *key = NULL;
   ares_qcache_entry_t *entry;
   ares_status_t        status = ARES_SUCCESS;
@@ -395,31 +506,52 @@ ares_status_t ares_qcache_fetch(ares_channel_t           *channel,
     return ARES_EFORMERR;
   }
 
-  if (channel->qcache == NULL) {
+  *dnsrec_resp = NULL;
+
+  qcache = channel->qcache;
+  if (qcache == NULL) {
     return ARES_ENOTFOUND;
   }
 
-  ares_qcache_expire(channel->qcache, now);
-
+  /* Calculate the key before taking the lock, it doesn't touch the cache */
   key = ares_qcache_calc_key(dnsrec);
   if (key == NULL) {
-    status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
-    goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
   }
 
-  entry = ares_htable_strvp_get_direct(channel->qcache->cache, key);
-  if (entry == NULL) {
+  ares_thread_mutex_lock(qcache->lock);
+
+  ares_qcache_expire(qcache, now);
+
+  entry = ares_htable_strvp_get_direct(qcache->cache, key);
+  if (entry != NULL) {
+    entry->refcnt++;
+  } else if (qcache->shm != NULL) {
+    status = ares_qcache_shm_fetch(qcache->shm, key, dnsrec_resp);
+  } else {
     status = ARES_ENOTFOUND;
-    goto done;
   }
 
-  ares_dns_record_ttl_decrement(entry->dnsrec,
-                                (unsigned int)(now->sec - entry->insert_ts));
-
-  *dnsrec_resp = entry->dnsrec;
+  ares_thread_mutex_unlock(qcache->lock);
 
-done:
   ares_free(key);
+
+  if (entry == NULL) {
+    return status;
+  }
+
+  /* The cached response is never modified after insertion, so it is safe to
+   * parse it without the lock held while we hold a reference. */
+  status = ares_dns_parse(entry->data, entry->data_len, 0, dnsrec_resp);
+  if (status == ARES_SUCCESS) {
+    ares_dns_record_ttl_decrement(*dnsrec_resp,
+                                  (unsigned int)(now->sec - entry->insert_ts));
+  }
+
+  ares_thread_mutex_lock(qcache->lock);
+  ares_qcache_entry_destroy_cb(entry);
+  ares_thread_mutex_unlock(qcache->lock);
+
   return status;
 }
 
@@ -428,15 +560,359 @@ ares_status_t ares_qcache_insert(ares_channel_t          *channel,
                                  const ares_query_t      *query,
                                  const ares_dns_record_t *dnsrec)
 {
-  ares_dns_record_t *dupdns = ares_dns_record_duplicate(dnsrec);
+  if (channel->qcache == NULL) {
+    return ARES_EFORMERR;
+  }
+
+  return ares_qcache_insert_int(channel->qcache, dnsrec, query->query, now);
+}
+
+/* Snapshot format, all integers big endian:
+ *   "ARESQC" 0x00 <version>
+ *   Repeated for each entry:
+ *     64bit expiration time, wall clock seconds
+ *     64bit insertion time, wall clock seconds
+ *     16bit key length, key
+ *     16bit response length, wire format response
+ *
+ * The cache internally uses the monotonic clock which is meaningless across
+ * restarts, so timestamps are converted to and from wall clock time. */
+static const unsigned char ares_qcache_snapshot_magic[] = {
+  'A', 'R', 'E', 'S', 'Q', 'C', 0x00, 0x01
+};
+
+static ares_status_t ares_qcache_append_be64(ares_buf_t *buf, ares_int64_t val)
+{
+  ares_status_t status;
+
+  status = ares_buf_append_be32(buf, (unsigned int)((val >> 32) & 0xFFFFFFFF));
+  if (status != ARES_SUCCESS) {
+    return status; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+  return ares_buf_append_be32(buf, (unsigned int)(val & 0xFFFFFFFF));
+}
+
+static ares_status_t ares_qcache_fetch_be64(ares_buf_t *buf, ares_int64_t *val)
+{
+  unsigned int  hi;
+  unsigned int  lo;
+  ares_status_t status;
+
+  status = ares_buf_fetch_be32(buf, &hi);
+  if (status != ARES_SUCCESS) {
+    return status;
+  }
+  status = ares_buf_fetch_be32(buf, &lo);
+  if (status != ARES_SUCCESS) {
+    return status;
+  }
+  *val = (ares_int64_t)(((ares_uint64_t)hi << 32) | lo);
+  return ARES_SUCCESS;
+}
+
+/* Matches ares_qcache_shm_cb_t so shared entries can be appended directly,
+ * arg is the snapshot buffer and timestamps are wall clock. */
+static ares_status_t ares_qcache_snapshot_append(void *arg, const char *key,
+                                                 size_t               key_len,
+                                                 const unsigned char *data,
+                                                 size_t               data_len,
+                                                 ares_int64_t insert_ts,
+                                                 ares_int64_t expire_ts)
+{
+  ares_buf_t   *buf = arg;
+  ares_status_t status;
+
+  if (key_len > 0xFFFF || data_len > 0xFFFF) {
+    return ARES_SUCCESS; /* LCOV_EXCL_LINE: DefensiveCoding */
+  }
+
+  status = ares_qcache_append_be64(buf, expire_ts);
+  if (status != ARES_SUCCESS) {
+    return status; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  status = ares_qcache_append_be64(buf, insert_ts);
+  if (status != ARES_SUCCESS) {
+    return status; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  status = ares_buf_append_be16(buf, (unsigned short)key_len);
+  if (status != ARES_SUCCESS) {
+    return status; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  status = ares_buf_append(buf, (const unsigned char *)key, key_len);
+  if (status != ARES_SUCCESS) {
+    return status; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  status = ares_buf_append_be16(buf, (unsigned short)data_len);
+  if (status != ARES_SUCCESS) {
+    return status; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  return ares_buf_append(buf, data, data_len);
+}
+
+/* Write the snapshot to a temporary file next to path, flush it to stable
+ * storage and then rename it into place, so a crash or a concurrent load
+ * never observes a partially written snapshot. */
+static ares_status_t ares_qcache_write_file(const char          *path,
+                                            const unsigned char *data,
+                                            size_t               data_len)
+{
+  ares_buf_t   *buf;
+  char         *tmppath;
+  FILE         *fp;
+  ares_status_t status = ARES_SUCCESS;
+
+  buf = ares_buf_create();
+  if (buf == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  if (ares_buf_append_str(buf, path) != ARES_SUCCESS ||
+      ares_buf_append_str(buf, ".tmp") != ARES_SUCCESS) {
+    ares_buf_destroy(buf); /* LCOV_EXCL_LINE: OutOfMemory */
+    return ARES_ENOMEM;    /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  tmppath = ares_buf_finish_str(buf, NULL);
+  if (tmppath == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  fp = fopen(tmppath, "wb");
+  if (fp == NULL) {
+    status = ARES_EFILE;
+    goto done;
+  }
+
+  if (fwrite(data, 1, data_len, fp) != data_len || fflush(fp) != 0) {
+    status = ARES_EFILE; /* LCOV_EXCL_LINE: UntestablePath */
+  }
+
+#ifdef _WIN32
+  if (status == ARES_SUCCESS && _commit(_fileno(fp)) != 0) {
+    status = ARES_EFILE; /* LCOV_EXCL_LINE: UntestablePath */
+  }
+#elif defined(HAVE_UNISTD_H)
+  if (status == ARES_SUCCESS && fsync(fileno(fp)) != 0) {
+    status = ARES_EFILE; /* LCOV_EXCL_LINE: UntestablePath */
+  }
+#endif
+
+  if (fclose(fp) != 0) {
+    status = ARES_EFILE; /* LCOV_EXCL_LINE: UntestablePath */
+  }
+
+  if (status == ARES_SUCCESS) {
+#ifdef _WIN32
+    if (!MoveFileExA(tmppath, path,
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+      status = ARES_EFILE;
+    }
+#else
+    if (rename(tmppath, path) != 0) {
+      status = ARES_EFILE;
+    }
+#endif
+  }
+
+  if (status != ARES_SUCCESS) {
+    remove(tmppath);
+  }
+
+done:
+  ares_free(tmppath);
+  return status;
+}
+
+ares_status_t ares_query_cache_save(ares_channel_t *channel, const char *path)
+{
+  ares_qcache_t     *qcache;
+  ares_buf_t        *buf = NULL;
+  ares_slist_node_t *node;
+  ares_timeval_t     now;
+  ares_int64_t       now_wall;
+  unsigned char     *data     = NULL;
+  size_t             data_len = 0;
   ares_status_t      status;
 
-  if (dupdns == NULL) {
-    return ARES_ENOMEM;
+  if (channel == NULL || path == NULL) {
+    return ARES_EFORMERR;
+  }
+
+  qcache = channel->qcache;
+  if (qcache == NULL || qcache->max_ttl == 0) {
+    return ARES_ENOTIMP;
   }
-  status = ares_qcache_insert_int(channel->qcache, dupdns, query->query, now);
+
+  buf = ares_buf_create();
+  if (buf == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  status = ares_buf_append(buf, ares_qcache_snapshot_magic,
+                           sizeof(ares_qcache_snapshot_magic));
+  if (status != ARES_SUCCESS) {
+    goto done; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  ares_tvnow(&now);
+  now_wall = (ares_int64_t)time(NULL);
+
+  ares_thread_mutex_lock(qcache->lock);
+  ares_qcache_expire(qcache, &now);
+  for (node = ares_slist_node_first(qcache->expire); node != NULL;
+       node = ares_slist_node_next(node)) {
+    const ares_qcache_entry_t *entry = ares_slist_node_val(node);
+
+    status = ares_qcache_snapshot_append(
+      buf, entry->key, ares_strlen(entry->key), entry->data, entry->data_len,
+      now_wall - ((ares_int64_t)now.sec - (ares_int64_t)entry->insert_ts),
+      now_wall + ((ares_int64_t)entry->expire_ts - (ares_int64_t)now.sec));
+    if (status != ARES_SUCCESS) {
+      break; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+  /* Entries held in the shared store are part of this channel's cache too,
+   * they already carry wall clock timestamps */
+  if (status == ARES_SUCCESS && qcache->shm != NULL) {
+    status =
+      ares_qcache_shm_foreach(qcache->shm, ares_qcache_snapshot_append, buf);
+  }
+  ares_thread_mutex_unlock(qcache->lock);
+
+  if (status != ARES_SUCCESS) {
+    goto done; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  data = ares_buf_finish_bin(buf, &data_len);
+  buf  = NULL;
+  if (data == NULL) {
+    status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  status = ares_qcache_write_file(path, data, data_len);
+
+done:
+  ares_buf_destroy(buf);
+  ares_free(data);
+  return status;
+}
+
+ares_status_t ares_query_cache_load(ares_channel_t *channel, const char *path)
+{
+  ares_qcache_t     *qcache;
+  ares_buf_t        *buf = NULL;
+  ares_timeval_t     now;
+  ares_int64_t       now_wall;
+  unsigned char      magic[sizeof(ares_qcache_snapshot_magic)];
+  ares_status_t      status;
+
+  if (channel == NULL || path == NULL) {
+    return ARES_EFORMERR;
+  }
+
+  qcache = channel->qcache;
+  if (qcache == NULL || qcache->max_ttl == 0) {
+    return ARES_ENOTIMP;
+  }
+
+  buf = ares_buf_create();
+  if (buf == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  status = ares_buf_load_file(path, buf);
   if (status != ARES_SUCCESS) {
-    ares_dns_record_destroy(dupdns);
+    goto done;
+  }
+
+  if (ares_buf_fetch_bytes(buf, magic, sizeof(magic)) != ARES_SUCCESS ||
+      memcmp(magic, ares_qcache_snapshot_magic, sizeof(magic)) != 0) {
+    status = ARES_EFILE;
+    goto done;
+  }
+
+  ares_tvnow(&now);
+  now_wall = (ares_int64_t)time(NULL);
+
+  while (ares_buf_len(buf) > 0) {
+    ares_int64_t         expire_ts;
+    ares_int64_t         insert_ts;
+    ares_int64_t         remaining;
+    ares_int64_t         age;
+    unsigned short       key_len;
+    unsigned short       data_len;
+    char                *key    = NULL;
+    ares_dns_record_t   *dnsrec = NULL;
+    unsigned char       *dup    = NULL;
+    const unsigned char *data;
+    size_t               remaining_len;
+
+    if (ares_qcache_fetch_be64(buf, &expire_ts) != ARES_SUCCESS ||
+        ares_qcache_fetch_be64(buf, &insert_ts) != ARES_SUCCESS ||
+        ares_buf_fetch_be16(buf, &key_len) != ARES_SUCCESS || key_len == 0 ||
+        ares_buf_fetch_bytes_dup(buf, key_len, ARES_TRUE,
+                                 (unsigned char **)&key) != ARES_SUCCESS) {
+      status = ARES_EFILE;
+      goto done;
+    }
+
+    if (ares_buf_fetch_be16(buf, &data_len) != ARES_SUCCESS ||
+        (data = ares_buf_peek(buf, &remaining_len)) == NULL ||
+        remaining_len < data_len) {
+      ares_free(key);
+      status = ARES_EFILE;
+      goto done;
+    }
+
+    remaining = expire_ts - now_wall;
+    age       = now_wall - insert_ts;
+
+    /* Skip anything that has expired since the snapshot, or has timestamps
+     * that make no sense relative to the current time */
+    if (remaining <= 0 || age < 0 ||
+        ares_dns_parse(data, data_len, 0, &dnsrec) != ARES_SUCCESS) {
+      ares_free(key);
+      ares_buf_consume(buf, data_len);
+      continue;
+    }
+    /* Only parsed to validate it, the cache holds the wire format */
+    ares_dns_record_destroy(dnsrec);
+
+    dup = ares_malloc(data_len);
+    if (dup == NULL) {
+      ares_free(key);       /* LCOV_EXCL_LINE: OutOfMemory */
+      status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+      goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+    memcpy(dup, data, data_len);
+    ares_buf_consume(buf, data_len);
+
+    if (remaining > (ares_int64_t)qcache->max_ttl) {
+      remaining = (ares_int64_t)qcache->max_ttl;
+    }
+
+    ares_thread_mutex_lock(qcache->lock);
+    /* Anything already cached is at least as fresh as the snapshot */
+    if (ares_htable_strvp_get_direct(qcache->cache, key) != NULL ||
+        ares_qcache_insert_entry(qcache, key, dup, data_len,
+                                 (time_t)(now.sec - age),
+                                 (time_t)(now.sec + remaining)) !=
+          ARES_SUCCESS) {
+      ares_free(key);
+      ares_free(dup);
+    }
+    ares_thread_mutex_unlock(qcache->lock);
   }
+
+  status = ARES_SUCCESS;
+
+done:
+  ares_buf_destroy(buf);
   return status;
 }
@@ -0,0 +1,652 @@
+/* MIT License
+ *
+ * Copyright (c) The c-ares project and its contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ares_private.h"
+#include "dsa/ares_htable.h"
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_FCNTL_H) && \
+  defined(HAVE_UNISTD_H) && !defined(_WIN32)
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <errno.h>
+/* Traditional POSIX record locks are owned by the process, so they neither
+ * exclude threads nor channels within a process, and closing any descriptor
+ * for the file drops them.  Only open file description locks give the
+ * semantics needed to initialize the file, and slots are accessed with the
+ * GCC/Clang __atomic builtins, so without both the shared cache isn't
+ * offered. */
+#  if defined(F_OFD_SETLKW) && defined(F_OFD_SETLK) && defined(__ATOMIC_ACQUIRE)
+#    define CARES_QCACHE_SHM 1
+#  endif
+#endif
+
+#ifdef CARES_QCACHE_SHM
+
+/* Shared query cache backing store.
+ *
+ * The cache lives in a file mapped into every process that opens the same
+ * path (ideally on a tmpfs such as /dev/shm).  It is a fixed size, open
+ * addressed hash table of fixed size slots, each holding the cache key and
+ * the wire format response.  Responses that don't fit in a slot are simply
+ * not stored here.
+ *
+ * Each slot is guarded by its own sequence lock, so lookups never block or
+ * make a system call to lock:  a reader copies the slot out, then checks the
+ * sequence number was even (not being written) and hasn't changed, retrying a
+ * few times otherwise.  A writer claims a slot by atomically moving its
+ * sequence number from even to odd, and releases it by bumping it again once
+ * written, so writers to different slots don't contend either.  A writer that
+ * dies mid-write leaves its slot odd, and the slot is then never used again.
+ * Open file description locks on the backing file are only taken while
+ * creating and initializing the file, which excludes other processes as well
+ * as other channels in the same process.
+ *
+ * The file may be written by anyone able to open it, so nothing read from it
+ * is trusted: the header is validated when mapping, and slots are copied out
+ * before their lengths are checked and used.  Touching the mapping past the
+ * end of a file a peer has truncated faults with SIGBUS, so the size is also
+ * checked before every access and a shrunk file is never accessed again.
+ * That can't close the window against a truncation racing with an access.
+ *
+ * Timestamps are wall-clock based as the monotonic clock isn't guaranteed to
+ * be comparable across processes or to survive a reboot with a persistent
+ * backing file.  Entries with timestamps that don't make sense relative to
+ * the current time are treated as expired. */
+
+#  define ARES_QCACHE_SHM_MAGIC     0x61717368 /* "aqsh" */
+#  define ARES_QCACHE_SHM_VERSION   2
+#  define ARES_QCACHE_SHM_HDR_LEN   64
+#  define ARES_QCACHE_SHM_SLOT_LEN  1280
+#  define ARES_QCACHE_SHM_PROBE_LEN 8
+#  define ARES_QCACHE_SHM_RETRIES   4
+
+typedef struct {
+  unsigned int magic;
+  unsigned int version;
+  unsigned int slot_len;
+  unsigned int nslots;
+} ares_qcache_shm_hdr_t;
+
+typedef struct {
+  unsigned int   seq; /* Odd while being written */
+  unsigned int   hash;
+  ares_int64_t   expire_ts;
+  ares_int64_t   insert_ts;
+  unsigned short key_len; /* 0 if slot is unused */
+  unsigned short data_len;
+} ares_qcache_shm_slot_t;
+
+struct ares_qcache_shm {
+  int            fd;
+  unsigned char *map;
+  size_t         map_len;
+  size_t         nslots;
+  ares_bool_t    truncated;
+};
+
+#  define ARES_QCACHE_SHM_PAYLOAD_LEN \
+    (ARES_QCACHE_SHM_SLOT_LEN - sizeof(ares_qcache_shm_slot_t))
+
+static ares_bool_t ares_qcache_shm_lock(const ares_qcache_shm_t *shm)
+{
+  struct flock fl;
+
+  memset(&fl, 0, sizeof(fl));
+  fl.l_type   = F_WRLCK;
+  fl.l_whence = SEEK_SET;
+  fl.l_start  = 0;
+  fl.l_len    = 0; /* Whole file */
+
+  while (1) {
+    if (fcntl(shm->fd, F_OFD_SETLKW, &fl) == 0) {
+      return ARES_TRUE;
+    }
+    if (errno != EINTR) {
+      return ARES_FALSE; /* LCOV_EXCL_LINE: UntestablePath */
+    }
+  }
+}
+
+static void ares_qcache_shm_unlock(const ares_qcache_shm_t *shm)
+{
+  struct flock fl;
+
+  memset(&fl, 0, sizeof(fl));
+  fl.l_type   = F_UNLCK;
+  fl.l_whence = SEEK_SET;
+  fl.l_start  = 0;
+  fl.l_len    = 0;
+
+  fcntl(shm->fd, F_OFD_SETLK, &fl);
+}
+
+/* Whether the mapping may be accessed, i.e. the file hasn't been truncated
+ * below the mapped length by a peer */
+static ares_bool_t ares_qcache_shm_usable(ares_qcache_shm_t *shm)
+{
+  struct stat st;
+
+  if (shm->truncated) {
+    return ARES_FALSE;
+  }
+
+  if (fstat(shm->fd, &st) != 0 || st.st_size < 0 ||
+      (size_t)st.st_size < shm->map_len) {
+    shm->truncated = ARES_TRUE;
+    return ARES_FALSE;
+  }
+
+  return ARES_TRUE;
+}
+
+static ares_qcache_shm_slot_t *
+  ares_qcache_shm_slot(const ares_qcache_shm_t *shm, size_t idx)
+{
+  return (ares_qcache_shm_slot_t *)((void *)(shm->map +
+                                             ARES_QCACHE_SHM_HDR_LEN +
+                                             (idx % shm->nslots) *
+                                               ARES_QCACHE_SHM_SLOT_LEN));
+}
+
+static unsigned char *ares_qcache_shm_slot_key(ares_qcache_shm_slot_t *slot)
+{
+  return (unsigned char *)slot + sizeof(*slot);
+}
+
+/* Take a consistent copy of a slot: its header into hdr and its key and data
+ * into payload, which holds ARES_QCACHE_SHM_PAYLOAD_LEN bytes.  Fails if the
+ * slot is being written, or was rewritten during every attempt.  A slot with
+ * lengths that don't fit is copied as unused.  Other processes may modify the
+ * slot at any time, so only the copies may be used. */
+static ares_bool_t ares_qcache_shm_slot_read(ares_qcache_shm_slot_t *slot,
+                                             ares_qcache_shm_slot_t *hdr,
+                                             unsigned char          *payload)
+{
+  size_t i;
+
+  for (i = 0; i < ARES_QCACHE_SHM_RETRIES; i++) {
+    unsigned int seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    size_t       len;
+
+    if (seq & 1) {
+      continue;
+    }
+
+    memcpy(hdr, slot, sizeof(*hdr));
+    len = (size_t)hdr->key_len + hdr->data_len;
+    if (len > ARES_QCACHE_SHM_PAYLOAD_LEN) {
+      hdr->key_len  = 0;
+      hdr->data_len = 0;
+      len           = 0;
+    }
+    memcpy(payload, ares_qcache_shm_slot_key(slot), len);
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq) {
+      hdr->seq = seq;
+      return ARES_TRUE;
+    }
+  }
+
+  return ARES_FALSE;
+}
+
+/* Claim a slot for writing, as long as it is still as it was read at seq */
+static ares_bool_t ares_qcache_shm_slot_claim(ares_qcache_shm_slot_t *slot,
+                                              unsigned int            seq)
+{
+  if (!__atomic_compare_exchange_n(&slot->seq, &seq, seq + 1, 0,
+                                   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+    return ARES_FALSE;
+  }
+  /* Readers must see the odd sequence number before any of the new contents */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  return ARES_TRUE;
+}
+
+static void ares_qcache_shm_slot_release(ares_qcache_shm_slot_t *slot,
+                                         unsigned int            seq)
+{
+  __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+static ares_bool_t ares_qcache_shm_slot_expired(
+  const ares_qcache_shm_slot_t *hdr, ares_int64_t now)
+{
+  if (hdr->key_len == 0) {
+    return ARES_TRUE;
+  }
+
+  /* Written in the future, the clock must have gone backwards */
+  if (hdr->insert_ts > now) {
+    return ARES_TRUE;
+  }
+
+  return hdr->expire_ts <= now ? ARES_TRUE : ARES_FALSE;
+}
+
+static ares_bool_t ares_qcache_shm_slot_match(const ares_qcache_shm_slot_t *hdr,
+                                              const unsigned char *payload,
+                                              unsigned int hash,
+                                              const char  *key, size_t key_len)
+{
+  if (hdr->key_len != key_len || hdr->hash != hash) {
+    return ARES_FALSE;
+  }
+  /* Keys are case insensitive like the per-channel cache, as DNS 0x20 may
+   * randomize the case of the name being cached */
+  return ares_strcaseeq_max((const char *)payload, key, key_len);
+}
+
+ares_status_t ares_qcache_shm_open(const char *path, size_t size,
+                                   ares_qcache_shm_t **shm_out)
+{
+  ares_qcache_shm_t     *shm    = NULL;
+  ares_qcache_shm_hdr_t *hdr    = NULL;
+  ares_bool_t            locked = ARES_FALSE;
+  ares_status_t          status = ARES_SUCCESS;
+  struct stat            st;
+
+  if (path == NULL || *path == 0 || shm_out == NULL) {
+    return ARES_EFORMERR;
+  }
+
+  *shm_out = NULL;
+
+  if (size == 0) {
+    size = DEFAULT_QCACHE_SHM_SIZE;
+  }
+
+  if (size < ARES_QCACHE_SHM_HDR_LEN + ARES_QCACHE_SHM_SLOT_LEN) {
+    return ARES_EFORMERR;
+  }
+
+  shm = ares_malloc_zero(sizeof(*shm));
+  if (shm == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+  shm->fd = -1;
+
+  shm->fd = open(path, O_RDWR | O_CREAT, 0600);
+  if (shm->fd < 0) {
+    status = ARES_EFILE;
+    goto done;
+  }
+
+#  ifdef FD_CLOEXEC
+  fcntl(shm->fd, F_SETFD, FD_CLOEXEC);
+#  endif
+
+  /* Hold an exclusive lock while sizing and initializing so two processes
+   * racing to create the file don't both initialize it */
+  if (!ares_qcache_shm_lock(shm)) {
+    status = ARES_EFILE; /* LCOV_EXCL_LINE: UntestablePath */
+    goto done;           /* LCOV_EXCL_LINE: UntestablePath */
+  }
+  locked = ARES_TRUE;
+
+  if (fstat(shm->fd, &st) != 0) {
+    status = ARES_EFILE; /* LCOV_EXCL_LINE: UntestablePath */
+    goto done;           /* LCOV_EXCL_LINE: UntestablePath */
+  }
+
+  if (st.st_size == 0) {
+    /* Newly created, size it ourselves.  The file is zero filled which means
+     * all slots start out unused */
+    shm->nslots  = (size - ARES_QCACHE_SHM_HDR_LEN) / ARES_QCACHE_SHM_SLOT_LEN;
+    shm->map_len = ARES_QCACHE_SHM_HDR_LEN +
+                   shm->nslots * ARES_QCACHE_SHM_SLOT_LEN;
+    if (ftruncate(shm->fd, (off_t)shm->map_len) != 0) {
+      status = ARES_EFILE; /* LCOV_EXCL_LINE: UntestablePath */
+      goto done;           /* LCOV_EXCL_LINE: UntestablePath */
+    }
+  } else {
+    /* Already exists, whoever created it decided the size.  It must at least
+     * hold the header, which is validated once mapped. */
+    if (!S_ISREG(st.st_mode) ||
+        (size_t)st.st_size <
+          ARES_QCACHE_SHM_HDR_LEN + ARES_QCACHE_SHM_SLOT_LEN) {
+      status = ARES_EFILE;
+      goto done;
+    }
+    shm->map_len = (size_t)st.st_size;
+  }
+
+  shm->map = mmap(NULL, shm->map_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+                  shm->fd, 0);
+  if (shm->map == MAP_FAILED) {
+    shm->map = NULL;
+    status   = ARES_EFILE;
+    goto done;
+  }
+
+  /* A peer not taking the lock may have shrunk the file since it was sized */
+  if (!ares_qcache_shm_usable(shm)) {
+    status = ARES_EFILE; /* LCOV_EXCL_LINE: UntestablePath */
+    goto done;           /* LCOV_EXCL_LINE: UntestablePath */
+  }
+
+  hdr = (ares_qcache_shm_hdr_t *)((void *)shm->map);
+  if (st.st_size == 0) {
+    hdr->version  = ARES_QCACHE_SHM_VERSION;
+    hdr->slot_len = ARES_QCACHE_SHM_SLOT_LEN;
+    hdr->nslots   = (unsigned int)shm->nslots;
+    hdr->magic    = ARES_QCACHE_SHM_MAGIC;
+  } else {
+    if (hdr->magic != ARES_QCACHE_SHM_MAGIC ||
+        hdr->version != ARES_QCACHE_SHM_VERSION ||
+        hdr->slot_len != ARES_QCACHE_SHM_SLOT_LEN || hdr->nslots == 0 ||
+        ARES_QCACHE_SHM_HDR_LEN + (size_t)hdr->nslots * hdr->slot_len >
+          shm->map_len) {
+      status = ARES_EFILE;
+      goto done;
+    }
+    shm->nslots = hdr->nslots;
+  }
+
+done:
+  if (locked) {
+    ares_qcache_shm_unlock(shm);
+  }
+
+  if (status != ARES_SUCCESS) {
+    ares_qcache_shm_close(shm);
+    return status;
+  }
+
+  *shm_out = shm;
+  return ARES_SUCCESS;
+}
+
+void ares_qcache_shm_close(ares_qcache_shm_t *shm)
+{
+  if (shm == NULL) {
+    return;
+  }
+
+  if (shm->map != NULL) {
+    munmap(shm->map, shm->map_len);
+  }
+
+  if (shm->fd >= 0) {
+    close(shm->fd);
+  }
+
+  ares_free(shm);
+}
+
+ares_status_t ares_qcache_shm_fetch(ares_qcache_shm_t  *shm,
+                                    const char         *key,
+                                    ares_dns_record_t **dnsrec_out)
+{
+  size_t                 key_len = ares_strlen(key);
+  unsigned int           hash;
+  ares_int64_t           now = (ares_int64_t)time(NULL);
+  unsigned char          payload[ARES_QCACHE_SHM_PAYLOAD_LEN];
+  ares_qcache_shm_slot_t hdr;
+  ares_status_t          status;
+  size_t                 i;
+
+  if (shm == NULL || key_len == 0 || dnsrec_out == NULL) {
+    return ARES_EFORMERR; /* LCOV_EXCL_LINE: DefensiveCoding */
+  }
+
+  if (!ares_qcache_shm_usable(shm)) {
+    return ARES_ENOTFOUND;
+  }
+
+  hash =
+    ares_htable_hash_FNV1a_casecmp((const unsigned char *)key, key_len, 0);
+
+  for (i = 0; i < ARES_QCACHE_SHM_PROBE_LEN; i++) {
+    ares_qcache_shm_slot_t *slot = ares_qcache_shm_slot(shm, hash + i);
+
+    if (ares_qcache_shm_slot_read(slot, &hdr, payload) &&
+        ares_qcache_shm_slot_match(&hdr, payload, hash, key, key_len) &&
+        !ares_qcache_shm_slot_expired(&hdr, now)) {
+      break;
+    }
+  }
+
+  if (i == ARES_QCACHE_SHM_PROBE_LEN) {
+    return ARES_ENOTFOUND;
+  }
+
+  status = ares_dns_parse(payload + hdr.key_len, hdr.data_len, 0, dnsrec_out);
+  if (status != ARES_SUCCESS) {
+    /* Corrupt entry, treat as a miss */
+    return ARES_ENOTFOUND;
+  }
+
+  ares_dns_record_ttl_decrement(*dnsrec_out,
+                                (unsigned int)(now - hdr.insert_ts));
+  return ARES_SUCCESS;
+}
+
+ares_status_t ares_qcache_shm_insert(ares_qcache_shm_t   *shm,
+                                     const char          *key,
+                                     const unsigned char *data,
+                                     size_t data_len, unsigned int ttl)
+{
+  size_t                  key_len = ares_strlen(key);
+  unsigned int            hash;
+  ares_int64_t            now    = (ares_int64_t)time(NULL);
+  ares_qcache_shm_slot_t *victim = NULL;
+  ares_qcache_shm_slot_t  victim_hdr;
+  unsigned char           payload[ARES_QCACHE_SHM_PAYLOAD_LEN];
+  size_t                  attempt;
+
+  if (shm == NULL || key_len == 0 || data == NULL || data_len == 0) {
+    return ARES_EFORMERR; /* LCOV_EXCL_LINE: DefensiveCoding */
+  }
+
+  /* Doesn't fit, let the caller decide what to do with it */
+  if (key_len + data_len > ARES_QCACHE_SHM_PAYLOAD_LEN) {
+    return ARES_ENOTIMP;
+  }
+
+  if (!ares_qcache_shm_usable(shm)) {
+    return ARES_ENOTIMP;
+  }
+
+  hash =
+    ares_htable_hash_FNV1a_casecmp((const unsigned char *)key, key_len, 0);
+
+  /* Another writer may claim the chosen slot first, then choose again */
+  for (attempt = 0; attempt < ARES_QCACHE_SHM_RETRIES; attempt++) {
+    size_t i;
+
+    /* Prefer replacing the same key, then an unused or expired slot, then the
+     * slot closest to expiring.  Slots being written are left alone. */
+    victim = NULL;
+    for (i = 0; i < ARES_QCACHE_SHM_PROBE_LEN; i++) {
+      ares_qcache_shm_slot_t *slot = ares_qcache_shm_slot(shm, hash + i);
+      ares_qcache_shm_slot_t  hdr;
+
+      if (!ares_qcache_shm_slot_read(slot, &hdr, payload)) {
+        continue;
+      }
+
+      if (ares_qcache_shm_slot_match(&hdr, payload, hash, key, key_len)) {
+        victim     = slot;
+        victim_hdr = hdr;
+        break;
+      }
+
+      if (victim != NULL && ares_qcache_shm_slot_expired(&victim_hdr, now)) {
+        continue;
+      }
+
+      if (victim == NULL || ares_qcache_shm_slot_expired(&hdr, now) ||
+          hdr.expire_ts < victim_hdr.expire_ts) {
+        victim     = slot;
+        victim_hdr = hdr;
+      }
+    }
+
+    if (victim == NULL) {
+      return ARES_ENOTIMP;
+    }
+
+    if (ares_qcache_shm_slot_claim(victim, victim_hdr.seq)) {
+      break;
+    }
+    victim = NULL;
+  }
+
+  if (victim == NULL) {
+    return ARES_ENOTIMP;
+  }
+
+  victim->expire_ts = now + (ares_int64_t)ttl;
+  victim->insert_ts = now;
+  victim->hash      = hash;
+  victim->key_len   = (unsigned short)key_len;
+  victim->data_len  = (unsigned short)data_len;
+  memcpy(ares_qcache_shm_slot_key(victim), key, key_len);
+  memcpy(ares_qcache_shm_slot_key(victim) + key_len, data, data_len);
+
+  ares_qcache_shm_slot_release(victim, victim_hdr.seq);
+
+  return ARES_SUCCESS;
+}
+
+ares_status_t ares_qcache_shm_foreach(ares_qcache_shm_t   *shm,
+                                      ares_qcache_shm_cb_t cb, void *arg)
+{
+  ares_int64_t  now    = (ares_int64_t)time(NULL);
+  ares_status_t status = ARES_SUCCESS;
+  unsigned char payload[ARES_QCACHE_SHM_PAYLOAD_LEN];
+  size_t        i;
+
+  if (shm == NULL || cb == NULL) {
+    return ARES_EFORMERR; /* LCOV_EXCL_LINE: DefensiveCoding */
+  }
+
+  /* Nothing can be read from a truncated file */
+  if (!ares_qcache_shm_usable(shm)) {
+    return ARES_SUCCESS;
+  }
+
+  for (i = 0; i < shm->nslots; i++) {
+    ares_qcache_shm_slot_t *slot = ares_qcache_shm_slot(shm, i);
+    ares_qcache_shm_slot_t  hdr;
+
+    if (!ares_qcache_shm_slot_read(slot, &hdr, payload) ||
+        ares_qcache_shm_slot_expired(&hdr, now)) {
+      continue;
+    }
+
+    status = cb(arg, (const char *)payload, hdr.key_len, payload + hdr.key_len,
+                hdr.data_len, hdr.insert_ts, hdr.expire_ts);
+    if (status != ARES_SUCCESS) {
+      break;
+    }
+  }
+
+  return status;
+}
+
+void ares_qcache_shm_flush(ares_qcache_shm_t *shm)
+{
+  size_t i;
+
+  if (shm == NULL || !ares_qcache_shm_usable(shm)) {
+    return;
+  }
+
+  for (i = 0; i < shm->nslots; i++) {
+    ares_qcache_shm_slot_t *slot = ares_qcache_shm_slot(shm, i);
+    unsigned int            seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+
+    /* Slots being written are left to their writer */
+    if ((seq & 1) || !ares_qcache_shm_slot_claim(slot, seq)) {
+      continue;
+    }
+    slot->key_len = 0;
+    ares_qcache_shm_slot_release(slot, seq);
+  }
+}
+
+#else
+
+ares_status_t ares_qcache_shm_open(const char *path, size_t size,
+                                   ares_qcache_shm_t **shm_out)
+{
+  (void)path;
+  (void)size;
+  if (shm_out != NULL) {
+    *shm_out = NULL;
+  }
+  return ARES_ENOTIMP;
+}
+
+void ares_qcache_shm_close(ares_qcache_shm_t *shm)
+{
+  (void)shm;
+}
+
+ares_status_t ares_qcache_shm_fetch(ares_qcache_shm_t  *shm,
+                                    const char         *key,
+                                    ares_dns_record_t **dnsrec_out)
+{
+  (void)shm;
+  (void)key;
+  (void)dnsrec_out;
+  return ARES_ENOTFOUND;
+}
+
+ares_status_t ares_qcache_shm_insert(ares_qcache_shm_t   *shm,
+                                     const char          *key,
+                                     const unsigned char *data,
+                                     size_t data_len, unsigned int ttl)
+{
+  (void)shm;
+  (void)key;
+  (void)data;
+  (void)data_len;
+  (void)ttl;
+  return ARES_ENOTIMP;
+}
+
+ares_status_t ares_qcache_shm_foreach(ares_qcache_shm_t   *shm,
+                                      ares_qcache_shm_cb_t cb, void *arg)
+{
+  (void)shm;
+  (void)cb;
+  (void)arg;
+  return ARES_SUCCESS;
+}
+
+void ares_qcache_shm_flush(ares_qcache_shm_t *shm)
+{
+  (void)shm;
+}
+
+#endif
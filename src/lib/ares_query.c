@@ -58,16 +58,19 @@ static void ares_query_dnsrec_cb(void *arg, ares_status_t status,
   ares_free(qquery);
 }
 
-ares_status_t ares_query_nolock(ares_channel_t *channel, const char *name,
-                                ares_dns_class_t     dnsclass,
-                                ares_dns_rec_type_t  type,
-                                ares_callback_dnsrec callback, void *arg,
-                                unsigned short *qid)
+/* Build the request for a query, along with the argument for
+ * ares_query_dnsrec_cb().  Only immutable channel configuration is used, so
+ * no channel lock is needed.  On failure the callback has been called. */
+static ares_status_t ares_query_prepare(const ares_channel_t *channel,
+                                        const char          *name,
+                                        ares_dns_class_t     dnsclass,
+                                        ares_dns_rec_type_t  type,
+                                        ares_callback_dnsrec callback,
+                                        void *arg, ares_dns_record_t **dnsrec,
+                                        ares_query_dnsrec_arg_t **qquery)
 {
-  ares_status_t            status;
-  ares_dns_record_t       *dnsrec = NULL;
-  ares_dns_flags_t         flags  = 0;
-  ares_query_dnsrec_arg_t *qquery = NULL;
+  ares_status_t    status;
+  ares_dns_flags_t flags = 0;
 
   if (channel == NULL || name == NULL || callback == NULL) {
     /* LCOV_EXCL_START: DefensiveCoding */
@@ -84,25 +87,44 @@ ares_status_t ares_query_nolock(ares_channel_t *channel, const char *name,
   }
 
   status = ares_dns_record_create_query(
-    &dnsrec, name, dnsclass, type, 0, flags,
+    dnsrec, name, dnsclass, type, 0, flags,
     (size_t)(channel->flags & ARES_FLAG_EDNS) ? channel->ednspsz : 0);
   if (status != ARES_SUCCESS) {
     callback(arg, status, 0, NULL); /* LCOV_EXCL_LINE: OutOfMemory */
     return status;                  /* LCOV_EXCL_LINE: OutOfMemory */
   }
 
-  qquery = ares_malloc(sizeof(*qquery));
-  if (qquery == NULL) {
+  *qquery = ares_malloc(sizeof(**qquery));
+  if (*qquery == NULL) {
     /* LCOV_EXCL_START: OutOfMemory */
     status = ARES_ENOMEM;
     callback(arg, status, 0, NULL);
-    ares_dns_record_destroy(dnsrec);
+    ares_dns_record_destroy(*dnsrec);
+    *dnsrec = NULL;
     return status;
     /* LCOV_EXCL_STOP */
   }
 
-  qquery->callback = callback;
-  qquery->arg      = arg;
+  (*qquery)->callback = callback;
+  (*qquery)->arg      = arg;
+  return ARES_SUCCESS;
+}
+
+ares_status_t ares_query_nolock(ares_channel_t *channel, const char *name,
+                                ares_dns_class_t     dnsclass,
+                                ares_dns_rec_type_t  type,
+                                ares_callback_dnsrec callback, void *arg,
+                                unsigned short *qid)
+{
+  ares_status_t            status;
+  ares_dns_record_t       *dnsrec = NULL;
+  ares_query_dnsrec_arg_t *qquery = NULL;
+
+  status = ares_query_prepare(channel, name, dnsclass, type, callback, arg,
+                              &dnsrec, &qquery);
+  if (status != ARES_SUCCESS) {
+    return status;
+  }
 
   /* Send it off.  qcallback will be called when we get an answer. */
   status = ares_send_nolock(channel, NULL, 0, dnsrec, ares_query_dnsrec_cb,
@@ -118,15 +140,36 @@ ares_status_t ares_query_dnsrec(ares_channel_t *channel, const char *name,
                                 ares_callback_dnsrec callback, void *arg,
                                 unsigned short *qid)
 {
-  ares_status_t status;
+  ares_status_t            status;
+  ares_dns_record_t       *dnsrec = NULL;
+  ares_query_dnsrec_arg_t *qquery = NULL;
 
   if (channel == NULL) {
     return ARES_EFORMERR;
   }
 
-  ares_channel_lock(channel);
-  status = ares_query_nolock(channel, name, dnsclass, type, callback, arg, qid);
-  ares_channel_unlock(channel);
+  status = ares_cbpool_wrap_dnsrec(channel, &callback, &arg);
+  if (status != ARES_SUCCESS) {
+    callback(arg, status, 0, NULL); /* LCOV_EXCL_LINE: OutOfMemory */
+    return status;                  /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  status = ares_query_prepare(channel, name, dnsclass, type, callback, arg,
+                              &dnsrec, &qquery);
+  if (status != ARES_SUCCESS) {
+    return status;
+  }
+
+  /* Cache hits are answered without the channel lock */
+  status = ares_send_cached(channel, dnsrec, ares_query_dnsrec_cb, qquery);
+  if (status == ARES_ENOTFOUND) {
+    ares_channel_lock(channel);
+    status = ares_send_nolock(channel, NULL, ARES_SEND_FLAG_NOCACHE, dnsrec,
+                              ares_query_dnsrec_cb, qquery, qid);
+    ares_channel_unlock(channel);
+  }
+
+  ares_dns_record_destroy(dnsrec);
   return status;
 }
 
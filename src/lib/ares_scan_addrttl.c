@@ -0,0 +1,213 @@
+/* MIT License
+ *
+ * Copyright (c) The c-ares project and its contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "ares_private.h"
+
+#ifdef HAVE_LIMITS_H
+#  include <limits.h>
+#endif
+
+/* Fixed part of an RR following the owner name: type, class, ttl, rdlength */
+#define ARES_SCAN_RR_FIXED_LEN 10
+
+static unsigned short ares_scan_be16(const unsigned char *ptr)
+{
+  return (unsigned short)((ptr[0] << 8) | ptr[1]);
+}
+
+static unsigned int ares_scan_be32(const unsigned char *ptr)
+{
+  return ((unsigned int)ptr[0] << 24) | ((unsigned int)ptr[1] << 16) |
+         ((unsigned int)ptr[2] << 8) | (unsigned int)ptr[3];
+}
+
+/* Options must exactly fill the OPT RR data, as ares_dns_parse() requires */
+static ares_bool_t ares_scan_opt_isvalid(const unsigned char *data,
+                                         size_t               len)
+{
+  size_t idx = 0;
+
+  while (idx < len) {
+    size_t optlen;
+
+    if (len - idx < 4) {
+      return ARES_FALSE;
+    }
+    optlen  = ares_scan_be16(data + idx + 2);
+    idx    += 4;
+    if (len - idx < optlen) {
+      return ARES_FALSE;
+    }
+    idx += optlen;
+  }
+  return ARES_TRUE;
+}
+
+ares_status_t ares_scan_addrttl(const unsigned char *abuf, size_t alen,
+                                int family, size_t req_naddrttls,
+                                struct ares_addrttl  *addrttls,
+                                struct ares_addr6ttl *addr6ttls,
+                                size_t               *naddrttls)
+{
+  size_t      pos       = 12;
+  size_t      rrcount;
+  size_t      i;
+  int         cname_ttl = INT_MAX;
+  ares_bool_t got_addr  = ARES_FALSE;
+  ares_bool_t got_cname = ARES_FALSE;
+  ares_bool_t got_opt   = ARES_FALSE;
+  size_t      ancount;
+
+  if (naddrttls == NULL) {
+    return ARES_EFORMERR; /* LCOV_EXCL_LINE: DefensiveCoding */
+  }
+  *naddrttls = 0;
+
+  if ((family == AF_INET && addrttls == NULL) ||
+      (family == AF_INET6 && addr6ttls == NULL)) {
+    req_naddrttls = 0;
+  }
+
+  /* Header, and the single question ares_dns_parse() accepts */
+  if (abuf == NULL || alen < 12 || alen > 0xFFFF ||
+      !ares_dns_opcode_isvalid((ares_dns_opcode_t)((abuf[2] >> 3) & 0xF)) ||
+      ares_scan_be16(abuf + 4) != 1) {
+    return ARES_ENOTIMP;
+  }
+  ancount = ares_scan_be16(abuf + 6);
+  rrcount = ancount + ares_scan_be16(abuf + 8) + ares_scan_be16(abuf + 10);
+
+  if (!ares_dns_name_isvalid_raw(abuf, alen, &pos) || alen - pos < 4) {
+    return ARES_ENOTIMP;
+  } else {
+    ares_dns_rec_type_t qtype  = ares_scan_be16(abuf + pos);
+    ares_dns_class_t    qclass = ares_scan_be16(abuf + pos + 2);
+
+    if (!ares_dns_rec_type_isvalid(qtype, ARES_TRUE) ||
+        !ares_dns_class_isvalid(qclass, qtype, ARES_TRUE)) {
+      return ARES_ENOTIMP;
+    }
+    pos += 4;
+  }
+
+  if (rrcount > (alen - pos) / 11) {
+    return ARES_ENOTIMP;
+  }
+
+  for (i = 0; i < rrcount; i++) {
+    ares_dns_rec_type_t  type;
+    ares_dns_class_t     rclass;
+    unsigned int         ttl;
+    size_t               rdlength;
+    const unsigned char *rdata;
+    ares_bool_t          is_answer_in;
+
+    if (!ares_dns_name_isvalid_raw(abuf, alen, &pos) ||
+        alen - pos < ARES_SCAN_RR_FIXED_LEN) {
+      return ARES_ENOTIMP;
+    }
+    type      = ares_scan_be16(abuf + pos);
+    rclass    = ares_scan_be16(abuf + pos + 2);
+    ttl       = ares_scan_be32(abuf + pos + 4);
+    rdlength  = ares_scan_be16(abuf + pos + 8);
+    pos      += ARES_SCAN_RR_FIXED_LEN;
+    if (alen - pos < rdlength) {
+      return ARES_ENOTIMP;
+    }
+    rdata        = abuf + pos;
+    is_answer_in = (i < ancount && rclass == ARES_CLASS_IN) ? ARES_TRUE
+                                                            : ARES_FALSE;
+
+    /* Anything other than what an address lookup normally returns is left
+     * to a full parse which also checks its contents */
+    if (type == ARES_REC_TYPE_OPT) {
+      if (i < ancount + ares_scan_be16(abuf + 8) || got_opt ||
+          !ares_scan_opt_isvalid(rdata, rdlength)) {
+        return ARES_ENOTIMP;
+      }
+      got_opt = ARES_TRUE;
+    } else if (type != ARES_REC_TYPE_A && type != ARES_REC_TYPE_AAAA &&
+               type != ARES_REC_TYPE_CNAME) {
+      return ARES_ENOTIMP;
+    } else if (!ares_dns_class_isvalid(rclass, type, ARES_FALSE)) {
+      return ARES_ENOTIMP;
+    } else if (type == ARES_REC_TYPE_CNAME) {
+      size_t target = pos;
+
+      if (!ares_dns_name_isvalid_raw(abuf, alen, &target) ||
+          target - pos > rdlength) {
+        return ARES_ENOTIMP;
+      }
+      if (is_answer_in) {
+        got_cname = ARES_TRUE;
+        if ((int)ttl < cname_ttl) {
+          cname_ttl = (int)ttl;
+        }
+      }
+    } else if (type == ARES_REC_TYPE_A) {
+      if (rdlength < sizeof(struct in_addr)) {
+        return ARES_ENOTIMP;
+      }
+      if (is_answer_in) {
+        got_addr = ARES_TRUE;
+        if (family == AF_INET && *naddrttls < req_naddrttls) {
+          memcpy(&addrttls[*naddrttls].ipaddr, rdata, sizeof(struct in_addr));
+          addrttls[*naddrttls].ttl = (int)ttl;
+          (*naddrttls)++;
+        }
+      }
+    } else {
+      if (rdlength < sizeof(struct ares_in6_addr)) {
+        return ARES_ENOTIMP;
+      }
+      if (is_answer_in) {
+        got_addr = ARES_TRUE;
+        if (family == AF_INET6 && *naddrttls < req_naddrttls) {
+          memcpy(&addr6ttls[*naddrttls].ip6addr, rdata,
+                 sizeof(struct ares_in6_addr));
+          addr6ttls[*naddrttls].ttl = (int)ttl;
+          (*naddrttls)++;
+        }
+      }
+    }
+
+    pos += rdlength;
+  }
+
+  if (!got_addr && !got_cname) {
+    *naddrttls = 0;
+    return ARES_ENODATA;
+  }
+
+  /* Addresses reached through a CNAME can't outlive it */
+  for (i = 0; i < *naddrttls; i++) {
+    int *ttlp = (family == AF_INET) ? &addrttls[i].ttl : &addr6ttls[i].ttl;
+    if (*ttlp > cname_ttl) {
+      *ttlp = cname_ttl;
+    }
+  }
+
+  return ARES_SUCCESS;
+}
@@ -31,6 +31,18 @@
 #  include <strings.h>
 #endif
 
+struct search_query;
+
+/* State of a single candidate name when searching in parallel */
+typedef struct {
+  struct search_query *squery;
+  unsigned short       qid;
+  ares_bool_t          done;
+  ares_status_t        status;
+  /* Response, only retained if it may end the search */
+  ares_dns_record_t   *dnsrec;
+} search_candidate_t;
+
 struct search_query {
   /* Arguments passed to ares_search_dnsrec() */
   ares_channel_t      *channel;
@@ -40,6 +52,9 @@ struct search_query {
   /* Duplicate of DNS record passed to ares_search_dnsrec() */
   ares_dns_record_t   *dnsrec;
 
+  /* Name being searched, as passed in */
+  char                *name;
+
   /* Search order for names */
   char               **names;
   size_t               names_cnt;
@@ -48,14 +63,28 @@ struct search_query {
   size_t               next_name_idx; /* next name index being attempted */
   size_t      timeouts;        /* number of timeouts we saw for this request */
   ares_bool_t ever_got_nodata; /* did we ever get ARES_ENODATA along the way? */
+
+  /* ARES_FLAG_PARALLEL_SEARCH state, one candidate per name */
+  search_candidate_t *candidates;
+  size_t      refcnt; /* outstanding candidates, plus any caller in progress */
+  ares_bool_t ended;  /* user callback has been invoked */
 };
 
 static void squery_free(struct search_query *squery)
 {
+  size_t i;
+
   if (squery == NULL) {
     return; /* LCOV_EXCL_LINE: DefensiveCoding */
   }
+  if (squery->candidates != NULL) {
+    for (i = 0; i < squery->names_cnt; i++) {
+      ares_dns_record_destroy(squery->candidates[i].dnsrec);
+    }
+    ares_free(squery->candidates);
+  }
   ares_strsplit_free(squery->names, squery->names_cnt);
+  ares_free(squery->name);
   ares_dns_record_destroy(squery->dnsrec);
   ares_free(squery);
 }
@@ -102,6 +131,41 @@ static ares_status_t ares_search_next(ares_channel_t      *channel,
   return status;
 }
 
+static ares_status_t search_reply_status(ares_status_t            status,
+                                         const ares_dns_record_t *dnsrec)
+{
+  ares_dns_rcode_t rcode;
+  size_t           ancount;
+
+  if (dnsrec == NULL) {
+    return status;
+  }
+
+  rcode   = ares_dns_record_get_rcode(dnsrec);
+  ancount = ares_dns_record_rr_cnt(dnsrec, ARES_SECTION_ANSWER);
+  return ares_dns_query_reply_tostatus(rcode, ancount);
+}
+
+/* Whether a result for the given candidate name means the search should move
+ * on to the next name rather than returning this result */
+static ares_bool_t search_should_continue(ares_status_t status,
+                                          const char   *name)
+{
+  switch (status) {
+    case ARES_ENODATA:
+    case ARES_ENOTFOUND:
+      return ARES_TRUE;
+    case ARES_ESERVFAIL:
+    case ARES_EREFUSED:
+      /* Issue #852, systemd-resolved may return SERVFAIL or REFUSED on a
+       * single label domain name. */
+      return ares_name_label_cnt(name) == 1 ? ARES_TRUE : ARES_FALSE;
+    default:
+      break;
+  }
+  return ARES_FALSE;
+}
+
 static void search_callback(void *arg, ares_status_t status, size_t timeouts,
                             const ares_dns_record_t *dnsrec)
 {
@@ -113,30 +177,13 @@ static void search_callback(void *arg, ares_status_t status, size_t timeouts,
 
   squery->timeouts += timeouts;
 
-  if (dnsrec) {
-    ares_dns_rcode_t rcode = ares_dns_record_get_rcode(dnsrec);
-    size_t ancount = ares_dns_record_rr_cnt(dnsrec, ARES_SECTION_ANSWER);
-    mystatus       = ares_dns_query_reply_tostatus(rcode, ancount);
-  } else {
-    mystatus = status;
-  }
+  ares_search_negcache_update(channel, squery->name, dnsrec);
+  mystatus = search_reply_status(status, dnsrec);
 
-  switch (mystatus) {
-    case ARES_ENODATA:
-    case ARES_ENOTFOUND:
-      break;
-    case ARES_ESERVFAIL:
-    case ARES_EREFUSED:
-      /* Issue #852, systemd-resolved may return SERVFAIL or REFUSED on a
-       * single label domain name. */
-      if (ares_name_label_cnt(squery->names[squery->next_name_idx - 1]) != 1) {
-        end_squery(squery, mystatus, dnsrec);
-        return;
-      }
-      break;
-    default:
-      end_squery(squery, mystatus, dnsrec);
-      return;
+  if (!search_should_continue(mystatus,
+                              squery->names[squery->next_name_idx - 1])) {
+    end_squery(squery, mystatus, dnsrec);
+    return;
   }
 
   /* If we ever get ARES_ENODATA along the way, record that; if the search
@@ -166,6 +213,137 @@ static void search_callback(void *arg, ares_status_t status, size_t timeouts,
   end_squery(squery, mystatus, NULL);
 }
 
+static void search_parallel_release(struct search_query *squery)
+{
+  squery->refcnt--;
+  if (squery->refcnt == 0) {
+    squery_free(squery);
+  }
+}
+
+/* Walk the candidates in priority order and, once every candidate ahead of
+ * one with a usable result has failed, return that result.  The answer is
+ * therefore identical to that of a sequential search. */
+static void search_parallel_check(struct search_query *squery)
+{
+  ares_status_t status = ARES_ENOTFOUND;
+  size_t        idx;
+  size_t        i;
+
+  if (squery->ended) {
+    return;
+  }
+
+  for (idx = 0; idx < squery->names_cnt; idx++) {
+    const search_candidate_t *cand = &squery->candidates[idx];
+
+    if (!cand->done) {
+      return;
+    }
+
+    status = cand->status;
+    if (!search_should_continue(status, squery->names[idx])) {
+      break;
+    }
+
+    if (status == ARES_ENODATA) {
+      squery->ever_got_nodata = ARES_TRUE;
+    }
+  }
+
+  squery->ended = ARES_TRUE;
+
+  /* The remaining queries can no longer change the result, don't let them
+   * spend any more time retrying */
+  for (i = 0; i < squery->names_cnt; i++) {
+    const search_candidate_t *cand = &squery->candidates[i];
+    ares_query_t             *query;
+
+    if (cand->done || cand->squery == NULL) {
+      continue;
+    }
+    query =
+      ares_htable_szvp_get_direct(squery->channel->queries_by_qid, cand->qid);
+    if (query != NULL && query->arg == cand) {
+      query->no_retries = ARES_TRUE;
+    }
+  }
+
+  if (idx < squery->names_cnt) {
+    squery->callback(squery->arg, status, squery->timeouts,
+                     squery->candidates[idx].dnsrec);
+    return;
+  }
+
+  if (status == ARES_ENOTFOUND && squery->ever_got_nodata) {
+    status = ARES_ENODATA;
+  }
+  squery->callback(squery->arg, status, squery->timeouts, NULL);
+}
+
+static void search_parallel_callback(void *arg, ares_status_t status,
+                                     size_t                   timeouts,
+                                     const ares_dns_record_t *dnsrec)
+{
+  search_candidate_t  *cand   = arg;
+  struct search_query *squery = cand->squery;
+  size_t               idx    = (size_t)(cand - squery->candidates);
+
+  ares_search_negcache_update(squery->channel, squery->name, dnsrec);
+
+  squery->timeouts += timeouts;
+  cand->done        = ARES_TRUE;
+  cand->status      = search_reply_status(status, dnsrec);
+
+  if (!squery->ended && dnsrec != NULL &&
+      !search_should_continue(cand->status, squery->names[idx])) {
+    cand->dnsrec = ares_dns_record_duplicate(dnsrec);
+    if (cand->dnsrec == NULL) {
+      cand->status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  /* Our reference is held until after the check, as the user callback may
+   * cause the remaining candidates to complete */
+  search_parallel_check(squery);
+  search_parallel_release(squery);
+}
+
+/* Issue a query for every candidate name at once, as used when
+ * ARES_FLAG_PARALLEL_SEARCH is set */
+static void ares_search_parallel(ares_channel_t      *channel,
+                                 struct search_query *squery)
+{
+  size_t i;
+
+  /* Reference held by ourselves while queries are being enqueued, as some
+   * may complete immediately (e.g. from the query cache) */
+  squery->refcnt = 1;
+
+  for (i = 0; i < squery->names_cnt && !squery->ended; i++) {
+    search_candidate_t *cand = &squery->candidates[i];
+    ares_status_t       status;
+
+    cand->squery = squery;
+
+    status = ares_dns_record_query_set_name(squery->dnsrec, 0,
+                                            squery->names[i]);
+    if (status != ARES_SUCCESS) {
+      cand->done   = ARES_TRUE;
+      cand->status = status;
+      continue;
+    }
+
+    /* The callback is always invoked on failure */
+    squery->refcnt++;
+    ares_send_nolock(channel, NULL, 0, squery->dnsrec, search_parallel_callback,
+                     cand, &cand->qid);
+  }
+
+  search_parallel_check(squery);
+  search_parallel_release(squery);
+}
+
 /* Determine if the domain should be looked up as-is, or if it is eligible
  * for search by appending domains */
 static ares_bool_t ares_search_eligible(const ares_channel_t *channel,
@@ -204,17 +382,17 @@ size_t ares_name_label_cnt(const char *name)
   return ndots + 1;
 }
 
-ares_status_t ares_search_name_list(const ares_channel_t *channel,
-                                    const char *name, char ***names,
-                                    size_t *names_len)
+ares_status_t ares_search_name_list(ares_channel_t *channel, const char *name,
+                                    char ***names, size_t *names_len)
 {
-  ares_status_t status;
-  char        **list     = NULL;
-  size_t        list_len = 0;
-  char         *alias    = NULL;
-  size_t        ndots    = 0;
-  size_t        idx      = 0;
-  size_t        i;
+  ares_status_t  status;
+  char         **list     = NULL;
+  size_t         list_len = 0;
+  char          *alias    = NULL;
+  size_t         ndots    = 0;
+  size_t         idx      = 0;
+  size_t         i;
+  ares_timeval_t now;
 
   /* Perform HOSTALIASES resolution */
   status = ares_lookup_hostaliases(channel, name, &alias);
@@ -279,11 +457,18 @@ ares_status_t ares_search_name_list(const ares_channel_t *channel,
   }
 
   /* Append each search suffix to the name */
+  ares_tvnow(&now);
   for (i = 0; i < channel->ndomains; i++) {
     status = ares_cat_domain(name, channel->domains[i], &list[idx]);
     if (status != ARES_SUCCESS) {
       goto done;
     }
+    if (ares_search_negcache_skip(channel, name, channel->domains[i],
+                                  list[idx], &now)) {
+      ares_free(list[idx]);
+      list[idx] = NULL;
+      continue;
+    }
     idx++;
   }
 
@@ -297,6 +482,8 @@ ares_status_t ares_search_name_list(const ares_channel_t *channel,
     idx++;
   }
 
+  /* Some search candidates may have been skipped */
+  list_len = idx;
 
 done:
   if (status == ARES_SUCCESS) {
@@ -361,12 +548,29 @@ static ares_status_t ares_search_int(ares_channel_t          *channel,
   squery->timeouts        = 0;
   squery->ever_got_nodata = ARES_FALSE;
 
+  squery->name = ares_strdup(name);
+  if (squery->name == NULL) {
+    status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    goto fail;            /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
   status =
     ares_search_name_list(channel, name, &squery->names, &squery->names_cnt);
   if (status != ARES_SUCCESS) {
     goto fail;
   }
 
+  if (channel->flags & ARES_FLAG_PARALLEL_SEARCH && squery->names_cnt > 1) {
+    squery->candidates =
+      ares_malloc_zero(sizeof(*squery->candidates) * squery->names_cnt);
+    if (squery->candidates == NULL) {
+      status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+      goto fail;            /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+    ares_search_parallel(channel, squery);
+    return ARES_SUCCESS;
+  }
+
   status = ares_search_next(channel, squery, &skip_cleanup);
   if (status != ARES_SUCCESS) {
     goto fail;
@@ -431,11 +635,12 @@ void ares_dnsrec_convert_cb(void *arg, ares_status_t status, size_t timeouts,
 void ares_search(ares_channel_t *channel, const char *name, int dnsclass,
                  int type, ares_callback callback, void *arg)
 {
-  ares_status_t      status;
-  ares_dns_record_t *dnsrec = NULL;
-  size_t             max_udp_size;
-  ares_dns_flags_t   rd_flag;
-  void              *carg = NULL;
+  ares_status_t        status;
+  ares_dns_record_t   *dnsrec = NULL;
+  size_t               max_udp_size;
+  ares_dns_flags_t     rd_flag;
+  void                *carg = NULL;
+  ares_callback_dnsrec ccb  = ares_dnsrec_convert_cb;
   if (channel == NULL || name == NULL) {
     return;
   }
@@ -451,19 +656,29 @@ void ares_search(ares_channel_t *channel, const char *name, int dnsclass,
     return;
   }
 
+  /* ares_search_int() is called directly rather than through
+   * ares_search_dnsrec(), so apply any callback offloading here */
+  status = ares_cbpool_wrap_dnsrec(channel, &ccb, &carg);
+  if (status != ARES_SUCCESS) {
+    /* LCOV_EXCL_START: OutOfMemory */
+    callback(arg, (int)status, 0, NULL, 0);
+    ares_free(carg);
+    return;
+    /* LCOV_EXCL_STOP */
+  }
+
   rd_flag      = !(channel->flags & ARES_FLAG_NORECURSE) ? ARES_FLAG_RD : 0;
   max_udp_size = (channel->flags & ARES_FLAG_EDNS) ? channel->ednspsz : 0;
   status       = ares_dns_record_create_query(
     &dnsrec, name, (ares_dns_class_t)dnsclass, (ares_dns_rec_type_t)type, 0,
     rd_flag, max_udp_size);
   if (status != ARES_SUCCESS) {
-    callback(arg, (int)status, 0, NULL, 0);
-    ares_free(carg);
+    ccb(carg, status, 0, NULL);
     return;
   }
 
   ares_channel_lock(channel);
-  ares_search_int(channel, dnsrec, ares_dnsrec_convert_cb, carg);
+  ares_search_int(channel, dnsrec, ccb, carg);
   ares_channel_unlock(channel);
 
   ares_dns_record_destroy(dnsrec);
@@ -480,6 +695,12 @@ ares_status_t ares_search_dnsrec(ares_channel_t          *channel,
     return ARES_EFORMERR; /* LCOV_EXCL_LINE: DefensiveCoding */
   }
 
+  status = ares_cbpool_wrap_dnsrec(channel, &callback, &arg);
+  if (status != ARES_SUCCESS) {
+    callback(arg, status, 0, NULL); /* LCOV_EXCL_LINE: OutOfMemory */
+    return status;                  /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
   ares_channel_lock(channel);
   status = ares_search_int(channel, dnsrec, callback, arg);
   ares_channel_unlock(channel);
@@ -0,0 +1,302 @@
+/* MIT License
+ *
+ * Copyright (c) The c-ares project and its contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ares_private.h"
+
+/* IMPLEMENTATION NOTES
+ * ====================
+ *
+ * With a high ndots and several search domains, most names looked up are not
+ * found under any search domain, yet each search domain is tried for every new
+ * name.  When ARES_FLAG_SEARCH_NEGCACHE is set, responses to search list
+ * candidates are used to skip candidates which can't exist:
+ *
+ *  - RFC 8020 says an NXDOMAIN means there is nothing at or below the name,
+ *    so NXDOMAIN responses which carry an SOA are remembered for the negative
+ *    TTL and any candidate at or below such a name is skipped.
+ *
+ *  - Misses are counted per search domain and label count of the name being
+ *    searched.  Once a search domain has returned only NXDOMAIN for
+ *    ARES_SEARCH_NEGCACHE_MISSES names with the same label count, it is
+ *    skipped for names of that label count for ARES_SEARCH_NEGCACHE_LEARN
+ *    seconds.  Any name found under the domain resets the count.  After the
+ *    learning period a single further miss suffices to skip it again.
+ *    Single-label names are not counted: they are typically short service
+ *    names (e.g. Kubernetes services) which only exist under one particular
+ *    search domain, and any one of them may be the first to exist there.
+ *
+ * The latter is a heuristic: a name that starts to exist under a search domain
+ * may not be found for up to ARES_SEARCH_NEGCACHE_LEARN seconds.  The as-is
+ * name is never skipped.  All state is dropped on ares_reinit().
+ */
+
+#define ARES_SEARCH_NEGCACHE_MISSES  3
+#define ARES_SEARCH_NEGCACHE_LEARN   300  /* seconds */
+#define ARES_SEARCH_NEGCACHE_MAX_TTL 3600 /* seconds */
+#define ARES_SEARCH_NEGCACHE_MAX     4096
+
+typedef struct {
+  size_t         misses;
+  ares_timeval_t skip_until;
+} ares_search_suffix_t;
+
+struct ares_search_negcache {
+  /*! NXDOMAIN name to ares_timeval_t expiration */
+  ares_htable_strvp_t *nxdomains;
+  /*! "<labels>:<domain>" to ares_search_suffix_t */
+  ares_htable_strvp_t *suffixes;
+};
+
+static void ares_search_negcache_destroy(ares_search_negcache_t *negcache)
+{
+  if (negcache == NULL) {
+    return;
+  }
+  ares_htable_strvp_destroy(negcache->nxdomains);
+  ares_htable_strvp_destroy(negcache->suffixes);
+  ares_free(negcache);
+}
+
+static ares_search_negcache_t *ares_search_negcache_create(void)
+{
+  ares_search_negcache_t *negcache = ares_malloc_zero(sizeof(*negcache));
+
+  if (negcache == NULL) {
+    return NULL; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  negcache->nxdomains = ares_htable_strvp_create(ares_free);
+  negcache->suffixes  = ares_htable_strvp_create(ares_free);
+  if (negcache->nxdomains == NULL || negcache->suffixes == NULL) {
+    ares_search_negcache_destroy(negcache); /* LCOV_EXCL_LINE: OutOfMemory */
+    return NULL;                            /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  return negcache;
+}
+
+/* Only misses for multi-label names are used to learn about search domains */
+static ares_bool_t ares_search_suffix_learned(const char *name)
+{
+  return ares_name_label_cnt(name) > 1 ? ARES_TRUE : ARES_FALSE;
+}
+
+static void ares_search_suffix_key(char *key, size_t key_len,
+                                   const char *name, const char *domain)
+{
+  snprintf(key, key_len, "%u:%s", (unsigned int)ares_name_label_cnt(name),
+           domain);
+}
+
+/* Determine the search domain used to form candidate from name */
+static const char *ares_search_domain(const ares_channel_t *channel,
+                                      const char *name, const char *candidate)
+{
+  size_t name_len = ares_strlen(name);
+  size_t i;
+
+  if (ares_strlen(candidate) <= name_len + 1 ||
+      candidate[name_len] != '.' ||
+      !ares_strcaseeq_max(candidate, name, name_len)) {
+    return NULL;
+  }
+
+  for (i = 0; i < channel->ndomains; i++) {
+    if (ares_strcaseeq(candidate + name_len + 1, channel->domains[i])) {
+      return channel->domains[i];
+    }
+  }
+
+  return NULL;
+}
+
+ares_bool_t ares_search_negcache_skip(ares_channel_t *channel,
+                                      const char *name, const char *domain,
+                                      const char           *candidate,
+                                      const ares_timeval_t *now)
+{
+  ares_search_negcache_t *negcache = channel->search_negcache;
+  ares_search_suffix_t   *suffix;
+  char                    key[300];
+  const char             *p;
+
+  if (negcache == NULL || !(channel->flags & ARES_FLAG_SEARCH_NEGCACHE)) {
+    return ARES_FALSE;
+  }
+
+  if (ares_search_suffix_learned(name)) {
+    ares_search_suffix_key(key, sizeof(key), name, domain);
+    suffix = ares_htable_strvp_get_direct(negcache->suffixes, key);
+  } else {
+    suffix = NULL;
+  }
+  if (suffix != NULL && suffix->misses >= ARES_SEARCH_NEGCACHE_MISSES) {
+    if (!ares_timedout(now, &suffix->skip_until)) {
+      return ARES_TRUE;
+    }
+    /* The learning period is over, so let this candidate be probed again.
+     * One miss below the threshold means a single further NXDOMAIN goes
+     * straight back to skipping, while a name found under the domain
+     * forgets the suffix entirely. */
+    suffix->misses = ARES_SEARCH_NEGCACHE_MISSES - 1;
+  }
+
+  /* Nothing exists at or below a name that returned NXDOMAIN */
+  for (p = candidate; p != NULL && *p != 0; p = strchr(p, '.')) {
+    const ares_timeval_t *expire;
+
+    if (*p == '.') {
+      p++;
+    }
+
+    expire = ares_htable_strvp_get_direct(negcache->nxdomains, p);
+    if (expire == NULL) {
+      continue;
+    }
+    if (!ares_timedout(now, expire)) {
+      return ARES_TRUE;
+    }
+    ares_htable_strvp_remove(negcache->nxdomains, p);
+  }
+
+  return ARES_FALSE;
+}
+
+static void ares_search_negcache_nxdomain(ares_search_negcache_t  *negcache,
+                                          const char              *candidate,
+                                          const ares_dns_record_t *dnsrec,
+                                          const ares_timeval_t    *now)
+{
+  unsigned int    ttl = ares_qcache_soa_minimum(dnsrec);
+  ares_timeval_t *expire;
+
+  /* RFC 2308 Section 5, without an SOA the NXDOMAIN must not be cached */
+  if (ttl == 0) {
+    return;
+  }
+  if (ttl > ARES_SEARCH_NEGCACHE_MAX_TTL) {
+    ttl = ARES_SEARCH_NEGCACHE_MAX_TTL;
+  }
+
+  expire = ares_malloc(sizeof(*expire));
+  if (expire == NULL) {
+    return; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+  *expire = *now;
+  ares_timeval_add(expire, (size_t)ttl * 1000);
+
+  /* Bounded, simply start over when full */
+  if (ares_htable_strvp_num_keys(negcache->nxdomains) >=
+      ARES_SEARCH_NEGCACHE_MAX) {
+    ares_htable_strvp_destroy(negcache->nxdomains);
+    negcache->nxdomains = ares_htable_strvp_create(ares_free);
+    if (negcache->nxdomains == NULL) {
+      ares_free(expire); /* LCOV_EXCL_LINE: OutOfMemory */
+      return;            /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  if (!ares_htable_strvp_insert(negcache->nxdomains, candidate, expire)) {
+    ares_free(expire); /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+}
+
+void ares_search_negcache_update(ares_channel_t          *channel,
+                                 const char              *name,
+                                 const ares_dns_record_t *dnsrec)
+{
+  ares_search_negcache_t *negcache;
+  ares_search_suffix_t   *suffix;
+  const char             *candidate = NULL;
+  const char             *domain;
+  ares_dns_rcode_t        rcode;
+  char                    key[300];
+  ares_timeval_t          now;
+
+  if (!(channel->flags & ARES_FLAG_SEARCH_NEGCACHE) || dnsrec == NULL ||
+      ares_dns_record_query_get(dnsrec, 0, &candidate, NULL, NULL) !=
+        ARES_SUCCESS) {
+    return;
+  }
+
+  domain = ares_search_domain(channel, name, candidate);
+  if (domain == NULL) {
+    return;
+  }
+
+  rcode = ares_dns_record_get_rcode(dnsrec);
+  if (rcode != ARES_RCODE_NXDOMAIN && rcode != ARES_RCODE_NOERROR) {
+    return;
+  }
+
+  if (channel->search_negcache == NULL) {
+    channel->search_negcache = ares_search_negcache_create();
+    if (channel->search_negcache == NULL) {
+      return; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+  negcache = channel->search_negcache;
+
+  ares_search_suffix_key(key, sizeof(key), name, domain);
+
+  /* The name exists (even if without the requested record type), so names of
+   * this shape do exist under the domain */
+  if (rcode == ARES_RCODE_NOERROR) {
+    ares_htable_strvp_remove(negcache->suffixes, key);
+    return;
+  }
+
+  ares_tvnow(&now);
+  ares_search_negcache_nxdomain(negcache, candidate, dnsrec, &now);
+
+  if (!ares_search_suffix_learned(name)) {
+    return;
+  }
+
+  suffix = ares_htable_strvp_get_direct(negcache->suffixes, key);
+  if (suffix == NULL) {
+    suffix = ares_malloc_zero(sizeof(*suffix));
+    if (suffix == NULL) {
+      return; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+    if (!ares_htable_strvp_insert(negcache->suffixes, key, suffix)) {
+      ares_free(suffix); /* LCOV_EXCL_LINE: OutOfMemory */
+      return;            /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  suffix->misses++;
+  if (suffix->misses >= ARES_SEARCH_NEGCACHE_MISSES) {
+    suffix->skip_until = now;
+    ares_timeval_add(&suffix->skip_until, ARES_SEARCH_NEGCACHE_LEARN * 1000);
+  }
+}
+
+void ares_search_negcache_flush(ares_channel_t *channel)
+{
+  ares_search_negcache_destroy(channel->search_negcache);
+  channel->search_negcache = NULL;
+}
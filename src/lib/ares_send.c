@@ -111,26 +111,26 @@ ares_status_t ares_send_nolock(ares_channel_t *channel, ares_server_t *server,
                                ares_callback_dnsrec callback, void *arg,
                                unsigned short *qid)
 {
-  ares_query_t            *query;
-  ares_timeval_t           now;
-  ares_status_t            status;
-  unsigned short           id          = generate_unique_qid(channel);
-  const ares_dns_record_t *dnsrec_resp = NULL;
+  ares_query_t  *query;
+  ares_timeval_t now;
+  ares_status_t  status;
+  unsigned short id = generate_unique_qid(channel);
 
   ares_tvnow(&now);
 
+  if (channel->destroying) {
+    callback(arg, ARES_EDESTRUCTION, 0, NULL);
+    return ARES_EDESTRUCTION;
+  }
+
   if (ares_slist_len(channel->servers) == 0) {
     callback(arg, ARES_ENOSERVER, 0, NULL);
     return ARES_ENOSERVER;
   }
 
   if (!(flags & ARES_SEND_FLAG_NOCACHE)) {
-    /* Check query cache */
-    status = ares_qcache_fetch(channel, &now, dnsrec, &dnsrec_resp);
+    status = ares_send_cached(channel, dnsrec, callback, arg);
     if (status != ARES_ENOTFOUND) {
-      /* ARES_SUCCESS means we retrieved the cache, anything else is a critical
-       * failure, all result in termination */
-      callback(arg, status, 0, dnsrec_resp);
       return status;
     }
   }
@@ -224,6 +224,33 @@ ares_status_t ares_send_nolock(ares_channel_t *channel, ares_server_t *server,
   return status;
 }
 
+ares_status_t ares_send_cached(ares_channel_t          *channel,
+                               const ares_dns_record_t *dnsrec,
+                               ares_callback_dnsrec callback, void *arg)
+{
+  ares_timeval_t     now;
+  ares_status_t      status;
+  ares_dns_record_t *dnsrec_resp = NULL;
+
+  /* The cache itself is created with the channel and only destroyed with it.
+   * A channel being destroyed fails new queries when they are sent. */
+  if (channel->qcache == NULL || channel->destroying) {
+    return ARES_ENOTFOUND;
+  }
+
+  ares_tvnow(&now);
+  status = ares_qcache_fetch(channel, &now, dnsrec, &dnsrec_resp);
+  if (status == ARES_ENOTFOUND) {
+    return status;
+  }
+
+  /* ARES_SUCCESS means we retrieved the cache, anything else is a critical
+   * failure, all result in termination */
+  callback(arg, status, 0, dnsrec_resp);
+  ares_dns_record_destroy(dnsrec_resp);
+  return status;
+}
+
 ares_status_t ares_send_dnsrec(ares_channel_t          *channel,
                                const ares_dns_record_t *dnsrec,
                                ares_callback_dnsrec callback, void *arg,
@@ -235,9 +262,21 @@ ares_status_t ares_send_dnsrec(ares_channel_t          *channel,
     return ARES_EFORMERR; /* LCOV_EXCL_LINE: DefensiveCoding */
   }
 
+  status = ares_cbpool_wrap_dnsrec(channel, &callback, &arg);
+  if (status != ARES_SUCCESS) {
+    callback(arg, status, 0, NULL); /* LCOV_EXCL_LINE: OutOfMemory */
+    return status;                  /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  status = ares_send_cached(channel, dnsrec, callback, arg);
+  if (status != ARES_ENOTFOUND) {
+    return status;
+  }
+
   ares_channel_lock(channel);
 
-  status = ares_send_nolock(channel, NULL, 0, dnsrec, callback, arg, qid);
+  status = ares_send_nolock(channel, NULL, ARES_SEND_FLAG_NOCACHE, dnsrec,
+                            callback, arg, qid);
 
   ares_channel_unlock(channel);
 
@@ -292,7 +331,9 @@ size_t ares_queue_active_queries(const ares_channel_t *channel)
 
   ares_channel_lock(channel);
 
-  len = ares_llist_len(channel->all_queries);
+  /* Completions still waiting on a callback worker are considered active */
+  len = ares_llist_len(channel->all_queries) +
+        ares_cbpool_pending(channel->cbpool);
 
   ares_channel_unlock(channel);
 
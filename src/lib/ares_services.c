@@ -0,0 +1,423 @@
+/* MIT License
+ *
+ * Copyright (c) The c-ares project and its contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ares_private.h"
+
+/* IMPLEMENTATION NOTES
+ * ====================
+ *
+ * getservbyname_r() and getservbyport_r() re-open and linearly scan the
+ * services file on every call, which stalls whatever thread is processing
+ * events.  When ARES_FLAG_SERVICES_CACHE is set, the services file is parsed
+ * once per process into hash tables keyed by "name/proto" and "port/proto".
+ * Keys are compared case-sensitively, as getservbyname() does.
+ *
+ * Like the hosts file, the file is checked for modification at most once every
+ * ARES_SERVICES_CHECK_INTERVAL_MS and reloaded if its size or modification time
+ * changed.  The database is protected by the global lock and results are
+ * copied out before it is released, so a reload never invalidates a result.
+ *
+ * Where no services file path is known (e.g. Windows) or it can't be read,
+ * ARES_ENOTIMP is returned so the caller can fall back to the system
+ * functions.
+ */
+
+#define ARES_SERVICES_CHECK_INTERVAL_MS 1000
+
+typedef struct {
+  char               *filename;
+  /*! when the file was loaded */
+  time_t              ts;
+  /*! modification time and size at load time, if have_stat */
+  time_t              mtime;
+  size_t              size;
+  ares_bool_t         have_stat;
+  /*! when the file was last checked for modification */
+  ares_timeval_t      checked;
+  /*! "name/proto" to decimal port, for service names and aliases */
+  ares_htable_dict_t *byname;
+  /*! "port/proto" to service name */
+  ares_htable_dict_t *byport;
+} ares_services_db_t;
+
+static ares_services_db_t *ares_services_db = NULL;
+/*! Services file used instead of the system one, for testing */
+static char               *ares_services_path_override = NULL;
+
+static void ares_services_db_destroy(ares_services_db_t *db)
+{
+  if (db == NULL) {
+    return;
+  }
+  ares_free(db->filename);
+  ares_htable_dict_destroy(db->byname);
+  ares_htable_dict_destroy(db->byport);
+  ares_free(db);
+}
+
+/* Must hold the global lock */
+static const char *ares_services_path(void)
+{
+  if (ares_services_path_override != NULL) {
+    return ares_services_path_override;
+  }
+
+#ifdef PATH_SERVICES
+  return PATH_SERVICES;
+#else
+  return NULL;
+#endif
+}
+
+/* Add to a table only if not already present, the first entry in the file
+ * wins as with the system functions */
+static ares_status_t ares_services_add(ares_htable_dict_t *table,
+                                       const char *key, const char *proto,
+                                       const char *val)
+{
+  char tkey[256];
+
+  snprintf(tkey, sizeof(tkey), "%s/%s", key, proto);
+
+  if (ares_htable_dict_get(table, tkey, NULL)) {
+    return ARES_SUCCESS;
+  }
+
+  if (!ares_htable_dict_insert(table, tkey, val)) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  return ARES_SUCCESS;
+}
+
+static ares_status_t ares_services_fetch_word(ares_buf_t *buf, char *out,
+                                              size_t out_len)
+{
+  unsigned char comment = '#';
+
+  ares_buf_consume_whitespace(buf, ARES_FALSE);
+
+  if (ares_buf_len(buf) == 0 || ares_buf_begins_with(buf, &comment, 1)) {
+    return ARES_ENOTFOUND;
+  }
+
+  ares_buf_tag(buf);
+
+  /* Must be at end of line */
+  if (ares_buf_consume_nonwhitespace(buf) == 0) {
+    return ARES_ENOTFOUND;
+  }
+
+  return ares_buf_tag_fetch_string(buf, out, out_len, ARES_BUF_CHARSET_ASCII);
+}
+
+/* Parse a line of the form:
+ *   name port/proto [alias ...] [# comment]
+ */
+static ares_status_t ares_services_parse_line(ares_services_db_t *db,
+                                              ares_buf_t         *buf)
+{
+  char          name[256];
+  char          portproto[32];
+  char          alias[256];
+  char         *proto;
+  unsigned int  port;
+  ares_status_t status;
+
+  if (ares_services_fetch_word(buf, name, sizeof(name)) != ARES_SUCCESS ||
+      ares_services_fetch_word(buf, portproto, sizeof(portproto)) !=
+        ARES_SUCCESS) {
+    return ARES_EBADSTR;
+  }
+
+  proto = strchr(portproto, '/');
+  if (proto == NULL || proto[1] == '\0') {
+    return ARES_EBADSTR;
+  }
+  *proto = '\0';
+  proto++;
+
+  if (!ares_str_parse_uint(portproto, 65535, &port) || port == 0) {
+    return ARES_EBADSTR;
+  }
+
+  status = ares_services_add(db->byport, portproto, proto, name);
+  if (status != ARES_SUCCESS) {
+    return status; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  status = ares_services_add(db->byname, name, proto, portproto);
+  if (status != ARES_SUCCESS) {
+    return status; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  while (ares_services_fetch_word(buf, alias, sizeof(alias)) == ARES_SUCCESS) {
+    status = ares_services_add(db->byname, alias, proto, portproto);
+    if (status != ARES_SUCCESS) {
+      return status; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  return ARES_SUCCESS;
+}
+
+static ares_status_t ares_services_parse(ares_services_db_t *db)
+{
+  ares_buf_t   *buf;
+  ares_status_t status;
+
+  buf = ares_buf_create();
+  if (buf == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  /* A missing file is loaded as empty rather than retried on every lookup */
+  status = ares_buf_load_file(db->filename, buf);
+  if (status == ARES_ENOTFOUND) {
+    status = ARES_SUCCESS;
+    goto done;
+  }
+  if (status != ARES_SUCCESS) {
+    goto done;
+  }
+
+  while (ares_buf_len(buf)) {
+    status = ares_services_parse_line(db, buf);
+    if (status == ARES_ENOMEM) {
+      goto done; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+
+    /* Bad lines are skipped */
+    ares_buf_consume_line(buf, ARES_TRUE);
+  }
+
+  status = ARES_SUCCESS;
+
+done:
+  ares_buf_destroy(buf);
+  return status;
+}
+
+static ares_services_db_t *ares_services_load(const char *filename)
+{
+  ares_services_db_t *db = ares_malloc_zero(sizeof(*db));
+
+  if (db == NULL) {
+    return NULL; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  db->filename = ares_strdup(filename);
+  db->byname   = ares_htable_dict_create_casesensitive();
+  db->byport   = ares_htable_dict_create_casesensitive();
+  if (db->filename == NULL || db->byname == NULL || db->byport == NULL) {
+    goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  /* Record what is being loaded before reading it, so a modification while
+   * reading is seen as a modification afterwards */
+  db->ts        = time(NULL);
+  db->have_stat = ares_file_stat(filename, &db->mtime, &db->size);
+  ares_tvnow(&db->checked);
+
+  if (ares_services_parse(db) != ARES_SUCCESS) {
+    goto fail;
+  }
+
+  return db;
+
+fail:
+  ares_services_db_destroy(db);
+  return NULL;
+}
+
+static ares_bool_t ares_services_modified(const ares_services_db_t *db)
+{
+  time_t mtime = 0;
+  size_t size  = 0;
+
+  /* Reload every 60s if we can't get a time */
+  if (!ares_file_stat(db->filename, &mtime, &size)) {
+    return time(NULL) - db->ts >= 60 ? ARES_TRUE : ARES_FALSE;
+  }
+
+  if (!db->have_stat || mtime != db->mtime || size != db->size) {
+    return ARES_TRUE;
+  }
+
+  /* Modification times only have a resolution of a second, see
+   * ares_hosts_modified() */
+  if (db->ts <= db->mtime) {
+    return ARES_TRUE;
+  }
+
+  return ARES_FALSE;
+}
+
+/* Returns with the global lock held and the current database, or NULL if
+ * there is none */
+static const ares_services_db_t *ares_services_acquire(void)
+{
+  const char         *filename;
+  char               *path;
+  ares_services_db_t *db;
+  ares_timeval_t      now;
+  ares_timeval_t      next;
+
+  ares_thread_global_lock();
+
+  filename = ares_services_path();
+  if (filename == NULL) {
+    return NULL;
+  }
+
+  ares_tvnow(&now);
+
+  db = ares_services_db;
+  if (db != NULL && ares_streq(db->filename, filename)) {
+    next = db->checked;
+    ares_timeval_add(&next, ARES_SERVICES_CHECK_INTERVAL_MS);
+    if (!ares_timedout(&now, &next)) {
+      return db;
+    }
+
+    db->checked = now;
+    if (!ares_services_modified(db)) {
+      return db;
+    }
+  }
+
+  /* Loaded without holding the global lock.  If multiple threads do this at
+   * the same time, the last one to finish wins, which is harmless. */
+  path = ares_strdup(filename);
+  ares_thread_global_unlock();
+  db = (path != NULL) ? ares_services_load(path) : NULL;
+  ares_free(path);
+  ares_thread_global_lock();
+
+  if (db != NULL) {
+    ares_services_db_destroy(ares_services_db);
+    ares_services_db = db;
+  }
+
+  /* On failure, keep using whatever was loaded before.  The path may have
+   * been changed while loading. */
+  filename = ares_services_path();
+  db       = ares_services_db;
+  if (db != NULL && !ares_streq(db->filename, filename)) {
+    return NULL;
+  }
+  return db;
+}
+
+ares_status_t ares_services_port(const char *name, const char *proto,
+                                 unsigned short *port)
+{
+  const ares_services_db_t *db;
+  const char               *val;
+  char                      key[256];
+  unsigned int              num    = 0;
+  ares_status_t             status = ARES_ENOTFOUND;
+
+  *port = 0;
+
+  db = ares_services_acquire();
+  if (db == NULL) {
+    status = ARES_ENOTIMP;
+    goto done;
+  }
+
+  snprintf(key, sizeof(key), "%s/%s", name, proto);
+  val = ares_htable_dict_get_direct(db->byname, key);
+  if (val != NULL && ares_str_parse_uint(val, 65535, &num)) {
+    *port  = (unsigned short)num;
+    status = ARES_SUCCESS;
+  }
+
+done:
+  ares_thread_global_unlock();
+  return status;
+}
+
+ares_status_t ares_services_name(unsigned short port, const char *proto,
+                                 char *buf, size_t buf_len)
+{
+  const ares_services_db_t *db;
+  const char               *val;
+  char                      key[32];
+  ares_status_t             status = ARES_ENOTFOUND;
+
+  db = ares_services_acquire();
+  if (db == NULL) {
+    status = ARES_ENOTIMP;
+    goto done;
+  }
+
+  snprintf(key, sizeof(key), "%u/%s", (unsigned int)port, proto);
+  val = ares_htable_dict_get_direct(db->byport, key);
+  if (val != NULL) {
+    ares_strcpy(buf, val, buf_len);
+    status = ARES_SUCCESS;
+  }
+
+done:
+  ares_thread_global_unlock();
+  return status;
+}
+
+ares_status_t ares_services_set_path(const char *path)
+{
+  char *dup = NULL;
+
+  if (path != NULL) {
+    dup = ares_strdup(path);
+    if (dup == NULL) {
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  ares_thread_global_lock();
+  ares_free(ares_services_path_override);
+  ares_services_path_override = dup;
+  ares_thread_global_unlock();
+
+  return ARES_SUCCESS;
+}
+
+void ares_services_cleanup(void)
+{
+  ares_services_db_t *db;
+  char               *path;
+
+  ares_thread_global_lock();
+  db                          = ares_services_db;
+  ares_services_db            = NULL;
+  path                        = ares_services_path_override;
+  ares_services_path_override = NULL;
+  ares_thread_global_unlock();
+
+  ares_services_db_destroy(db);
+  ares_free(path);
+}
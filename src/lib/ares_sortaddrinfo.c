@@ -334,6 +334,115 @@ static int rfc6724_compare(const void *ptr1, const void *ptr2)
   return ((int)a1->original_order) - ((int)a2->original_order);
 }
 
+/* Cached source address for a reachable destination address */
+typedef struct {
+  ares_sockaddr src_addr;
+  ares_int64_t  expire_ts;
+} ares_srcaddr_entry_t;
+
+/* Enough for an IPv6 address, a '%' and a 32bit scope id */
+#define ARES_SRCADDR_KEY_LEN (INET6_ADDRSTRLEN + 11)
+
+/* Generate the cache key for a destination address, returns ARES_FALSE if
+ * the address family isn't cacheable.  The key is the exact destination
+ * address (not the port), as a more specific route may exist for any
+ * destination.  The same link-local address on different interfaces is a
+ * different destination, so the IPv6 scope id is part of the key. */
+static ares_bool_t ares_srcaddr_key(const struct sockaddr *addr, char *key,
+                                    size_t key_len)
+{
+  const struct sockaddr_in6 *sin6;
+  size_t                     len;
+
+  switch (addr->sa_family) {
+    case AF_INET:
+      return ares_inet_ntop(
+               AF_INET,
+               &((const struct sockaddr_in *)(const void *)addr)->sin_addr,
+               key, (ares_socklen_t)key_len) != NULL
+               ? ARES_TRUE
+               : ARES_FALSE;
+    case AF_INET6:
+      break;
+    default:
+      return ARES_FALSE;
+  }
+
+  sin6 = (const struct sockaddr_in6 *)(const void *)addr;
+  if (ares_inet_ntop(AF_INET6, &sin6->sin6_addr, key,
+                     (ares_socklen_t)key_len) == NULL) {
+    return ARES_FALSE; /* LCOV_EXCL_LINE: DefensiveCoding */
+  }
+
+#ifdef HAVE_STRUCT_SOCKADDR_IN6_SIN6_SCOPE_ID
+  len = ares_strlen(key);
+  snprintf(key + len, key_len - len, "%%%u", (unsigned int)sin6->sin6_scope_id);
+#else
+  (void)len;
+#endif
+  return ARES_TRUE;
+}
+
+void ares_srcaddr_cache_flush(ares_channel_t *channel)
+{
+  ares_htable_strvp_destroy(channel->srcaddr_cache);
+  channel->srcaddr_cache = NULL;
+}
+
+static const ares_srcaddr_entry_t *
+  ares_srcaddr_cache_get(ares_channel_t *channel, const char *key,
+                         const ares_timeval_t *now)
+{
+  const ares_srcaddr_entry_t *entry;
+
+  entry = ares_htable_strvp_get_direct(channel->srcaddr_cache, key);
+  if (entry == NULL) {
+    return NULL;
+  }
+
+  if (entry->expire_ts <= now->sec) {
+    ares_htable_strvp_remove(channel->srcaddr_cache, key);
+    return NULL;
+  }
+
+  return entry;
+}
+
+static void ares_srcaddr_cache_set(ares_channel_t *channel, const char *key,
+                                   const ares_timeval_t  *now,
+                                   const struct sockaddr *src_addr)
+{
+  ares_srcaddr_entry_t *entry;
+
+  /* Bound the size, stale entries are otherwise only removed on lookup */
+  if (channel->srcaddr_cache != NULL &&
+      ares_htable_strvp_num_keys(channel->srcaddr_cache) >=
+        ARES_SRCADDR_CACHE_MAX) {
+    ares_srcaddr_cache_flush(channel);
+  }
+
+  if (channel->srcaddr_cache == NULL) {
+    channel->srcaddr_cache = ares_htable_strvp_create(ares_free);
+    if (channel->srcaddr_cache == NULL) {
+      return; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  entry = ares_malloc_zero(sizeof(*entry));
+  if (entry == NULL) {
+    return; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  entry->expire_ts = now->sec + ARES_SRCADDR_CACHE_TTL;
+  memcpy(&entry->src_addr, src_addr,
+         src_addr->sa_family == AF_INET6 ? sizeof(struct sockaddr_in6)
+                                         : sizeof(struct sockaddr_in));
+
+  if (!ares_htable_strvp_insert(channel->srcaddr_cache, key, entry)) {
+    ares_free(entry); /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+}
+
 /*
  * Find the source address that will be used if trying to connect to the given
  * address.
@@ -342,8 +451,9 @@ static int rfc6724_compare(const void *ptr1, const void *ptr2)
  * and -1 if a fatal error occurred. If 0 or 1, the contents of src_addr are
  * undefined.
  */
-static int find_src_addr(ares_channel_t *channel, const struct sockaddr *addr,
-                         struct sockaddr *src_addr)
+static int find_src_addr_nocache(ares_channel_t        *channel,
+                                 const struct sockaddr *addr,
+                                 struct sockaddr       *src_addr)
 {
   ares_socket_t   sock;
   ares_socklen_t  len;
@@ -385,12 +495,49 @@ static int find_src_addr(ares_channel_t *channel, const struct sockaddr *addr,
   return 1;
 }
 
+/* Same as find_src_addr_nocache(), but source addresses are cached for a
+ * short time since each lookup costs several syscalls and the same
+ * destinations tend to be returned repeatedly.  Only successful lookups are
+ * cached, an unreachable destination may become reachable at any time and is
+ * rare enough that retrying it is cheap.  The cache is also flushed on
+ * reinit, which is triggered by system configuration changes. */
+static int find_src_addr(ares_channel_t *channel, const struct sockaddr *addr,
+                         struct sockaddr      *src_addr,
+                         const ares_timeval_t *now)
+{
+  char                        key[ARES_SRCADDR_KEY_LEN];
+  const ares_srcaddr_entry_t *entry;
+  int                         rv;
+
+  if (!ares_srcaddr_key(addr, key, sizeof(key))) {
+    return find_src_addr_nocache(channel, addr, src_addr);
+  }
+
+  entry = ares_srcaddr_cache_get(channel, key, now);
+  if (entry != NULL) {
+    memcpy(src_addr, &entry->src_addr,
+           entry->src_addr.sa.sa_family == AF_INET6
+             ? sizeof(struct sockaddr_in6)
+             : sizeof(struct sockaddr_in));
+    return 1;
+  }
+
+  rv = find_src_addr_nocache(channel, addr, src_addr);
+  if (rv == 1) {
+    ares_srcaddr_cache_set(channel, key, now, src_addr);
+  }
+
+  return rv;
+}
+
 /*
  * Sort the linked list starting at sentinel->ai_next in RFC6724 order.
- * Will leave the list unchanged if an error occurs.
+ * Will leave the list unchanged if an error occurs.  now is used to expire
+ * cached source addresses.
  */
 ares_status_t ares_sortaddrinfo(ares_channel_t            *channel,
-                                struct ares_addrinfo_node *list_sentinel)
+                                struct ares_addrinfo_node *list_sentinel,
+                                const ares_timeval_t      *now)
 {
   struct ares_addrinfo_node *cur;
   size_t                     nelem = 0;
@@ -423,7 +570,8 @@ ares_status_t ares_sortaddrinfo(ares_channel_t            *channel,
     assert(cur != NULL);
     elems[i].ai             = cur;
     elems[i].original_order = i;
-    has_src_addr = find_src_addr(channel, cur->ai_addr, &elems[i].src_addr.sa);
+    has_src_addr =
+      find_src_addr(channel, cur->ai_addr, &elems[i].src_addr.sa, now);
     if (has_src_addr == -1) {
       ares_free(elems);
       return ARES_ENOTFOUND;
@@ -637,34 +637,354 @@ static ares_status_t ares_sysconfig_apply(ares_channel_t         *channel,
   return ARES_SUCCESS;
 }
 
-ares_status_t ares_init_by_sysconfig(ares_channel_t *channel)
+/* The system configuration read for one channel is reused when creating
+ * others, so creating many channels doesn't re-read and re-parse it each time.
+ * Where it comes from files, it is reused only while none of them changed, the
+ * same check the hosts file registry makes, or not at all if they can't be
+ * checked.  Elsewhere it is reused only while a configuration change monitor
+ * is running to report changes. */
+#if !defined(USE_WINSOCK) && !defined(__MVS__) && !defined(__riscos__) && \
+  !defined(WATT32) && !defined(ANDROID) && !defined(__ANDROID__) &&       \
+  !defined(__APPLE__) && !defined(CARES_USE_LIBRESOLV) && !defined(__QNX__)
+#  ifdef HAVE_STAT
+#    define ARES_SYSCONFIG_FROM_FILES
+#  else
+#    define ARES_SYSCONFIG_NO_CACHE
+#  endif
+#endif
+
+#define ARES_SYSCONFIG_MAX_FILES 4
+
+typedef struct {
+  ares_bool_t exists;
+  time_t      mtime;
+  size_t      size;
+} ares_sysconfig_file_t;
+
+/*! State of every file the configuration is read from, taken before reading */
+typedef struct {
+  /*! when the files were examined */
+  time_t               ts;
+  ares_sysconfig_file_t files[ARES_SYSCONFIG_MAX_FILES];
+} ares_sysconfig_files_t;
+
+typedef struct {
+  ares_bool_t                     valid;
+  /*! configuration as read from the system, before the environment */
+  ares_sysconfig_t                sysconfig;
+  /*! channel settings the configuration read depends on */
+  char                           *resolvconf_path;
+  struct ares_socket_functions_ex sock_funcs;
+  void                           *sock_func_cb_data;
+  /*! files read, if read from files */
+  ares_sysconfig_files_t          files;
+  /*! generation of the monitors covering this, 0 if none were */
+  size_t                          watch_gen;
+} ares_sysconfig_cache_t;
+
+/* All protected by the global lock */
+static ares_sysconfig_cache_t ares_sysconfig_cache;
+/*! Bumped on invalidation so a read started before it isn't cached */
+static size_t                 ares_sysconfig_cache_epoch = 0;
+/*! Number of running configuration change monitors */
+static size_t                 ares_sysconfig_watchers    = 0;
+/*! Bumped whenever monitoring starts, as changes may have been missed while
+ *  nothing was monitoring */
+static size_t                 ares_sysconfig_watch_gen   = 0;
+
+static ares_status_t ares_sysconfig_duplicate(ares_sysconfig_t       *dest,
+                                              const ares_sysconfig_t *src)
 {
-  ares_status_t    status;
-  ares_sysconfig_t sysconfig;
+  ares_status_t status;
 
-  memset(&sysconfig, 0, sizeof(sysconfig));
-  sysconfig.ndots = 1; /* Default value if not otherwise set */
+  memset(dest, 0, sizeof(*dest));
+
+  status = ares_sconfig_duplicate(&dest->sconfig, src->sconfig);
+  if (status != ARES_SUCCESS) {
+    goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  if (src->sortlist != NULL) {
+    dest->sortlist =
+      ares_malloc(sizeof(*dest->sortlist) * src->nsortlist);
+    if (dest->sortlist == NULL) {
+      goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+    memcpy(dest->sortlist, src->sortlist,
+           sizeof(*dest->sortlist) * src->nsortlist);
+    dest->nsortlist = src->nsortlist;
+  }
+
+  if (src->domains != NULL) {
+    dest->domains = ares_strsplit_duplicate(src->domains, src->ndomains);
+    if (dest->domains == NULL) {
+      goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+    dest->ndomains = src->ndomains;
+  }
+
+  if (src->lookups != NULL) {
+    dest->lookups = ares_strdup(src->lookups);
+    if (dest->lookups == NULL) {
+      goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  dest->ndots      = src->ndots;
+  dest->tries      = src->tries;
+  dest->rotate     = src->rotate;
+  dest->timeout_ms = src->timeout_ms;
+  dest->usevc      = src->usevc;
+  return ARES_SUCCESS;
+
+/* LCOV_EXCL_START: OutOfMemory */
+fail:
+  ares_sysconfig_free(dest);
+  return ARES_ENOMEM;
+  /* LCOV_EXCL_STOP */
+}
+
+/* Must hold the global lock */
+static void ares_sysconfig_cache_clear(void)
+{
+  ares_sysconfig_free(&ares_sysconfig_cache.sysconfig);
+  ares_free(ares_sysconfig_cache.resolvconf_path);
+  memset(&ares_sysconfig_cache, 0, sizeof(ares_sysconfig_cache));
+}
+
+void ares_sysconfig_cache_invalidate(void)
+{
+  ares_thread_global_lock();
+  ares_sysconfig_cache_clear();
+  ares_sysconfig_cache_epoch++;
+  ares_thread_global_unlock();
+}
+
+void ares_sysconfig_watch_start(void)
+{
+  ares_thread_global_lock();
+  if (ares_sysconfig_watchers++ == 0) {
+    ares_sysconfig_watch_gen++;
+  }
+  ares_thread_global_unlock();
+}
+
+void ares_sysconfig_watch_stop(void)
+{
+  ares_thread_global_lock();
+  if (ares_sysconfig_watchers > 0) {
+    ares_sysconfig_watchers--;
+  }
+  ares_thread_global_unlock();
+}
+
+#ifdef ARES_SYSCONFIG_FROM_FILES
+static void ares_sysconfig_files_stat(const ares_channel_t   *channel,
+                                      ares_sysconfig_files_t *state)
+{
+  size_t i;
+
+  memset(state, 0, sizeof(*state));
+  state->ts = time(NULL);
+
+  for (i = 0; i < ARES_SYSCONFIG_MAX_FILES; i++) {
+    const char *path = ares_sysconfig_files_path(channel, i);
+    if (path == NULL) {
+      break; /* LCOV_EXCL_LINE: DefensiveCoding */
+    }
+    state->files[i].exists =
+      ares_file_stat(path, &state->files[i].mtime, &state->files[i].size);
+  }
+}
+
+static ares_bool_t
+  ares_sysconfig_files_unchanged(const ares_sysconfig_files_t *cached,
+                                 const ares_sysconfig_files_t *current)
+{
+  size_t i;
+
+  for (i = 0; i < ARES_SYSCONFIG_MAX_FILES; i++) {
+    const ares_sysconfig_file_t *c = &cached->files[i];
+    const ares_sysconfig_file_t *f = &current->files[i];
+
+    if (c->exists != f->exists) {
+      return ARES_FALSE;
+    }
 
+    if (!c->exists) {
+      continue;
+    }
+
+    /* A file read within the same second it was modified may have missed a
+     * later modification within that second, so isn't reused */
+    if (c->mtime != f->mtime || c->size != f->size || cached->ts <= c->mtime) {
+      return ARES_FALSE;
+    }
+  }
+
+  return ARES_TRUE;
+}
+#endif
+
+/* Must hold the global lock */
+static ares_bool_t
+  ares_sysconfig_cache_match(const ares_channel_t         *channel,
+                             const ares_sysconfig_files_t *files)
+{
+  const ares_sysconfig_cache_t *cache = &ares_sysconfig_cache;
+
+  if (!cache->valid) {
+    return ARES_FALSE;
+  }
+
+  /* The configuration read depends on these, see ares_sconfig_append() */
+  if (!ares_streq(cache->resolvconf_path != NULL ? cache->resolvconf_path : "",
+                  channel->resolvconf_path != NULL ? channel->resolvconf_path
+                                                   : "") ||
+      cache->sock_funcs.aif_nametoindex !=
+        channel->sock_funcs.aif_nametoindex ||
+      cache->sock_funcs.aif_indextoname !=
+        channel->sock_funcs.aif_indextoname ||
+      cache->sock_func_cb_data != channel->sock_func_cb_data) {
+    return ARES_FALSE;
+  }
+
+#if defined(ARES_SYSCONFIG_FROM_FILES)
+  /* Monitors may not watch every file read, so always check them */
+  return ares_sysconfig_files_unchanged(&cache->files, files);
+#elif defined(ARES_SYSCONFIG_NO_CACHE)
+  (void)files;
+  return ARES_FALSE;
+#else
+  (void)files;
+  return (cache->watch_gen != 0 &&
+          cache->watch_gen == ares_sysconfig_watch_gen &&
+          ares_sysconfig_watchers > 0)
+           ? ARES_TRUE
+           : ARES_FALSE;
+#endif
+}
+
+static ares_status_t
+  ares_sysconfig_cache_fetch(const ares_channel_t         *channel,
+                             const ares_sysconfig_files_t *files,
+                             ares_sysconfig_t             *sysconfig)
+{
+  ares_status_t status = ARES_ENOTFOUND;
+
+  ares_thread_global_lock();
+  if (ares_sysconfig_cache_match(channel, files)) {
+    status =
+      ares_sysconfig_duplicate(sysconfig, &ares_sysconfig_cache.sysconfig);
+  }
+  ares_thread_global_unlock();
+
+  return status;
+}
+
+/* Caching is best effort, failures are ignored */
+static void ares_sysconfig_cache_store(const ares_channel_t         *channel,
+                                       const ares_sysconfig_t       *sysconfig,
+                                       const ares_sysconfig_files_t *files,
+                                       size_t epoch, size_t watch_gen)
+{
+  ares_sysconfig_cache_t cache;
+
+  memset(&cache, 0, sizeof(cache));
+
+  if (ares_sysconfig_duplicate(&cache.sysconfig, sysconfig) != ARES_SUCCESS) {
+    return; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  if (channel->resolvconf_path != NULL) {
+    cache.resolvconf_path = ares_strdup(channel->resolvconf_path);
+    if (cache.resolvconf_path == NULL) {
+      ares_sysconfig_free(&cache.sysconfig); /* LCOV_EXCL_LINE: OutOfMemory */
+      return;                                /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  cache.valid             = ARES_TRUE;
+  cache.sock_funcs        = channel->sock_funcs;
+  cache.sock_func_cb_data = channel->sock_func_cb_data;
+  cache.files             = *files;
+  cache.watch_gen         = watch_gen;
+
+  ares_thread_global_lock();
+  /* Configuration changed while we were reading it, what we read may predate
+   * the change */
+  if (epoch != ares_sysconfig_cache_epoch) {
+    ares_thread_global_unlock();
+    ares_sysconfig_free(&cache.sysconfig);
+    ares_free(cache.resolvconf_path);
+    return;
+  }
+  ares_sysconfig_cache_clear();
+  ares_sysconfig_cache = cache;
+  ares_thread_global_unlock();
+}
+
+static ares_status_t ares_init_sysconfig_system(const ares_channel_t *channel,
+                                                ares_sysconfig_t     *sysconfig)
+{
 #if defined(USE_WINSOCK)
-  status = ares_init_sysconfig_windows(channel, &sysconfig);
+  return ares_init_sysconfig_windows(channel, sysconfig);
 #elif defined(__MVS__)
-  status = ares_init_sysconfig_mvs(channel, &sysconfig);
+  return ares_init_sysconfig_mvs(channel, sysconfig);
 #elif defined(__riscos__)
-  status = ares_init_sysconfig_riscos(channel, &sysconfig);
+  return ares_init_sysconfig_riscos(channel, sysconfig);
 #elif defined(WATT32)
-  status = ares_init_sysconfig_watt32(channel, &sysconfig);
+  return ares_init_sysconfig_watt32(channel, sysconfig);
 #elif defined(ANDROID) || defined(__ANDROID__)
-  status = ares_init_sysconfig_android(channel, &sysconfig);
+  return ares_init_sysconfig_android(channel, sysconfig);
 #elif defined(__APPLE__)
-  status = ares_init_sysconfig_macos(channel, &sysconfig);
+  return ares_init_sysconfig_macos(channel, sysconfig);
 #elif defined(CARES_USE_LIBRESOLV)
-  status = ares_init_sysconfig_libresolv(channel, &sysconfig);
+  return ares_init_sysconfig_libresolv(channel, sysconfig);
 #elif defined(__QNX__)
-  status = ares_init_sysconfig_qnx(channel, &sysconfig);
+  return ares_init_sysconfig_qnx(channel, sysconfig);
 #else
-  status = ares_init_sysconfig_files(channel, &sysconfig, ARES_TRUE);
+  return ares_init_sysconfig_files(channel, sysconfig, ARES_TRUE);
+#endif
+}
+
+ares_status_t ares_init_by_sysconfig(ares_channel_t *channel)
+{
+  ares_status_t          status;
+  ares_sysconfig_t       sysconfig;
+  ares_sysconfig_files_t files;
+
+  memset(&sysconfig, 0, sizeof(sysconfig));
+  memset(&files, 0, sizeof(files));
+
+#ifdef ARES_SYSCONFIG_FROM_FILES
+  /* Before reading, so a change made while reading isn't missed */
+  ares_sysconfig_files_stat(channel, &files);
 #endif
 
+  /* Reuse what was read for another channel if we can */
+  status = ares_sysconfig_cache_fetch(channel, &files, &sysconfig);
+  if (status == ARES_ENOTFOUND) {
+    size_t epoch;
+    size_t watch_gen = 0;
+
+    ares_thread_global_lock();
+    epoch = ares_sysconfig_cache_epoch;
+    /* Monitors only watch the default system configuration */
+    if (ares_sysconfig_watchers > 0 && channel->resolvconf_path == NULL) {
+      watch_gen = ares_sysconfig_watch_gen;
+    }
+    ares_thread_global_unlock();
+
+    sysconfig.ndots = 1; /* Default value if not otherwise set */
+
+    status = ares_init_sysconfig_system(channel, &sysconfig);
+    if (status == ARES_SUCCESS) {
+      ares_sysconfig_cache_store(channel, &sysconfig, &files, epoch,
+                                 watch_gen);
+    }
+  }
+
   if (status != ARES_SUCCESS) {
     goto done;
   }
@@ -823,6 +823,29 @@ done:
   return status;
 }
 
+/* Read by ares_init_sysconfig_files() after resolv.conf */
+#define PATH_NSSWITCH_CONF "/etc/nsswitch.conf"
+#define PATH_NETSVC_CONF   "/etc/netsvc.conf"
+#define PATH_SVC_CONF      "/etc/svc.conf"
+
+const char *ares_sysconfig_files_path(const ares_channel_t *channel,
+                                      size_t                idx)
+{
+  static const char * const paths[] = { PATH_NSSWITCH_CONF, PATH_NETSVC_CONF,
+                                        PATH_SVC_CONF };
+
+  if (idx == 0) {
+    return (channel->resolvconf_path != NULL) ? channel->resolvconf_path
+                                              : PATH_RESOLV_CONF;
+  }
+
+  if (idx - 1 >= sizeof(paths) / sizeof(*paths)) {
+    return NULL;
+  }
+
+  return paths[idx - 1];
+}
+
 ares_status_t ares_init_sysconfig_files(const ares_channel_t *channel,
                                         ares_sysconfig_t     *sysconfig,
                                         ares_bool_t process_resolvconf)
@@ -832,9 +855,7 @@ ares_status_t ares_init_sysconfig_files(const ares_channel_t *channel,
   /* Resolv.conf */
   if (process_resolvconf) {
     status = process_config_lines(channel,
-                                  (channel->resolvconf_path != NULL)
-                                    ? channel->resolvconf_path
-                                    : PATH_RESOLV_CONF,
+                                  ares_sysconfig_files_path(channel, 0),
                                   sysconfig, ares_sysconfig_parse_resolv_line);
     if (status != ARES_SUCCESS && status != ARES_ENOTFOUND) {
       goto done;
@@ -842,21 +863,21 @@ ares_status_t ares_init_sysconfig_files(const ares_channel_t *channel,
   }
 
   /* Nsswitch.conf */
-  status = process_config_lines(channel, "/etc/nsswitch.conf", sysconfig,
+  status = process_config_lines(channel, PATH_NSSWITCH_CONF, sysconfig,
                                 parse_nsswitch_line);
   if (status != ARES_SUCCESS && status != ARES_ENOTFOUND) {
     goto done;
   }
 
   /* netsvc.conf */
-  status = process_config_lines(channel, "/etc/netsvc.conf", sysconfig,
+  status = process_config_lines(channel, PATH_NETSVC_CONF, sysconfig,
                                 parse_svcconf_line);
   if (status != ARES_SUCCESS && status != ARES_ENOTFOUND) {
     goto done;
   }
 
   /* svc.conf */
-  status = process_config_lines(channel, "/etc/svc.conf", sysconfig,
+  status = process_config_lines(channel, PATH_SVC_CONF, sysconfig,
                                 parse_svcconf_line);
   if (status != ARES_SUCCESS && status != ARES_ENOTFOUND) {
     goto done;
@@ -999,6 +999,95 @@ fail:
   /* LCOV_EXCL_STOP */
 }
 
+ares_status_t ares_sconfig_duplicate(ares_llist_t      **dest,
+                                    const ares_llist_t *src)
+{
+  ares_llist_node_t *node;
+  ares_llist_t      *s;
+
+  *dest = NULL;
+
+  if (src == NULL) {
+    return ARES_SUCCESS;
+  }
+
+  s = ares_llist_create(ares_free);
+  if (s == NULL) {
+    goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  for (node = ares_llist_node_first((ares_llist_t *)((size_t)src));
+       node != NULL; node = ares_llist_node_next(node)) {
+    ares_sconfig_t *sconfig = ares_malloc(sizeof(*sconfig));
+
+    if (sconfig == NULL) {
+      goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+
+    memcpy(sconfig, ares_llist_node_val(node), sizeof(*sconfig));
+
+    if (ares_llist_insert_last(s, sconfig) == NULL) {
+      ares_free(sconfig); /* LCOV_EXCL_LINE: OutOfMemory */
+      goto fail;          /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  *dest = s;
+  return ARES_SUCCESS;
+
+/* LCOV_EXCL_START: OutOfMemory */
+fail:
+  ares_llist_destroy(s);
+  return ARES_ENOMEM;
+  /* LCOV_EXCL_STOP */
+}
+
+ares_status_t ares_servers_to_sconfig_llist(const ares_channel_t *channel,
+                                            ares_llist_t        **llist)
+{
+  ares_slist_node_t *node;
+  ares_llist_t      *s;
+
+  *llist = NULL;
+
+  s = ares_llist_create(ares_free);
+  if (s == NULL) {
+    goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  /* Copied as-is, the ports and link-local scope were already resolved when
+   * the servers were configured */
+  for (node = ares_slist_node_first(channel->servers); node != NULL;
+       node = ares_slist_node_next(node)) {
+    const ares_server_t *server  = ares_slist_node_val(node);
+    ares_sconfig_t      *sconfig = ares_malloc_zero(sizeof(*sconfig));
+
+    if (sconfig == NULL) {
+      goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+
+    memcpy(&sconfig->addr, &server->addr, sizeof(sconfig->addr));
+    sconfig->udp_port = server->udp_port;
+    sconfig->tcp_port = server->tcp_port;
+    ares_strcpy(sconfig->ll_iface, server->ll_iface, sizeof(sconfig->ll_iface));
+    sconfig->ll_scope = server->ll_scope;
+
+    if (ares_llist_insert_last(s, sconfig) == NULL) {
+      ares_free(sconfig); /* LCOV_EXCL_LINE: OutOfMemory */
+      goto fail;          /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  *llist = s;
+  return ARES_SUCCESS;
+
+/* LCOV_EXCL_START: OutOfMemory */
+fail:
+  ares_llist_destroy(s);
+  return ARES_ENOMEM;
+  /* LCOV_EXCL_STOP */
+}
+
 static ares_bool_t ares_server_use_uri(const ares_server_t *server)
 {
   /* Currently only reason to use new format is if the ports for udp and tcp
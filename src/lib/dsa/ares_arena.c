@@ -0,0 +1,216 @@
+/* MIT License
+ *
+ * Copyright (c) The c-ares project and its contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "ares_private.h"
+#include "ares_arena.h"
+
+/* Alignment suitable for any object kept in an arena */
+typedef union {
+  void  *p;
+  double d;
+  long   l;
+  size_t s;
+} ares_arena_align_t;
+
+#define ARES_ARENA_ALIGN     sizeof(ares_arena_align_t)
+#define ARES_ARENA_ROUNDUP(x) \
+  (((x) + ARES_ARENA_ALIGN - 1) & ~(ARES_ARENA_ALIGN - 1))
+#define ARES_ARENA_MIN_BLOCK 256
+
+typedef struct ares_arena_block {
+  struct ares_arena_block *next; /*!< Previously filled block */
+  unsigned char           *data;
+  size_t                   size;
+  size_t                   used;
+} ares_arena_block_t;
+
+struct ares_arena {
+  ares_arena_block_t *current;
+  /*! Lives in the same allocation as the arena, data follows the arena */
+  ares_arena_block_t  first;
+};
+
+ares_arena_t *ares_arena_create(size_t size_hint)
+{
+  ares_arena_t *arena;
+  size_t        hdr_len = ARES_ARENA_ROUNDUP(sizeof(*arena));
+
+  if (size_hint < ARES_ARENA_MIN_BLOCK) {
+    size_hint = ARES_ARENA_MIN_BLOCK;
+  }
+  size_hint = ARES_ARENA_ROUNDUP(size_hint);
+  if (size_hint > SIZE_MAX - hdr_len) {
+    return NULL;
+  }
+
+  arena = ares_malloc(hdr_len + size_hint);
+  if (arena == NULL) {
+    return NULL; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  arena->first.next = NULL;
+  arena->first.data = (unsigned char *)arena + hdr_len;
+  arena->first.size = size_hint;
+  arena->first.used = 0;
+  arena->current    = &arena->first;
+  return arena;
+}
+
+void ares_arena_destroy(ares_arena_t *arena)
+{
+  ares_arena_block_t *blk;
+
+  if (arena == NULL) {
+    return;
+  }
+
+  blk = arena->current;
+  while (blk != &arena->first) {
+    ares_arena_block_t *next = blk->next;
+    ares_free(blk);
+    blk = next;
+  }
+
+  ares_free(arena);
+}
+
+static ares_arena_block_t *ares_arena_grow(ares_arena_t *arena, size_t len)
+{
+  ares_arena_block_t *blk;
+  size_t              hdr_len = ARES_ARENA_ROUNDUP(sizeof(*blk));
+  size_t              size    = arena->current->size;
+
+  /* Double each time so the number of blocks stays logarithmic */
+  if (size <= (SIZE_MAX - hdr_len) / 2) {
+    size *= 2;
+  }
+  if (size < len) {
+    size = len;
+  }
+  if (size > SIZE_MAX - hdr_len) {
+    return NULL;
+  }
+
+  blk = ares_malloc(hdr_len + size);
+  if (blk == NULL) {
+    return NULL; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  blk->next      = arena->current;
+  blk->data      = (unsigned char *)blk + hdr_len;
+  blk->size      = size;
+  blk->used      = 0;
+  arena->current = blk;
+  return blk;
+}
+
+static void *ares_arena_alloc_align(ares_arena_t *arena, size_t len,
+                                    size_t align)
+{
+  ares_arena_block_t *blk;
+  size_t              offset;
+  void               *ptr;
+
+  if (arena == NULL || len == 0 || len > SIZE_MAX - ARES_ARENA_ALIGN) {
+    return NULL;
+  }
+
+  blk    = arena->current;
+  offset = (blk->used + align - 1) & ~(align - 1);
+  if (offset > blk->size || blk->size - offset < len) {
+    blk = ares_arena_grow(arena, len);
+    if (blk == NULL) {
+      return NULL;
+    }
+    offset = 0;
+  }
+
+  ptr       = blk->data + offset;
+  blk->used = offset + len;
+  return ptr;
+}
+
+void *ares_arena_alloc(ares_arena_t *arena, size_t len)
+{
+  return ares_arena_alloc_align(arena, len, ARES_ARENA_ALIGN);
+}
+
+void *ares_arena_alloc_zero(ares_arena_t *arena, size_t len)
+{
+  void *ptr = ares_arena_alloc(arena, len);
+
+  if (ptr != NULL) {
+    memset(ptr, 0, len);
+  }
+  return ptr;
+}
+
+void *ares_arena_memdup(ares_arena_t *arena, const void *data, size_t len,
+                        ares_bool_t null_term)
+{
+  unsigned char *ptr;
+
+  if (data == NULL && len != 0) {
+    return NULL;
+  }
+
+  ptr = ares_arena_alloc_align(arena, null_term ? len + 1 : len, 1);
+  if (ptr == NULL) {
+    return NULL;
+  }
+
+  if (len) {
+    memcpy(ptr, data, len);
+  }
+  if (null_term) {
+    ptr[len] = 0;
+  }
+  return ptr;
+}
+
+char *ares_arena_strdup(ares_arena_t *arena, const char *str)
+{
+  if (str == NULL) {
+    return NULL;
+  }
+  return ares_arena_memdup(arena, str, ares_strlen(str), ARES_TRUE);
+}
+
+ares_bool_t ares_arena_owns(const ares_arena_t *arena, const void *ptr)
+{
+  const ares_arena_block_t *blk;
+  const unsigned char      *p = ptr;
+
+  if (arena == NULL || ptr == NULL) {
+    return ARES_FALSE;
+  }
+
+  for (blk = arena->current; blk != NULL; blk = blk->next) {
+    if (p >= blk->data && p < blk->data + blk->size) {
+      return ARES_TRUE;
+    }
+  }
+  return ARES_FALSE;
+}
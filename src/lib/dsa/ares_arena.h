@@ -0,0 +1,122 @@
+/* MIT License
+ *
+ * Copyright (c) The c-ares project and its contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef __ARES__ARENA_H
+#define __ARES__ARENA_H
+
+/*! \addtogroup ares_arena Arena Allocator
+ *
+ * Bump allocator for objects that all live and die together, such as a
+ * parsed DNS record.  Memory comes from a block sized on creation; when it
+ * runs out, another block twice the size is chained on.  Individual
+ * allocations are never freed, only the whole arena, so the common case is
+ * a single malloc() and a single free().
+ *
+ * Memory handed out stays valid until the arena is destroyed.  Objects that
+ * may be handed either arena or heap memory can tell them apart with
+ * ares_arena_owns().
+ *
+ * @{
+ */
+struct ares_arena;
+
+/*! Arena Object, opaque */
+typedef struct ares_arena ares_arena_t;
+
+/*! Create an arena.  The arena itself lives in its first block, so nothing
+ *  else is allocated until that is used up.
+ *
+ *  \param[in] size_hint  Expected total size of all allocations, used to
+ *                        size the first block.  Can be 0.
+ *  \return arena object, or NULL on out of memory
+ */
+ares_arena_t *ares_arena_create(size_t size_hint);
+
+/*! Destroy an arena, freeing all memory allocated from it.
+ *
+ *  \param[in] arena  Initialized arena object, may be NULL.
+ */
+void ares_arena_destroy(ares_arena_t *arena);
+
+/*! Allocate memory suitably aligned for any object.  The memory is not
+ *  zeroed.
+ *
+ *  \param[in] arena  Initialized arena object
+ *  \param[in] len    Length to allocate, must be greater than 0
+ *  \return pointer to memory, or NULL on out of memory
+ */
+void *ares_arena_alloc(ares_arena_t *arena, size_t len);
+
+/*! Allocate zeroed memory suitably aligned for any object.
+ *
+ *  \param[in] arena  Initialized arena object
+ *  \param[in] len    Length to allocate, must be greater than 0
+ *  \return pointer to memory, or NULL on out of memory
+ */
+void *ares_arena_alloc_zero(ares_arena_t *arena, size_t len);
+
+/*! Copy data into the arena.  No alignment is applied.
+ *
+ *  \param[in] arena     Initialized arena object
+ *  \param[in] data      Data to copy, may only be NULL if len is 0
+ *  \param[in] len       Length of data
+ *  \param[in] null_term Whether to append a NULL terminator
+ *  \return pointer to copy, or NULL on out of memory or if nothing would
+ *          be allocated
+ */
+void *ares_arena_memdup(ares_arena_t *arena, const void *data, size_t len,
+                        ares_bool_t null_term);
+
+/*! Copy a NULL-terminated string into the arena.
+ *
+ *  \param[in] arena  Initialized arena object
+ *  \param[in] str    String to copy
+ *  \return pointer to copy, or NULL on out of memory or if str is NULL
+ */
+char *ares_arena_strdup(ares_arena_t *arena, const char *str);
+
+/*! Determine whether memory was allocated from the arena.
+ *
+ *  \param[in] arena  Initialized arena object, may be NULL.
+ *  \param[in] ptr    Pointer to check, may be NULL.
+ *  \return ARES_TRUE if ptr points into the arena, ARES_FALSE otherwise
+ */
+ares_bool_t ares_arena_owns(const ares_arena_t *arena, const void *ptr);
+
+/*! Create an array whose memory comes from an arena.  Growing it leaves the
+ *  old storage behind in the arena, and destroying it only runs the member
+ *  destructor.  Otherwise it behaves as one created by ares_array_create().
+ *
+ *  \param[in] arena       Initialized arena object
+ *  \param[in] member_size Size of each member
+ *  \param[in] destruct    Optional member destructor
+ *  \return array object, or NULL on out of memory
+ */
+ares_array_t *ares_array_create_arena(ares_arena_t *arena, size_t member_size,
+                                      ares_array_destructor_t destruct);
+
+/*! @} */
+
+#endif /* __ARES__ARENA_H */
@@ -25,6 +25,7 @@
  */
 #include "ares_private.h"
 #include "ares_array.h"
+#include "ares_arena.h"
 
 #define ARES__ARRAY_MIN 4
 
@@ -35,6 +36,7 @@ struct ares_array {
   size_t                  cnt;
   size_t                  offset;
   size_t                  alloc_cnt;
+  ares_arena_t           *arena; /*!< If set, all memory comes from here */
 };
 
 ares_array_t *ares_array_create(size_t                  member_size,
@@ -56,6 +58,26 @@ ares_array_t *ares_array_create(size_t                  member_size,
   return arr;
 }
 
+ares_array_t *ares_array_create_arena(ares_arena_t *arena, size_t member_size,
+                                      ares_array_destructor_t destruct)
+{
+  ares_array_t *arr;
+
+  if (arena == NULL || member_size == 0) {
+    return NULL;
+  }
+
+  arr = ares_arena_alloc_zero(arena, sizeof(*arr));
+  if (arr == NULL) {
+    return NULL;
+  }
+
+  arr->member_size = member_size;
+  arr->destruct    = destruct;
+  arr->arena       = arena;
+  return arr;
+}
+
 size_t ares_array_len(const ares_array_t *arr)
 {
   if (arr == NULL) {
@@ -110,6 +132,10 @@ void ares_array_destroy(ares_array_t *arr)
     }
   }
 
+  if (arr->arena != NULL) {
+    return;
+  }
+
   ares_free(arr->arr);
   ares_free(arr);
 }
@@ -163,6 +189,17 @@ void *ares_array_finish(ares_array_t *arr, size_t *num_members)
     arr->offset = 0;
   }
 
+  /* Caller frees the result, so it can't be handed arena memory */
+  if (arr->arena != NULL) {
+    ptr = ares_malloc_zero(arr->cnt * arr->member_size + 1);
+    if (ptr == NULL) {
+      return NULL;
+    }
+    memcpy(ptr, arr->arr, arr->cnt * arr->member_size);
+    *num_members = arr->cnt;
+    return ptr;
+  }
+
   ptr          = arr->arr;
   *num_members = arr->cnt;
   ares_free(arr);
@@ -194,10 +231,24 @@ ares_status_t ares_array_set_size(ares_array_t *arr, size_t size)
     return ARES_SUCCESS;
   }
 
-  temp =
-    ares_realloc_zero_array(arr->arr, arr->alloc_cnt, size, arr->member_size);
-  if (temp == NULL) {
-    return ARES_ENOMEM;
+  if (arr->arena != NULL) {
+    /* The old storage is left behind, it goes away with the arena */
+    if (size > SIZE_MAX / arr->member_size) {
+      return ARES_ENOMEM;
+    }
+    temp = ares_arena_alloc_zero(arr->arena, size * arr->member_size);
+    if (temp == NULL) {
+      return ARES_ENOMEM;
+    }
+    if (arr->alloc_cnt) {
+      memcpy(temp, arr->arr, arr->alloc_cnt * arr->member_size);
+    }
+  } else {
+    temp = ares_realloc_zero_array(arr->arr, arr->alloc_cnt, size,
+                                   arr->member_size);
+    if (temp == NULL) {
+      return ARES_ENOMEM;
+    }
   }
   arr->alloc_cnt = size;
   arr->arr       = temp;
@@ -52,6 +52,11 @@ static unsigned int hash_func(const void *key, unsigned int seed)
   return ares_htable_hash_FNV1a_casecmp(key, ares_strlen(key), seed);
 }
 
+static unsigned int hash_func_case(const void *key, unsigned int seed)
+{
+  return ares_htable_hash_FNV1a(key, ares_strlen(key), seed);
+}
+
 static const void *bucket_key(const void *bucket)
 {
   const ares_htable_dict_bucket_t *arg = bucket;
@@ -73,14 +78,21 @@ static ares_bool_t key_eq(const void *key1, const void *key2)
   return ares_strcaseeq(key1, key2);
 }
 
-ares_htable_dict_t *ares_htable_dict_create(void)
+static ares_bool_t key_eq_case(const void *key1, const void *key2)
+{
+  return ares_streq(key1, key2);
+}
+
+static ares_htable_dict_t *
+  ares_htable_dict_create_int(ares_htable_hashfunc_t hash,
+                              ares_htable_key_eq_t   eq)
 {
   ares_htable_dict_t *htable = ares_malloc(sizeof(*htable));
   if (htable == NULL) {
     goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
   }
 
-  htable->hash = ares_htable_create(hash_func, bucket_key, bucket_free, key_eq);
+  htable->hash = ares_htable_create(hash, bucket_key, bucket_free, eq);
   if (htable->hash == NULL) {
     goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
   }
@@ -97,6 +109,16 @@ fail:
   /* LCOV_EXCL_STOP */
 }
 
+ares_htable_dict_t *ares_htable_dict_create(void)
+{
+  return ares_htable_dict_create_int(hash_func, key_eq);
+}
+
+ares_htable_dict_t *ares_htable_dict_create_casesensitive(void)
+{
+  return ares_htable_dict_create_int(hash_func_case, key_eq_case);
+}
+
 ares_bool_t ares_htable_dict_insert(ares_htable_dict_t *htable, const char *key,
                                     const char *val)
 {
@@ -96,6 +96,17 @@ struct ares_event_thread {
   /*! Reference to the ares channel, for being able to call things like
    *  ares_timeout() and ares_process_fd(). */
   ares_channel_t         *channel;
+  /*! Whether this is the primary event thread for the channel.  Only the
+   *  primary handles timeouts, pending writes, and configuration change
+   *  monitoring.  Secondary threads only service the sockets sharded to
+   *  them. */
+  ares_bool_t             primary;
+  /*! All event threads servicing the channel, with the primary itself at
+   *  index 0.  Sockets are distributed across these by descriptor.  Only
+   *  populated on the primary. */
+  ares_event_thread_t   **shards;
+  /*! Number of entries in shards */
+  size_t                  nshards;
   /*! Whether or not on the next loop we should process a pending write */
   ares_bool_t             process_pending_write;
   /*! Not-yet-processed event handle updates.  These will get enqueued by a
@@ -46,12 +46,21 @@ void ares_event_configchg_destroy(ares_event_configchg_t *configchg)
 #elif defined(__linux__) && defined(CARES_THREADS)
 
 #  include <sys/inotify.h>
+#  include <sys/socket.h>
+#  include <linux/netlink.h>
+#  include <linux/rtnetlink.h>
 
 struct ares_event_configchg {
   int                  inotify_fd;
+  /* rtnetlink socket for address changes or -1, owned by its own event */
+  int                  netlink_fd;
   ares_event_thread_t *e;
 };
 
+typedef struct {
+  int fd;
+} ares_event_configchg_netlink_t;
+
 void ares_event_configchg_destroy(ares_event_configchg_t *configchg)
 {
   if (configchg == NULL) {
@@ -60,6 +69,10 @@ void ares_event_configchg_destroy(ares_event_configchg_t *configchg)
 
   /* Tell event system to stop monitoring for changes.  This will cause the
    * cleanup to be called */
+  if (configchg->netlink_fd >= 0) {
+    ares_event_update(NULL, configchg->e, ARES_EVENT_FLAG_NONE, NULL,
+                      configchg->netlink_fd, NULL, NULL, NULL);
+  }
   ares_event_update(NULL, configchg->e, ARES_EVENT_FLAG_NONE, NULL,
                     configchg->inotify_fd, NULL, NULL, NULL);
 }
@@ -79,6 +92,71 @@ static void ares_event_configchg_free(void *data)
   ares_free(configchg);
 }
 
+static void ares_event_configchg_netlink_free(void *data)
+{
+  ares_event_configchg_netlink_t *nl = data;
+
+  close(nl->fd);
+  ares_free(nl);
+  ares_iface_ips_watch_stop();
+}
+
+static void ares_event_configchg_netlink_cb(ares_event_thread_t *e,
+                                            ares_socket_t fd, void *data,
+                                            ares_event_flags_t flags)
+{
+  unsigned char buf[4096];
+
+  (void)e;
+  (void)data;
+  (void)flags;
+
+  /* The messages themselves don't matter, only that something changed.  An
+   * error such as ENOBUFS means messages were lost, which must be treated as
+   * a change too. */
+  while (recv((int)fd, buf, sizeof(buf), 0) > 0)
+    ;
+
+  ares_iface_ips_cache_invalidate();
+}
+
+/* Watch for interface address changes, so the per-process snapshot of them
+ * can be used until they change.  Failure isn't fatal, the snapshot is then
+ * just cached for less time. */
+static void ares_event_configchg_netlink_init(ares_event_configchg_t *c)
+{
+  ares_event_configchg_netlink_t *nl;
+  struct sockaddr_nl              sa;
+
+  nl = ares_malloc_zero(sizeof(*nl));
+  if (nl == NULL) {
+    return; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  nl->fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                  NETLINK_ROUTE);
+  if (nl->fd == -1) {
+    ares_free(nl); /* LCOV_EXCL_LINE: UntestablePath */
+    return;        /* LCOV_EXCL_LINE: UntestablePath */
+  }
+
+  memset(&sa, 0, sizeof(sa));
+  sa.nl_family = AF_NETLINK;
+  sa.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+  if (bind(nl->fd, (struct sockaddr *)&sa, sizeof(sa)) == -1 ||
+      ares_event_update(NULL, c->e, ARES_EVENT_FLAG_READ,
+                        ares_event_configchg_netlink_cb, nl->fd, nl,
+                        ares_event_configchg_netlink_free,
+                        NULL) != ARES_SUCCESS) {
+    close(nl->fd); /* LCOV_EXCL_LINE: UntestablePath */
+    ares_free(nl); /* LCOV_EXCL_LINE: UntestablePath */
+    return;        /* LCOV_EXCL_LINE: UntestablePath */
+  }
+
+  c->netlink_fd = nl->fd;
+  ares_iface_ips_watch_start();
+}
+
 static void ares_event_configchg_cb(ares_event_thread_t *e, ares_socket_t fd,
                                     void *data, ares_event_flags_t flags)
 {
@@ -94,6 +172,7 @@ static void ares_event_configchg_cb(ares_event_thread_t *e, ares_socket_t fd,
   const struct inotify_event *event;
   ssize_t                     len;
   ares_bool_t                 triggered = ARES_FALSE;
+  ares_bool_t                 hosts     = ARES_FALSE;
 
   (void)fd;
   (void)flags;
@@ -120,6 +199,10 @@ static void ares_event_configchg_cb(ares_event_thread_t *e, ares_socket_t fd,
           ares_strcaseeq(event->name, "nsswitch.conf")) {
         triggered = ARES_TRUE;
       }
+
+      if (ares_strcaseeq(event->name, "hosts")) {
+        hosts = ARES_TRUE;
+      }
     }
   }
 
@@ -127,6 +210,11 @@ static void ares_event_configchg_cb(ares_event_thread_t *e, ares_socket_t fd,
    * we don't want to reload the config back to back */
   if (triggered) {
     ares_reinit(e->channel);
+  } else if (hosts) {
+    /* The hosts file is reloaded lazily on next use, no need for a reinit */
+    ares_channel_lock(e->channel);
+    ares_hosts_file_expire(e->channel->hf);
+    ares_channel_unlock(e->channel);
   }
 }
 
@@ -147,6 +235,7 @@ ares_status_t ares_event_configchg_init(ares_event_configchg_t **configchg,
   }
 
   c->e          = e;
+  c->netlink_fd = -1;
   c->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
   if (c->inotify_fd == -1) {
     status = ARES_ESERVFAIL; /* LCOV_EXCL_LINE: UntestablePath */
@@ -164,6 +253,9 @@ ares_status_t ares_event_configchg_init(ares_event_configchg_t **configchg,
   status =
     ares_event_update(NULL, e, ARES_EVENT_FLAG_READ, ares_event_configchg_cb,
                       c->inotify_fd, c, ares_event_configchg_free, NULL);
+  if (status == ARES_SUCCESS) {
+    ares_event_configchg_netlink_init(c);
+  }
 
 done:
   if (status != ARES_SUCCESS) {
@@ -201,13 +201,36 @@ static void ares_event_thread_process_fd(ares_event_thread_t *e,
   if (flags & ARES_EVENT_FLAG_WRITE) {
     event.events |= ARES_FD_EVENT_WRITE;
   }
-  ares_process_fds(e->channel, &event, 1, ARES_PROCESS_FLAG_SKIP_NON_FD);
+  ares_process_fds_evthread(e->channel, &event, 1,
+                            ARES_PROCESS_FLAG_SKIP_NON_FD);
+}
+
+/* Pick the event thread responsible for servicing a socket.  This must always
+ * return the same thread for the same descriptor so that updates and removals
+ * are delivered to the thread the socket was originally registered with. */
+static ares_event_thread_t *ares_event_thread_shard(ares_event_thread_t *e,
+                                                    ares_socket_t        fd)
+{
+  size_t idx;
+
+  if (e->nshards <= 1) {
+    return e;
+  }
+
+#  ifdef USE_WINSOCK
+  /* Socket handles on Windows are always a multiple of 4 */
+  idx = (size_t)(fd >> 2);
+#  else
+  idx = (size_t)fd;
+#  endif
+
+  return e->shards[idx % e->nshards];
 }
 
 static void ares_event_thread_sockstate_cb(void *data, ares_socket_t socket_fd,
                                            int readable, int writable)
 {
-  ares_event_thread_t *e     = data;
+  ares_event_thread_t *e     = ares_event_thread_shard(data, socket_fd);
   ares_event_flags_t   flags = ARES_EVENT_FLAG_NONE;
 
   if (readable) {
@@ -344,6 +367,14 @@ static void *ares_event_thread(void *arg)
      * triggered cross-thread */
     ares_thread_mutex_unlock(e->mutex);
 
+    /* Secondary threads only service socket events, they sleep until one
+     * arrives or they are woken for an update */
+    if (!e->primary) {
+      e->ev_sys->wait(e, 0);
+      ares_thread_mutex_lock(e->mutex);
+      continue;
+    }
+
     tvout = ares_timeout(e->channel, NULL, &tv);
     if (tvout != NULL) {
       timeout_ms =
@@ -383,6 +414,16 @@ static void *ares_event_thread(void *arg)
 
 static void ares_event_thread_destroy_int(ares_event_thread_t *e)
 {
+  size_t i;
+
+  /* Shut down any secondary threads first, index 0 is ourselves */
+  for (i = 1; i < e->nshards; i++) {
+    ares_event_thread_destroy_int(e->shards[i]);
+  }
+  ares_free(e->shards);
+  e->shards  = NULL;
+  e->nshards = 0;
+
   /* Wake thread and tell it to shutdown if it exists */
   ares_thread_mutex_lock(e->mutex);
   if (e->isup) {
@@ -483,10 +524,14 @@ static const ares_event_sys_t *ares_event_fetch_sys(ares_evsys_t evsys)
 #  endif
 }
 
-ares_status_t ares_event_thread_init(ares_channel_t *channel)
+static ares_status_t ares_event_thread_start(ares_channel_t       *channel,
+                                             ares_bool_t           primary,
+                                             ares_event_thread_t **e_out)
 {
   ares_event_thread_t *e;
 
+  *e_out = NULL;
+
   e = ares_malloc_zero(sizeof(*e));
   if (e == NULL) {
     return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
@@ -517,6 +562,7 @@ ares_status_t ares_event_thread_init(ares_channel_t *channel)
   }
 
   e->channel = channel;
+  e->primary = primary;
   e->isup    = ARES_TRUE;
   e->ev_sys  = ares_event_fetch_sys(channel->evsys);
   if (e->ev_sys == NULL) {
@@ -524,19 +570,9 @@ ares_status_t ares_event_thread_init(ares_channel_t *channel)
     return ARES_ENOTIMP;              /* LCOV_EXCL_LINE: UntestablePath */
   }
 
-  channel->sock_state_cb                = ares_event_thread_sockstate_cb;
-  channel->sock_state_cb_data           = e;
-  channel->notify_pending_write_cb      = notifywrite_cb;
-  channel->notify_pending_write_cb_data = e;
-  ares_set_query_enqueue_cb(channel, notifyenqueue_cb, e);
-
   if (!e->ev_sys->init(e)) {
-    /* LCOV_EXCL_START: UntestablePath */
-    ares_event_thread_destroy_int(e);
-    channel->sock_state_cb      = NULL;
-    channel->sock_state_cb_data = NULL;
-    return ARES_ESERVFAIL;
-    /* LCOV_EXCL_STOP */
+    ares_event_thread_destroy_int(e); /* LCOV_EXCL_LINE: UntestablePath */
+    return ARES_ESERVFAIL;            /* LCOV_EXCL_LINE: UntestablePath */
   }
 
   /* Before starting the thread, process any possible events the initialization
@@ -548,14 +584,55 @@ ares_status_t ares_event_thread_init(ares_channel_t *channel)
 
   /* Start thread */
   if (ares_thread_create(&e->thread, ares_event_thread, e) != ARES_SUCCESS) {
-    /* LCOV_EXCL_START: UntestablePath */
-    ares_event_thread_destroy_int(e);
-    channel->sock_state_cb      = NULL;
-    channel->sock_state_cb_data = NULL;
-    return ARES_ESERVFAIL;
-    /* LCOV_EXCL_STOP */
+    ares_event_thread_destroy_int(e); /* LCOV_EXCL_LINE: UntestablePath */
+    return ARES_ESERVFAIL;            /* LCOV_EXCL_LINE: UntestablePath */
+  }
+
+  *e_out = e;
+  return ARES_SUCCESS;
+}
+
+ares_status_t ares_event_thread_init(ares_channel_t *channel)
+{
+  ares_event_thread_t *e;
+  ares_status_t        status;
+  size_t               cnt = channel->event_thread_cnt;
+
+  if (cnt == 0) {
+    cnt = 1;
+  }
+
+  status = ares_event_thread_start(channel, ARES_TRUE, &e);
+  if (status != ARES_SUCCESS) {
+    return status;
   }
 
+  e->shards = ares_malloc_zero(cnt * sizeof(*e->shards));
+  if (e->shards == NULL) {
+    ares_event_thread_destroy_int(e); /* LCOV_EXCL_LINE: OutOfMemory */
+    return ARES_ENOMEM;               /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+  e->shards[0] = e;
+  e->nshards   = 1;
+
+  /* Spawn any secondary threads.  No sockets can exist on the channel yet so
+   * it is safe to grow the shard list without any locking. */
+  while (e->nshards < cnt) {
+    status = ares_event_thread_start(channel, ARES_FALSE,
+                                     &e->shards[e->nshards]);
+    if (status != ARES_SUCCESS) {
+      ares_event_thread_destroy_int(e); /* LCOV_EXCL_LINE: UntestablePath */
+      return status;                    /* LCOV_EXCL_LINE: UntestablePath */
+    }
+    e->nshards++;
+  }
+
+  channel->sock_state_cb                = ares_event_thread_sockstate_cb;
+  channel->sock_state_cb_data           = e;
+  channel->notify_pending_write_cb      = notifywrite_cb;
+  channel->notify_pending_write_cb_data = e;
+  ares_set_query_enqueue_cb(channel, notifyenqueue_cb, e);
+
   return ARES_SUCCESS;
 }
 
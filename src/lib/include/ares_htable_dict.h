@@ -57,6 +57,12 @@ CARES_EXTERN void ares_htable_dict_destroy(ares_htable_dict_t *htable);
  */
 CARES_EXTERN ares_htable_dict_t *ares_htable_dict_create(void);
 
+/*! Create string key, string value hash table whose keys are compared
+ *  case-sensitively, unlike ares_htable_dict_create()
+ *
+ */
+CARES_EXTERN ares_htable_dict_t *ares_htable_dict_create_casesensitive(void);
+
 /*! Insert key/value into hash table
  *
  *  \param[in] htable Initialized hash table
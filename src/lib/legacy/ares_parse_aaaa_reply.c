@@ -57,6 +57,7 @@ int ares_parse_aaaa_reply(const unsigned char *abuf, int alen,
   ares_status_t        status;
   size_t               req_naddrttls = 0;
   ares_dns_record_t   *dnsrec        = NULL;
+  ares_arena_t        *arena         = NULL;
 
   if (alen < 0) {
     return ARES_EBADRESP;
@@ -69,12 +70,31 @@ int ares_parse_aaaa_reply(const unsigned char *abuf, int alen,
 
   memset(&ai, 0, sizeof(ai));
 
+  /* Without a hostent the addresses can come straight from the response */
+  if (host == NULL) {
+    size_t temp_naddrttls = 0;
+    status = ares_scan_addrttl(abuf, (size_t)alen, AF_INET6, req_naddrttls,
+                               NULL, addrttls, &temp_naddrttls);
+    if (status != ARES_ENOTIMP) {
+      if (naddrttls) {
+        *naddrttls = (int)temp_naddrttls;
+      }
+      return (int)status;
+    }
+  }
+
   status = ares_dns_parse(abuf, (size_t)alen, 0, &dnsrec);
   if (status != ARES_SUCCESS) {
     goto fail;
   }
 
-  status = ares_parse_into_addrinfo(dnsrec, 0, 0, &ai);
+  arena = ares_arena_create(0);
+  if (arena == NULL) {
+    status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    goto fail;            /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  status = ares_parse_into_addrinfo(dnsrec, 0, 0, arena, &ai);
   if (status != ARES_SUCCESS && status != ARES_ENODATA) {
     goto fail;
   }
@@ -95,10 +115,8 @@ int ares_parse_aaaa_reply(const unsigned char *abuf, int alen,
   }
 
 fail:
-  ares_freeaddrinfo_cnames(ai.cnames);
-  ares_freeaddrinfo_nodes(ai.nodes);
+  ares_arena_destroy(arena);
   ares_free(question_hostname);
-  ares_free(ai.name);
   ares_dns_record_destroy(dnsrec);
 
   if (status == ARES_EBADNAME) {
@@ -565,125 +565,6 @@ const char *ares_dns_rr_key_tostr(ares_dns_rr_key_t key)
   return "UNKNOWN";
 }
 
-ares_dns_datatype_t ares_dns_rr_key_datatype(ares_dns_rr_key_t key)
-{
-  switch (key) {
-    case ARES_RR_A_ADDR:
-      return ARES_DATATYPE_INADDR;
-
-    case ARES_RR_AAAA_ADDR:
-      return ARES_DATATYPE_INADDR6;
-
-    case ARES_RR_NS_NSDNAME:
-    case ARES_RR_CNAME_CNAME:
-    case ARES_RR_SOA_MNAME:
-    case ARES_RR_SOA_RNAME:
-    case ARES_RR_PTR_DNAME:
-    case ARES_RR_MX_EXCHANGE:
-    case ARES_RR_SIG_SIGNERS_NAME:
-    case ARES_RR_RRSIG_SIGNERS_NAME:
-    case ARES_RR_NSEC_NEXT_DOMAIN:
-    case ARES_RR_SRV_TARGET:
-    case ARES_RR_SVCB_TARGET:
-    case ARES_RR_HTTPS_TARGET:
-    case ARES_RR_NAPTR_REPLACEMENT:
-    case ARES_RR_URI_TARGET:
-      return ARES_DATATYPE_NAME;
-
-    case ARES_RR_HINFO_CPU:
-    case ARES_RR_HINFO_OS:
-    case ARES_RR_NAPTR_FLAGS:
-    case ARES_RR_NAPTR_SERVICES:
-    case ARES_RR_NAPTR_REGEXP:
-    case ARES_RR_CAA_TAG:
-      return ARES_DATATYPE_STR;
-
-    case ARES_RR_SOA_SERIAL:
-    case ARES_RR_SOA_REFRESH:
-    case ARES_RR_SOA_RETRY:
-    case ARES_RR_SOA_EXPIRE:
-    case ARES_RR_SOA_MINIMUM:
-    case ARES_RR_SIG_ORIGINAL_TTL:
-    case ARES_RR_SIG_EXPIRATION:
-    case ARES_RR_SIG_INCEPTION:
-    case ARES_RR_RRSIG_ORIGINAL_TTL:
-    case ARES_RR_RRSIG_EXPIRATION:
-    case ARES_RR_RRSIG_INCEPTION:
-      return ARES_DATATYPE_U32;
-
-    case ARES_RR_MX_PREFERENCE:
-    case ARES_RR_SIG_TYPE_COVERED:
-    case ARES_RR_SIG_KEY_TAG:
-    case ARES_RR_RRSIG_TYPE_COVERED:
-    case ARES_RR_RRSIG_KEY_TAG:
-    case ARES_RR_DS_KEY_TAG:
-    case ARES_RR_DNSKEY_FLAGS:
-    case ARES_RR_NSEC3_ITERATIONS:
-    case ARES_RR_NSEC3PARAM_ITERATIONS:
-    case ARES_RR_SRV_PRIORITY:
-    case ARES_RR_SRV_WEIGHT:
-    case ARES_RR_SRV_PORT:
-    case ARES_RR_NAPTR_ORDER:
-    case ARES_RR_NAPTR_PREFERENCE:
-    case ARES_RR_OPT_UDP_SIZE:
-    case ARES_RR_OPT_FLAGS:
-    case ARES_RR_SVCB_PRIORITY:
-    case ARES_RR_HTTPS_PRIORITY:
-    case ARES_RR_URI_PRIORITY:
-    case ARES_RR_URI_WEIGHT:
-    case ARES_RR_RAW_RR_TYPE:
-      return ARES_DATATYPE_U16;
-
-    case ARES_RR_SIG_ALGORITHM:
-    case ARES_RR_SIG_LABELS:
-    case ARES_RR_RRSIG_ALGORITHM:
-    case ARES_RR_RRSIG_LABELS:
-    case ARES_RR_DS_ALGORITHM:
-    case ARES_RR_DS_DIGEST_TYPE:
-    case ARES_RR_SSHFP_ALGORITHM:
-    case ARES_RR_SSHFP_FP_TYPE:
-    case ARES_RR_DNSKEY_PROTOCOL:
-    case ARES_RR_DNSKEY_ALGORITHM:
-    case ARES_RR_NSEC3_HASH_ALGORITHM:
-    case ARES_RR_NSEC3_FLAGS:
-    case ARES_RR_NSEC3PARAM_HASH_ALGORITHM:
-    case ARES_RR_NSEC3PARAM_FLAGS:
-    case ARES_RR_OPT_VERSION:
-    case ARES_RR_TLSA_CERT_USAGE:
-    case ARES_RR_TLSA_SELECTOR:
-    case ARES_RR_TLSA_MATCH:
-    case ARES_RR_CAA_CRITICAL:
-      return ARES_DATATYPE_U8;
-
-    case ARES_RR_CAA_VALUE:
-      return ARES_DATATYPE_BINP;
-
-    case ARES_RR_TXT_DATA:
-      return ARES_DATATYPE_ABINP;
-
-    case ARES_RR_SIG_SIGNATURE:
-    case ARES_RR_RRSIG_SIGNATURE:
-    case ARES_RR_DS_DIGEST:
-    case ARES_RR_SSHFP_FINGERPRINT:
-    case ARES_RR_NSEC_TYPE_BIT_MAPS:
-    case ARES_RR_DNSKEY_PUBLIC_KEY:
-    case ARES_RR_NSEC3_SALT:
-    case ARES_RR_NSEC3_NEXT_HASHED_OWNER:
-    case ARES_RR_NSEC3_TYPE_BIT_MAPS:
-    case ARES_RR_NSEC3PARAM_SALT:
-    case ARES_RR_TLSA_DATA:
-    case ARES_RR_RAW_RR_DATA:
-      return ARES_DATATYPE_BIN;
-
-    case ARES_RR_OPT_OPTIONS:
-    case ARES_RR_SVCB_PARAMS:
-    case ARES_RR_HTTPS_PARAMS:
-      return ARES_DATATYPE_OPT;
-  }
-
-  return 0;
-}
-
 static const ares_dns_rr_key_t rr_a_keys[]     = { ARES_RR_A_ADDR };
 static const ares_dns_rr_key_t rr_ns_keys[]    = { ARES_RR_NS_NSDNAME };
 static const ares_dns_rr_key_t rr_cname_keys[] = { ARES_RR_CNAME_CNAME };
@@ -763,105 +644,353 @@ static const ares_dns_rr_key_t rr_caa_keys[]    = { ARES_RR_CAA_CRITICAL,
 static const ares_dns_rr_key_t rr_raw_rr_keys[] = { ARES_RR_RAW_RR_TYPE,
                                                     ARES_RR_RAW_RR_DATA };
 
-const ares_dns_rr_key_t *ares_dns_rr_get_keys(ares_dns_rec_type_t type,
-                                              size_t             *cnt)
-{
-  if (cnt == NULL) {
-    return NULL;
-  }
+/* Where each key's value lives, in the same order as the key lists above.
+ * Offsets are relative to the type's data structure within (or, for types
+ * stored out of line, pointed to by) the RR's union, so accessors don't need
+ * a switch statement per key. */
+#define RR_FIELD(dt, st, m)          { dt, offsetof(st, m), 0 }
+#define RR_FIELD_LEN(dt, st, m, len) { dt, offsetof(st, m), offsetof(st, len) }
 
-  *cnt = 0;
+static const ares_dns_rr_field_t rr_a_fields[] = {
+  RR_FIELD(ARES_DATATYPE_INADDR, ares_dns_a_t, addr)
+};
+static const ares_dns_rr_field_t rr_ns_fields[] = {
+  RR_FIELD(ARES_DATATYPE_NAME, ares_dns_ns_t, nsdname)
+};
+static const ares_dns_rr_field_t rr_cname_fields[] = {
+  RR_FIELD(ARES_DATATYPE_NAME, ares_dns_cname_t, cname)
+};
+static const ares_dns_rr_field_t rr_soa_fields[] = {
+  RR_FIELD(ARES_DATATYPE_NAME, ares_dns_soa_t, mname),
+  RR_FIELD(ARES_DATATYPE_NAME, ares_dns_soa_t, rname),
+  RR_FIELD(ARES_DATATYPE_U32, ares_dns_soa_t, serial),
+  RR_FIELD(ARES_DATATYPE_U32, ares_dns_soa_t, refresh),
+  RR_FIELD(ARES_DATATYPE_U32, ares_dns_soa_t, retry),
+  RR_FIELD(ARES_DATATYPE_U32, ares_dns_soa_t, expire),
+  RR_FIELD(ARES_DATATYPE_U32, ares_dns_soa_t, minimum)
+};
+static const ares_dns_rr_field_t rr_ptr_fields[] = {
+  RR_FIELD(ARES_DATATYPE_NAME, ares_dns_ptr_t, dname)
+};
+static const ares_dns_rr_field_t rr_hinfo_fields[] = {
+  RR_FIELD(ARES_DATATYPE_STR, ares_dns_hinfo_t, cpu),
+  RR_FIELD(ARES_DATATYPE_STR, ares_dns_hinfo_t, os)
+};
+static const ares_dns_rr_field_t rr_mx_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_mx_t, preference),
+  RR_FIELD(ARES_DATATYPE_NAME, ares_dns_mx_t, exchange)
+};
+static const ares_dns_rr_field_t rr_sig_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_sig_t, type_covered),
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_sig_t, algorithm),
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_sig_t, labels),
+  RR_FIELD(ARES_DATATYPE_U32, ares_dns_sig_t, original_ttl),
+  RR_FIELD(ARES_DATATYPE_U32, ares_dns_sig_t, expiration),
+  RR_FIELD(ARES_DATATYPE_U32, ares_dns_sig_t, inception),
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_sig_t, key_tag),
+  RR_FIELD(ARES_DATATYPE_NAME, ares_dns_sig_t, signers_name),
+  RR_FIELD_LEN(ARES_DATATYPE_BIN, ares_dns_sig_t, signature, signature_len)
+};
+static const ares_dns_rr_field_t rr_txt_fields[] = {
+  RR_FIELD(ARES_DATATYPE_ABINP, ares_dns_txt_t, strs)
+};
+static const ares_dns_rr_field_t rr_aaaa_fields[] = {
+  RR_FIELD(ARES_DATATYPE_INADDR6, ares_dns_aaaa_t, addr)
+};
+static const ares_dns_rr_field_t rr_srv_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_srv_t, priority),
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_srv_t, weight),
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_srv_t, port),
+  RR_FIELD(ARES_DATATYPE_NAME, ares_dns_srv_t, target)
+};
+static const ares_dns_rr_field_t rr_naptr_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_naptr_t, order),
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_naptr_t, preference),
+  RR_FIELD(ARES_DATATYPE_STR, ares_dns_naptr_t, flags),
+  RR_FIELD(ARES_DATATYPE_STR, ares_dns_naptr_t, services),
+  RR_FIELD(ARES_DATATYPE_STR, ares_dns_naptr_t, regexp),
+  RR_FIELD(ARES_DATATYPE_NAME, ares_dns_naptr_t, replacement)
+};
+static const ares_dns_rr_field_t rr_opt_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_opt_t, udp_size),
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_opt_t, version),
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_opt_t, flags),
+  RR_FIELD(ARES_DATATYPE_OPT, ares_dns_opt_t, options)
+};
+static const ares_dns_rr_field_t rr_ds_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_ds_t, key_tag),
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_ds_t, algorithm),
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_ds_t, digest_type),
+  RR_FIELD_LEN(ARES_DATATYPE_BIN, ares_dns_ds_t, digest, digest_len)
+};
+static const ares_dns_rr_field_t rr_sshfp_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_sshfp_t, algorithm),
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_sshfp_t, fp_type),
+  RR_FIELD_LEN(ARES_DATATYPE_BIN, ares_dns_sshfp_t, fingerprint,
+               fingerprint_len)
+};
+static const ares_dns_rr_field_t rr_rrsig_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_rrsig_t, type_covered),
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_rrsig_t, algorithm),
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_rrsig_t, labels),
+  RR_FIELD(ARES_DATATYPE_U32, ares_dns_rrsig_t, original_ttl),
+  RR_FIELD(ARES_DATATYPE_U32, ares_dns_rrsig_t, expiration),
+  RR_FIELD(ARES_DATATYPE_U32, ares_dns_rrsig_t, inception),
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_rrsig_t, key_tag),
+  RR_FIELD(ARES_DATATYPE_NAME, ares_dns_rrsig_t, signers_name),
+  RR_FIELD_LEN(ARES_DATATYPE_BIN, ares_dns_rrsig_t, signature, signature_len)
+};
+static const ares_dns_rr_field_t rr_nsec_fields[] = {
+  RR_FIELD(ARES_DATATYPE_NAME, ares_dns_nsec_t, next_domain_name),
+  RR_FIELD_LEN(ARES_DATATYPE_BIN, ares_dns_nsec_t, type_bit_maps,
+               type_bit_maps_len)
+};
+static const ares_dns_rr_field_t rr_dnskey_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_dnskey_t, flags),
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_dnskey_t, protocol),
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_dnskey_t, algorithm),
+  RR_FIELD_LEN(ARES_DATATYPE_BIN, ares_dns_dnskey_t, public_key,
+               public_key_len)
+};
+static const ares_dns_rr_field_t rr_nsec3_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_nsec3_t, hash_algorithm),
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_nsec3_t, flags),
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_nsec3_t, iterations),
+  RR_FIELD_LEN(ARES_DATATYPE_BIN, ares_dns_nsec3_t, salt, salt_len),
+  RR_FIELD_LEN(ARES_DATATYPE_BIN, ares_dns_nsec3_t, next_hashed_owner_name,
+               next_hashed_owner_name_len),
+  RR_FIELD_LEN(ARES_DATATYPE_BIN, ares_dns_nsec3_t, type_bit_maps,
+               type_bit_maps_len)
+};
+static const ares_dns_rr_field_t rr_nsec3param_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_nsec3param_t, hash_algorithm),
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_nsec3param_t, flags),
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_nsec3param_t, iterations),
+  RR_FIELD_LEN(ARES_DATATYPE_BIN, ares_dns_nsec3param_t, salt, salt_len)
+};
+static const ares_dns_rr_field_t rr_tlsa_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_tlsa_t, cert_usage),
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_tlsa_t, selector),
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_tlsa_t, match),
+  RR_FIELD_LEN(ARES_DATATYPE_BIN, ares_dns_tlsa_t, data, data_len)
+};
+static const ares_dns_rr_field_t rr_svcb_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_svcb_t, priority),
+  RR_FIELD(ARES_DATATYPE_NAME, ares_dns_svcb_t, target),
+  RR_FIELD(ARES_DATATYPE_OPT, ares_dns_svcb_t, params)
+};
+static const ares_dns_rr_field_t rr_uri_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_uri_t, priority),
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_uri_t, weight),
+  RR_FIELD(ARES_DATATYPE_NAME, ares_dns_uri_t, target)
+};
+static const ares_dns_rr_field_t rr_caa_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U8, ares_dns_caa_t, critical),
+  RR_FIELD(ARES_DATATYPE_STR, ares_dns_caa_t, tag),
+  RR_FIELD_LEN(ARES_DATATYPE_BINP, ares_dns_caa_t, value, value_len)
+};
+static const ares_dns_rr_field_t rr_raw_rr_fields[] = {
+  RR_FIELD(ARES_DATATYPE_U16, ares_dns_raw_rr_t, type),
+  RR_FIELD_LEN(ARES_DATATYPE_BIN, ares_dns_raw_rr_t, data, length)
+};
 
+#define RR_SCHEMA(keys, fields, st, out_of_line)                               \
+  { keys, fields, sizeof(keys) / sizeof(*(keys)), sizeof(st), out_of_line }
+
+static const ares_dns_rr_schema_t rr_a_schema =
+  RR_SCHEMA(rr_a_keys, rr_a_fields, ares_dns_a_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_ns_schema =
+  RR_SCHEMA(rr_ns_keys, rr_ns_fields, ares_dns_ns_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_cname_schema =
+  RR_SCHEMA(rr_cname_keys, rr_cname_fields, ares_dns_cname_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_soa_schema =
+  RR_SCHEMA(rr_soa_keys, rr_soa_fields, ares_dns_soa_t, ARES_TRUE);
+static const ares_dns_rr_schema_t rr_ptr_schema =
+  RR_SCHEMA(rr_ptr_keys, rr_ptr_fields, ares_dns_ptr_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_hinfo_schema =
+  RR_SCHEMA(rr_hinfo_keys, rr_hinfo_fields, ares_dns_hinfo_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_mx_schema =
+  RR_SCHEMA(rr_mx_keys, rr_mx_fields, ares_dns_mx_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_txt_schema =
+  RR_SCHEMA(rr_txt_keys, rr_txt_fields, ares_dns_txt_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_sig_schema =
+  RR_SCHEMA(rr_sig_keys, rr_sig_fields, ares_dns_sig_t, ARES_TRUE);
+static const ares_dns_rr_schema_t rr_aaaa_schema =
+  RR_SCHEMA(rr_aaaa_keys, rr_aaaa_fields, ares_dns_aaaa_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_srv_schema =
+  RR_SCHEMA(rr_srv_keys, rr_srv_fields, ares_dns_srv_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_naptr_schema =
+  RR_SCHEMA(rr_naptr_keys, rr_naptr_fields, ares_dns_naptr_t, ARES_TRUE);
+static const ares_dns_rr_schema_t rr_opt_schema =
+  RR_SCHEMA(rr_opt_keys, rr_opt_fields, ares_dns_opt_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_ds_schema =
+  RR_SCHEMA(rr_ds_keys, rr_ds_fields, ares_dns_ds_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_sshfp_schema =
+  RR_SCHEMA(rr_sshfp_keys, rr_sshfp_fields, ares_dns_sshfp_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_rrsig_schema =
+  RR_SCHEMA(rr_rrsig_keys, rr_rrsig_fields, ares_dns_rrsig_t, ARES_TRUE);
+static const ares_dns_rr_schema_t rr_nsec_schema =
+  RR_SCHEMA(rr_nsec_keys, rr_nsec_fields, ares_dns_nsec_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_dnskey_schema =
+  RR_SCHEMA(rr_dnskey_keys, rr_dnskey_fields, ares_dns_dnskey_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_nsec3_schema =
+  RR_SCHEMA(rr_nsec3_keys, rr_nsec3_fields, ares_dns_nsec3_t, ARES_TRUE);
+static const ares_dns_rr_schema_t rr_nsec3param_schema =
+  RR_SCHEMA(rr_nsec3param_keys, rr_nsec3param_fields, ares_dns_nsec3param_t,
+            ARES_FALSE);
+static const ares_dns_rr_schema_t rr_tlsa_schema =
+  RR_SCHEMA(rr_tlsa_keys, rr_tlsa_fields, ares_dns_tlsa_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_svcb_schema =
+  RR_SCHEMA(rr_svcb_keys, rr_svcb_fields, ares_dns_svcb_t, ARES_FALSE);
+/* HTTPS shares the SVCB layout, only the keys differ */
+static const ares_dns_rr_schema_t rr_https_schema =
+  RR_SCHEMA(rr_https_keys, rr_svcb_fields, ares_dns_svcb_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_uri_schema =
+  RR_SCHEMA(rr_uri_keys, rr_uri_fields, ares_dns_uri_t, ARES_FALSE);
+static const ares_dns_rr_schema_t rr_caa_schema =
+  RR_SCHEMA(rr_caa_keys, rr_caa_fields, ares_dns_caa_t, ARES_TRUE);
+static const ares_dns_rr_schema_t rr_raw_rr_schema =
+  RR_SCHEMA(rr_raw_rr_keys, rr_raw_rr_fields, ares_dns_raw_rr_t, ARES_FALSE);
+
+#undef RR_SCHEMA
+#undef RR_FIELD_LEN
+#undef RR_FIELD
+
+const ares_dns_rr_schema_t *ares_dns_rr_get_schema(ares_dns_rec_type_t type)
+{
   switch (type) {
     case ARES_REC_TYPE_A:
-      *cnt = sizeof(rr_a_keys) / sizeof(*rr_a_keys);
-      return rr_a_keys;
+      return &rr_a_schema;
     case ARES_REC_TYPE_NS:
-      *cnt = sizeof(rr_ns_keys) / sizeof(*rr_ns_keys);
-      return rr_ns_keys;
+      return &rr_ns_schema;
     case ARES_REC_TYPE_CNAME:
-      *cnt = sizeof(rr_cname_keys) / sizeof(*rr_cname_keys);
-      return rr_cname_keys;
+      return &rr_cname_schema;
     case ARES_REC_TYPE_SOA:
-      *cnt = sizeof(rr_soa_keys) / sizeof(*rr_soa_keys);
-      return rr_soa_keys;
+      return &rr_soa_schema;
     case ARES_REC_TYPE_PTR:
-      *cnt = sizeof(rr_ptr_keys) / sizeof(*rr_ptr_keys);
-      return rr_ptr_keys;
+      return &rr_ptr_schema;
     case ARES_REC_TYPE_HINFO:
-      *cnt = sizeof(rr_hinfo_keys) / sizeof(*rr_hinfo_keys);
-      return rr_hinfo_keys;
+      return &rr_hinfo_schema;
     case ARES_REC_TYPE_MX:
-      *cnt = sizeof(rr_mx_keys) / sizeof(*rr_mx_keys);
-      return rr_mx_keys;
+      return &rr_mx_schema;
     case ARES_REC_TYPE_TXT:
-      *cnt = sizeof(rr_txt_keys) / sizeof(*rr_txt_keys);
-      return rr_txt_keys;
+      return &rr_txt_schema;
     case ARES_REC_TYPE_SIG:
-      *cnt = sizeof(rr_sig_keys) / sizeof(*rr_sig_keys);
-      return rr_sig_keys;
+      return &rr_sig_schema;
     case ARES_REC_TYPE_AAAA:
-      *cnt = sizeof(rr_aaaa_keys) / sizeof(*rr_aaaa_keys);
-      return rr_aaaa_keys;
+      return &rr_aaaa_schema;
     case ARES_REC_TYPE_SRV:
-      *cnt = sizeof(rr_srv_keys) / sizeof(*rr_srv_keys);
-      return rr_srv_keys;
+      return &rr_srv_schema;
     case ARES_REC_TYPE_NAPTR:
-      *cnt = sizeof(rr_naptr_keys) / sizeof(*rr_naptr_keys);
-      return rr_naptr_keys;
+      return &rr_naptr_schema;
     case ARES_REC_TYPE_OPT:
-      *cnt = sizeof(rr_opt_keys) / sizeof(*rr_opt_keys);
-      return rr_opt_keys;
+      return &rr_opt_schema;
     case ARES_REC_TYPE_DS:
-      *cnt = sizeof(rr_ds_keys) / sizeof(*rr_ds_keys);
-      return rr_ds_keys;
+      return &rr_ds_schema;
     case ARES_REC_TYPE_SSHFP:
-      *cnt = sizeof(rr_sshfp_keys) / sizeof(*rr_sshfp_keys);
-      return rr_sshfp_keys;
+      return &rr_sshfp_schema;
     case ARES_REC_TYPE_RRSIG:
-      *cnt = sizeof(rr_rrsig_keys) / sizeof(*rr_rrsig_keys);
-      return rr_rrsig_keys;
+      return &rr_rrsig_schema;
     case ARES_REC_TYPE_NSEC:
-      *cnt = sizeof(rr_nsec_keys) / sizeof(*rr_nsec_keys);
-      return rr_nsec_keys;
+      return &rr_nsec_schema;
     case ARES_REC_TYPE_DNSKEY:
-      *cnt = sizeof(rr_dnskey_keys) / sizeof(*rr_dnskey_keys);
-      return rr_dnskey_keys;
+      return &rr_dnskey_schema;
     case ARES_REC_TYPE_NSEC3:
-      *cnt = sizeof(rr_nsec3_keys) / sizeof(*rr_nsec3_keys);
-      return rr_nsec3_keys;
+      return &rr_nsec3_schema;
     case ARES_REC_TYPE_NSEC3PARAM:
-      *cnt = sizeof(rr_nsec3param_keys) / sizeof(*rr_nsec3param_keys);
-      return rr_nsec3param_keys;
+      return &rr_nsec3param_schema;
     case ARES_REC_TYPE_TLSA:
-      *cnt = sizeof(rr_tlsa_keys) / sizeof(*rr_tlsa_keys);
-      return rr_tlsa_keys;
+      return &rr_tlsa_schema;
     case ARES_REC_TYPE_SVCB:
-      *cnt = sizeof(rr_svcb_keys) / sizeof(*rr_svcb_keys);
-      return rr_svcb_keys;
+      return &rr_svcb_schema;
     case ARES_REC_TYPE_HTTPS:
-      *cnt = sizeof(rr_https_keys) / sizeof(*rr_https_keys);
-      return rr_https_keys;
+      return &rr_https_schema;
     case ARES_REC_TYPE_ANY:
       /* Not real */
       break;
     case ARES_REC_TYPE_URI:
-      *cnt = sizeof(rr_uri_keys) / sizeof(*rr_uri_keys);
-      return rr_uri_keys;
+      return &rr_uri_schema;
     case ARES_REC_TYPE_CAA:
-      *cnt = sizeof(rr_caa_keys) / sizeof(*rr_caa_keys);
-      return rr_caa_keys;
+      return &rr_caa_schema;
     case ARES_REC_TYPE_RAW_RR:
-      *cnt = sizeof(rr_raw_rr_keys) / sizeof(*rr_raw_rr_keys);
-      return rr_raw_rr_keys;
+      return &rr_raw_rr_schema;
   }
 
   return NULL;
 }
 
+const ares_dns_rr_field_t *
+  ares_dns_rr_schema_field(const ares_dns_rr_schema_t *schema,
+                           ares_dns_rr_key_t           key)
+{
+  size_t idx;
+
+  if (schema == NULL) {
+    return NULL;
+  }
+
+  /* Keys are numbered from 1 within their type, so a key is normally found at
+   * its own number.  OPT skips one, for which a scan is needed. */
+  idx = (size_t)(key % 100) - 1;
+  if (idx >= schema->cnt || schema->keys[idx] != key) {
+    for (idx = 0; idx < schema->cnt; idx++) {
+      if (schema->keys[idx] == key) {
+        break;
+      }
+    }
+    if (idx == schema->cnt) {
+      return NULL;
+    }
+  }
+
+  return &schema->fields[idx];
+}
+
+ares_dns_datatype_t ares_dns_rr_key_datatype(ares_dns_rr_key_t key)
+{
+  const ares_dns_rr_field_t *field =
+    ares_dns_rr_schema_field(ares_dns_rr_get_schema(key / 100), key);
+
+  if (field == NULL) {
+    return 0;
+  }
+  return field->datatype;
+}
+
+const ares_dns_rr_key_t *ares_dns_rr_get_keys(ares_dns_rec_type_t type,
+                                              size_t             *cnt)
+{
+  const ares_dns_rr_schema_t *schema;
+
+  if (cnt == NULL) {
+    return NULL;
+  }
+
+  schema = ares_dns_rr_get_schema(type);
+  if (schema == NULL) {
+    *cnt = 0;
+    return NULL;
+  }
+
+  *cnt = schema->cnt;
+  return schema->keys;
+}
+
+/* Case-insensitive hash of a mnemonic's length and first and last characters.
+ * The multipliers were picked so the record type and class mnemonics each
+ * land in their own slot of the index tables below, so a lookup needs a single
+ * string comparison.  The index tables have to be regenerated when a mnemonic
+ * is added. */
+static size_t ares_dns_mnemonic_hash(const char *str, size_t len)
+{
+  return len + (size_t)ares_tolower((unsigned char)str[0]) * 26 +
+         (size_t)ares_tolower((unsigned char)str[len - 1]) * 15;
+}
+
 ares_bool_t ares_dns_class_fromstr(ares_dns_class_t *qclass, const char *str)
 {
-  size_t i;
+  size_t len;
+  size_t idx;
 
   static const struct {
     const char      *name;
@@ -871,27 +1000,35 @@ ares_bool_t ares_dns_class_fromstr(ares_dns_class_t *qclass, const char *str)
     { "CH",   ARES_CLASS_CHAOS  },
     { "HS",   ARES_CLASS_HESIOD },
     { "NONE", ARES_CLASS_NONE   },
-    { "ANY",  ARES_CLASS_ANY    },
-    { NULL,   0                 }
+    { "ANY",  ARES_CLASS_ANY    }
   };
 
+  /* 1-based index into list by ares_dns_mnemonic_hash() % 8, 0 if unused */
+  static const unsigned char slots[] = { 2, 0, 0, 4, 5, 0, 1, 3 };
+
   if (qclass == NULL || str == NULL) {
     return ARES_FALSE;
   }
 
-  for (i = 0; list[i].name != NULL; i++) {
-    if (ares_strcaseeq(list[i].name, str)) {
-      *qclass = list[i].qclass;
-      return ARES_TRUE;
-    }
+  len = ares_strlen(str);
+  if (len == 0) {
+    return ARES_FALSE;
   }
-  return ARES_FALSE;
+
+  idx = slots[ares_dns_mnemonic_hash(str, len) % sizeof(slots)];
+  if (idx == 0 || !ares_strcaseeq(list[idx - 1].name, str)) {
+    return ARES_FALSE;
+  }
+
+  *qclass = list[idx - 1].qclass;
+  return ARES_TRUE;
 }
 
 ares_bool_t ares_dns_rec_type_fromstr(ares_dns_rec_type_t *qtype,
                                       const char          *str)
 {
-  size_t i;
+  size_t len;
+  size_t idx;
 
   static const struct {
     const char         *name;
@@ -923,21 +1060,33 @@ ares_bool_t ares_dns_rec_type_fromstr(ares_dns_rec_type_t *qtype,
     { "ANY",        ARES_REC_TYPE_ANY        },
     { "URI",        ARES_REC_TYPE_URI        },
     { "CAA",        ARES_REC_TYPE_CAA        },
-    { "RAW_RR",     ARES_REC_TYPE_RAW_RR     },
-    { NULL,         0                        }
+    { "RAW_RR",     ARES_REC_TYPE_RAW_RR     }
+  };
+
+  /* 1-based index into list by ares_dns_mnemonic_hash() % 64, 0 if unused */
+  static const unsigned char slots[] = {
+    26, 0, 0,  15, 0,  18, 0, 0,  27, 0,  1,  0,  25, 10, 0, 0,
+    0,  5, 23, 0,  0,  13, 6, 8,  0,  20, 0,  11, 7,  0,  0, 12,
+    4,  0, 16, 0,  0,  0,  0, 14, 0,  0,  0,  2,  0,  0,  19, 0,
+    22, 0, 0,  0,  24, 0,  0, 0,  0,  0,  9,  21, 0,  17, 3, 0
   };
 
   if (qtype == NULL || str == NULL) {
     return ARES_FALSE;
   }
 
-  for (i = 0; list[i].name != NULL; i++) {
-    if (ares_strcaseeq(list[i].name, str)) {
-      *qtype = list[i].type;
-      return ARES_TRUE;
-    }
+  len = ares_strlen(str);
+  if (len == 0) {
+    return ARES_FALSE;
   }
-  return ARES_FALSE;
+
+  idx = slots[ares_dns_mnemonic_hash(str, len) % sizeof(slots)];
+  if (idx == 0 || !ares_strcaseeq(list[idx - 1].name, str)) {
+    return ARES_FALSE;
+  }
+
+  *qtype = list[idx - 1].type;
+  return ARES_TRUE;
 }
 
 const char *ares_dns_section_tostr(ares_dns_section_t section)
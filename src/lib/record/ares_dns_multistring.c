@@ -40,6 +40,8 @@ struct ares_dns_multistring {
   size_t         cache_str_len;
   /*! Data making up strings */
   ares_array_t  *strs; /*!< multistring_data_t type */
+  /*! If set, all memory comes from here */
+  ares_arena_t  *arena;
 };
 
 static void ares_dns_multistring_free_cb(void *arg)
@@ -68,6 +70,46 @@ ares_dns_multistring_t *ares_dns_multistring_create(void)
   return strs;
 }
 
+ares_dns_multistring_t *ares_dns_multistring_create_arena(ares_arena_t *arena)
+{
+  ares_dns_multistring_t *strs;
+
+  if (arena == NULL) {
+    return NULL;
+  }
+
+  strs = ares_arena_alloc_zero(arena, sizeof(*strs));
+  if (strs == NULL) {
+    return NULL;
+  }
+
+  strs->strs = ares_array_create_arena(arena, sizeof(multistring_data_t), NULL);
+  if (strs->strs == NULL) {
+    return NULL;
+  }
+
+  strs->arena = arena;
+  return strs;
+}
+
+/* Strings held by an arena multistring must live in the arena too, so copy
+ * them in if needed.  The caller still owns str if this fails. */
+static unsigned char *ares_dns_multistring_adopt(ares_dns_multistring_t *strs,
+                                                 unsigned char *str, size_t len)
+{
+  unsigned char *copy;
+
+  if (strs->arena == NULL || ares_arena_owns(strs->arena, str)) {
+    return str;
+  }
+
+  copy = ares_arena_memdup(strs->arena, str, len, ARES_TRUE);
+  if (copy != NULL) {
+    ares_free(str);
+  }
+  return copy;
+}
+
 void ares_dns_multistring_clear(ares_dns_multistring_t *strs)
 {
   if (strs == NULL) {
@@ -81,7 +123,7 @@ void ares_dns_multistring_clear(ares_dns_multistring_t *strs)
 
 void ares_dns_multistring_destroy(ares_dns_multistring_t *strs)
 {
-  if (strs == NULL) {
+  if (strs == NULL || strs->arena != NULL) {
     return;
   }
   ares_dns_multistring_clear(strs);
@@ -107,7 +149,14 @@ ares_status_t ares_dns_multistring_swap_own(ares_dns_multistring_t *strs,
     return ARES_EFORMERR;
   }
 
-  ares_free(data->data);
+  str = ares_dns_multistring_adopt(strs, str, len);
+  if (str == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  if (strs->arena == NULL) {
+    ares_free(data->data);
+  }
   data->data = str;
   data->len  = len;
   return ARES_SUCCESS;
@@ -141,6 +190,13 @@ ares_status_t ares_dns_multistring_add_own(ares_dns_multistring_t *strs,
     return ARES_EFORMERR;
   }
 
+  if (str != NULL) {
+    str = ares_dns_multistring_adopt(strs, str, len);
+    if (str == NULL) {
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
   status = ares_array_insert_last((void **)&data, strs->strs);
   if (status != ARES_SUCCESS) {
     return status;
@@ -150,7 +206,13 @@ ares_status_t ares_dns_multistring_add_own(ares_dns_multistring_t *strs,
    * success or fail on a zero-length string which is actually valid.  So we
    * are going to allocate a 1-byte buffer to use as a placeholder in this
    * case */
-  if (str == NULL) {
+  if (str == NULL && strs->arena != NULL) {
+    str = ares_arena_memdup(strs->arena, NULL, 0, ARES_TRUE);
+    if (str == NULL) {
+      ares_array_remove_last(strs->strs);
+      return ARES_ENOMEM;
+    }
+  } else if (str == NULL) {
     str = ares_malloc_zero(1);
     if (str == NULL) {
       ares_array_remove_last(strs->strs);
@@ -191,6 +253,39 @@ const unsigned char *
   return data->data;
 }
 
+static const unsigned char *
+  ares_dns_multistring_combined_arena(ares_dns_multistring_t *strs,
+                                      size_t                 *len)
+{
+  size_t         total = 0;
+  size_t         i;
+  unsigned char *ptr;
+
+  for (i = 0; i < ares_array_len(strs->strs); i++) {
+    const multistring_data_t *data = ares_array_at_const(strs->strs, i);
+    total                         += data->len;
+  }
+
+  /* Previous cache, if any, is left behind in the arena */
+  strs->cache_str = ares_arena_alloc(strs->arena, total + 1);
+  if (strs->cache_str == NULL) {
+    return NULL; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  ptr = strs->cache_str;
+  for (i = 0; i < ares_array_len(strs->strs); i++) {
+    const multistring_data_t *data = ares_array_at_const(strs->strs, i);
+    memcpy(ptr, data->data, data->len);
+    ptr += data->len;
+  }
+  *ptr = 0;
+
+  strs->cache_str_len     = total;
+  strs->cache_invalidated = ARES_FALSE;
+  *len                    = total;
+  return strs->cache_str;
+}
+
 const unsigned char *ares_dns_multistring_combined(ares_dns_multistring_t *strs,
                                                    size_t                 *len)
 {
@@ -210,10 +305,16 @@ const unsigned char *ares_dns_multistring_combined(ares_dns_multistring_t *strs,
   }
 
   /* Clear cache */
-  ares_free(strs->cache_str);
+  if (strs->arena == NULL) {
+    ares_free(strs->cache_str);
+  }
   strs->cache_str     = NULL;
   strs->cache_str_len = 0;
 
+  if (strs->arena != NULL) {
+    return ares_dns_multistring_combined_arena(strs, len);
+  }
+
   buf = ares_buf_create();
 
   for (i = 0; i < ares_array_len(strs->strs); i++) {
@@ -236,8 +337,9 @@ const unsigned char *ares_dns_multistring_combined(ares_dns_multistring_t *strs,
   return strs->cache_str;
 }
 
-ares_status_t ares_dns_multistring_parse_buf(ares_buf_t *buf,
-                                             size_t      remaining_len,
+ares_status_t ares_dns_multistring_parse_buf(ares_buf_t   *buf,
+                                             ares_arena_t *arena,
+                                             size_t        remaining_len,
                                              ares_dns_multistring_t **strs,
                                              ares_bool_t validate_printable)
 {
@@ -254,7 +356,11 @@ ares_status_t ares_dns_multistring_parse_buf(ares_buf_t *buf,
   }
 
   if (strs != NULL) {
-    *strs = ares_dns_multistring_create();
+    if (arena != NULL) {
+      *strs = ares_dns_multistring_create_arena(arena);
+    } else {
+      *strs = ares_dns_multistring_create();
+    }
     if (*strs == NULL) {
       return ARES_ENOMEM;
     }
@@ -280,7 +386,20 @@ ares_status_t ares_dns_multistring_parse_buf(ares_buf_t *buf,
 
     if (strs != NULL) {
       unsigned char *data = NULL;
-      if (len) {
+      if (len && arena != NULL) {
+        size_t               mylen;
+        const unsigned char *ptr = ares_buf_peek(buf, &mylen);
+        if (mylen < len) {
+          status = ARES_EBADRESP;
+          break;
+        }
+        data = ares_arena_memdup(arena, ptr, len, ARES_TRUE);
+        if (data == NULL) {
+          status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+          break;                /* LCOV_EXCL_LINE: OutOfMemory */
+        }
+        ares_buf_consume(buf, len);
+      } else if (len) {
         status = ares_buf_fetch_bytes_dup(buf, len, ARES_TRUE, &data);
         if (status != ARES_SUCCESS) {
           break;
@@ -288,7 +407,9 @@ ares_status_t ares_dns_multistring_parse_buf(ares_buf_t *buf,
       }
       status = ares_dns_multistring_add_own(*strs, data, len);
       if (status != ARES_SUCCESS) {
-        ares_free(data);
+        if (arena == NULL) {
+          ares_free(data);
+        }
         break;
       }
     } else {
@@ -32,6 +32,15 @@ struct ares_dns_multistring;
 typedef struct ares_dns_multistring ares_dns_multistring_t;
 
 ares_dns_multistring_t *ares_dns_multistring_create(void);
+
+/*! Create a multistring whose memory all comes from an arena.  Strings
+ *  handed over that are not already in the arena are copied in, and
+ *  destroying it is a no-op.
+ *
+ *  \param[in] arena  Initialized arena object
+ *  \return multistring object, or NULL on out of memory
+ */
+ares_dns_multistring_t *ares_dns_multistring_create_arena(ares_arena_t *arena);
 void ares_dns_multistring_clear(ares_dns_multistring_t *strs);
 void ares_dns_multistring_destroy(ares_dns_multistring_t *strs);
 ares_status_t ares_dns_multistring_swap_own(ares_dns_multistring_t *strs,
@@ -53,6 +62,8 @@ const unsigned char *ares_dns_multistring_combined(ares_dns_multistring_t *strs,
  *  not included in the length for each value).
  *
  *  \param[in]  buf                initialized buffer object
+ *  \param[in]  arena              Arena to allocate the result from, or NULL
+ *                                 to use the heap.
  *  \param[in]  remaining_len      maximum length that should be used for
  *                                 parsing the string, this is often less than
  *                                 the remaining buffer and is based on the RR
@@ -64,8 +75,9 @@ const unsigned char *ares_dns_multistring_combined(ares_dns_multistring_t *strs,
  *                                 data.
  *  \return ARES_SUCCESS on success
  */
-ares_status_t ares_dns_multistring_parse_buf(ares_buf_t *buf,
-                                             size_t      remaining_len,
+ares_status_t ares_dns_multistring_parse_buf(ares_buf_t   *buf,
+                                             ares_arena_t *arena,
+                                             size_t        remaining_len,
                                              ares_dns_multistring_t **strs,
                                              ares_bool_t validate_printable);
 
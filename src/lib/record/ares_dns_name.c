@@ -38,6 +38,10 @@
  * without limit. */
 #define ARES_MAX_INDIRS 128
 
+/* Names previously written to the message and their offsets, used as name
+ * compression targets.  Indexed by the full name so finding the longest
+ * target for a new name is a lookup per label rather than a scan of every
+ * name written so far. */
 typedef struct {
   char  *name;
   size_t name_len;
@@ -54,7 +58,28 @@ static void ares_nameoffset_free(void *arg)
   ares_free(off);
 }
 
-static ares_status_t ares_nameoffset_create(ares_llist_t **list,
+/* Due to DNS 0x20, lets not inadvertently mangle things, use case-sensitive
+ * matching instead of case-insensitive.  This may result in slightly larger
+ * DNS queries overall. */
+static unsigned int ares_nameoffset_hash(const void *key, unsigned int seed)
+{
+  const char *name = key;
+  return ares_htable_hash_FNV1a((const unsigned char *)name,
+                                ares_strlen(name), seed);
+}
+
+static const void *ares_nameoffset_key(const void *bucket)
+{
+  const ares_nameoffset_t *off = bucket;
+  return off->name;
+}
+
+static ares_bool_t ares_nameoffset_key_eq(const void *key1, const void *key2)
+{
+  return ares_streq(key1, key2);
+}
+
+static ares_status_t ares_nameoffset_create(ares_htable_t **list,
                                             const char *name, size_t idx)
 {
   ares_status_t      status;
@@ -74,7 +99,8 @@ static ares_status_t ares_nameoffset_create(ares_llist_t **list,
   }
 
   if (*list == NULL) {
-    *list = ares_llist_create(ares_nameoffset_free);
+    *list = ares_htable_create(ares_nameoffset_hash, ares_nameoffset_key,
+                               ares_nameoffset_free, ares_nameoffset_key_eq);
   }
   if (*list == NULL) {
     status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
@@ -95,7 +121,7 @@ static ares_status_t ares_nameoffset_create(ares_llist_t **list,
   off->name_len = ares_strlen(off->name);
   off->idx      = idx;
 
-  if (ares_llist_insert_last(*list, off) == NULL) {
+  if (!ares_htable_insert(*list, off)) {
     status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
     goto fail;            /* LCOV_EXCL_LINE: OutOfMemory */
   }
@@ -109,52 +135,37 @@ fail:
   /* LCOV_EXCL_STOP */
 }
 
-static const ares_nameoffset_t *ares_nameoffset_find(ares_llist_t *list,
-                                                     const char   *name)
+static const ares_nameoffset_t *
+  ares_nameoffset_find(const ares_htable_t *list, const char *name)
 {
-  size_t                   name_len = ares_strlen(name);
-  ares_llist_node_t       *node;
-  const ares_nameoffset_t *longest_match = NULL;
+  const ares_nameoffset_t *off;
+  ares_bool_t              escaped = ARES_FALSE;
+  size_t                   i;
 
-  if (list == NULL || name == NULL || name_len == 0) {
+  if (list == NULL || name == NULL || *name == 0) {
     return NULL;
   }
 
-  for (node = ares_llist_node_first(list); node != NULL;
-       node = ares_llist_node_next(node)) {
-    const ares_nameoffset_t *val = ares_llist_node_val(node);
-    size_t                   prefix_len;
-
-    /* Can't be a match if the stored name is longer */
-    if (val->name_len > name_len) {
+  /* Only whole names are recorded, and a target must start on a label
+   * boundary, e.g. "example.com" may be used for "my.example.com" but not
+   * "myexample.com".  So try the name itself followed by the suffix after
+   * each unescaped separator, the first one found is the longest. */
+  off = ares_htable_get(list, name);
+  for (i = 0; off == NULL && name[i] != 0; i++) {
+    if (escaped) {
+      escaped = ARES_FALSE;
       continue;
     }
-
-    /* Can't be the longest match if our existing longest match is longer */
-    if (longest_match != NULL && longest_match->name_len > val->name_len) {
+    if (name[i] == '\\') {
+      escaped = ARES_TRUE;
       continue;
     }
-
-    prefix_len = name_len - val->name_len;
-
-    /* Due to DNS 0x20, lets not inadvertently mangle things, use case-sensitive
-     * matching instead of case-insensitive.  This may result in slightly
-     * larger DNS queries overall. */
-    if (!ares_streq(val->name, name + prefix_len)) {
-      continue;
+    if (name[i] == '.' && name[i + 1] != 0) {
+      off = ares_htable_get(list, name + i + 1);
     }
-
-    /* We need to make sure if `val->name` is "example.com" that name is
-     * is separated by a label, e.g. "myexample.com" is not ok, however
-     * "my.example.com" is, so we look for the preceding "." */
-    if (prefix_len != 0 && name[prefix_len - 1] != '.') {
-      continue;
-    }
-
-    longest_match = val;
   }
 
-  return longest_match;
+  return off;
 }
 
 static void ares_dns_labels_free_cb(void *arg)
@@ -374,7 +385,7 @@ done:
   return status;
 }
 
-ares_status_t ares_dns_name_write(ares_buf_t *buf, ares_llist_t **list,
+ares_status_t ares_dns_name_write(ares_buf_t *buf, ares_htable_t **list,
                                   ares_bool_t validate_hostname,
                                   const char *name)
 {
@@ -560,28 +571,232 @@ fail:
   return status;
 }
 
-ares_status_t ares_dns_name_parse(ares_buf_t *buf, char **name,
-                                  ares_bool_t is_hostname,
-                                  ares_bool_t allow_compression)
+/* Once decoded, the name a compression pointer leads to is the same every
+ * time it is referenced, and the rules for decoding it don't depend on how it
+ * was reached.  Large answers tend to point back at the question name or a
+ * handful of other names over and over, so remember the decoded names by
+ * offset in a small open-addressed table for the life of the message. */
+#define ARES_DNS_NAME_MEMO_MIN_SIZE 16
+#define ARES_DNS_NAME_MEMO_MAX_CNT  256
+
+/* Pointer targets remembered while decoding a single name */
+#define ARES_DNS_NAME_MEMO_JUMPS 4
+
+typedef struct {
+  size_t      offset;   /*!< Offset of the name plus 1, 0 if slot unused */
+  size_t      str_pos;  /*!< Position of the decoded name in strs */
+  size_t      str_len;  /*!< Length of the decoded name */
+  size_t      name_len; /*!< Length as counted against the name limit */
+  size_t      indir;    /*!< Pointers followed while decoding */
+  ares_bool_t is_hostname; /*!< Whether hostname validation was applied */
+} ares_dns_name_memo_entry_t;
+
+struct ares_dns_name_memo {
+  ares_dns_name_memo_entry_t *slots;
+  size_t                      size;
+  size_t                      cnt;
+  ares_buf_t                 *strs;
+};
+
+typedef struct {
+  size_t offset;
+  size_t str_pos;
+  size_t name_len;
+  size_t indir;
+} ares_dns_name_jump_t;
+
+void ares_dns_name_memo_destroy(ares_dns_name_memo_t *memo)
 {
-  size_t        save_offset = 0;
-  unsigned char c;
-  ares_status_t status;
-  ares_buf_t   *namebuf     = NULL;
-  size_t        label_start = ares_buf_get_position(buf);
-  size_t        name_len    = 0;
-  size_t        indir       = 0;
+  if (memo == NULL) {
+    return;
+  }
+  ares_free(memo->slots);
+  ares_buf_destroy(memo->strs);
+  ares_free(memo);
+}
+
+static ares_dns_name_memo_entry_t *
+  ares_dns_name_memo_slot(const ares_dns_name_memo_t *memo, size_t offset)
+{
+  size_t idx = offset & (memo->size - 1);
+
+  while (memo->slots[idx].offset != 0 &&
+         memo->slots[idx].offset != offset + 1) {
+    idx = (idx + 1) & (memo->size - 1);
+  }
+  return &memo->slots[idx];
+}
+
+static const ares_dns_name_memo_entry_t *
+  ares_dns_name_memo_get(const ares_dns_name_memo_t *memo, size_t offset,
+                         ares_bool_t is_hostname)
+{
+  const ares_dns_name_memo_entry_t *entry;
+
+  if (memo == NULL) {
+    return NULL;
+  }
+
+  entry = ares_dns_name_memo_slot(memo, offset);
+  if (entry->offset == 0) {
+    return NULL;
+  }
+
+  /* A name only validated as a hostname can be used for anything else, but
+   * not the other way around */
+  if (is_hostname && !entry->is_hostname) {
+    return NULL;
+  }
+  return entry;
+}
+
+static ares_status_t ares_dns_name_memo_grow(ares_dns_name_memo_t *memo)
+{
+  ares_dns_name_memo_entry_t *old      = memo->slots;
+  size_t                      old_size = memo->size;
+  size_t                      i;
+
+  memo->size  = (old_size == 0) ? ARES_DNS_NAME_MEMO_MIN_SIZE : old_size * 2;
+  memo->slots = ares_malloc_zero(sizeof(*memo->slots) * memo->size);
+  if (memo->slots == NULL) {
+    /* LCOV_EXCL_START: OutOfMemory */
+    memo->slots = old;
+    memo->size  = old_size;
+    return ARES_ENOMEM;
+    /* LCOV_EXCL_STOP */
+  }
+
+  for (i = 0; i < old_size; i++) {
+    if (old[i].offset != 0) {
+      *ares_dns_name_memo_slot(memo, old[i].offset - 1) = old[i];
+    }
+  }
+  ares_free(old);
+  return ARES_SUCCESS;
+}
+
+static ares_status_t
+  ares_dns_name_memo_add(ares_dns_name_memo_t **memo, size_t offset,
+                         const unsigned char *str, size_t str_len,
+                         size_t name_len, size_t indir, ares_bool_t is_hostname)
+{
+  ares_dns_name_memo_entry_t *entry;
+  ares_status_t               status;
+
+  if (*memo == NULL) {
+    *memo = ares_malloc_zero(sizeof(**memo));
+    if (*memo == NULL) {
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  if ((*memo)->strs == NULL) {
+    (*memo)->strs = ares_buf_create();
+    if ((*memo)->strs == NULL) {
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  /* Keep at most half the slots in use */
+  if (((*memo)->cnt + 1) * 2 > (*memo)->size) {
+    if ((*memo)->cnt >= ARES_DNS_NAME_MEMO_MAX_CNT) {
+      return ARES_SUCCESS;
+    }
+    status = ares_dns_name_memo_grow(*memo);
+    if (status != ARES_SUCCESS) {
+      return status; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  entry = ares_dns_name_memo_slot(*memo, offset);
+  if (entry->offset != 0) {
+    /* Already known, only upgrade it to having been validated as a hostname
+     * as the decoded name itself is the same */
+    if (is_hostname) {
+      entry->is_hostname = ARES_TRUE;
+    }
+    return ARES_SUCCESS;
+  }
+
+  entry->str_pos = ares_buf_len((*memo)->strs);
+  if (str_len != 0) {
+    status = ares_buf_append((*memo)->strs, str, str_len);
+    if (status != ARES_SUCCESS) {
+      return status; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  entry->offset      = offset + 1;
+  entry->str_len     = str_len;
+  entry->name_len    = name_len;
+  entry->indir       = indir;
+  entry->is_hostname = is_hostname;
+  (*memo)->cnt++;
+  return ARES_SUCCESS;
+}
+
+/* Remember the names the pointers followed while decoding the name now in
+ * namebuf lead to */
+static ares_status_t
+  ares_dns_name_memo_save(ares_dns_name_memo_t     **memo,
+                          const ares_buf_t          *namebuf,
+                          const ares_dns_name_jump_t *jumps, size_t num_jumps,
+                          size_t name_len, size_t indir,
+                          ares_bool_t is_hostname)
+{
+  const unsigned char *str;
+  size_t               str_len = 0;
+  size_t               i;
+
+  str = ares_buf_peek(namebuf, &str_len);
+
+  for (i = 0; i < num_jumps; i++) {
+    const ares_dns_name_jump_t *jump    = &jumps[i];
+    size_t                      pos     = jump->str_pos;
+    size_t                      sub_len = name_len - jump->name_len;
+    ares_status_t               status;
+
+    /* Skip the separator added before the first label of the target */
+    if (sub_len != 0 && jump->name_len != 0) {
+      pos++;
+      sub_len--;
+    }
+
+    status = ares_dns_name_memo_add(memo, jump->offset,
+                                    (str_len > pos) ? str + pos : NULL,
+                                    str_len - pos, sub_len,
+                                    indir - jump->indir, is_hostname);
+    if (status != ARES_SUCCESS) {
+      return status; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  return ARES_SUCCESS;
+}
+
+/* namebuf may be NULL to only validate and skip the name */
+static ares_status_t ares_dns_name_parse_int(ares_buf_t            *buf,
+                                             ares_buf_t            *namebuf,
+                                             ares_dns_name_memo_t **memo,
+                                             ares_bool_t is_hostname,
+                                             ares_bool_t allow_compression)
+{
+  size_t               save_offset = 0;
+  unsigned char        c;
+  ares_status_t        status;
+  size_t               label_start = ares_buf_get_position(buf);
+  size_t               name_len    = 0;
+  size_t               indir       = 0;
+  ares_dns_name_jump_t jumps[ARES_DNS_NAME_MEMO_JUMPS];
+  size_t               num_jumps = 0;
 
   if (buf == NULL) {
     return ARES_EFORMERR;
   }
 
-  if (name != NULL) {
-    namebuf = ares_buf_create();
-    if (namebuf == NULL) {
-      status = ARES_ENOMEM;
-      goto fail;
-    }
+  /* Nothing to remember if only validating */
+  if (namebuf == NULL) {
+    memo = NULL;
   }
 
   /* The compression scheme allows a domain name in a message to be
@@ -665,6 +880,55 @@ ares_status_t ares_dns_name_parse(ares_buf_t *buf, char **name,
         save_offset = ares_buf_get_position(buf);
       }
 
+      if (memo != NULL) {
+        const ares_dns_name_memo_entry_t *entry =
+          ares_dns_name_memo_get(*memo, offset, is_hostname);
+
+        /* Already decoded, the same limits apply as if it was decoded again
+         * as part of this name */
+        if (entry != NULL) {
+          if (entry->name_len != 0) {
+            if (name_len) {
+              name_len++;
+            }
+            name_len += entry->name_len;
+          }
+          indir += entry->indir;
+          if (name_len > ARES_MAX_NAME_PRESENTATION_LEN ||
+              indir > ARES_MAX_INDIRS) {
+            status = ARES_EBADNAME;
+            goto fail;
+          }
+
+          if (entry->str_len != 0) {
+            size_t               strs_len = 0;
+            const unsigned char *strs =
+              ares_buf_peek((*memo)->strs, &strs_len);
+
+            if (ares_buf_len(namebuf) != 0) {
+              status = ares_buf_append_byte(namebuf, '.');
+              if (status != ARES_SUCCESS) {
+                goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+              }
+            }
+            status =
+              ares_buf_append(namebuf, strs + entry->str_pos, entry->str_len);
+            if (status != ARES_SUCCESS) {
+              goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+            }
+          }
+          break;
+        }
+
+        if (num_jumps < ARES_DNS_NAME_MEMO_JUMPS) {
+          jumps[num_jumps].offset   = offset;
+          jumps[num_jumps].str_pos  = ares_buf_len(namebuf);
+          jumps[num_jumps].name_len = name_len;
+          jumps[num_jumps].indir    = indir;
+          num_jumps++;
+        }
+      }
+
       status = ares_buf_set_position(buf, offset);
       if (status != ARES_SUCCESS) {
         status = ARES_EBADNAME;
@@ -698,7 +962,7 @@ ares_status_t ares_dns_name_parse(ares_buf_t *buf, char **name,
     }
 
     /* Labels are separated by periods */
-    if (ares_buf_len(namebuf) != 0 && name != NULL) {
+    if (ares_buf_len(namebuf) != 0 && namebuf != NULL) {
       status = ares_buf_append_byte(namebuf, '.');
       if (status != ARES_SUCCESS) {
         goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
@@ -711,28 +975,190 @@ ares_status_t ares_dns_name_parse(ares_buf_t *buf, char **name,
     }
   }
 
+  if (memo != NULL && num_jumps != 0) {
+    status = ares_dns_name_memo_save(memo, namebuf, jumps, num_jumps, name_len,
+                                     indir, is_hostname);
+    if (status != ARES_SUCCESS) {
+      goto fail; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
   /* Restore offset read after first redirect/pointer as this is where the DNS
    * message continues */
   if (save_offset) {
     ares_buf_set_position(buf, save_offset);
   }
 
+  return ARES_SUCCESS;
+
+fail:
+  /* We want badname response if we couldn't parse */
+  if (status == ARES_EBADRESP) {
+    status = ARES_EBADNAME;
+  }
+
+  return status;
+}
+
+ares_status_t ares_dns_name_parse(ares_buf_t *buf, char **name,
+                                  ares_bool_t is_hostname,
+                                  ares_bool_t allow_compression)
+{
+  ares_status_t status;
+  ares_buf_t   *namebuf = NULL;
+
+  if (name != NULL) {
+    namebuf = ares_buf_create();
+    if (namebuf == NULL) {
+      return ARES_ENOMEM;
+    }
+  }
+
+  status = ares_dns_name_parse_int(buf, namebuf, NULL, is_hostname,
+                                   allow_compression);
+  if (status != ARES_SUCCESS) {
+    ares_buf_destroy(namebuf);
+    return status;
+  }
+
   if (name != NULL) {
     *name = ares_buf_finish_str(namebuf, NULL);
     if (*name == NULL) {
-      status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
-      goto fail;            /* LCOV_EXCL_LINE: OutOfMemory */
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
     }
   }
 
   return ARES_SUCCESS;
+}
 
-fail:
-  /* We want badname response if we couldn't parse */
-  if (status == ARES_EBADRESP) {
-    status = ARES_EBADNAME;
+ares_status_t ares_dns_name_parse_into(ares_buf_t            *buf,
+                                       ares_buf_t            *namebuf,
+                                       ares_dns_name_memo_t **memo,
+                                       const char           **name,
+                                       ares_bool_t            is_hostname,
+                                       ares_bool_t allow_compression)
+{
+  ares_status_t status;
+  size_t        len;
+
+  if (namebuf == NULL || name == NULL) {
+    return ARES_EFORMERR;
   }
 
-  ares_buf_destroy(namebuf);
-  return status;
+  ares_buf_consume(namebuf, ares_buf_len(namebuf));
+
+  status = ares_dns_name_parse_int(buf, namebuf, memo, is_hostname,
+                                   allow_compression);
+  if (status != ARES_SUCCESS) {
+    return status;
+  }
+
+  /* NULL terminate without counting it in the length */
+  status = ares_buf_append_byte(namebuf, 0);
+  if (status != ARES_SUCCESS) {
+    return status; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+  *name = (const char *)ares_buf_peek(namebuf, &len);
+  ares_buf_set_length(namebuf, len - 1);
+  return ARES_SUCCESS;
+}
+
+ares_status_t ares_dns_name_skip(ares_buf_t *buf)
+{
+  unsigned char c;
+  size_t        name_len = 0;
+
+  if (buf == NULL) {
+    return ARES_EFORMERR;
+  }
+
+  while (1) {
+    if (ares_buf_fetch_bytes(buf, &c, 1) != ARES_SUCCESS) {
+      return ARES_EBADNAME;
+    }
+
+    /* A pointer always ends the name, its target is checked once decoded */
+    if ((c & 0xc0) == 0xc0) {
+      if (ares_buf_consume(buf, 1) != ARES_SUCCESS) {
+        return ARES_EBADNAME;
+      }
+      return ARES_SUCCESS;
+    }
+
+    /* 10 and 01 are reserved */
+    if ((c & 0xc0) != 0) {
+      return ARES_EBADNAME;
+    }
+
+    if (c == 0) {
+      return ARES_SUCCESS;
+    }
+
+    name_len += (size_t)c + 1;
+    if (name_len > 255 || ares_buf_consume(buf, c) != ARES_SUCCESS) {
+      return ARES_EBADNAME;
+    }
+  }
+}
+
+ares_bool_t ares_dns_name_isvalid_raw(const unsigned char *msg, size_t msg_len,
+                                      size_t *pos)
+{
+  size_t      idx         = *pos;
+  size_t      label_start = *pos;
+  size_t      save_offset = 0;
+  size_t      name_len    = 0;
+  size_t      indir       = 0;
+  ares_bool_t jumped      = ARES_FALSE;
+
+  /* Same rules as ares_dns_name_parse_int() with compression allowed */
+  while (1) {
+    unsigned char c;
+
+    if (label_start > idx) {
+      label_start = idx;
+    }
+
+    if (idx >= msg_len) {
+      return ARES_FALSE;
+    }
+    c = msg[idx++];
+
+    if ((c & 0xc0) == 0xc0) {
+      size_t offset;
+
+      if (idx >= msg_len) {
+        return ARES_FALSE;
+      }
+      offset = ((size_t)(c & 0x3F) << 8) | (size_t)msg[idx++];
+
+      indir++;
+      if (offset >= label_start || indir > ARES_MAX_INDIRS) {
+        return ARES_FALSE;
+      }
+
+      if (!jumped) {
+        save_offset = idx;
+        jumped      = ARES_TRUE;
+      }
+      idx = offset;
+      continue;
+    } else if ((c & 0xc0) != 0) {
+      return ARES_FALSE;
+    } else if (c == 0) {
+      break;
+    }
+
+    if (name_len) {
+      name_len++;
+    }
+    name_len += c;
+    if (name_len > ARES_MAX_NAME_PRESENTATION_LEN || msg_len - idx < c) {
+      return ARES_FALSE;
+    }
+    idx += c;
+  }
+
+  *pos = jumped ? save_offset : idx;
+  return ARES_TRUE;
 }
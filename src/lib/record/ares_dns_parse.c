@@ -39,13 +39,41 @@ static size_t ares_dns_rr_remaining_len(const ares_buf_t *buf, size_t orig_len,
   return rdlength - used_len;
 }
 
+/* Like ares_buf_fetch_bytes_dup(), but the memory is owned by the record so
+ * comes from its arena if it has one */
+static ares_status_t ares_dns_rr_fetch_bytes_dup(ares_buf_t    *buf,
+                                                 ares_dns_rr_t *rr, size_t len,
+                                                 ares_bool_t     null_term,
+                                                 unsigned char **bytes)
+{
+  size_t               remaining_len;
+  const unsigned char *ptr = ares_buf_peek(buf, &remaining_len);
+
+  if (len == 0 || remaining_len < len) {
+    return ARES_EBADRESP;
+  }
+
+  *bytes = ares_dns_record_malloc(rr->parent, null_term ? len + 1 : len);
+  if (*bytes == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  memcpy(*bytes, ptr, len);
+  if (null_term) {
+    (*bytes)[len] = 0;
+  }
+  return ares_buf_consume(buf, len);
+}
+
 static ares_status_t ares_dns_parse_and_set_dns_name(ares_buf_t    *buf,
                                                      ares_bool_t    is_hostname,
                                                      ares_dns_rr_t *rr,
                                                      ares_dns_rr_key_t key)
 {
-  ares_status_t status;
-  char         *name = NULL;
+  ares_status_t      status;
+  ares_dns_record_t *dnsrec = rr->parent;
+  const char        *tmp    = NULL;
+  char              *name   = NULL;
   /* Only RR types defined in RFC1035 may use name compression within their
    * RDATA (RFC3597).  Reject compression pointers for any other type (e.g.
    * SRV per RFC2782) to match the write-side policy and avoid following
@@ -53,14 +81,20 @@ static ares_status_t ares_dns_parse_and_set_dns_name(ares_buf_t    *buf,
   ares_bool_t   allow_compression =
     ares_dns_rec_allow_name_comp(ares_dns_rr_get_type(rr));
 
-  status = ares_dns_name_parse(buf, &name, is_hostname, allow_compression);
+  status = ares_dns_name_parse_into(buf, dnsrec->namebuf, &dnsrec->namememo,
+                                    &tmp, is_hostname, allow_compression);
   if (status != ARES_SUCCESS) {
     return status;
   }
 
+  name = ares_dns_record_strdup(dnsrec, tmp);
+  if (name == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
   status = ares_dns_rr_set_str_own(rr, key, name);
   if (status != ARES_SUCCESS) {
-    ares_free(name);
+    ares_dns_record_free_data(dnsrec, name);
     return status;
   }
   return ARES_SUCCESS;
@@ -72,22 +106,41 @@ static ares_status_t ares_dns_parse_and_set_dns_str(ares_buf_t       *buf,
                                                     ares_dns_rr_key_t key,
                                                     ares_bool_t blank_allowed)
 {
-  ares_status_t status;
-  char         *str = NULL;
+  ares_status_t        status;
+  const unsigned char *ptr;
+  size_t               len;
+  char                *str = NULL;
 
-  status = ares_buf_parse_dns_str(buf, max_len, &str);
+  /* Validate and skip the string, then copy it straight out of the message
+   * rather than through an intermediate buffer */
+  ares_buf_tag(buf);
+  status = ares_buf_parse_dns_str(buf, max_len, NULL);
   if (status != ARES_SUCCESS) {
     return status;
   }
 
-  if (!blank_allowed && ares_strlen(str) == 0) {
-    ares_free(str);
+  /* Tagged data includes the length octet */
+  ptr = ares_buf_tag_fetch(buf, &len);
+  if (ptr == NULL || len == 0) {
+    return ARES_EBADRESP; /* LCOV_EXCL_LINE: DefensiveCoding */
+  }
+  ptr++;
+  len--;
+
+  if (!blank_allowed && len == 0) {
     return ARES_EBADRESP;
   }
 
+  str = ares_dns_record_malloc(rr->parent, len + 1);
+  if (str == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+  memcpy(str, ptr, len);
+  str[len] = 0;
+
   status = ares_dns_rr_set_str_own(rr, key, str);
   if (status != ARES_SUCCESS) {
-    ares_free(str);
+    ares_dns_record_free_data(rr->parent, str);
     return status;
   }
   return ARES_SUCCESS;
@@ -101,8 +154,8 @@ static ares_status_t
   ares_status_t           status;
   ares_dns_multistring_t *strs = NULL;
 
-  status =
-    ares_dns_multistring_parse_buf(buf, max_len, &strs, validate_printable);
+  status = ares_dns_multistring_parse_buf(buf, rr->parent->arena, max_len,
+                                          &strs, validate_printable);
   if (status != ARES_SUCCESS) {
     return status;
   }
@@ -355,14 +408,14 @@ static ares_status_t ares_dns_parse_rr_sig(ares_buf_t *buf, ares_dns_rr_t *rr,
     return ARES_EBADRESP;
   }
 
-  status = ares_buf_fetch_bytes_dup(buf, len, ARES_FALSE, &data);
+  status = ares_dns_rr_fetch_bytes_dup(buf, rr, len, ARES_FALSE, &data);
   if (status != ARES_SUCCESS) {
     return status;
   }
 
   status = ares_dns_rr_set_bin_own(rr, ARES_RR_SIG_SIGNATURE, data, len);
   if (status != ARES_SUCCESS) {
-    ares_free(data);
+    ares_dns_record_free_data(rr->parent, data);
     return status;
   }
 
@@ -512,7 +565,7 @@ static ares_status_t ares_dns_parse_rr_opt(ares_buf_t *buf, ares_dns_rr_t *rr,
     }
 
     if (len) {
-      status = ares_buf_fetch_bytes_dup(buf, len, ARES_TRUE, &val);
+      status = ares_dns_rr_fetch_bytes_dup(buf, rr, len, ARES_TRUE, &val);
       if (status != ARES_SUCCESS) {
         return status;
       }
@@ -520,7 +573,7 @@ static ares_status_t ares_dns_parse_rr_opt(ares_buf_t *buf, ares_dns_rr_t *rr,
 
     status = ares_dns_rr_set_opt_own(rr, ARES_RR_OPT_OPTIONS, opt, val, len);
     if (status != ARES_SUCCESS) {
-      ares_free(val);
+      ares_dns_record_free_data(rr->parent, val);
       return status;
     }
   }
@@ -556,14 +609,14 @@ static ares_status_t ares_dns_parse_rr_ds(ares_buf_t *buf, ares_dns_rr_t *rr,
     return ARES_EBADRESP;
   }
 
-  status = ares_buf_fetch_bytes_dup(buf, len, ARES_FALSE, &data);
+  status = ares_dns_rr_fetch_bytes_dup(buf, rr, len, ARES_FALSE, &data);
   if (status != ARES_SUCCESS) {
     return status;
   }
 
   status = ares_dns_rr_set_bin_own(rr, ARES_RR_DS_DIGEST, data, len);
   if (status != ARES_SUCCESS) {
-    ares_free(data);
+    ares_dns_record_free_data(rr->parent, data);
     return status;
   }
 
@@ -593,14 +646,14 @@ static ares_status_t ares_dns_parse_rr_sshfp(ares_buf_t *buf, ares_dns_rr_t *rr,
     return ARES_EBADRESP;
   }
 
-  status = ares_buf_fetch_bytes_dup(buf, len, ARES_FALSE, &data);
+  status = ares_dns_rr_fetch_bytes_dup(buf, rr, len, ARES_FALSE, &data);
   if (status != ARES_SUCCESS) {
     return status;
   }
 
   status = ares_dns_rr_set_bin_own(rr, ARES_RR_SSHFP_FINGERPRINT, data, len);
   if (status != ARES_SUCCESS) {
-    ares_free(data);
+    ares_dns_record_free_data(rr->parent, data);
     return status;
   }
 
@@ -661,14 +714,14 @@ static ares_status_t ares_dns_parse_rr_rrsig(ares_buf_t *buf, ares_dns_rr_t *rr,
     return ARES_EBADRESP;
   }
 
-  status = ares_buf_fetch_bytes_dup(buf, len, ARES_FALSE, &data);
+  status = ares_dns_rr_fetch_bytes_dup(buf, rr, len, ARES_FALSE, &data);
   if (status != ARES_SUCCESS) {
     return status;
   }
 
   status = ares_dns_rr_set_bin_own(rr, ARES_RR_RRSIG_SIGNATURE, data, len);
   if (status != ARES_SUCCESS) {
-    ares_free(data);
+    ares_dns_record_free_data(rr->parent, data);
     return status;
   }
 
@@ -694,14 +747,14 @@ static ares_status_t ares_dns_parse_rr_nsec(ares_buf_t *buf, ares_dns_rr_t *rr,
     return ARES_EBADRESP;
   }
 
-  status = ares_buf_fetch_bytes_dup(buf, len, ARES_FALSE, &data);
+  status = ares_dns_rr_fetch_bytes_dup(buf, rr, len, ARES_FALSE, &data);
   if (status != ARES_SUCCESS) {
     return status;
   }
 
   status = ares_dns_rr_set_bin_own(rr, ARES_RR_NSEC_TYPE_BIT_MAPS, data, len);
   if (status != ARES_SUCCESS) {
-    ares_free(data);
+    ares_dns_record_free_data(rr->parent, data);
     return status;
   }
 
@@ -736,14 +789,14 @@ static ares_status_t
     return ARES_EBADRESP;
   }
 
-  status = ares_buf_fetch_bytes_dup(buf, len, ARES_FALSE, &data);
+  status = ares_dns_rr_fetch_bytes_dup(buf, rr, len, ARES_FALSE, &data);
   if (status != ARES_SUCCESS) {
     return status;
   }
 
   status = ares_dns_rr_set_bin_own(rr, ARES_RR_DNSKEY_PUBLIC_KEY, data, len);
   if (status != ARES_SUCCESS) {
-    ares_free(data);
+    ares_dns_record_free_data(rr->parent, data);
     return status;
   }
 
@@ -782,13 +835,14 @@ static ares_status_t ares_dns_parse_rr_nsec3(ares_buf_t *buf, ares_dns_rr_t *rr,
   }
 
   if (salt_length > 0) {
-    status = ares_buf_fetch_bytes_dup(buf, salt_length, ARES_FALSE, &data);
+    status =
+      ares_dns_rr_fetch_bytes_dup(buf, rr, salt_length, ARES_FALSE, &data);
     if (status != ARES_SUCCESS) {
       return status;
     }
     status = ares_dns_rr_set_bin_own(rr, ARES_RR_NSEC3_SALT, data, salt_length);
     if (status != ARES_SUCCESS) {
-      ares_free(data);
+      ares_dns_record_free_data(rr->parent, data);
       return status;
     }
   } else {
@@ -808,7 +862,7 @@ static ares_status_t ares_dns_parse_rr_nsec3(ares_buf_t *buf, ares_dns_rr_t *rr,
     return ARES_EBADRESP;
   }
 
-  status = ares_buf_fetch_bytes_dup(buf, hash_length, ARES_FALSE, &data);
+  status = ares_dns_rr_fetch_bytes_dup(buf, rr, hash_length, ARES_FALSE, &data);
   if (status != ARES_SUCCESS) {
     return status;
   }
@@ -816,21 +870,21 @@ static ares_status_t ares_dns_parse_rr_nsec3(ares_buf_t *buf, ares_dns_rr_t *rr,
   status = ares_dns_rr_set_bin_own(rr, ARES_RR_NSEC3_NEXT_HASHED_OWNER, data,
                                    hash_length);
   if (status != ARES_SUCCESS) {
-    ares_free(data);
+    ares_dns_record_free_data(rr->parent, data);
     return status;
   }
 
   /* Type Bit Maps (remaining) */
   len = ares_dns_rr_remaining_len(buf, orig_len, rdlength);
   if (len > 0) {
-    status = ares_buf_fetch_bytes_dup(buf, len, ARES_FALSE, &data);
+    status = ares_dns_rr_fetch_bytes_dup(buf, rr, len, ARES_FALSE, &data);
     if (status != ARES_SUCCESS) {
       return status;
     }
     status =
       ares_dns_rr_set_bin_own(rr, ARES_RR_NSEC3_TYPE_BIT_MAPS, data, len);
     if (status != ARES_SUCCESS) {
-      ares_free(data);
+      ares_dns_record_free_data(rr->parent, data);
       return status;
     }
   } else {
@@ -876,14 +930,15 @@ static ares_status_t ares_dns_parse_rr_nsec3param(ares_buf_t    *buf,
   }
 
   if (salt_length > 0) {
-    status = ares_buf_fetch_bytes_dup(buf, salt_length, ARES_FALSE, &data);
+    status =
+      ares_dns_rr_fetch_bytes_dup(buf, rr, salt_length, ARES_FALSE, &data);
     if (status != ARES_SUCCESS) {
       return status;
     }
     status =
       ares_dns_rr_set_bin_own(rr, ARES_RR_NSEC3PARAM_SALT, data, salt_length);
     if (status != ARES_SUCCESS) {
-      ares_free(data);
+      ares_dns_record_free_data(rr->parent, data);
       return status;
     }
   } else {
@@ -924,14 +979,14 @@ static ares_status_t ares_dns_parse_rr_tlsa(ares_buf_t *buf, ares_dns_rr_t *rr,
     return ARES_EBADRESP;
   }
 
-  status = ares_buf_fetch_bytes_dup(buf, len, ARES_FALSE, &data);
+  status = ares_dns_rr_fetch_bytes_dup(buf, rr, len, ARES_FALSE, &data);
   if (status != ARES_SUCCESS) {
     return status;
   }
 
   status = ares_dns_rr_set_bin_own(rr, ARES_RR_TLSA_DATA, data, len);
   if (status != ARES_SUCCESS) {
-    ares_free(data);
+    ares_dns_record_free_data(rr->parent, data);
     return status;
   }
 
@@ -974,7 +1029,7 @@ static ares_status_t ares_dns_parse_rr_svcb(ares_buf_t *buf, ares_dns_rr_t *rr,
     }
 
     if (len) {
-      status = ares_buf_fetch_bytes_dup(buf, len, ARES_TRUE, &val);
+      status = ares_dns_rr_fetch_bytes_dup(buf, rr, len, ARES_TRUE, &val);
       if (status != ARES_SUCCESS) {
         return status;
       }
@@ -982,7 +1037,7 @@ static ares_status_t ares_dns_parse_rr_svcb(ares_buf_t *buf, ares_dns_rr_t *rr,
 
     status = ares_dns_rr_set_opt_own(rr, ARES_RR_SVCB_PARAMS, opt, val, len);
     if (status != ARES_SUCCESS) {
-      ares_free(val);
+      ares_dns_record_free_data(rr->parent, val);
       return status;
     }
   }
@@ -1026,7 +1081,7 @@ static ares_status_t ares_dns_parse_rr_https(ares_buf_t *buf, ares_dns_rr_t *rr,
     }
 
     if (len) {
-      status = ares_buf_fetch_bytes_dup(buf, len, ARES_TRUE, &val);
+      status = ares_dns_rr_fetch_bytes_dup(buf, rr, len, ARES_TRUE, &val);
       if (status != ARES_SUCCESS) {
         return status;
       }
@@ -1034,7 +1089,7 @@ static ares_status_t ares_dns_parse_rr_https(ares_buf_t *buf, ares_dns_rr_t *rr,
 
     status = ares_dns_rr_set_opt_own(rr, ARES_RR_HTTPS_PARAMS, opt, val, len);
     if (status != ARES_SUCCESS) {
-      ares_free(val);
+      ares_dns_record_free_data(rr->parent, val);
       return status;
     }
   }
@@ -1116,14 +1171,14 @@ static ares_status_t ares_dns_parse_rr_caa(ares_buf_t *buf, ares_dns_rr_t *rr,
     status = ARES_EBADRESP;
     return status;
   }
-  status = ares_buf_fetch_bytes_dup(buf, data_len, ARES_TRUE, &data);
+  status = ares_dns_rr_fetch_bytes_dup(buf, rr, data_len, ARES_TRUE, &data);
   if (status != ARES_SUCCESS) {
     return status;
   }
 
   status = ares_dns_rr_set_bin_own(rr, ARES_RR_CAA_VALUE, data, data_len);
   if (status != ARES_SUCCESS) {
-    ares_free(data);
+    ares_dns_record_free_data(rr->parent, data);
     return status;
   }
   data = NULL;
@@ -1149,20 +1204,43 @@ static ares_status_t ares_dns_parse_rr_raw_rr(ares_buf_t    *buf,
     return ARES_SUCCESS;
   }
 
-  status = ares_buf_fetch_bytes_dup(buf, rdlength, ARES_FALSE, &bytes);
+  status = ares_dns_rr_fetch_bytes_dup(buf, rr, rdlength, ARES_FALSE, &bytes);
   if (status != ARES_SUCCESS) {
     return status;
   }
 
   status = ares_dns_rr_set_bin_own(rr, ARES_RR_RAW_RR_DATA, bytes, rdlength);
   if (status != ARES_SUCCESS) {
-    ares_free(bytes);
+    ares_dns_record_free_data(rr->parent, bytes);
     return status;
   }
 
   return ARES_SUCCESS;
 }
 
+/* Estimate the memory a parsed record needs so its arena rarely has to grow:
+ * the question and RR arrays, sized as ares_array does, plus enough for the
+ * decompressed names and data.  Counts are bounded by what could fit in the
+ * rest of the message so a bogus header can't ask for a huge arena. */
+static size_t ares_dns_parse_arena_size(size_t remaining_len, size_t qdcount,
+                                        size_t rrcount)
+{
+  const size_t min_rr_wire_len = 11;
+  size_t       max_cnt         = remaining_len / min_rr_wire_len + 1;
+
+  if (qdcount > max_cnt) {
+    qdcount = max_cnt;
+  }
+  if (rrcount > max_cnt) {
+    rrcount = max_cnt;
+  }
+
+  return sizeof(ares_dns_record_t) + 256 +
+         ares_round_up_pow2(qdcount + 4) * sizeof(ares_dns_qd_t) +
+         (ares_round_up_pow2(rrcount + 4) + 8) * sizeof(ares_dns_rr_t) +
+         remaining_len * 2;
+}
+
 static ares_status_t ares_dns_parse_header(ares_buf_t *buf, unsigned int flags,
                                            ares_dns_record_t **dnsrec,
                                            unsigned short     *qdcount,
@@ -1285,8 +1363,16 @@ static ares_status_t ares_dns_parse_header(ares_buf_t *buf, unsigned int flags,
     goto fail;
   }
 
-  status = ares_dns_record_create(dnsrec, id, dns_flags, opcode,
-                                  ARES_RCODE_NOERROR /* Temporary */);
+  if (flags & ARES_DNS_PARSE_ARENA) {
+    status = ares_dns_record_create_arena(
+      dnsrec,
+      ares_dns_parse_arena_size(ares_buf_len(buf), *qdcount,
+                                (size_t)*ancount + *nscount + *arcount),
+      id, dns_flags, opcode, ARES_RCODE_NOERROR /* Temporary */);
+  } else {
+    status = ares_dns_record_create(dnsrec, id, dns_flags, opcode,
+                                    ARES_RCODE_NOERROR /* Temporary */);
+  }
   if (status != ARES_SUCCESS) {
     goto fail;
   }
@@ -1370,10 +1456,56 @@ static ares_status_t
   return ARES_EFORMERR;
 }
 
+/* Parse the data of an rr and make sure exactly rdlength bytes of the
+ * buffer are used */
+static ares_status_t ares_dns_parse_rr_rdata(ares_buf_t *buf, size_t rdlength,
+                                             ares_dns_rr_t      *rr,
+                                             ares_dns_rec_type_t type,
+                                             unsigned short      raw_type,
+                                             unsigned short      raw_class,
+                                             unsigned int        raw_ttl)
+{
+  ares_status_t status;
+  size_t        remaining_len;
+  size_t        processed_len;
+
+  /* Pull into another buffer for safety */
+  if (rdlength > ares_buf_len(buf)) {
+    return ARES_EBADRESP;
+  }
+
+  /* Record the current remaining length in the buffer so we can tell how
+   * much was processed */
+  remaining_len = ares_buf_len(buf);
+
+  /* Fill in the data for the rr */
+  status = ares_dns_parse_rr_data(buf, rdlength, rr, type, raw_type,
+                                  raw_class, raw_ttl);
+  if (status != ARES_SUCCESS) {
+    return status;
+  }
+
+  /* Determine how many bytes were processed */
+  processed_len = remaining_len - ares_buf_len(buf);
+
+  /* If too many bytes were processed, error! */
+  if (processed_len > rdlength) {
+    return ARES_EBADRESP;
+  }
+
+  /* If too few bytes were processed, consume the unprocessed data for this
+   * record as the parser may not have wanted/needed to use it */
+  if (processed_len < rdlength) {
+    ares_buf_consume(buf, rdlength - processed_len);
+  }
+
+  return ARES_SUCCESS;
+}
+
 static ares_status_t ares_dns_parse_qd(ares_buf_t        *buf,
                                        ares_dns_record_t *dnsrec)
 {
-  char               *name = NULL;
+  const char         *name = NULL;
   unsigned short      u16;
   ares_status_t       status;
   ares_dns_rec_type_t type;
@@ -1395,7 +1527,8 @@ static ares_status_t ares_dns_parse_qd(ares_buf_t        *buf,
    */
 
   /* Name */
-  status = ares_dns_name_parse(buf, &name, ARES_FALSE, ARES_TRUE);
+  status = ares_dns_name_parse_into(buf, dnsrec->namebuf, &dnsrec->namememo,
+                                    &name, ARES_FALSE, ARES_TRUE);
   if (status != ARES_SUCCESS) {
     goto done;
   }
@@ -1421,7 +1554,6 @@ static ares_status_t ares_dns_parse_qd(ares_buf_t        *buf,
   }
 
 done:
-  ares_free(name);
   return status;
 }
 
@@ -1429,7 +1561,7 @@ static ares_status_t ares_dns_parse_rr(ares_buf_t *buf, unsigned int flags,
                                        ares_dns_section_t sect,
                                        ares_dns_record_t *dnsrec)
 {
-  char               *name = NULL;
+  const char         *name = NULL;
   unsigned short      u16;
   unsigned short      raw_type;
   ares_status_t       status;
@@ -1437,9 +1569,8 @@ static ares_status_t ares_dns_parse_rr(ares_buf_t *buf, unsigned int flags,
   ares_dns_class_t    qclass;
   unsigned int        ttl;
   size_t              rdlength;
-  ares_dns_rr_t      *rr            = NULL;
-  size_t              remaining_len = 0;
-  size_t              processed_len = 0;
+  ares_dns_rr_t      *rr     = NULL;
+  size_t              offset = ares_buf_get_position(buf);
   ares_bool_t         namecomp;
 
   /* All RRs have the same top level format shown below:
@@ -1465,8 +1596,14 @@ static ares_status_t ares_dns_parse_rr(ares_buf_t *buf, unsigned int flags,
    * +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
    */
 
-  /* Name */
-  status = ares_dns_name_parse(buf, &name, ARES_FALSE, ARES_TRUE);
+  /* Name, lazily parsed RRs only need to get past it for now */
+  if (dnsrec->lazybuf != NULL) {
+    status = ares_dns_name_skip(buf);
+  } else {
+    status = ares_dns_name_parse_into(buf, dnsrec->namebuf,
+                                      &dnsrec->namememo, &name, ARES_FALSE,
+                                      ARES_TRUE);
+  }
   if (status != ARES_SUCCESS) {
     goto done;
   }
@@ -1520,12 +1657,28 @@ static ares_status_t ares_dns_parse_rr(ares_buf_t *buf, unsigned int flags,
     type = ARES_REC_TYPE_RAW_RR;
   }
 
-  /* Pull into another buffer for safety */
   if (rdlength > ares_buf_len(buf)) {
     status = ARES_EBADRESP;
     goto done;
   }
 
+  /* Index the rr to be decoded on first access.  The OPT RR's TTL carries
+   * the upper bits of the rcode which is needed now, decoding it again later
+   * sets the same bits. */
+  if (dnsrec->lazybuf != NULL) {
+    if (type == ARES_REC_TYPE_OPT) {
+      dnsrec->raw_rcode |= (unsigned short)((ttl >> 20) & 0x0FF0);
+    }
+    status = ares_dns_record_rr_add_lazy(
+      dnsrec, sect, type, type == ARES_REC_TYPE_OPT ? ARES_CLASS_IN : qclass,
+      type == ARES_REC_TYPE_OPT ? 0 : ttl, offset);
+    if (status != ARES_SUCCESS) {
+      goto done;
+    }
+    status = ares_buf_consume(buf, rdlength);
+    goto done;
+  }
+
   /* Add the base rr */
   status =
     ares_dns_record_rr_add(&rr, dnsrec, sect, name, type,
@@ -1535,49 +1688,90 @@ static ares_status_t ares_dns_parse_rr(ares_buf_t *buf, unsigned int flags,
     goto done;
   }
 
-  /* Record the current remaining length in the buffer so we can tell how
-   * much was processed */
-  remaining_len = ares_buf_len(buf);
+  status = ares_dns_parse_rr_rdata(buf, rdlength, rr, type, raw_type,
+                                   (unsigned short)qclass, ttl);
 
-  /* Fill in the data for the rr */
-  status = ares_dns_parse_rr_data(buf, rdlength, rr, type, raw_type,
-                                  (unsigned short)qclass, ttl);
-  if (status != ARES_SUCCESS) {
-    goto done;
+done:
+  return status;
+}
+
+ares_status_t ares_dns_rr_decode(ares_dns_rr_t *rr)
+{
+  ares_dns_record_t *dnsrec;
+  ares_buf_t        *buf;
+  const char        *name = NULL;
+  unsigned short     raw_type;
+  unsigned short     raw_class;
+  unsigned short     rdlength;
+  unsigned int       ttl;
+  ares_status_t      status;
+
+  if (rr == NULL || rr->lazy_offset == 0) {
+    return ARES_SUCCESS;
   }
 
-  /* Determine how many bytes were processed */
-  processed_len = remaining_len - ares_buf_len(buf);
+  /* Don't retry, some data may have been added to the rr already */
+  if (rr->lazy_offset == ARES_DNS_RR_LAZY_FAILED) {
+    return ARES_EBADRESP;
+  }
 
-  /* If too many bytes were processed, error! */
-  if (processed_len > rdlength) {
-    status = ARES_EBADRESP;
+  dnsrec = rr->parent;
+  buf    = dnsrec->lazybuf;
+
+  if (dnsrec->namebuf == NULL) {
+    dnsrec->namebuf = ares_buf_create();
+    if (dnsrec->namebuf == NULL) {
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  status = ares_buf_set_position(buf, rr->lazy_offset);
+  if (status != ARES_SUCCESS) {
+    goto done; /* LCOV_EXCL_LINE: DefensiveCoding */
+  }
+
+  status = ares_dns_name_parse_into(buf, dnsrec->namebuf, &dnsrec->namememo,
+                                    &name, ARES_FALSE, ARES_TRUE);
+  if (status != ARES_SUCCESS) {
     goto done;
   }
 
-  /* If too few bytes were processed, consume the unprocessed data for this
-   * record as the parser may not have wanted/needed to use it */
-  if (processed_len < rdlength) {
-    ares_buf_consume(buf, rdlength - processed_len);
+  rr->name = ares_dns_record_intern_name(dnsrec, name);
+  if (rr->name == NULL) {
+    status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    goto done;            /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  /* The fixed fields were validated when the RR was indexed */
+  if (ares_buf_fetch_be16(buf, &raw_type) != ARES_SUCCESS ||
+      ares_buf_fetch_be16(buf, &raw_class) != ARES_SUCCESS ||
+      ares_buf_fetch_be32(buf, &ttl) != ARES_SUCCESS ||
+      ares_buf_fetch_be16(buf, &rdlength) != ARES_SUCCESS) {
+    status = ARES_EBADRESP; /* LCOV_EXCL_LINE: DefensiveCoding */
+    goto done;              /* LCOV_EXCL_LINE: DefensiveCoding */
   }
 
+  status = ares_dns_parse_rr_rdata(buf, rdlength, rr, rr->type, raw_type,
+                                   raw_class, ttl);
 
 done:
-  ares_free(name);
+  rr->lazy_offset = (status == ARES_SUCCESS) ? 0 : ARES_DNS_RR_LAZY_FAILED;
   return status;
 }
 
 static ares_status_t ares_dns_parse_buf(ares_buf_t *buf, unsigned int flags,
                                         ares_dns_record_t **dnsrec)
 {
-  ares_status_t  status;
-  size_t         total_rr_count;
-  const size_t   min_rr_wire_len = 11;
-  unsigned short qdcount;
-  unsigned short ancount;
-  unsigned short nscount;
-  unsigned short arcount;
-  unsigned short i;
+  ares_status_t        status;
+  size_t               total_rr_count;
+  const size_t         min_rr_wire_len = 11;
+  const unsigned char *msg;
+  size_t               msg_len = 0;
+  unsigned short       qdcount;
+  unsigned short       ancount;
+  unsigned short       nscount;
+  unsigned short       arcount;
+  unsigned short       i;
 
   if (buf == NULL || dnsrec == NULL) {
     return ARES_EFORMERR; /* LCOV_EXCL_LINE: DefensiveCoding */
@@ -1605,6 +1799,8 @@ static ares_status_t ares_dns_parse_buf(ares_buf_t *buf, unsigned int flags,
    * +---------------------+
    */
 
+  msg = ares_buf_peek(buf, &msg_len);
+
   /* Parse header */
   status = ares_dns_parse_header(buf, flags, dnsrec, &qdcount, &ancount,
                                  &nscount, &arcount);
@@ -1612,6 +1808,23 @@ static ares_status_t ares_dns_parse_buf(ares_buf_t *buf, unsigned int flags,
     goto fail;
   }
 
+  /* RRs are decoded from a copy of the message on first access */
+  if (flags & ARES_DNS_PARSE_LAZY) {
+    (*dnsrec)->lazybuf = ares_buf_create();
+    if ((*dnsrec)->lazybuf == NULL ||
+        ares_buf_append((*dnsrec)->lazybuf, msg, msg_len) != ARES_SUCCESS) {
+      status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+      goto fail;            /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  /* Names are decoded here before being copied into the record */
+  (*dnsrec)->namebuf = ares_buf_create();
+  if ((*dnsrec)->namebuf == NULL) {
+    status = ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    goto fail;            /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
   /* Must have questions */
   if (qdcount == 0) {
     status = ARES_EBADRESP;
@@ -1709,6 +1922,14 @@ static ares_status_t ares_dns_parse_buf(ares_buf_t *buf, unsigned int flags,
     (*dnsrec)->rcode = (ares_dns_rcode_t)(*dnsrec)->raw_rcode;
   }
 
+  /* Lazily decoded RRs still need it */
+  if ((*dnsrec)->lazybuf == NULL) {
+    ares_buf_destroy((*dnsrec)->namebuf);
+    (*dnsrec)->namebuf = NULL;
+    ares_dns_name_memo_destroy((*dnsrec)->namememo);
+    (*dnsrec)->namememo = NULL;
+  }
+
   return ARES_SUCCESS;
 
 fail:
@@ -82,6 +82,94 @@ ares_status_t
                                ares_dns_rec_type_t type, unsigned short id,
                                ares_dns_flags_t flags, size_t max_udp_size);
 
+/*! Create a DNS record whose memory, including the record itself, all comes
+ *  from a single arena released at once by ares_dns_record_destroy().  Data
+ *  later handed to the record that isn't in the arena is copied into it, and
+ *  replaced or removed data isn't reclaimed until the record is destroyed,
+ *  so this is meant for records that are mostly read, such as parsed
+ *  responses.
+ *
+ *  \param[out] dnsrec    DNS record object to create.
+ *  \param[in]  size_hint Expected size of all data in the record, used to
+ *                        size the arena.
+ *  \param[in]  id        DNS query id
+ *  \param[in]  flags     DNS flags, one or more ares_dns_flags_t
+ *  \param[in]  opcode    DNS opcode
+ *  \param[in]  rcode     DNS rcode
+ *  \return ARES_SUCCESS on success, otherwise an error code.
+ */
+ares_status_t ares_dns_record_create_arena(ares_dns_record_t **dnsrec,
+                                           size_t              size_hint,
+                                           unsigned short id,
+                                           unsigned short flags,
+                                           ares_dns_opcode_t opcode,
+                                           ares_dns_rcode_t  rcode);
+
+/*! Allocate memory to be owned by a DNS record, from its arena if it has one.
+ *  Release with ares_dns_record_free_data().
+ *
+ *  \param[in] dnsrec  Initialized DNS record object
+ *  \param[in] len     Length to allocate
+ *  \return pointer to memory, or NULL on out of memory
+ */
+void *ares_dns_record_malloc(ares_dns_record_t *dnsrec, size_t len);
+
+/*! Duplicate a string to be owned by a DNS record, see
+ *  ares_dns_record_malloc().
+ *
+ *  \param[in] dnsrec  Initialized DNS record object
+ *  \param[in] str     String to duplicate
+ *  \return duplicated string, or NULL on out of memory
+ */
+char *ares_dns_record_strdup(ares_dns_record_t *dnsrec, const char *str);
+
+/*! Release memory from ares_dns_record_malloc() or ares_dns_record_strdup().
+ *  Arena memory is only released with the record.
+ *
+ *  \param[in] dnsrec  Initialized DNS record object
+ *  \param[in] ptr     Pointer to release, may be NULL
+ */
+void ares_dns_record_free_data(ares_dns_record_t *dnsrec, void *ptr);
+
+/*! Get the copy of an owner name kept by the record, adding it if there isn't
+ *  one yet.  Owner names are shared by RRs and only released with the record.
+ *
+ *  \param[in] dnsrec  Initialized DNS record object
+ *  \param[in] name    Owner name
+ *  \return pointer to the record's copy of the name, or NULL on out of memory
+ */
+char *ares_dns_record_intern_name(ares_dns_record_t *dnsrec, const char *name);
+
+/*! Add a resource record whose owner name and data haven't been decoded yet.
+ *  They are read from the parsed message kept by the record the first time
+ *  the RR is retrieved, see ares_dns_rr_decode().
+ *
+ *  \param[in] dnsrec  Initialized DNS record object with a parsed message
+ *  \param[in] sect    Section to add the RR to
+ *  \param[in] type    Type the RR will be decoded as
+ *  \param[in] rclass  Class of the RR
+ *  \param[in] ttl     TTL of the RR
+ *  \param[in] offset  Offset of the start of the RR in the parsed message
+ *  \return ARES_SUCCESS on success, otherwise an error code.
+ */
+ares_status_t ares_dns_record_rr_add_lazy(ares_dns_record_t  *dnsrec,
+                                          ares_dns_section_t  sect,
+                                          ares_dns_rec_type_t type,
+                                          ares_dns_class_t    rclass,
+                                          unsigned int ttl, size_t offset);
+
+/*! Decode the owner name and data of a resource record added with
+ *  ares_dns_record_rr_add_lazy().  Does nothing if the RR is already decoded.
+ *  An RR that fails to decode is never retried.
+ *
+ *  \param[in] rr  Resource record to decode
+ *  \return ARES_SUCCESS on success, otherwise an error code.
+ */
+ares_status_t ares_dns_rr_decode(ares_dns_rr_t *rr);
+
+/*! ares_dns_rr_t lazy_offset of a lazily parsed RR that failed to decode */
+#define ARES_DNS_RR_LAZY_FAILED UINT_MAX
+
 /*! Convert the RCODE and ANCOUNT from a DNS query reply into a status code.
  *
  *  \param[in] rcode   The RCODE from the reply.
@@ -271,44 +359,80 @@ typedef struct {
   size_t         length; /*!< Length of raw RR data */
 } ares_dns_raw_rr_t;
 
-/*! DNS RR data structure */
+/*! DNS RR data structure.
+ *
+ *  Answers are mostly many small RRs, so the data of the few types larger than
+ *  the rest is allocated separately, along with the RR, to keep the union (and
+ *  every RR) small.  The owner name is shared with other RRs in the record,
+ *  see ares_dns_record_intern_name(). */
 struct ares_dns_rr {
   ares_dns_record_t  *parent;
   char               *name;
   ares_dns_rec_type_t type;
   ares_dns_class_t    rclass;
   unsigned int        ttl;
+  unsigned int        lazy_offset; /*!< Offset of the RR in the parent's
+                                    *   lazybuf while it is still undecoded,
+                                    *   otherwise 0 */
 
   union {
-    ares_dns_a_t          a;
-    ares_dns_ns_t         ns;
-    ares_dns_cname_t      cname;
-    ares_dns_soa_t        soa;
-    ares_dns_ptr_t        ptr;
-    ares_dns_hinfo_t      hinfo;
-    ares_dns_mx_t         mx;
-    ares_dns_txt_t        txt;
-    ares_dns_sig_t        sig;
-    ares_dns_rrsig_t      rrsig;
-    ares_dns_ds_t         ds;
-    ares_dns_sshfp_t      sshfp;
-    ares_dns_nsec_t       nsec;
-    ares_dns_dnskey_t     dnskey;
-    ares_dns_nsec3_t      nsec3;
-    ares_dns_nsec3param_t nsec3param;
-    ares_dns_aaaa_t       aaaa;
-    ares_dns_srv_t        srv;
-    ares_dns_naptr_t      naptr;
-    ares_dns_opt_t        opt;
-    ares_dns_tlsa_t       tlsa;
-    ares_dns_svcb_t       svcb;
-    ares_dns_svcb_t   https; /*!< https is a type of svcb, so this is right */
-    ares_dns_uri_t    uri;
-    ares_dns_caa_t    caa;
-    ares_dns_raw_rr_t raw_rr;
+    void                  *data; /*!< Data of a type stored out of line */
+    ares_dns_a_t           a;
+    ares_dns_ns_t          ns;
+    ares_dns_cname_t       cname;
+    ares_dns_soa_t        *soa;
+    ares_dns_ptr_t         ptr;
+    ares_dns_hinfo_t       hinfo;
+    ares_dns_mx_t          mx;
+    ares_dns_txt_t         txt;
+    ares_dns_sig_t        *sig;
+    ares_dns_rrsig_t      *rrsig;
+    ares_dns_ds_t          ds;
+    ares_dns_sshfp_t       sshfp;
+    ares_dns_nsec_t        nsec;
+    ares_dns_dnskey_t      dnskey;
+    ares_dns_nsec3_t      *nsec3;
+    ares_dns_nsec3param_t  nsec3param;
+    ares_dns_aaaa_t        aaaa;
+    ares_dns_srv_t         srv;
+    ares_dns_naptr_t      *naptr;
+    ares_dns_opt_t         opt;
+    ares_dns_tlsa_t        tlsa;
+    ares_dns_svcb_t        svcb;
+    ares_dns_svcb_t        https; /*!< https is a type of svcb */
+    ares_dns_uri_t         uri;
+    ares_dns_caa_t        *caa;
+    ares_dns_raw_rr_t      raw_rr;
   } r;
 };
 
+/*! Where the value of an RR key is stored */
+typedef struct {
+  ares_dns_datatype_t datatype;
+  unsigned short      offset;     /*!< Offset within the type's data */
+  unsigned short      len_offset; /*!< Offset of the length, BIN and BINP */
+} ares_dns_rr_field_t;
+
+/*! Layout of the data of an RR type, see ares_dns_mapping.c */
+typedef struct {
+  const ares_dns_rr_key_t   *keys;
+  const ares_dns_rr_field_t *fields; /*!< One per key, in the same order */
+  size_t                     cnt;
+  size_t                     size;        /*!< Size of the type's data */
+  ares_bool_t                out_of_line; /*!< Data is allocated on its own
+                                           *   and referenced from the
+                                           *   union */
+} ares_dns_rr_schema_t;
+
+const ares_dns_rr_schema_t *ares_dns_rr_get_schema(ares_dns_rec_type_t type);
+const ares_dns_rr_field_t  *
+  ares_dns_rr_schema_field(const ares_dns_rr_schema_t *schema,
+                           ares_dns_rr_key_t           key);
+
+/*! Names already decoded from a single DNS message, keyed by their offset,
+ *  so compression pointers to them don't need to be decoded again. */
+typedef struct ares_dns_name_memo ares_dns_name_memo_t;
+
 /*! DNS data structure */
 struct ares_dns_record {
   unsigned short    id;            /*!< DNS query id */
@@ -327,6 +451,23 @@ struct ares_dns_record {
   ares_array_t     *an;            /*!< Type is ares_dns_rr_t */
   ares_array_t     *ns;            /*!< Type is ares_dns_rr_t */
   ares_array_t     *ar;            /*!< Type is ares_dns_rr_t */
+  ares_array_t     *names;         /*!< Type is char *, owner names shared by
+                                    *   RRs */
+
+  ares_arena_t     *arena;         /*!< If set, all memory for this record,
+                                    *   including the record, comes from
+                                    *   here */
+  ares_buf_t       *namebuf;       /*!< Scratch buffer names are decoded into
+                                    *   while parsing */
+  ares_buf_t       *lazybuf;       /*!< Copy of the parsed message lazily
+                                    *   decoded RRs are read from */
+  unsigned int      lazy_counted;  /*!< Bitmask of sections, by
+                                    *   ares_dns_section_t, whose lazily
+                                    *   parsed RRs have all been decoded */
+
+  ares_dns_name_memo_t *namememo; /*!< Names compression pointers in the
+                                   *   parsed message lead to, lives as long
+                                   *   as namebuf */
 };
 
 #endif
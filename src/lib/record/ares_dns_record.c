@@ -40,6 +40,15 @@ static void ares_dns_qd_free_cb(void *arg)
   ares_free(qd->name);
 }
 
+static void ares_dns_name_free_cb(void *arg)
+{
+  char **name = arg;
+  if (name == NULL) {
+    return; /* LCOV_EXCL_LINE: DefensiveCoding */
+  }
+  ares_free(*name);
+}
+
 static void ares_dns_rr_free_cb(void *arg)
 {
   ares_dns_rr_t *rr = arg;
@@ -49,10 +58,12 @@ static void ares_dns_rr_free_cb(void *arg)
   ares_dns_rr_free(rr);
 }
 
-ares_status_t ares_dns_record_create(ares_dns_record_t **dnsrec,
-                                     unsigned short id, unsigned short flags,
-                                     ares_dns_opcode_t opcode,
-                                     ares_dns_rcode_t  rcode)
+static ares_status_t ares_dns_record_create_int(ares_dns_record_t **dnsrec,
+                                                ares_arena_t      *arena,
+                                                unsigned short     id,
+                                                unsigned short     flags,
+                                                ares_dns_opcode_t  opcode,
+                                                ares_dns_rcode_t   rcode)
 {
   if (dnsrec == NULL) {
     return ARES_EFORMERR;
@@ -65,7 +76,11 @@ ares_status_t ares_dns_record_create(ares_dns_record_t **dnsrec,
     return ARES_EFORMERR;
   }
 
-  *dnsrec = ares_malloc_zero(sizeof(**dnsrec));
+  if (arena != NULL) {
+    *dnsrec = ares_arena_alloc_zero(arena, sizeof(**dnsrec));
+  } else {
+    *dnsrec = ares_malloc_zero(sizeof(**dnsrec));
+  }
   if (*dnsrec == NULL) {
     return ARES_ENOMEM;
   }
@@ -74,13 +89,33 @@ ares_status_t ares_dns_record_create(ares_dns_record_t **dnsrec,
   (*dnsrec)->flags  = flags;
   (*dnsrec)->opcode = opcode;
   (*dnsrec)->rcode  = rcode;
-  (*dnsrec)->qd = ares_array_create(sizeof(ares_dns_qd_t), ares_dns_qd_free_cb);
-  (*dnsrec)->an = ares_array_create(sizeof(ares_dns_rr_t), ares_dns_rr_free_cb);
-  (*dnsrec)->ns = ares_array_create(sizeof(ares_dns_rr_t), ares_dns_rr_free_cb);
-  (*dnsrec)->ar = ares_array_create(sizeof(ares_dns_rr_t), ares_dns_rr_free_cb);
+  (*dnsrec)->arena  = arena;
+  if (arena != NULL) {
+    /* Everything members point to is in the arena, nothing to destruct */
+    (*dnsrec)->qd =
+      ares_array_create_arena(arena, sizeof(ares_dns_qd_t), NULL);
+    (*dnsrec)->an =
+      ares_array_create_arena(arena, sizeof(ares_dns_rr_t), NULL);
+    (*dnsrec)->ns =
+      ares_array_create_arena(arena, sizeof(ares_dns_rr_t), NULL);
+    (*dnsrec)->ar =
+      ares_array_create_arena(arena, sizeof(ares_dns_rr_t), NULL);
+    (*dnsrec)->names = ares_array_create_arena(arena, sizeof(char *), NULL);
+  } else {
+    (*dnsrec)->qd =
+      ares_array_create(sizeof(ares_dns_qd_t), ares_dns_qd_free_cb);
+    (*dnsrec)->an =
+      ares_array_create(sizeof(ares_dns_rr_t), ares_dns_rr_free_cb);
+    (*dnsrec)->ns =
+      ares_array_create(sizeof(ares_dns_rr_t), ares_dns_rr_free_cb);
+    (*dnsrec)->ar =
+      ares_array_create(sizeof(ares_dns_rr_t), ares_dns_rr_free_cb);
+    (*dnsrec)->names =
+      ares_array_create(sizeof(char *), ares_dns_name_free_cb);
+  }
 
   if ((*dnsrec)->qd == NULL || (*dnsrec)->an == NULL || (*dnsrec)->ns == NULL ||
-      (*dnsrec)->ar == NULL) {
+      (*dnsrec)->ar == NULL || (*dnsrec)->names == NULL) {
     ares_dns_record_destroy(*dnsrec);
     *dnsrec = NULL;
     return ARES_ENOMEM;
@@ -89,6 +124,133 @@ ares_status_t ares_dns_record_create(ares_dns_record_t **dnsrec,
   return ARES_SUCCESS;
 }
 
+ares_status_t ares_dns_record_create(ares_dns_record_t **dnsrec,
+                                     unsigned short id, unsigned short flags,
+                                     ares_dns_opcode_t opcode,
+                                     ares_dns_rcode_t  rcode)
+{
+  return ares_dns_record_create_int(dnsrec, NULL, id, flags, opcode, rcode);
+}
+
+ares_status_t ares_dns_record_create_arena(ares_dns_record_t **dnsrec,
+                                           size_t              size_hint,
+                                           unsigned short id,
+                                           unsigned short flags,
+                                           ares_dns_opcode_t opcode,
+                                           ares_dns_rcode_t  rcode)
+{
+  ares_arena_t *arena;
+  ares_status_t status;
+
+  if (dnsrec == NULL) {
+    return ARES_EFORMERR;
+  }
+
+  arena = ares_arena_create(size_hint);
+  if (arena == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  status = ares_dns_record_create_int(dnsrec, arena, id, flags, opcode, rcode);
+  if (status != ARES_SUCCESS) {
+    ares_arena_destroy(arena);
+  }
+  return status;
+}
+
+void *ares_dns_record_malloc(ares_dns_record_t *dnsrec, size_t len)
+{
+  if (dnsrec->arena != NULL) {
+    return ares_arena_alloc(dnsrec->arena, len);
+  }
+  return ares_malloc(len);
+}
+
+char *ares_dns_record_strdup(ares_dns_record_t *dnsrec, const char *str)
+{
+  if (dnsrec->arena != NULL) {
+    return ares_arena_strdup(dnsrec->arena, str);
+  }
+  return ares_strdup(str);
+}
+
+void ares_dns_record_free_data(ares_dns_record_t *dnsrec, void *ptr)
+{
+  if (dnsrec->arena != NULL) {
+    return;
+  }
+  ares_free(ptr);
+}
+
+/* Everything an arena record references must live in its arena, so data
+ * handed over that doesn't is copied in.  On failure, the caller still owns
+ * *val. */
+static ares_status_t ares_dns_rr_adopt(const ares_dns_rr_t *dns_rr,
+                                       void **val, size_t len)
+{
+  ares_arena_t *arena = dns_rr->parent->arena;
+  void         *copy;
+
+  if (arena == NULL || *val == NULL || ares_arena_owns(arena, *val)) {
+    return ARES_SUCCESS;
+  }
+
+  copy = ares_arena_memdup(arena, *val, len, ARES_TRUE);
+  if (copy == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  ares_free(*val);
+  *val = copy;
+  return ARES_SUCCESS;
+}
+
+/* RRs sharing an owner name are nearly always next to each other, so only the
+ * most recently added names are checked. */
+#define ARES_DNS_RECORD_INTERN_SCAN 8
+
+char *ares_dns_record_intern_name(ares_dns_record_t *dnsrec, const char *name)
+{
+  size_t cnt = ares_array_len(dnsrec->names);
+  size_t i;
+  char  *copy;
+
+  for (i = 0; i < cnt && i < ARES_DNS_RECORD_INTERN_SCAN; i++) {
+    char *const *existing = ares_array_at_const(dnsrec->names, cnt - i - 1);
+    if (ares_streq(*existing, name)) {
+      return *existing;
+    }
+  }
+
+  copy = ares_dns_record_strdup(dnsrec, name);
+  if (copy == NULL) {
+    return NULL; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  if (ares_array_insertdata_last(dnsrec->names, &copy) != ARES_SUCCESS) {
+    ares_dns_record_free_data(dnsrec, copy); /* LCOV_EXCL_LINE: OutOfMemory */
+    return NULL;                             /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+  return copy;
+}
+
+/* Allocate the data of types stored out of line, see struct ares_dns_rr */
+static ares_status_t ares_dns_rr_alloc_data(ares_dns_rr_t *rr)
+{
+  const ares_dns_rr_schema_t *schema = ares_dns_rr_get_schema(rr->type);
+
+  if (schema == NULL || !schema->out_of_line) {
+    return ARES_SUCCESS;
+  }
+
+  rr->r.data = ares_dns_record_malloc(rr->parent, schema->size);
+  if (rr->r.data == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+  memset(rr->r.data, 0, schema->size);
+  return ARES_SUCCESS;
+}
+
 unsigned short ares_dns_record_get_id(const ares_dns_record_t *dnsrec)
 {
   if (dnsrec == NULL) {
@@ -130,125 +292,57 @@ ares_dns_rcode_t ares_dns_record_get_rcode(const ares_dns_record_t *dnsrec)
   return dnsrec->rcode;
 }
 
-static void ares_dns_rr_free(ares_dns_rr_t *rr)
+/* The owner name belongs to the record's name pool, not the RR */
+static unsigned char *ares_dns_rr_data_base(ares_dns_rr_t              *rr,
+                                            const ares_dns_rr_schema_t *schema)
 {
-  ares_free(rr->name);
-
-  switch (rr->type) {
-    case ARES_REC_TYPE_A:
-    case ARES_REC_TYPE_AAAA:
-    case ARES_REC_TYPE_ANY:
-      /* Nothing to free */
-      break;
-
-    case ARES_REC_TYPE_NS:
-      ares_free(rr->r.ns.nsdname);
-      break;
-
-    case ARES_REC_TYPE_CNAME:
-      ares_free(rr->r.cname.cname);
-      break;
-
-    case ARES_REC_TYPE_SOA:
-      ares_free(rr->r.soa.mname);
-      ares_free(rr->r.soa.rname);
-      break;
-
-    case ARES_REC_TYPE_PTR:
-      ares_free(rr->r.ptr.dname);
-      break;
-
-    case ARES_REC_TYPE_HINFO:
-      ares_free(rr->r.hinfo.cpu);
-      ares_free(rr->r.hinfo.os);
-      break;
-
-    case ARES_REC_TYPE_MX:
-      ares_free(rr->r.mx.exchange);
-      break;
-
-    case ARES_REC_TYPE_TXT:
-      ares_dns_multistring_destroy(rr->r.txt.strs);
-      break;
-
-    case ARES_REC_TYPE_SIG:
-      ares_free(rr->r.sig.signers_name);
-      ares_free(rr->r.sig.signature);
-      break;
-
-    case ARES_REC_TYPE_SRV:
-      ares_free(rr->r.srv.target);
-      break;
-
-    case ARES_REC_TYPE_NAPTR:
-      ares_free(rr->r.naptr.flags);
-      ares_free(rr->r.naptr.services);
-      ares_free(rr->r.naptr.regexp);
-      ares_free(rr->r.naptr.replacement);
-      break;
-
-    case ARES_REC_TYPE_OPT:
-      ares_array_destroy(rr->r.opt.options);
-      break;
-
-    case ARES_REC_TYPE_DS:
-      ares_free(rr->r.ds.digest);
-      break;
-
-    case ARES_REC_TYPE_SSHFP:
-      ares_free(rr->r.sshfp.fingerprint);
-      break;
-
-    case ARES_REC_TYPE_RRSIG:
-      ares_free(rr->r.rrsig.signers_name);
-      ares_free(rr->r.rrsig.signature);
-      break;
-
-    case ARES_REC_TYPE_NSEC:
-      ares_free(rr->r.nsec.next_domain_name);
-      ares_free(rr->r.nsec.type_bit_maps);
-      break;
-
-    case ARES_REC_TYPE_DNSKEY:
-      ares_free(rr->r.dnskey.public_key);
-      break;
-
-    case ARES_REC_TYPE_NSEC3:
-      ares_free(rr->r.nsec3.salt);
-      ares_free(rr->r.nsec3.next_hashed_owner_name);
-      ares_free(rr->r.nsec3.type_bit_maps);
-      break;
-
-    case ARES_REC_TYPE_NSEC3PARAM:
-      ares_free(rr->r.nsec3param.salt);
-      break;
-
-    case ARES_REC_TYPE_TLSA:
-      ares_free(rr->r.tlsa.data);
-      break;
+  if (schema->out_of_line) {
+    return rr->r.data;
+  }
+  return (unsigned char *)&rr->r;
+}
 
-    case ARES_REC_TYPE_SVCB:
-      ares_free(rr->r.svcb.target);
-      ares_array_destroy(rr->r.svcb.params);
-      break;
+static void ares_dns_rr_free(ares_dns_rr_t *rr)
+{
+  const ares_dns_rr_schema_t *schema = ares_dns_rr_get_schema(rr->type);
+  unsigned char              *base;
+  size_t                      i;
 
-    case ARES_REC_TYPE_HTTPS:
-      ares_free(rr->r.https.target);
-      ares_array_destroy(rr->r.https.params);
-      break;
+  if (schema == NULL) {
+    return;
+  }
 
-    case ARES_REC_TYPE_URI:
-      ares_free(rr->r.uri.target);
-      break;
+  base = ares_dns_rr_data_base(rr, schema);
+  if (base == NULL) {
+    return;
+  }
 
-    case ARES_REC_TYPE_CAA:
-      ares_free(rr->r.caa.tag);
-      ares_free(rr->r.caa.value);
-      break;
+  for (i = 0; i < schema->cnt; i++) {
+    void *ptr = base + schema->fields[i].offset;
+
+    switch (schema->fields[i].datatype) {
+      case ARES_DATATYPE_NAME:
+      case ARES_DATATYPE_STR:
+        ares_free(*(char **)ptr);
+        break;
+      case ARES_DATATYPE_BIN:
+      case ARES_DATATYPE_BINP:
+        ares_free(*(unsigned char **)ptr);
+        break;
+      case ARES_DATATYPE_ABINP:
+        ares_dns_multistring_destroy(*(ares_dns_multistring_t **)ptr);
+        break;
+      case ARES_DATATYPE_OPT:
+        ares_array_destroy(*(ares_array_t **)ptr);
+        break;
+      default:
+        /* Nothing to free */
+        break;
+    }
+  }
 
-    case ARES_REC_TYPE_RAW_RR:
-      ares_free(rr->r.raw_rr.data);
-      break;
+  if (schema->out_of_line) {
+    ares_free(base);
   }
 }
 
@@ -258,6 +352,16 @@ void ares_dns_record_destroy(ares_dns_record_t *dnsrec)
     return;
   }
 
+  ares_buf_destroy(dnsrec->namebuf);
+  ares_dns_name_memo_destroy(dnsrec->namememo);
+  ares_buf_destroy(dnsrec->lazybuf);
+
+  /* The record itself is in the arena too */
+  if (dnsrec->arena != NULL) {
+    ares_arena_destroy(dnsrec->arena);
+    return;
+  }
+
   /* Free questions */
   ares_array_destroy(dnsrec->qd);
 
@@ -270,6 +374,9 @@ void ares_dns_record_destroy(ares_dns_record_t *dnsrec)
   /* Free additional */
   ares_array_destroy(dnsrec->ar);
 
+  /* Free owner names, after the RRs referencing them */
+  ares_array_destroy(dnsrec->names);
+
   ares_free(dnsrec);
 }
 
@@ -302,7 +409,7 @@ ares_status_t ares_dns_record_query_add(ares_dns_record_t  *dnsrec,
     return status;
   }
 
-  qd->name = ares_strdup(name);
+  qd->name = ares_dns_record_strdup(dnsrec, name);
   if (qd->name == NULL) {
     ares_array_remove_at(dnsrec->qd, idx);
     return ARES_ENOMEM;
@@ -325,13 +432,13 @@ ares_status_t ares_dns_record_query_set_name(ares_dns_record_t *dnsrec,
   qd = ares_array_at(dnsrec->qd, idx);
 
   orig_name = qd->name;
-  qd->name  = ares_strdup(name);
+  qd->name  = ares_dns_record_strdup(dnsrec, name);
   if (qd->name == NULL) {
     qd->name = orig_name; /* LCOV_EXCL_LINE: OutOfMemory */
     return ARES_ENOMEM;   /* LCOV_EXCL_LINE: OutOfMemory */
   }
 
-  ares_free(orig_name);
+  ares_dns_record_free_data(dnsrec, orig_name);
   return ARES_SUCCESS;
 }
 
@@ -378,23 +485,54 @@ ares_status_t ares_dns_record_query_get(const ares_dns_record_t *dnsrec,
   return ARES_SUCCESS;
 }
 
+/* Decode every lazily parsed RR in a section, dropping those that fail, so
+ * that each RR counted can also be retrieved */
+static void ares_dns_record_rr_decode_all(ares_dns_record_t *dnsrec,
+                                          ares_dns_section_t sect,
+                                          ares_array_t      *arr)
+{
+  size_t i;
+
+  if (dnsrec->lazybuf == NULL || dnsrec->lazy_counted & (1U << sect)) {
+    return;
+  }
+
+  for (i = ares_array_len(arr); i-- > 0;) {
+    ares_dns_rr_t *rr = ares_array_at(arr, i);
+
+    if (ares_dns_rr_decode(rr) != ARES_SUCCESS) {
+      ares_array_remove_at(arr, i);
+    }
+  }
+
+  dnsrec->lazy_counted |= 1U << sect;
+}
+
 size_t ares_dns_record_rr_cnt(const ares_dns_record_t *dnsrec,
                               ares_dns_section_t       sect)
 {
+  ares_dns_record_t *rec = (void *)((size_t)dnsrec);
+  ares_array_t      *arr = NULL;
+
   if (dnsrec == NULL || !ares_dns_section_isvalid(sect)) {
     return 0;
   }
 
   switch (sect) {
     case ARES_SECTION_ANSWER:
-      return ares_array_len(dnsrec->an);
+      arr = rec->an;
+      break;
     case ARES_SECTION_AUTHORITY:
-      return ares_array_len(dnsrec->ns);
+      arr = rec->ns;
+      break;
     case ARES_SECTION_ADDITIONAL:
-      return ares_array_len(dnsrec->ar);
+      arr = rec->ar;
+      break;
   }
 
-  return 0; /* LCOV_EXCL_LINE: DefensiveCoding */
+  ares_dns_record_rr_decode_all(rec, sect, arr);
+
+  return ares_array_len(arr);
 }
 
 ares_status_t ares_dns_record_rr_prealloc(ares_dns_record_t *dnsrec,
@@ -463,22 +601,69 @@ ares_status_t ares_dns_record_rr_add(ares_dns_rr_t    **rr_out,
     return status; /* LCOV_EXCL_LINE: OutOfMemory */
   }
 
-  rr->name = ares_strdup(name);
-  if (rr->name == NULL) {
-    ares_array_remove_at(arr, idx);
-    return ARES_ENOMEM;
-  }
-
   rr->parent = dnsrec;
   rr->type   = type;
   rr->rclass = rclass;
   rr->ttl    = ttl;
 
+  rr->name = ares_dns_record_intern_name(dnsrec, name);
+  if (rr->name == NULL || ares_dns_rr_alloc_data(rr) != ARES_SUCCESS) {
+    ares_array_remove_at(arr, idx);
+    return ARES_ENOMEM;
+  }
+
   *rr_out = rr;
 
   return ARES_SUCCESS;
 }
 
+ares_status_t ares_dns_record_rr_add_lazy(ares_dns_record_t  *dnsrec,
+                                          ares_dns_section_t  sect,
+                                          ares_dns_rec_type_t type,
+                                          ares_dns_class_t    rclass,
+                                          unsigned int ttl, size_t offset)
+{
+  ares_dns_rr_t *rr  = NULL;
+  ares_array_t  *arr = NULL;
+  ares_status_t  status;
+
+  if (dnsrec == NULL || dnsrec->lazybuf == NULL || offset == 0 ||
+      offset >= ARES_DNS_RR_LAZY_FAILED || !ares_dns_section_isvalid(sect) ||
+      !ares_dns_rec_type_isvalid(type, ARES_FALSE) ||
+      !ares_dns_class_isvalid(rclass, type, ARES_FALSE)) {
+    return ARES_EFORMERR;
+  }
+
+  switch (sect) {
+    case ARES_SECTION_ANSWER:
+      arr = dnsrec->an;
+      break;
+    case ARES_SECTION_AUTHORITY:
+      arr = dnsrec->ns;
+      break;
+    case ARES_SECTION_ADDITIONAL:
+      arr = dnsrec->ar;
+      break;
+  }
+
+  status = ares_array_insert_last((void **)&rr, arr);
+  if (status != ARES_SUCCESS) {
+    return status; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  rr->parent      = dnsrec;
+  rr->type        = type;
+  rr->rclass      = rclass;
+  rr->ttl         = ttl;
+  rr->lazy_offset = (unsigned int)offset;
+
+  status = ares_dns_rr_alloc_data(rr);
+  if (status != ARES_SUCCESS) {
+    ares_array_remove_last(arr); /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+  return status;
+}
+
 ares_status_t ares_dns_record_rr_del(ares_dns_record_t *dnsrec,
                                      ares_dns_section_t sect, size_t idx)
 {
@@ -506,7 +691,8 @@ ares_status_t ares_dns_record_rr_del(ares_dns_record_t *dnsrec,
 ares_dns_rr_t *ares_dns_record_rr_get(ares_dns_record_t *dnsrec,
                                       ares_dns_section_t sect, size_t idx)
 {
-  ares_array_t *arr = NULL;
+  ares_array_t  *arr = NULL;
+  ares_dns_rr_t *rr;
 
   if (dnsrec == NULL || !ares_dns_section_isvalid(sect)) {
     return NULL;
@@ -524,7 +710,15 @@ ares_dns_rr_t *ares_dns_record_rr_get(ares_dns_record_t *dnsrec,
       break;
   }
 
-  return ares_array_at(arr, idx);
+  rr = ares_array_at(arr, idx);
+
+  /* Lazily parsed RRs are decoded the first time they're handed out */
+  if (rr != NULL && rr->lazy_offset != 0 &&
+      ares_dns_rr_decode(rr) != ARES_SUCCESS) {
+    return NULL;
+  }
+
+  return rr;
 }
 
 const ares_dns_rr_t *
@@ -578,335 +772,34 @@ ares_status_t ares_dns_rr_set_ttl(ares_dns_rr_t *dns_rr, unsigned int ttl)
 static void *ares_dns_rr_data_ptr(ares_dns_rr_t *dns_rr, ares_dns_rr_key_t key,
                                   size_t **lenptr)
 {
-  if (dns_rr == NULL || dns_rr->type != ares_dns_rr_key_to_rec_type(key)) {
+  const ares_dns_rr_schema_t *schema;
+  const ares_dns_rr_field_t  *field;
+  unsigned char              *base;
+
+  if (dns_rr == NULL) {
     return NULL; /* LCOV_EXCL_LINE: DefensiveCoding */
   }
 
-  switch (key) {
-    case ARES_RR_A_ADDR:
-      return &dns_rr->r.a.addr;
-
-    case ARES_RR_NS_NSDNAME:
-      return &dns_rr->r.ns.nsdname;
-
-    case ARES_RR_CNAME_CNAME:
-      return &dns_rr->r.cname.cname;
-
-    case ARES_RR_SOA_MNAME:
-      return &dns_rr->r.soa.mname;
-
-    case ARES_RR_SOA_RNAME:
-      return &dns_rr->r.soa.rname;
-
-    case ARES_RR_SOA_SERIAL:
-      return &dns_rr->r.soa.serial;
-
-    case ARES_RR_SOA_REFRESH:
-      return &dns_rr->r.soa.refresh;
-
-    case ARES_RR_SOA_RETRY:
-      return &dns_rr->r.soa.retry;
-
-    case ARES_RR_SOA_EXPIRE:
-      return &dns_rr->r.soa.expire;
-
-    case ARES_RR_SOA_MINIMUM:
-      return &dns_rr->r.soa.minimum;
-
-    case ARES_RR_PTR_DNAME:
-      return &dns_rr->r.ptr.dname;
-
-    case ARES_RR_AAAA_ADDR:
-      return &dns_rr->r.aaaa.addr;
-
-    case ARES_RR_HINFO_CPU:
-      return &dns_rr->r.hinfo.cpu;
-
-    case ARES_RR_HINFO_OS:
-      return &dns_rr->r.hinfo.os;
-
-    case ARES_RR_MX_PREFERENCE:
-      return &dns_rr->r.mx.preference;
-
-    case ARES_RR_MX_EXCHANGE:
-      return &dns_rr->r.mx.exchange;
-
-    case ARES_RR_SIG_TYPE_COVERED:
-      return &dns_rr->r.sig.type_covered;
-
-    case ARES_RR_SIG_ALGORITHM:
-      return &dns_rr->r.sig.algorithm;
-
-    case ARES_RR_SIG_LABELS:
-      return &dns_rr->r.sig.labels;
-
-    case ARES_RR_SIG_ORIGINAL_TTL:
-      return &dns_rr->r.sig.original_ttl;
-
-    case ARES_RR_SIG_EXPIRATION:
-      return &dns_rr->r.sig.expiration;
-
-    case ARES_RR_SIG_INCEPTION:
-      return &dns_rr->r.sig.inception;
-
-    case ARES_RR_SIG_KEY_TAG:
-      return &dns_rr->r.sig.key_tag;
-
-    case ARES_RR_SIG_SIGNERS_NAME:
-      return &dns_rr->r.sig.signers_name;
-
-    case ARES_RR_SIG_SIGNATURE:
-      if (lenptr == NULL) {
-        return NULL;
-      }
-      *lenptr = &dns_rr->r.sig.signature_len;
-      return &dns_rr->r.sig.signature;
-
-    case ARES_RR_TXT_DATA:
-      return &dns_rr->r.txt.strs;
-
-    case ARES_RR_SRV_PRIORITY:
-      return &dns_rr->r.srv.priority;
-
-    case ARES_RR_SRV_WEIGHT:
-      return &dns_rr->r.srv.weight;
-
-    case ARES_RR_SRV_PORT:
-      return &dns_rr->r.srv.port;
-
-    case ARES_RR_SRV_TARGET:
-      return &dns_rr->r.srv.target;
-
-    case ARES_RR_NAPTR_ORDER:
-      return &dns_rr->r.naptr.order;
-
-    case ARES_RR_NAPTR_PREFERENCE:
-      return &dns_rr->r.naptr.preference;
-
-    case ARES_RR_NAPTR_FLAGS:
-      return &dns_rr->r.naptr.flags;
-
-    case ARES_RR_NAPTR_SERVICES:
-      return &dns_rr->r.naptr.services;
-
-    case ARES_RR_NAPTR_REGEXP:
-      return &dns_rr->r.naptr.regexp;
-
-    case ARES_RR_NAPTR_REPLACEMENT:
-      return &dns_rr->r.naptr.replacement;
-
-    case ARES_RR_OPT_UDP_SIZE:
-      return &dns_rr->r.opt.udp_size;
-
-    case ARES_RR_OPT_VERSION:
-      return &dns_rr->r.opt.version;
-
-    case ARES_RR_OPT_FLAGS:
-      return &dns_rr->r.opt.flags;
-
-    case ARES_RR_OPT_OPTIONS:
-      return &dns_rr->r.opt.options;
-
-    case ARES_RR_DS_KEY_TAG:
-      return &dns_rr->r.ds.key_tag;
-
-    case ARES_RR_DS_ALGORITHM:
-      return &dns_rr->r.ds.algorithm;
-
-    case ARES_RR_DS_DIGEST_TYPE:
-      return &dns_rr->r.ds.digest_type;
-
-    case ARES_RR_DS_DIGEST:
-      if (lenptr == NULL) {
-        return NULL;
-      }
-      *lenptr = &dns_rr->r.ds.digest_len;
-      return &dns_rr->r.ds.digest;
-
-    case ARES_RR_SSHFP_ALGORITHM:
-      return &dns_rr->r.sshfp.algorithm;
-
-    case ARES_RR_SSHFP_FP_TYPE:
-      return &dns_rr->r.sshfp.fp_type;
-
-    case ARES_RR_SSHFP_FINGERPRINT:
-      if (lenptr == NULL) {
-        return NULL;
-      }
-      *lenptr = &dns_rr->r.sshfp.fingerprint_len;
-      return &dns_rr->r.sshfp.fingerprint;
-
-    case ARES_RR_RRSIG_TYPE_COVERED:
-      return &dns_rr->r.rrsig.type_covered;
-
-    case ARES_RR_RRSIG_ALGORITHM:
-      return &dns_rr->r.rrsig.algorithm;
-
-    case ARES_RR_RRSIG_LABELS:
-      return &dns_rr->r.rrsig.labels;
-
-    case ARES_RR_RRSIG_ORIGINAL_TTL:
-      return &dns_rr->r.rrsig.original_ttl;
-
-    case ARES_RR_RRSIG_EXPIRATION:
-      return &dns_rr->r.rrsig.expiration;
-
-    case ARES_RR_RRSIG_INCEPTION:
-      return &dns_rr->r.rrsig.inception;
-
-    case ARES_RR_RRSIG_KEY_TAG:
-      return &dns_rr->r.rrsig.key_tag;
-
-    case ARES_RR_RRSIG_SIGNERS_NAME:
-      return &dns_rr->r.rrsig.signers_name;
-
-    case ARES_RR_RRSIG_SIGNATURE:
-      if (lenptr == NULL) {
-        return NULL;
-      }
-      *lenptr = &dns_rr->r.rrsig.signature_len;
-      return &dns_rr->r.rrsig.signature;
-
-    case ARES_RR_NSEC_NEXT_DOMAIN:
-      return &dns_rr->r.nsec.next_domain_name;
-
-    case ARES_RR_NSEC_TYPE_BIT_MAPS:
-      if (lenptr == NULL) {
-        return NULL;
-      }
-      *lenptr = &dns_rr->r.nsec.type_bit_maps_len;
-      return &dns_rr->r.nsec.type_bit_maps;
-
-    case ARES_RR_DNSKEY_FLAGS:
-      return &dns_rr->r.dnskey.flags;
-
-    case ARES_RR_DNSKEY_PROTOCOL:
-      return &dns_rr->r.dnskey.protocol;
-
-    case ARES_RR_DNSKEY_ALGORITHM:
-      return &dns_rr->r.dnskey.algorithm;
-
-    case ARES_RR_DNSKEY_PUBLIC_KEY:
-      if (lenptr == NULL) {
-        return NULL;
-      }
-      *lenptr = &dns_rr->r.dnskey.public_key_len;
-      return &dns_rr->r.dnskey.public_key;
-
-    case ARES_RR_NSEC3_HASH_ALGORITHM:
-      return &dns_rr->r.nsec3.hash_algorithm;
-
-    case ARES_RR_NSEC3_FLAGS:
-      return &dns_rr->r.nsec3.flags;
-
-    case ARES_RR_NSEC3_ITERATIONS:
-      return &dns_rr->r.nsec3.iterations;
-
-    case ARES_RR_NSEC3_SALT:
-      if (lenptr == NULL) {
-        return NULL;
-      }
-      *lenptr = &dns_rr->r.nsec3.salt_len;
-      return &dns_rr->r.nsec3.salt;
-
-    case ARES_RR_NSEC3_NEXT_HASHED_OWNER:
-      if (lenptr == NULL) {
-        return NULL;
-      }
-      *lenptr = &dns_rr->r.nsec3.next_hashed_owner_name_len;
-      return &dns_rr->r.nsec3.next_hashed_owner_name;
-
-    case ARES_RR_NSEC3_TYPE_BIT_MAPS:
-      if (lenptr == NULL) {
-        return NULL;
-      }
-      *lenptr = &dns_rr->r.nsec3.type_bit_maps_len;
-      return &dns_rr->r.nsec3.type_bit_maps;
-
-    case ARES_RR_NSEC3PARAM_HASH_ALGORITHM:
-      return &dns_rr->r.nsec3param.hash_algorithm;
-
-    case ARES_RR_NSEC3PARAM_FLAGS:
-      return &dns_rr->r.nsec3param.flags;
-
-    case ARES_RR_NSEC3PARAM_ITERATIONS:
-      return &dns_rr->r.nsec3param.iterations;
-
-    case ARES_RR_NSEC3PARAM_SALT:
-      if (lenptr == NULL) {
-        return NULL;
-      }
-      *lenptr = &dns_rr->r.nsec3param.salt_len;
-      return &dns_rr->r.nsec3param.salt;
-
-    case ARES_RR_TLSA_CERT_USAGE:
-      return &dns_rr->r.tlsa.cert_usage;
-
-    case ARES_RR_TLSA_SELECTOR:
-      return &dns_rr->r.tlsa.selector;
-
-    case ARES_RR_TLSA_MATCH:
-      return &dns_rr->r.tlsa.match;
-
-    case ARES_RR_TLSA_DATA:
-      if (lenptr == NULL) {
-        return NULL;
-      }
-      *lenptr = &dns_rr->r.tlsa.data_len;
-      return &dns_rr->r.tlsa.data;
-
-    case ARES_RR_SVCB_PRIORITY:
-      return &dns_rr->r.svcb.priority;
-
-    case ARES_RR_SVCB_TARGET:
-      return &dns_rr->r.svcb.target;
-
-    case ARES_RR_SVCB_PARAMS:
-      return &dns_rr->r.svcb.params;
-
-    case ARES_RR_HTTPS_PRIORITY:
-      return &dns_rr->r.https.priority;
-
-    case ARES_RR_HTTPS_TARGET:
-      return &dns_rr->r.https.target;
-
-    case ARES_RR_HTTPS_PARAMS:
-      return &dns_rr->r.https.params;
-
-    case ARES_RR_URI_PRIORITY:
-      return &dns_rr->r.uri.priority;
-
-    case ARES_RR_URI_WEIGHT:
-      return &dns_rr->r.uri.weight;
-
-    case ARES_RR_URI_TARGET:
-      return &dns_rr->r.uri.target;
-
-    case ARES_RR_CAA_CRITICAL:
-      return &dns_rr->r.caa.critical;
-
-    case ARES_RR_CAA_TAG:
-      return &dns_rr->r.caa.tag;
-
-    case ARES_RR_CAA_VALUE:
-      if (lenptr == NULL) {
-        return NULL;
-      }
-      *lenptr = &dns_rr->r.caa.value_len;
-      return &dns_rr->r.caa.value;
+  schema = ares_dns_rr_get_schema(dns_rr->type);
+  field  = ares_dns_rr_schema_field(schema, key);
+  if (field == NULL) {
+    return NULL; /* LCOV_EXCL_LINE: DefensiveCoding */
+  }
 
-    case ARES_RR_RAW_RR_TYPE:
-      return &dns_rr->r.raw_rr.type;
+  base = ares_dns_rr_data_base(dns_rr, schema);
+  if (base == NULL) {
+    return NULL; /* LCOV_EXCL_LINE: DefensiveCoding */
+  }
 
-    case ARES_RR_RAW_RR_DATA:
-      if (lenptr == NULL) {
-        return NULL;
-      }
-      *lenptr = &dns_rr->r.raw_rr.length;
-      return &dns_rr->r.raw_rr.data;
+  if (field->datatype == ARES_DATATYPE_BIN ||
+      field->datatype == ARES_DATATYPE_BINP) {
+    if (lenptr == NULL) {
+      return NULL;
+    }
+    *lenptr = (size_t *)((void *)(base + field->len_offset));
   }
 
-  return NULL;
+  return base + field->offset;
 }
 
 static const void *ares_dns_rr_data_ptr_const(const ares_dns_rr_t *dns_rr,
@@ -1006,18 +899,18 @@ unsigned int ares_dns_rr_get_u32(const ares_dns_rr_t *dns_rr,
 const unsigned char *ares_dns_rr_get_bin(const ares_dns_rr_t *dns_rr,
                                          ares_dns_rr_key_t key, size_t *len)
 {
-  unsigned char * const *bin     = NULL;
-  size_t const          *bin_len = NULL;
+  unsigned char * const *bin      = NULL;
+  size_t const          *bin_len  = NULL;
+  ares_dns_datatype_t    datatype = ares_dns_rr_key_datatype(key);
 
-  if ((ares_dns_rr_key_datatype(key) != ARES_DATATYPE_BIN &&
-       ares_dns_rr_key_datatype(key) != ARES_DATATYPE_BINP &&
-       ares_dns_rr_key_datatype(key) != ARES_DATATYPE_ABINP) ||
+  if ((datatype != ARES_DATATYPE_BIN && datatype != ARES_DATATYPE_BINP &&
+       datatype != ARES_DATATYPE_ABINP) ||
       len == NULL) {
     return NULL;
   }
 
   /* Array of strings, return concatenated version */
-  if (ares_dns_rr_key_datatype(key) == ARES_DATATYPE_ABINP) {
+  if (datatype == ARES_DATATYPE_ABINP) {
     ares_dns_multistring_t * const *strs =
       ares_dns_rr_data_ptr_const(dns_rr, key, NULL);
 
@@ -1095,6 +988,15 @@ ares_status_t ares_dns_rr_del_abin(ares_dns_rr_t *dns_rr, ares_dns_rr_key_t key,
   return ares_dns_multistring_del(*strs, idx);
 }
 
+static ares_dns_multistring_t *
+  ares_dns_rr_multistring_create(const ares_dns_rr_t *dns_rr)
+{
+  if (dns_rr->parent->arena != NULL) {
+    return ares_dns_multistring_create_arena(dns_rr->parent->arena);
+  }
+  return ares_dns_multistring_create();
+}
+
 ares_status_t ares_dns_rr_add_abin(ares_dns_rr_t *dns_rr, ares_dns_rr_key_t key,
                                    const unsigned char *val, size_t len)
 {
@@ -1106,7 +1008,7 @@ ares_status_t ares_dns_rr_add_abin(ares_dns_rr_t *dns_rr, ares_dns_rr_key_t key,
   unsigned char           *temp;
   ares_dns_multistring_t **strs;
 
-  if (ares_dns_rr_key_datatype(key) != ARES_DATATYPE_ABINP) {
+  if (datatype != ARES_DATATYPE_ABINP) {
     return ARES_EFORMERR;
   }
 
@@ -1125,13 +1027,13 @@ ares_status_t ares_dns_rr_add_abin(ares_dns_rr_t *dns_rr, ares_dns_rr_key_t key,
   }
 
   if (*strs == NULL) {
-    *strs = ares_dns_multistring_create();
+    *strs = ares_dns_rr_multistring_create(dns_rr);
     if (*strs == NULL) {
       return ARES_ENOMEM;
     }
   }
 
-  temp = ares_malloc(alloclen);
+  temp = ares_dns_record_malloc(dns_rr->parent, alloclen);
   if (temp == NULL) {
     return ARES_ENOMEM;
   }
@@ -1147,7 +1049,7 @@ ares_status_t ares_dns_rr_add_abin(ares_dns_rr_t *dns_rr, ares_dns_rr_key_t key,
 
   status = ares_dns_multistring_add_own(*strs, temp, len);
   if (status != ARES_SUCCESS) {
-    ares_free(temp);
+    ares_dns_record_free_data(dns_rr->parent, temp);
   }
 
   return status;
@@ -1156,10 +1058,10 @@ ares_status_t ares_dns_rr_add_abin(ares_dns_rr_t *dns_rr, ares_dns_rr_key_t key,
 const char *ares_dns_rr_get_str(const ares_dns_rr_t *dns_rr,
                                 ares_dns_rr_key_t    key)
 {
-  char * const *str;
+  char * const       *str;
+  ares_dns_datatype_t datatype = ares_dns_rr_key_datatype(key);
 
-  if (ares_dns_rr_key_datatype(key) != ARES_DATATYPE_STR &&
-      ares_dns_rr_key_datatype(key) != ARES_DATATYPE_NAME) {
+  if (datatype != ARES_DATATYPE_STR && datatype != ARES_DATATYPE_NAME) {
     return NULL;
   }
 
@@ -1370,23 +1272,24 @@ ares_status_t ares_dns_rr_set_bin_own(ares_dns_rr_t    *dns_rr,
                                       ares_dns_rr_key_t key, unsigned char *val,
                                       size_t len)
 {
-  unsigned char **bin;
-  size_t         *bin_len = NULL;
+  unsigned char     **bin;
+  size_t             *bin_len  = NULL;
+  ares_dns_datatype_t datatype = ares_dns_rr_key_datatype(key);
+  ares_status_t       status;
 
-  if (ares_dns_rr_key_datatype(key) != ARES_DATATYPE_BIN &&
-      ares_dns_rr_key_datatype(key) != ARES_DATATYPE_BINP &&
-      ares_dns_rr_key_datatype(key) != ARES_DATATYPE_ABINP) {
+  if (datatype != ARES_DATATYPE_BIN && datatype != ARES_DATATYPE_BINP &&
+      datatype != ARES_DATATYPE_ABINP) {
     return ARES_EFORMERR;
   }
 
-  if (ares_dns_rr_key_datatype(key) == ARES_DATATYPE_ABINP) {
+  if (datatype == ARES_DATATYPE_ABINP) {
     ares_dns_multistring_t **strs = ares_dns_rr_data_ptr(dns_rr, key, NULL);
     if (strs == NULL) {
       return ARES_EFORMERR;
     }
 
     if (*strs == NULL) {
-      *strs = ares_dns_multistring_create();
+      *strs = ares_dns_rr_multistring_create(dns_rr);
       if (*strs == NULL) {
         return ARES_ENOMEM;
       }
@@ -1403,8 +1306,13 @@ ares_status_t ares_dns_rr_set_bin_own(ares_dns_rr_t    *dns_rr,
     return ARES_EFORMERR;
   }
 
+  status = ares_dns_rr_adopt(dns_rr, (void **)&val, len);
+  if (status != ARES_SUCCESS) {
+    return status; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
   if (*bin) {
-    ares_free(*bin);
+    ares_dns_record_free_data(dns_rr->parent, *bin);
   }
   *bin     = val;
   *bin_len = len;
@@ -1438,7 +1346,11 @@ ares_status_t ares_dns_rr_set_bin(ares_dns_rr_t *dns_rr, ares_dns_rr_key_t key,
   }
   alloclen = is_nullterm ? len + 1 : len;
 
-  temp = ares_malloc(alloclen);
+  if (dns_rr == NULL) {
+    return ARES_EFORMERR;
+  }
+
+  temp = ares_dns_record_malloc(dns_rr->parent, alloclen);
 
   if (temp == NULL) {
     return ARES_ENOMEM;
@@ -1455,7 +1367,7 @@ ares_status_t ares_dns_rr_set_bin(ares_dns_rr_t *dns_rr, ares_dns_rr_key_t key,
 
   status = ares_dns_rr_set_bin_own(dns_rr, key, temp, len);
   if (status != ARES_SUCCESS) {
-    ares_free(temp);
+    ares_dns_record_free_data(dns_rr->parent, temp);
   }
 
   return status;
@@ -1464,10 +1376,11 @@ ares_status_t ares_dns_rr_set_bin(ares_dns_rr_t *dns_rr, ares_dns_rr_key_t key,
 ares_status_t ares_dns_rr_set_str_own(ares_dns_rr_t    *dns_rr,
                                       ares_dns_rr_key_t key, char *val)
 {
-  char **str;
+  char              **str;
+  ares_dns_datatype_t datatype = ares_dns_rr_key_datatype(key);
+  ares_status_t       status;
 
-  if (ares_dns_rr_key_datatype(key) != ARES_DATATYPE_STR &&
-      ares_dns_rr_key_datatype(key) != ARES_DATATYPE_NAME) {
+  if (datatype != ARES_DATATYPE_STR && datatype != ARES_DATATYPE_NAME) {
     return ARES_EFORMERR;
   }
 
@@ -1476,8 +1389,13 @@ ares_status_t ares_dns_rr_set_str_own(ares_dns_rr_t    *dns_rr,
     return ARES_EFORMERR;
   }
 
+  status = ares_dns_rr_adopt(dns_rr, (void **)&val, ares_strlen(val));
+  if (status != ARES_SUCCESS) {
+    return status; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
   if (*str) {
-    ares_free(*str);
+    ares_dns_record_free_data(dns_rr->parent, *str);
   }
   *str = val;
 
@@ -1490,8 +1408,12 @@ ares_status_t ares_dns_rr_set_str(ares_dns_rr_t *dns_rr, ares_dns_rr_key_t key,
   ares_status_t status;
   char         *temp = NULL;
 
+  if (dns_rr == NULL) {
+    return ARES_EFORMERR;
+  }
+
   if (val != NULL) {
-    temp = ares_strdup(val);
+    temp = ares_dns_record_strdup(dns_rr->parent, val);
     if (temp == NULL) {
       return ARES_ENOMEM;
     }
@@ -1499,12 +1421,40 @@ ares_status_t ares_dns_rr_set_str(ares_dns_rr_t *dns_rr, ares_dns_rr_key_t key,
 
   status = ares_dns_rr_set_str_own(dns_rr, key, temp);
   if (status != ARES_SUCCESS) {
-    ares_free(temp);
+    ares_dns_record_free_data(dns_rr->parent, temp);
   }
 
   return status;
 }
 
+/* Copy a heap multistring into the record's arena, see ares_dns_rr_adopt() */
+static ares_status_t ares_dns_rr_adopt_abin(const ares_dns_rr_t     *dns_rr,
+                                            ares_dns_multistring_t **strs)
+{
+  ares_dns_multistring_t *copy;
+  size_t                  i;
+
+  copy = ares_dns_multistring_create_arena(dns_rr->parent->arena);
+  if (copy == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  for (i = 0; i < ares_dns_multistring_cnt(*strs); i++) {
+    size_t               len;
+    const unsigned char *str = ares_dns_multistring_get(*strs, i, &len);
+    unsigned char       *dup =
+      ares_arena_memdup(dns_rr->parent->arena, str, len, ARES_TRUE);
+    if (dup == NULL ||
+        ares_dns_multistring_add_own(copy, dup, len) != ARES_SUCCESS) {
+      return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  ares_dns_multistring_destroy(*strs);
+  *strs = copy;
+  return ARES_SUCCESS;
+}
+
 ares_status_t ares_dns_rr_set_abin_own(ares_dns_rr_t          *dns_rr,
                                        ares_dns_rr_key_t       key,
                                        ares_dns_multistring_t *strs)
@@ -1520,6 +1470,14 @@ ares_status_t ares_dns_rr_set_abin_own(ares_dns_rr_t          *dns_rr,
     return ARES_EFORMERR;
   }
 
+  if (strs != NULL && dns_rr->parent->arena != NULL &&
+      !ares_arena_owns(dns_rr->parent->arena, strs)) {
+    ares_status_t status = ares_dns_rr_adopt_abin(dns_rr, &strs);
+    if (status != ARES_SUCCESS) {
+      return status; /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
   if (*strs_ptr != NULL) {
     ares_dns_multistring_destroy(*strs_ptr);
   }
@@ -1542,7 +1500,8 @@ ares_status_t ares_dns_rr_set_opt_own(ares_dns_rr_t    *dns_rr,
                                       unsigned char *val, size_t val_len)
 {
   ares_array_t     **options;
-  ares_dns_optval_t *optptr = NULL;
+  ares_dns_optval_t *optptr   = NULL;
+  ares_bool_t        inserted = ARES_FALSE;
   size_t             idx;
   size_t             cnt;
   ares_status_t      status;
@@ -1556,7 +1515,10 @@ ares_status_t ares_dns_rr_set_opt_own(ares_dns_rr_t    *dns_rr,
     return ARES_EFORMERR;
   }
 
-  if (*options == NULL) {
+  if (*options == NULL && dns_rr->parent->arena != NULL) {
+    *options = ares_array_create_arena(dns_rr->parent->arena,
+                                       sizeof(ares_dns_optval_t), NULL);
+  } else if (*options == NULL) {
     *options =
       ares_array_create(sizeof(ares_dns_optval_t), ares_dns_opt_free_cb);
   }
@@ -1575,18 +1537,27 @@ ares_status_t ares_dns_rr_set_opt_own(ares_dns_rr_t    *dns_rr,
     }
   }
 
-  /* Duplicate entry, replace */
-  if (idx != cnt && optptr != NULL) {
-    goto done;
+  /* Not a duplicate entry to replace */
+  if (idx == cnt || optptr == NULL) {
+    status = ares_array_insert_last((void **)&optptr, *options);
+    if (status != ARES_SUCCESS) {
+      return status;
+    }
+    inserted = ARES_TRUE;
   }
 
-  status = ares_array_insert_last((void **)&optptr, *options);
+  /* Last as it may free val, which the caller still owns on failure */
+  status = ares_dns_rr_adopt(dns_rr, (void **)&val, val_len);
   if (status != ARES_SUCCESS) {
+    /* LCOV_EXCL_START: OutOfMemory */
+    if (inserted) {
+      ares_array_remove_last(*options);
+    }
     return status;
+    /* LCOV_EXCL_STOP */
   }
 
-done:
-  ares_free(optptr->val);
+  ares_dns_record_free_data(dns_rr->parent, optptr->val);
   optptr->opt     = opt;
   optptr->val     = val;
   optptr->val_len = val_len;
@@ -1609,7 +1580,11 @@ ares_status_t ares_dns_rr_set_opt(ares_dns_rr_t *dns_rr, ares_dns_rr_key_t key,
     }
     alloclen = val_len + 1;
 
-    temp = ares_malloc(alloclen);
+    if (dns_rr == NULL) {
+      return ARES_EFORMERR;
+    }
+
+    temp = ares_dns_record_malloc(dns_rr->parent, alloclen);
     if (temp == NULL) {
       return ARES_ENOMEM;
     }
@@ -1622,8 +1597,8 @@ ares_status_t ares_dns_rr_set_opt(ares_dns_rr_t *dns_rr, ares_dns_rr_key_t key,
   }
 
   status = ares_dns_rr_set_opt_own(dns_rr, key, opt, temp, val_len);
-  if (status != ARES_SUCCESS) {
-    ares_free(temp);
+  if (status != ARES_SUCCESS && dns_rr != NULL) {
+    ares_dns_record_free_data(dns_rr->parent, temp);
   }
 
   return status;
@@ -859,22 +859,52 @@ ares_status_t ares_buf_fetch_bytes_into_buf(ares_buf_t *buf, ares_buf_t *dest,
   return ares_buf_consume(buf, len);
 }
 
+/* Whitespace classes of each byte, indexed by the byte value */
+#define ARES_BUF_WS_SPACE    0x1
+#define ARES_BUF_WS_LINEFEED 0x2
+
+static const unsigned char ares_buf_ws_table[256] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0,
+  ARES_BUF_WS_SPACE,    /* \t */
+  ARES_BUF_WS_LINEFEED, /* \n */
+  ARES_BUF_WS_SPACE,    /* \v */
+  ARES_BUF_WS_SPACE,    /* \f */
+  ARES_BUF_WS_SPACE,    /* \r */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  ARES_BUF_WS_SPACE /* ' ' */
+};
+
 static ares_bool_t ares_is_whitespace(unsigned char c,
                                       ares_bool_t   include_linefeed)
 {
-  switch (c) {
-    case '\r':
-    case '\t':
-    case ' ':
-    case '\v':
-    case '\f':
-      return ARES_TRUE;
-    case '\n':
-      return include_linefeed;
-    default:
-      break;
+  unsigned char mask = ARES_BUF_WS_SPACE;
+  if (include_linefeed) {
+    mask |= ARES_BUF_WS_LINEFEED;
+  }
+  return (ares_buf_ws_table[c] & mask) ? ARES_TRUE : ARES_FALSE;
+}
+
+/* Bitmap of the bytes in a charset, so testing whether a byte is a member
+ * doesn't depend on the size of the charset */
+typedef struct {
+  unsigned char bits[256 / 8];
+} ares_buf_charmap_t;
+
+static void ares_buf_charmap_init(ares_buf_charmap_t  *map,
+                                  const unsigned char *charset, size_t len)
+{
+  size_t i;
+
+  memset(map, 0, sizeof(*map));
+  for (i = 0; i < len; i++) {
+    map->bits[charset[i] >> 3] |= (unsigned char)(1 << (charset[i] & 7));
   }
-  return ARES_FALSE;
+}
+
+static ares_bool_t ares_buf_charmap_isset(const ares_buf_charmap_t *map,
+                                          unsigned char             c)
+{
+  return (map->bits[c >> 3] & (1 << (c & 7))) ? ARES_TRUE : ARES_FALSE;
 }
 
 size_t ares_buf_consume_whitespace(ares_buf_t *buf,
@@ -926,19 +956,16 @@ size_t ares_buf_consume_line(ares_buf_t *buf, ares_bool_t include_linefeed)
 {
   size_t               remaining_len = 0;
   const unsigned char *ptr           = ares_buf_fetch(buf, &remaining_len);
+  const unsigned char *p;
   size_t               i;
 
   if (ptr == NULL) {
     return 0;
   }
 
-  for (i = 0; i < remaining_len; i++) {
-    if (ptr[i] == '\n') {
-      goto done;
-    }
-  }
+  p = memchr(ptr, '\n', remaining_len);
+  i = (p == NULL) ? remaining_len : (size_t)(p - ptr);
 
-done:
   if (include_linefeed && i < remaining_len && ptr[i] == '\n') {
     i++;
   }
@@ -957,6 +984,7 @@ size_t ares_buf_consume_until_charset(ares_buf_t          *buf,
   const unsigned char *ptr           = ares_buf_fetch(buf, &remaining_len);
   size_t               pos;
   ares_bool_t          found = ARES_FALSE;
+  ares_buf_charmap_t   map;
 
   if (ptr == NULL || charset == NULL || len == 0) {
     return 0;
@@ -974,13 +1002,11 @@ size_t ares_buf_consume_until_charset(ares_buf_t          *buf,
     goto done;
   }
 
+  ares_buf_charmap_init(&map, charset, len);
   for (pos = 0; pos < remaining_len; pos++) {
-    size_t j;
-    for (j = 0; j < len; j++) {
-      if (ptr[pos] == charset[j]) {
-        found = ARES_TRUE;
-        goto done;
-      }
+    if (ares_buf_charmap_isset(&map, ptr[pos])) {
+      found = ARES_TRUE;
+      break;
     }
   }
 
@@ -1003,22 +1029,20 @@ size_t ares_buf_consume_last_charset(ares_buf_t          *buf,
   const unsigned char *ptr           = ares_buf_fetch(buf, &remaining_len);
   ares_ssize_t         pos;
   ares_bool_t          found = ARES_FALSE;
+  ares_buf_charmap_t   map;
 
   if (ptr == NULL || charset == NULL || len == 0) {
     return require_charset ? SIZE_MAX : 0;
   }
 
+  ares_buf_charmap_init(&map, charset, len);
   for (pos = (ares_ssize_t)remaining_len - 1; pos >= 0; pos--) {
-    size_t j;
-    for (j = 0; j < len; j++) {
-      if (ptr[pos] == charset[j]) {
-        found = ARES_TRUE;
-        goto done;
-      }
+    if (ares_buf_charmap_isset(&map, ptr[pos])) {
+      found = ARES_TRUE;
+      break;
     }
   }
 
-done:
   if (!found) {
     if (require_charset) {
       return SIZE_MAX;
@@ -1069,20 +1093,15 @@ size_t ares_buf_consume_charset(ares_buf_t *buf, const unsigned char *charset,
   size_t               remaining_len = 0;
   const unsigned char *ptr           = ares_buf_fetch(buf, &remaining_len);
   size_t               i;
+  ares_buf_charmap_t   map;
 
   if (ptr == NULL || charset == NULL || len == 0) {
     return 0;
   }
 
+  ares_buf_charmap_init(&map, charset, len);
   for (i = 0; i < remaining_len; i++) {
-    size_t j;
-    for (j = 0; j < len; j++) {
-      if (ptr[i] == charset[j]) {
-        break;
-      }
-    }
-    /* Not found */
-    if (j == len) {
+    if (!ares_buf_charmap_isset(&map, ptr[i])) {
       break;
     }
   }
@@ -562,6 +562,204 @@ static ares_status_t ares_iface_ips_enumerate(ares_iface_ips_t *ips,
 
 #endif
 
+/* Per-process snapshot of the addresses on all interfaces.  Enumerating
+ * interfaces costs several system calls, so the snapshot is reused until it
+ * is older than ARES_IFACE_IPS_CACHE_MS.  While something is watching for
+ * address changes (see ares_iface_ips_watch_start()) it is instead reused
+ * until invalidated. */
+#define ARES_IFACE_IPS_CACHE_MS 1000
+#define ARES_IFACE_IP_ALL                                                \
+  (ARES_IFACE_IP_V4 | ARES_IFACE_IP_V6 | ARES_IFACE_IP_LOOPBACK |        \
+   ARES_IFACE_IP_OFFLINE | ARES_IFACE_IP_LINKLOCAL)
+
+typedef struct {
+  ares_iface_ips_t *ips;
+  ares_timeval_t    expires;
+  /*! ares_iface_ips_watch_gen when enumerated while watched, otherwise 0 */
+  size_t            watch_gen;
+  /*! set by ares_iface_ips_cache_set(), reused until invalidated */
+  ares_bool_t       pinned;
+} ares_iface_ips_cache_t;
+
+/* All protected by the global lock */
+static ares_iface_ips_cache_t ares_iface_ips_cache;
+static size_t                 ares_iface_ips_cache_epoch = 0;
+static size_t                 ares_iface_ips_watchers    = 0;
+static size_t                 ares_iface_ips_watch_gen   = 0;
+
+void ares_iface_ips_cache_invalidate(void)
+{
+  ares_iface_ips_t *ips;
+
+  ares_thread_global_lock();
+  ips = ares_iface_ips_cache.ips;
+  memset(&ares_iface_ips_cache, 0, sizeof(ares_iface_ips_cache));
+  ares_iface_ips_cache_epoch++;
+  ares_thread_global_unlock();
+
+  ares_iface_ips_destroy(ips);
+}
+
+void ares_iface_ips_watch_start(void)
+{
+  ares_thread_global_lock();
+  if (ares_iface_ips_watchers++ == 0) {
+    ares_iface_ips_watch_gen++;
+  }
+  ares_thread_global_unlock();
+}
+
+void ares_iface_ips_watch_stop(void)
+{
+  ares_thread_global_lock();
+  if (ares_iface_ips_watchers > 0) {
+    ares_iface_ips_watchers--;
+  }
+  ares_thread_global_unlock();
+}
+
+ares_status_t ares_iface_ips_cache_set(const char             *name,
+                                       const struct ares_addr *addrs,
+                                       size_t                  cnt)
+{
+  ares_iface_ips_t *ips;
+  ares_iface_ips_t *old;
+  ares_status_t     status;
+  size_t            i;
+
+  if (name == NULL || (addrs == NULL && cnt != 0)) {
+    return ARES_EFORMERR; /* LCOV_EXCL_LINE: DefensiveCoding */
+  }
+
+  ips = ares_iface_ips_alloc(ARES_IFACE_IP_ALL);
+  if (ips == NULL) {
+    return ARES_ENOMEM; /* LCOV_EXCL_LINE: OutOfMemory */
+  }
+
+  for (i = 0; i < cnt; i++) {
+    status = ares_iface_ips_add(ips, ARES_IFACE_IP_NONE, name, &addrs[i], 0, 0);
+    if (status != ARES_SUCCESS) {
+      ares_iface_ips_destroy(ips); /* LCOV_EXCL_LINE: OutOfMemory */
+      return status;               /* LCOV_EXCL_LINE: OutOfMemory */
+    }
+  }
+
+  ares_thread_global_lock();
+  old = ares_iface_ips_cache.ips;
+  memset(&ares_iface_ips_cache, 0, sizeof(ares_iface_ips_cache));
+  ares_iface_ips_cache.ips    = ips;
+  ares_iface_ips_cache.pinned = ARES_TRUE;
+  ares_iface_ips_cache_epoch++;
+  ares_thread_global_unlock();
+
+  ares_iface_ips_destroy(old);
+  return ARES_SUCCESS;
+}
+
+/* Returns with the global lock held and the current snapshot, or NULL if
+ * interfaces can't be enumerated */
+static const ares_iface_ips_t *ares_iface_ips_snapshot_acquire(void)
+{
+  const ares_iface_ips_cache_t *cache = &ares_iface_ips_cache;
+  ares_iface_ips_t             *ips   = NULL;
+  ares_iface_ips_t             *old   = NULL;
+  ares_timeval_t                now;
+  size_t                        epoch;
+  size_t                        watch_gen = 0;
+
+  ares_tvnow(&now);
+
+  ares_thread_global_lock();
+  if (cache->ips != NULL) {
+    if (cache->pinned) {
+      return cache->ips;
+    }
+    if (cache->watch_gen != 0 && cache->watch_gen == ares_iface_ips_watch_gen &&
+        ares_iface_ips_watchers > 0) {
+      return cache->ips;
+    }
+    if (!ares_timedout(&now, &cache->expires)) {
+      return cache->ips;
+    }
+  }
+  epoch = ares_iface_ips_cache_epoch;
+  if (ares_iface_ips_watchers > 0) {
+    watch_gen = ares_iface_ips_watch_gen;
+  }
+  ares_thread_global_unlock();
+
+  if (ares_iface_ips(&ips, ARES_IFACE_IP_ALL, NULL) != ARES_SUCCESS) {
+    ips = NULL;
+  }
+
+  ares_thread_global_lock();
+  if (ips == NULL) {
+    return NULL;
+  }
+
+  old                            = ares_iface_ips_cache.ips;
+  ares_iface_ips_cache.ips       = ips;
+  ares_iface_ips_cache.expires   = now;
+  ares_iface_ips_cache.watch_gen = 0;
+  /* If addresses changed while enumerating, what we have may predate the
+   * change, so it is only used for this call */
+  if (epoch == ares_iface_ips_cache_epoch) {
+    ares_timeval_add(&ares_iface_ips_cache.expires, ARES_IFACE_IPS_CACHE_MS);
+    ares_iface_ips_cache.watch_gen = watch_gen;
+  }
+
+  /* Nothing can be referencing the old snapshot as it is only used with the
+   * global lock held */
+  ares_iface_ips_destroy(old);
+  return ips;
+}
+
+#if !defined(HAVE_IF_NAMETOINDEX) || !defined(HAVE_IF_INDEXTONAME)
+/* What enumerating with ARES_IFACE_IP_V6 | ARES_IFACE_IP_LINKLOCAL returns */
+static ares_bool_t ares_iface_ips_is_online_linklocal6(
+  const ares_iface_ips_t *ips, size_t idx)
+{
+  ares_iface_ip_flags_t flags = ares_iface_ips_get_flags(ips, idx);
+
+  if (flags & (ARES_IFACE_IP_LOOPBACK | ARES_IFACE_IP_OFFLINE)) {
+    return ARES_FALSE;
+  }
+
+  return (flags & ARES_IFACE_IP_V6 && flags & ARES_IFACE_IP_LINKLOCAL)
+           ? ARES_TRUE
+           : ARES_FALSE;
+}
+#endif
+
+ares_iface_ip_flags_t ares_iface_ips_families(void)
+{
+  const ares_iface_ips_t *ips;
+  ares_iface_ip_flags_t   families = ARES_IFACE_IP_NONE;
+  size_t                  i;
+
+  ips = ares_iface_ips_snapshot_acquire();
+  if (ips == NULL) {
+    /* Can't tell, so assume both are usable */
+    families = ARES_IFACE_IP_V4 | ARES_IFACE_IP_V6;
+    goto done;
+  }
+
+  for (i = 0; i < ares_iface_ips_cnt(ips); i++) {
+    ares_iface_ip_flags_t flags = ares_iface_ips_get_flags(ips, i);
+
+    if (flags & (ARES_IFACE_IP_LOOPBACK | ARES_IFACE_IP_OFFLINE |
+                 ARES_IFACE_IP_LINKLOCAL)) {
+      continue;
+    }
+
+    families |= flags & (ARES_IFACE_IP_V4 | ARES_IFACE_IP_V6);
+  }
+
+done:
+  ares_thread_global_unlock();
+  return families;
+}
+
 
 unsigned int ares_os_if_nametoindex(const char *name)
 {
@@ -571,30 +769,29 @@ unsigned int ares_os_if_nametoindex(const char *name)
   }
   return if_nametoindex(name);
 #else
-  ares_status_t     status;
-  ares_iface_ips_t *ips = NULL;
-  size_t            i;
-  unsigned int      index = 0;
+  const ares_iface_ips_t *ips;
+  size_t                  i;
+  unsigned int            index = 0;
 
   if (name == NULL) {
     return 0;
   }
 
-  status =
-    ares_iface_ips(&ips, ARES_IFACE_IP_V6 | ARES_IFACE_IP_LINKLOCAL, name);
-  if (status != ARES_SUCCESS) {
+  ips = ares_iface_ips_snapshot_acquire();
+  if (ips == NULL) {
     goto done;
   }
 
   for (i = 0; i < ares_iface_ips_cnt(ips); i++) {
-    if (ares_iface_ips_get_flags(ips, i) & ARES_IFACE_IP_LINKLOCAL) {
+    if (ares_iface_ips_is_online_linklocal6(ips, i) &&
+        ares_strcaseeq(ares_iface_ips_get_name(ips, i), name)) {
       index = ares_iface_ips_get_ll_scope(ips, i);
       goto done;
     }
   }
 
 done:
-  ares_iface_ips_destroy(ips);
+  ares_thread_global_unlock();
   return index;
 #endif
 }
@@ -608,27 +805,25 @@ const char *ares_os_if_indextoname(unsigned int index, char *name,
   }
   return if_indextoname(index, name);
 #else
-  ares_status_t     status;
-  ares_iface_ips_t *ips = NULL;
-  size_t            i;
-  const char       *ptr = NULL;
+  const ares_iface_ips_t *ips;
+  size_t                  i;
+  const char             *ptr = NULL;
 
   if (name == NULL || name_len < IF_NAMESIZE) {
-    goto done;
+    return NULL;
   }
 
   if (index == 0) {
-    goto done;
+    return NULL;
   }
 
-  status =
-    ares_iface_ips(&ips, ARES_IFACE_IP_V6 | ARES_IFACE_IP_LINKLOCAL, NULL);
-  if (status != ARES_SUCCESS) {
+  ips = ares_iface_ips_snapshot_acquire();
+  if (ips == NULL) {
     goto done;
   }
 
   for (i = 0; i < ares_iface_ips_cnt(ips); i++) {
-    if (ares_iface_ips_get_flags(ips, i) & ARES_IFACE_IP_LINKLOCAL &&
+    if (ares_iface_ips_is_online_linklocal6(ips, i) &&
         ares_iface_ips_get_ll_scope(ips, i) == index) {
       ares_strcpy(name, ares_iface_ips_get_name(ips, i), name_len);
       ptr = name;
@@ -637,7 +832,7 @@ const char *ares_os_if_indextoname(unsigned int index, char *name,
   }
 
 done:
-  ares_iface_ips_destroy(ips);
+  ares_thread_global_unlock();
   return ptr;
 #endif
 }
@@ -119,6 +119,40 @@ unsigned int ares_iface_ips_get_ll_scope(const ares_iface_ips_t *ips,
                                          size_t                  idx);
 
 
+/*! Address families with at least one address configured on an online
+ *  interface, not counting loopback and link-local addresses.  Answered from
+ *  a per-process snapshot of interface addresses.
+ *
+ * \return ARES_IFACE_IP_V4 and/or ARES_IFACE_IP_V6, or both if interfaces
+ *         can't be enumerated
+ */
+ares_iface_ip_flags_t ares_iface_ips_families(void);
+
+/*! Discard the per-process snapshot of interface addresses, as addresses have
+ *  changed */
+void ares_iface_ips_cache_invalidate(void);
+
+/*! Replace the per-process snapshot of interface addresses with one holding
+ *  only the given addresses, all on one online interface, until
+ *  ares_iface_ips_cache_invalidate().  For testing.
+ *
+ * \param[in] name   Interface name
+ * \param[in] addrs  Addresses on the interface
+ * \param[in] cnt    Number of addresses
+ * \return ARES_SUCCESS on success
+ */
+ares_status_t ares_iface_ips_cache_set(const char             *name,
+                                       const struct ares_addr *addrs,
+                                       size_t                  cnt);
+
+/*! Something will call ares_iface_ips_cache_invalidate() when addresses
+ *  change, so the snapshot need not expire until then.  Must be paired with
+ *  ares_iface_ips_watch_stop(). */
+void ares_iface_ips_watch_start(void);
+
+/*! No longer watching for address changes */
+void ares_iface_ips_watch_stop(void);
+
 /*! Retrieve the interface index (aka link local scope) from the interface
  *  name.
  *
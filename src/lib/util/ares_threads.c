@@ -71,6 +71,36 @@ void ares_thread_mutex_unlock(ares_thread_mutex_t *mut)
   LeaveCriticalSection(&mut->mutex);
 }
 
+#    if _WIN32_WINNT >= 0x0600 /* Vista */
+static SRWLOCK ares_global_lock = SRWLOCK_INIT;
+
+void ares_thread_global_lock(void)
+{
+  AcquireSRWLockExclusive(&ares_global_lock);
+}
+
+void ares_thread_global_unlock(void)
+{
+  ReleaseSRWLockExclusive(&ares_global_lock);
+}
+#    else
+/* No statically initializable lock before Vista, spin instead.  The lock is
+ * only ever held briefly. */
+static volatile LONG ares_global_lock = 0;
+
+void ares_thread_global_lock(void)
+{
+  while (InterlockedCompareExchange(&ares_global_lock, 1, 0) != 0) {
+    Sleep(0);
+  }
+}
+
+void ares_thread_global_unlock(void)
+{
+  InterlockedExchange(&ares_global_lock, 0);
+}
+#    endif
+
 #    if _WIN32_WINNT >= 0x0600 /* Vista */
 
 struct ares_thread_cond {
@@ -486,6 +516,18 @@ void ares_thread_mutex_unlock(ares_thread_mutex_t *mut)
   pthread_mutex_unlock(&mut->mutex);
 }
 
+static pthread_mutex_t ares_global_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void ares_thread_global_lock(void)
+{
+  pthread_mutex_lock(&ares_global_lock);
+}
+
+void ares_thread_global_unlock(void)
+{
+  pthread_mutex_unlock(&ares_global_lock);
+}
+
 struct ares_thread_cond {
   pthread_cond_t cond;
 };
@@ -658,6 +700,14 @@ void ares_thread_mutex_unlock(ares_thread_mutex_t *mut)
   (void)mut;
 }
 
+void ares_thread_global_lock(void)
+{
+}
+
+void ares_thread_global_unlock(void)
+{
+}
+
 ares_thread_cond_t *ares_thread_cond_create(void)
 {
   return NULL;
@@ -785,7 +835,8 @@ ares_status_t ares_queue_wait_empty(ares_channel_t *channel, int timeout_ms)
   }
 
   ares_thread_mutex_lock(channel->lock);
-  while (ares_llist_len(channel->all_queries)) {
+  while (ares_llist_len(channel->all_queries) ||
+         ares_cbpool_pending(channel->cbpool)) {
     if (timeout_ms < 0) {
       ares_thread_cond_wait(channel->cond_empty, channel->lock);
     } else {
@@ -822,7 +873,8 @@ void ares_queue_notify_empty(ares_channel_t *channel)
   }
 
   /* We are guaranteed to be holding a channel lock already */
-  if (ares_llist_len(channel->all_queries)) {
+  if (ares_llist_len(channel->all_queries) ||
+      ares_cbpool_pending(channel->cbpool)) {
     return;
   }
 
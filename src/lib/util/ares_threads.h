@@ -34,6 +34,11 @@ void ares_thread_mutex_destroy(ares_thread_mutex_t *mut);
 void ares_thread_mutex_lock(ares_thread_mutex_t *mut);
 void ares_thread_mutex_unlock(ares_thread_mutex_t *mut);
 
+/*! Process-wide lock protecting state shared between channels.  It needs no
+ *  initialization, is not recursive, and must only be held briefly. */
+void ares_thread_global_lock(void);
+void ares_thread_global_unlock(void);
+
 
 struct ares_thread_cond;
 typedef struct ares_thread_cond ares_thread_cond_t;
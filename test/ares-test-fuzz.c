@@ -141,6 +141,16 @@ int LLVMFuzzerTestOneInput(const unsigned char *data, unsigned long size)
     return -1;
   }
 
+  /* Lazily decoding every RR, which writing does, must be just as safe */
+  if (ares_dns_parse(data, size, ARES_DNS_PARSE_LAZY, &dnsrec) ==
+      ARES_SUCCESS) {
+    ares_dns_write(dnsrec, &datadup, &datadup_len);
+    ares_free(datadup);
+    datadup = NULL;
+    ares_dns_record_destroy(dnsrec);
+    dnsrec = NULL;
+  }
+
   if (ares_dns_parse(data, size, 0, &dnsrec) != ARES_SUCCESS) {
     goto done;
   }
@@ -25,6 +25,10 @@
  */
 #include "ares-test.h"
 
+#ifdef __linux__
+#  include <utime.h>
+#endif
+
 extern "C" {
   #include "ares_private.h"
 }
@@ -153,6 +157,17 @@ TEST_F(LibraryTest, OptionsChannelInit) {
   ares_destroy(channel2);
 }
 
+TEST_F(LibraryTest, OptionsEventThreadCntRequiresEventThread) {
+  struct ares_options opts;
+  memset(&opts, 0, sizeof(opts));
+  opts.event_thread_cnt = 2;
+
+  ares_channel_t *channel = nullptr;
+  EXPECT_EQ(ARES_EFORMERR,
+            ares_init_options(&channel, &opts, ARES_OPT_EVENT_THREAD_CNT));
+  EXPECT_EQ(nullptr, channel);
+}
+
 TEST_F(LibraryTest, ChannelAllocFail) {
   ares_channel_t *channel;
   for (int ii = 1; ii <= 25; ii++) {
@@ -295,6 +310,88 @@ TEST_F(LibraryTest, EnvInitModernOptions) {
   ares_destroy(channel);
 }
 
+static std::string InitDomains(const char *resolvconf) {
+  struct ares_options opts;
+  memset(&opts, 0, sizeof(opts));
+  opts.resolvconf_path = strdup(resolvconf);
+  ares_channel_t *channel = nullptr;
+  EXPECT_EQ(ARES_SUCCESS, ares_init_options(&channel, &opts, ARES_OPT_RESOLVCONF));
+  free(opts.resolvconf_path);
+
+  std::string domains;
+  for (size_t i = 0; i < channel->ndomains; i++) {
+    domains += (i ? " " : "") + std::string(channel->domains[i]);
+  }
+  ares_destroy(channel);
+  return domains;
+}
+
+TEST_F(LibraryTest, SysconfigCachedAcrossChannels) {
+  TempFile resolvconf("search first.com\nnameserver 1.2.3.4\n");
+  EXPECT_EQ("first.com", InitDomains(resolvconf.filename()));
+
+  // The environment still overrides configuration reused from another channel
+  {
+    EnvValue v1("LOCALDOMAIN", "this.is.local");
+    EXPECT_EQ("this.is.local", InitDomains(resolvconf.filename()));
+  }
+
+  // A reinit of any channel means the configuration may have changed, so the
+  // next channel created reads it again
+  FILE *fp = fopen(resolvconf.filename(), "w");
+  ASSERT_NE(nullptr, fp);
+  fputs("search second.com\nnameserver 1.2.3.4\n", fp);
+  fclose(fp);
+
+  ares_channel_t *channel = nullptr;
+  EXPECT_EQ(ARES_SUCCESS, ares_init(&channel));
+  EXPECT_EQ(ARES_SUCCESS, ares_reinit(channel));
+  EXPECT_EQ("second.com", InitDomains(resolvconf.filename()));
+  ares_destroy(channel);
+}
+
+#ifdef __linux__
+static void WriteResolvConf(const char *filename, const char *contents,
+                            time_t mtime) {
+  FILE *fp = fopen(filename, "w");
+  ASSERT_NE(nullptr, fp);
+  fputs(contents, fp);
+  fclose(fp);
+  struct utimbuf times;
+  times.actime  = mtime;
+  times.modtime = mtime;
+  ASSERT_EQ(0, utime(filename, &times));
+}
+
+TEST_F(LibraryTest, SysconfigCacheValidatesFiles) {
+  TempFile resolvconf("");
+  time_t   old = time(NULL) - 10;
+
+  WriteResolvConf(resolvconf.filename(),
+                  "search first.com\nnameserver 1.2.3.4\n", old);
+  EXPECT_EQ("first.com", InitDomains(resolvconf.filename()));
+
+  // Nothing visible to stat() changed, so what was read before is reused
+  WriteResolvConf(resolvconf.filename(),
+                  "search other.com\nnameserver 1.2.3.4\n", old);
+  EXPECT_EQ("first.com", InitDomains(resolvconf.filename()));
+
+  // Without any reinit or monitor, a changed file is read again
+  WriteResolvConf(resolvconf.filename(),
+                  "search other.com\nnameserver 1.2.3.4\n", old + 1);
+  EXPECT_EQ("other.com", InitDomains(resolvconf.filename()));
+
+  // A file read in the same second it was written isn't trusted, as it could
+  // be written again within that second without its mtime changing
+  WriteResolvConf(resolvconf.filename(),
+                  "search third.com\nnameserver 1.2.3.4\n", time(NULL));
+  EXPECT_EQ("third.com", InitDomains(resolvconf.filename()));
+  WriteResolvConf(resolvconf.filename(),
+                  "search fifth.com\nnameserver 1.2.3.4\n", time(NULL));
+  EXPECT_EQ("fifth.com", InitDomains(resolvconf.filename()));
+}
+#endif
+
 TEST_F(LibraryTest, EnvInitAllocFail) {
   ares_channel_t *channel;
   EnvValue v1("LOCALDOMAIN", "this.is.local");
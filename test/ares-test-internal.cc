@@ -60,6 +60,7 @@ extern "C" {
 #endif
 }
 
+#include <condition_variable>
 #include <string>
 #include <vector>
 
@@ -399,6 +400,33 @@ TEST_F(LibraryTest, IfaceIPs) {
 
   ares_iface_ips_destroy(ips);
 }
+
+TEST_F(LibraryTest, IfaceIPsFamilies) {
+  ares_iface_ips_t     *ips = NULL;
+  ares_iface_ip_flags_t expected = ARES_IFACE_IP_NONE;
+  size_t                i;
+
+  if (ares_iface_ips(&ips, (ares_iface_ip_flags_t)(ARES_IFACE_IP_V4|ARES_IFACE_IP_V6), NULL) != ARES_SUCCESS) {
+    /* Can't tell, both must be assumed usable */
+    EXPECT_EQ((int)(ARES_IFACE_IP_V4|ARES_IFACE_IP_V6), (int)ares_iface_ips_families());
+    return;
+  }
+
+  for (i=0; i<ares_iface_ips_cnt(ips); i++) {
+    ares_iface_ip_flags_t flags = ares_iface_ips_get_flags(ips, i);
+    if (flags & ARES_IFACE_IP_LINKLOCAL)
+      continue;
+    expected = (ares_iface_ip_flags_t)(expected | (flags & (ARES_IFACE_IP_V4|ARES_IFACE_IP_V6)));
+  }
+  ares_iface_ips_destroy(ips);
+
+  /* Second lookup is answered from the snapshot, as is the one after it is
+   * invalidated */
+  EXPECT_EQ((int)expected, (int)ares_iface_ips_families());
+  EXPECT_EQ((int)expected, (int)ares_iface_ips_families());
+  ares_iface_ips_cache_invalidate();
+  EXPECT_EQ((int)expected, (int)ares_iface_ips_families());
+}
 #endif
 
 TEST_F(LibraryTest, HtableMisuse) {
@@ -1172,6 +1200,43 @@ TEST_F(LibraryTest, BufCodepoint) {
     ares_buf_destroy(buf);
   }
 
+  /* Charset scans with bytes across the whole range */
+  {
+    static const unsigned char data[] = { 0x01, 0x80, 0xFF, 0x01, 'a',
+                                          0x07, 0xFF, 'b',  0x00, 'c' };
+    static const unsigned char set[]  = { 0xFF, 0x80, 0x01 };
+    static const unsigned char stop[] = { 0x00, 0x07 };
+    ares_buf_t *buf = ares_buf_create_const(data, sizeof(data));
+
+    ASSERT_NE(nullptr, buf);
+    EXPECT_EQ((size_t)4, ares_buf_consume_charset(buf, set, sizeof(set)));
+    EXPECT_EQ((size_t)1, ares_buf_consume_until_charset(buf, stop,
+                                                        sizeof(stop),
+                                                        ARES_TRUE));
+    EXPECT_EQ((size_t)3, ares_buf_consume_last_charset(buf, stop, sizeof(stop),
+                                                       ARES_TRUE));
+    EXPECT_EQ((size_t)2, ares_buf_len(buf)); /* "\0c" remains */
+    EXPECT_EQ(SIZE_MAX, ares_buf_consume_until_charset(buf, set, sizeof(set),
+                                                       ARES_TRUE));
+    ares_buf_destroy(buf);
+  }
+
+  /* Whitespace classes, linefeed only counts when asked for */
+  {
+    static const char data[] = " \t\v\f\r\n x\ny";
+    ares_buf_t *buf = ares_buf_create_const((const unsigned char *)data,
+                                            sizeof(data) - 1);
+
+    ASSERT_NE(nullptr, buf);
+    EXPECT_EQ((size_t)5, ares_buf_consume_whitespace(buf, ARES_FALSE));
+    EXPECT_EQ((size_t)2, ares_buf_consume_whitespace(buf, ARES_TRUE));
+    EXPECT_EQ((size_t)1, ares_buf_consume_nonwhitespace(buf));
+    EXPECT_EQ((size_t)1, ares_buf_consume_line(buf, ARES_TRUE));
+    EXPECT_EQ((size_t)1, ares_buf_consume_line(buf, ARES_TRUE));
+    EXPECT_EQ((size_t)0, ares_buf_len(buf));
+    ares_buf_destroy(buf);
+  }
+
   /* ares_buf_isprint() */
   {
     ares_buf_t *buf = ares_buf_create_const((const unsigned char *)"abc", 3);
@@ -1328,6 +1393,586 @@ TEST_F(FileChannelTest, GetAddrInfoHostsIPV6) {
   EXPECT_EQ("{ipv6.com addr=[[0000:0000:0000:0000:0000:0000:0000:0001]]}", ss.str());
 }
 
+TEST_F(FileChannelTest, GetAddrInfoHostsModified) {
+  TempFile hostsfile("1.2.3.4 example.com\n");
+  EnvValue with_env("CARES_HOSTS", hostsfile.filename());
+  struct ares_addrinfo_hints hints = {0, 0, 0, 0};
+  hints.ai_family = AF_INET;
+  hints.ai_flags = ARES_AI_ENVHOSTS | ARES_AI_NOSORT;
+
+  AddrInfoResult result1 = {};
+  ares_getaddrinfo(channel_, "example.com", NULL, &hints, AddrInfoCallback, &result1);
+  Process();
+  EXPECT_TRUE(result1.done_);
+  std::stringstream ss1;
+  ss1 << result1.ai_;
+  EXPECT_EQ("{addr=[1.2.3.4]}", ss1.str());
+
+  // Rewrite with the same size, most likely within the same second as the
+  // file was loaded, so neither the size nor the modification time changes.
+  FILE *fp = fopen(hostsfile.filename(), "w");
+  ASSERT_NE(nullptr, fp);
+  fputs("5.6.7.8 example.com\n", fp);
+  fclose(fp);
+
+  // Wait out the rate limit on checking for modification
+  ares_sleep_time(1100);
+
+  AddrInfoResult result2 = {};
+  ares_getaddrinfo(channel_, "example.com", NULL, &hints, AddrInfoCallback, &result2);
+  Process();
+  EXPECT_TRUE(result2.done_);
+  std::stringstream ss2;
+  ss2 << result2.ai_;
+  EXPECT_EQ("{addr=[5.6.7.8]}", ss2.str());
+}
+
+TEST_F(FileChannelTest, GetAddrInfoHostsSharedAcrossChannels) {
+  TempFile hostsfile("1.2.3.4 example.com www.example.com\n"
+                     "2.3.4.5 example.com\n");
+  EnvValue with_env("CARES_HOSTS", hostsfile.filename());
+  struct ares_addrinfo_hints hints = {0, 0, 0, 0};
+  hints.ai_family = AF_INET;
+  hints.ai_flags = ARES_AI_CANONNAME | ARES_AI_ENVHOSTS | ARES_AI_NOSORT;
+
+  ares_channel_t *channel2 = nullptr;
+  EXPECT_EQ(ARES_SUCCESS, ares_dup(&channel2, channel_));
+
+  // A copy loaded within the second the file was written is never shared,
+  // as a further write within that second would go unnoticed
+  ares_sleep_time(1100);
+
+  // Both channels load the same unchanged file, and so share the parsed copy
+  for (int i = 0; i < 3; i++) {
+    ares_channel_t *channel = (i == 1) ? channel2 : channel_;
+    AddrInfoResult result = {};
+    ares_getaddrinfo(channel, "example.com", NULL, &hints, AddrInfoCallback, &result);
+    Process();
+    EXPECT_TRUE(result.done_);
+    std::stringstream ss;
+    ss << result.ai_;
+    EXPECT_EQ("{www.example.com->example.com addr=[1.2.3.4], addr=[2.3.4.5]}", ss.str());
+
+    // The duplicate was made before anything was loaded, so it found the
+    // copy parsed for the first channel through the registry
+    if (i == 1) {
+      EXPECT_NE(nullptr, ares_hosts_file_id(channel_));
+      EXPECT_EQ(ares_hosts_file_id(channel_), ares_hosts_file_id(channel2));
+
+      // Dropping one channel's reference must leave the other's intact
+      const void *id = ares_hosts_file_id(channel_);
+      ares_destroy(channel2);
+      channel2 = nullptr;
+      EXPECT_EQ(id, ares_hosts_file_id(channel_));
+    }
+  }
+}
+
+TEST_F(FileChannelTest, GetAddrInfoHostsDupAfterLoad) {
+  TempFile hostsfile("1.2.3.4 example.com\n");
+  EnvValue with_env("CARES_HOSTS", hostsfile.filename());
+  struct ares_addrinfo_hints hints = {0, 0, 0, 0};
+  hints.ai_family = AF_INET;
+  hints.ai_flags = ARES_AI_ENVHOSTS | ARES_AI_NOSORT;
+
+  AddrInfoResult result = {};
+  ares_getaddrinfo(channel_, "example.com", NULL, &hints, AddrInfoCallback, &result);
+  Process();
+  EXPECT_TRUE(result.done_);
+  std::stringstream ss;
+  ss << result.ai_;
+  EXPECT_EQ("{addr=[1.2.3.4]}", ss.str());
+
+  // The copy takes over the already loaded file, and must keep it usable
+  // after the channel it came from is gone
+  ares_channel_t *channel2 = nullptr;
+  EXPECT_EQ(ARES_SUCCESS, ares_dup(&channel2, channel_));
+  ares_destroy(channel_);
+  channel_ = nullptr;
+
+  AddrInfoResult result2 = {};
+  ares_getaddrinfo(channel2, "example.com", NULL, &hints, AddrInfoCallback, &result2);
+  EXPECT_TRUE(result2.done_);
+  std::stringstream ss2;
+  ss2 << result2.ai_;
+  EXPECT_EQ("{addr=[1.2.3.4]}", ss2.str());
+  ares_destroy(channel2);
+}
+
+static void SearchNegCacheReply(ares_channel_t *channel, const char *name,
+                                const char *candidate, ares_dns_rcode_t rcode)
+{
+  ares_dns_record_t *dnsrec = NULL;
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_record_create(&dnsrec, 0, ARES_FLAG_QR,
+                                                 ARES_OPCODE_QUERY, rcode));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_record_query_add(dnsrec, candidate,
+                                                    ARES_REC_TYPE_A,
+                                                    ARES_CLASS_IN));
+  ares_search_negcache_update(channel, name, dnsrec);
+  ares_dns_record_destroy(dnsrec);
+}
+
+TEST_F(LibraryTest, SearchNegCacheReprobe) {
+  struct ares_options opts;
+  char               *domains[] = { (char *)"first.com" };
+  memset(&opts, 0, sizeof(opts));
+  opts.flags    = ARES_FLAG_SEARCH_NEGCACHE;
+  opts.domains  = domains;
+  opts.ndomains = 1;
+  ares_channel_t *channel = nullptr;
+  EXPECT_EQ(ARES_SUCCESS, ares_init_options(&channel, &opts,
+                                            ARES_OPT_FLAGS | ARES_OPT_DOMAINS));
+
+  ares_timeval_t now;
+  ares_tvnow(&now);
+  ares_timeval_t later = now;
+  later.sec += 301;
+
+  /* Three misses for 2 label names, and first.com is skipped for them */
+  const char *names[] = { "a.example", "b.example", "c.example" };
+  for (const char *name : names) {
+    std::string candidate = std::string(name) + ".first.com";
+    EXPECT_FALSE(ares_search_negcache_skip(channel, name, "first.com",
+                                           candidate.c_str(), &now));
+    SearchNegCacheReply(channel, name, candidate.c_str(), ARES_RCODE_NXDOMAIN);
+  }
+  EXPECT_TRUE(ares_search_negcache_skip(channel, "d.example", "first.com",
+                                        "d.example.first.com", &now));
+  /* Other label counts are unaffected */
+  EXPECT_FALSE(ares_search_negcache_skip(channel, "d", "first.com",
+                                         "d.first.com", &now));
+  /* Single-label names are never learned about */
+  for (const char *name : { "a", "b", "c" }) {
+    std::string candidate = std::string(name) + ".first.com";
+    SearchNegCacheReply(channel, name, candidate.c_str(), ARES_RCODE_NXDOMAIN);
+  }
+  EXPECT_FALSE(ares_search_negcache_skip(channel, "d", "first.com",
+                                         "d.first.com", &now));
+
+  /* Once the learning period is over the domain is probed again, and a
+   * single further miss goes straight back to skipping */
+  EXPECT_FALSE(ares_search_negcache_skip(channel, "d.example", "first.com",
+                                         "d.example.first.com", &later));
+  SearchNegCacheReply(channel, "d.example", "d.example.first.com",
+                      ARES_RCODE_NXDOMAIN);
+  EXPECT_TRUE(ares_search_negcache_skip(channel, "e.example", "first.com",
+                                        "e.example.first.com", &now));
+
+  /* After the next period, a name found under the domain forgets it */
+  EXPECT_FALSE(ares_search_negcache_skip(channel, "e.example", "first.com",
+                                         "e.example.first.com", &later));
+  SearchNegCacheReply(channel, "e.example", "e.example.first.com",
+                      ARES_RCODE_NOERROR);
+  SearchNegCacheReply(channel, "f.example", "f.example.first.com",
+                      ARES_RCODE_NXDOMAIN);
+  EXPECT_FALSE(ares_search_negcache_skip(channel, "g.example", "first.com",
+                                         "g.example.first.com", &now));
+
+  /* Not consulted without the flag */
+  ares_search_negcache_flush(channel);
+  channel->flags &= ~((unsigned int)ARES_FLAG_SEARCH_NEGCACHE);
+  for (const char *name : names) {
+    std::string candidate = std::string(name) + ".first.com";
+    SearchNegCacheReply(channel, name, candidate.c_str(), ARES_RCODE_NXDOMAIN);
+  }
+  EXPECT_FALSE(ares_search_negcache_skip(channel, "d.example", "first.com",
+                                         "d.example.first.com", &now));
+
+  ares_destroy(channel);
+}
+
+#ifdef CARES_THREADS
+struct ChannelLockHolder {
+  std::mutex              lock;
+  std::condition_variable cond;
+  bool                    locked   = false;
+  bool                    released = false;
+  bool                    done     = false;
+  bool                    answered_while_locked = false;
+  ares_status_t           status   = ARES_ENOTFOUND;
+};
+
+static void CacheHitCallback(void *arg, ares_status_t status, size_t timeouts,
+                             const ares_dns_record_t *dnsrec) {
+  ChannelLockHolder *holder = (ChannelLockHolder *)arg;
+  (void)timeouts;
+  (void)dnsrec;
+  std::lock_guard<std::mutex> lk(holder->lock);
+  holder->status                = status;
+  holder->answered_while_locked = !holder->released;
+  holder->done                  = true;
+  holder->cond.notify_all();
+}
+
+TEST_F(LibraryTest, QueryCacheHitWithoutChannelLock) {
+  struct ares_options opts;
+  memset(&opts, 0, sizeof(opts));
+  opts.qcache_max_ttl = 3600;
+  ares_channel_t *channel = nullptr;
+  EXPECT_EQ(ARES_SUCCESS,
+            ares_init_options(&channel, &opts, ARES_OPT_QUERY_CACHE));
+
+  /* Seed the cache with an answer to the request ares_query_dnsrec() sends */
+  ares_dns_record_t *req  = nullptr;
+  ares_dns_record_t *resp = nullptr;
+  ares_dns_rr_t     *rr   = nullptr;
+  struct in_addr     addr;
+  EXPECT_EQ(ARES_SUCCESS,
+            ares_dns_record_create_query(&req, "www.example.com",
+                                         ARES_CLASS_IN, ARES_REC_TYPE_A, 0,
+                                         ARES_FLAG_RD, 0));
+  EXPECT_EQ(ARES_SUCCESS,
+            ares_dns_record_create(&resp, 0, ARES_FLAG_QR | ARES_FLAG_RD,
+                                   ARES_OPCODE_QUERY, ARES_RCODE_NOERROR));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_record_query_add(resp, "www.example.com",
+                                                    ARES_REC_TYPE_A,
+                                                    ARES_CLASS_IN));
+  EXPECT_EQ(ARES_SUCCESS,
+            ares_dns_record_rr_add(&rr, resp, ARES_SECTION_ANSWER,
+                                   "www.example.com", ARES_REC_TYPE_A,
+                                   ARES_CLASS_IN, 300));
+  EXPECT_LT(0, ares_inet_pton(AF_INET, "1.2.3.4", &addr));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_rr_set_addr(rr, ARES_RR_A_ADDR, &addr));
+
+  ares_query_t   query;
+  ares_timeval_t now;
+  memset(&query, 0, sizeof(query));
+  query.query = req;
+  ares_tvnow(&now);
+  EXPECT_EQ(ARES_SUCCESS, ares_qcache_insert(channel, &now, &query, resp));
+  ares_dns_record_destroy(req);
+  ares_dns_record_destroy(resp);
+
+  /* Another thread holds the channel lock until the answer arrives, giving
+   * up after a while so a regression fails rather than deadlocks */
+  ChannelLockHolder holder;
+  std::thread       other([channel, &holder] {
+    std::unique_lock<std::mutex> lk(holder.lock);
+    ares_channel_lock(channel);
+    holder.locked = true;
+    holder.cond.notify_all();
+    holder.cond.wait_for(lk, std::chrono::seconds(5),
+                         [&holder] { return holder.done; });
+    holder.released = true;
+    ares_channel_unlock(channel);
+  });
+  {
+    std::unique_lock<std::mutex> lk(holder.lock);
+    holder.cond.wait(lk, [&holder] { return holder.locked; });
+  }
+
+  EXPECT_EQ(ARES_SUCCESS,
+            ares_query_dnsrec(channel, "www.example.com", ARES_CLASS_IN,
+                              ARES_REC_TYPE_A, CacheHitCallback, &holder,
+                              NULL));
+  other.join();
+
+  EXPECT_TRUE(holder.done);
+  EXPECT_EQ(ARES_SUCCESS, holder.status);
+  EXPECT_TRUE(holder.answered_while_locked);
+
+  ares_destroy(channel);
+}
+#endif
+
+struct SrcAddrSockState {
+  size_t sockets = 0;
+  int    family  = AF_UNSPEC;
+};
+
+static ares_socket_t SrcAddrSocket(int domain, int type, int protocol,
+                                   void *user_data)
+{
+  SrcAddrSockState *state = reinterpret_cast<SrcAddrSockState *>(user_data);
+  (void)domain;
+  (void)type;
+  (void)protocol;
+  state->sockets++;
+  return ::socket(AF_INET, SOCK_DGRAM, 0);
+}
+
+static int SrcAddrClose(ares_socket_t sock, void *user_data)
+{
+  (void)user_data;
+  return ::close(sock);
+}
+
+static int SrcAddrSetsockopt(ares_socket_t sock, ares_socket_opt_t opt,
+                             const void *val, ares_socklen_t val_size,
+                             void *user_data)
+{
+  (void)sock;
+  (void)opt;
+  (void)val;
+  (void)val_size;
+  (void)user_data;
+  return 0;
+}
+
+/* 127.0.0.3 is unreachable, everything else connects */
+static int SrcAddrConnect(ares_socket_t sock, const struct sockaddr *address,
+                          ares_socklen_t address_len, unsigned int flags,
+                          void *user_data)
+{
+  SrcAddrSockState *state = reinterpret_cast<SrcAddrSockState *>(user_data);
+  (void)sock;
+  (void)address_len;
+  (void)flags;
+  state->family = address->sa_family;
+  if (address->sa_family == AF_INET &&
+      ((const struct sockaddr_in *)(const void *)address)->sin_addr.s_addr ==
+        htonl(0x7F000003)) {
+    errno = ENETUNREACH;
+    return -1;
+  }
+  return 0;
+}
+
+static ares_ssize_t SrcAddrRecvfrom(ares_socket_t sock, void *buffer,
+                                    size_t length, int flags,
+                                    struct sockaddr *address,
+                                    ares_socklen_t  *address_len,
+                                    void            *user_data)
+{
+  (void)sock;
+  (void)buffer;
+  (void)length;
+  (void)flags;
+  (void)address;
+  (void)address_len;
+  (void)user_data;
+  errno = EBADF;
+  return -1;
+}
+
+static ares_ssize_t SrcAddrSendto(ares_socket_t sock, const void *buffer,
+                                  size_t length, int flags,
+                                  const struct sockaddr *address,
+                                  ares_socklen_t address_len, void *user_data)
+{
+  (void)sock;
+  (void)buffer;
+  (void)length;
+  (void)flags;
+  (void)address;
+  (void)address_len;
+  (void)user_data;
+  errno = EBADF;
+  return -1;
+}
+
+static int SrcAddrGetsockname(ares_socket_t sock, struct sockaddr *address,
+                              ares_socklen_t *address_len, void *user_data)
+{
+  SrcAddrSockState *state = reinterpret_cast<SrcAddrSockState *>(user_data);
+  (void)sock;
+  if (state->family == AF_INET6) {
+    struct sockaddr_in6 sin6;
+    memset(&sin6, 0, sizeof(sin6));
+    sin6.sin6_family = AF_INET6;
+    sin6.sin6_addr.s6_addr[15] = 1;
+    memcpy(address, &sin6, sizeof(sin6));
+    *address_len = sizeof(sin6);
+  } else {
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family      = AF_INET;
+    sin.sin_addr.s_addr = htonl(0x7F000001);
+    memcpy(address, &sin, sizeof(sin));
+    *address_len = sizeof(sin);
+  }
+  return 0;
+}
+
+TEST_F(LibraryTest, SortAddrInfoSrcAddrCache) {
+  struct ares_socket_functions_ex funcs;
+  memset(&funcs, 0, sizeof(funcs));
+  funcs.version      = 1;
+  funcs.asocket      = SrcAddrSocket;
+  funcs.aclose       = SrcAddrClose;
+  funcs.asetsockopt  = SrcAddrSetsockopt;
+  funcs.aconnect     = SrcAddrConnect;
+  funcs.arecvfrom    = SrcAddrRecvfrom;
+  funcs.asendto      = SrcAddrSendto;
+  funcs.agetsockname = SrcAddrGetsockname;
+
+  SrcAddrSockState state;
+  ares_channel_t  *channel = nullptr;
+  EXPECT_EQ(ARES_SUCCESS, ares_init(&channel));
+  EXPECT_EQ(ARES_SUCCESS,
+            ares_set_socket_functions_ex(channel, &funcs, &state));
+
+  struct sockaddr_in        sin[3];
+  struct ares_addrinfo_node nodes[3];
+  memset(sin, 0, sizeof(sin));
+  memset(nodes, 0, sizeof(nodes));
+  for (size_t i = 0; i < 3; i++) {
+    sin[i].sin_family      = AF_INET;
+    sin[i].sin_addr.s_addr = htonl(0x7F000001 + (unsigned int)i);
+    nodes[i].ai_family     = AF_INET;
+    nodes[i].ai_addrlen    = sizeof(sin[i]);
+    nodes[i].ai_addr       = (struct sockaddr *)&sin[i];
+  }
+
+  auto sort = [&](size_t first, size_t cnt, const ares_timeval_t *now) {
+    struct ares_addrinfo_node sentinel;
+    memset(&sentinel, 0, sizeof(sentinel));
+    for (size_t i = first; i < first + cnt; i++) {
+      nodes[i].ai_next = (i + 1 < first + cnt) ? &nodes[i + 1] : nullptr;
+    }
+    sentinel.ai_next = &nodes[first];
+    EXPECT_EQ(ARES_SUCCESS, ares_sortaddrinfo(channel, &sentinel, now));
+  };
+
+  ares_timeval_t now;
+  ares_tvnow(&now);
+
+  /* First lookup of each destination opens a socket, repeats are hits */
+  sort(0, 2, &now);
+  EXPECT_EQ(2, (int)state.sockets);
+  sort(0, 2, &now);
+  EXPECT_EQ(2, (int)state.sockets);
+
+  /* Flushing forgets everything */
+  ares_srcaddr_cache_flush(channel);
+  sort(0, 2, &now);
+  EXPECT_EQ(4, (int)state.sockets);
+
+  /* As does expiry */
+  ares_timeval_t later = now;
+  later.sec += ARES_SRCADDR_CACHE_TTL;
+  sort(0, 2, &later);
+  EXPECT_EQ(6, (int)state.sockets);
+  sort(0, 2, &later);
+  EXPECT_EQ(6, (int)state.sockets);
+
+  /* An unreachable destination isn't cached */
+  sort(2, 1, &later);
+  EXPECT_EQ(7, (int)state.sockets);
+  sort(2, 1, &later);
+  EXPECT_EQ(8, (int)state.sockets);
+
+#ifdef HAVE_STRUCT_SOCKADDR_IN6_SIN6_SCOPE_ID
+  /* The same link-local address on different interfaces is a different
+   * destination */
+  struct sockaddr_in6       sin6[2];
+  struct ares_addrinfo_node nodes6[2];
+  memset(sin6, 0, sizeof(sin6));
+  memset(nodes6, 0, sizeof(nodes6));
+  for (size_t i = 0; i < 2; i++) {
+    sin6[i].sin6_family           = AF_INET6;
+    sin6[i].sin6_addr.s6_addr[0]  = 0xfe;
+    sin6[i].sin6_addr.s6_addr[1]  = 0x80;
+    sin6[i].sin6_addr.s6_addr[15] = 1;
+    sin6[i].sin6_scope_id         = (unsigned int)i + 1;
+    nodes6[i].ai_family           = AF_INET6;
+    nodes6[i].ai_addrlen          = sizeof(sin6[i]);
+    nodes6[i].ai_addr             = (struct sockaddr *)&sin6[i];
+  }
+  for (size_t pass = 0; pass < 2; pass++) {
+    struct ares_addrinfo_node sentinel;
+    memset(&sentinel, 0, sizeof(sentinel));
+    nodes6[0].ai_next = &nodes6[1];
+    nodes6[1].ai_next = nullptr;
+    sentinel.ai_next  = &nodes6[0];
+    EXPECT_EQ(ARES_SUCCESS, ares_sortaddrinfo(channel, &sentinel, &later));
+    EXPECT_EQ(10, (int)state.sockets);
+  }
+#endif
+
+  ares_destroy(channel);
+}
+
+TEST_F(LibraryTest, ServicesCache) {
+  TempFile servicesfile("# comment\n"
+                        "myservice 12345/tcp myalias # trailing comment\n"
+                        "myservice 12346/udp\n"
+                        "other 12345/tcp\n"
+                        "MYSERVICE 12347/tcp\n"
+                        "bad 99999/tcp\n");
+  EXPECT_EQ(ARES_SUCCESS, ares_services_set_path(servicesfile.filename()));
+
+  struct ares_options opts;
+  memset(&opts, 0, sizeof(opts));
+  opts.flags = ARES_FLAG_SERVICES_CACHE;
+  ares_channel_t *channel = nullptr;
+  EXPECT_EQ(ARES_SUCCESS, ares_init_options(&channel, &opts, ARES_OPT_FLAGS));
+
+  struct ares_addrinfo_hints hints = {0, 0, 0, 0};
+  hints.ai_family = AF_INET;
+  hints.ai_flags = ARES_AI_NOSORT;
+
+  // Names are case-sensitive, as with getservbyname()
+  const struct {
+    const char *service;
+    const char *expected;
+  } services[] = {
+    { "myservice", "{addr=[1.2.3.4:12345]}" },
+    { "myalias",   "{addr=[1.2.3.4:12345]}" },
+    { "MYSERVICE", "{addr=[1.2.3.4:12347]}" },
+  };
+  for (const auto &service : services) {
+    AddrInfoResult result = {};
+    ares_getaddrinfo(channel, "1.2.3.4", service.service, &hints,
+                     AddrInfoCallback, &result);
+    EXPECT_TRUE(result.done_);
+    std::stringstream ss;
+    ss << result.ai_;
+    EXPECT_EQ(service.expected, ss.str()) << service.service;
+  }
+
+  const char *bad[] = { "bad", "MyService" };
+  for (const char *service : bad) {
+    AddrInfoResult result = {};
+    ares_getaddrinfo(channel, "1.2.3.4", service, &hints, AddrInfoCallback,
+                     &result);
+    EXPECT_TRUE(result.done_);
+    EXPECT_EQ(ARES_ESERVICE, result.status_) << service;
+  }
+
+  // The first entry for a port wins, and the protocol must match
+  struct sockaddr_in sin;
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_port   = htons(12345);
+  NameInfoResult niresult;
+  ares_getnameinfo(channel, (const struct sockaddr *)&sin, sizeof(sin),
+                   ARES_NI_LOOKUPSERVICE, NameInfoCallback, &niresult);
+  EXPECT_TRUE(niresult.done_);
+  EXPECT_EQ("myservice", niresult.service_);
+
+  sin.sin_port = htons(12346);
+  NameInfoResult niresult2;
+  ares_getnameinfo(channel, (const struct sockaddr *)&sin, sizeof(sin),
+                   ARES_NI_LOOKUPSERVICE | ARES_NI_UDP, NameInfoCallback,
+                   &niresult2);
+  EXPECT_TRUE(niresult2.done_);
+  EXPECT_EQ("myservice", niresult2.service_);
+
+  NameInfoResult niresult3;
+  ares_getnameinfo(channel, (const struct sockaddr *)&sin, sizeof(sin),
+                   ARES_NI_LOOKUPSERVICE, NameInfoCallback, &niresult3);
+  EXPECT_TRUE(niresult3.done_);
+  EXPECT_EQ("12346", niresult3.service_);
+
+  // Modifications are picked up once the rate limit on checks expires
+  FILE *fp = fopen(servicesfile.filename(), "w");
+  ASSERT_NE(nullptr, fp);
+  fputs("myservice 23456/tcp\n", fp);
+  fclose(fp);
+  ares_sleep_time(1100);
+
+  AddrInfoResult result2 = {};
+  ares_getaddrinfo(channel, "1.2.3.4", "myservice", &hints, AddrInfoCallback, &result2);
+  EXPECT_TRUE(result2.done_);
+  std::stringstream ss2;
+  ss2 << result2.ai_;
+  EXPECT_EQ("{addr=[1.2.3.4:23456]}", ss2.str());
+
+  ares_destroy(channel);
+  EXPECT_EQ(ARES_SUCCESS, ares_services_set_path(nullptr));
+}
+
 // Regression for #1049: hostnames merged into a single entry only because they
 // share an ip address must not leak each other's *other* addresses (forward
 // lookup) or appear as each other's aliases (address-scoped cnames).  Here
@@ -1993,6 +2638,21 @@ TEST_F(LibraryTest, DNSRecord) {
   /* Re-write */
   EXPECT_EQ(ARES_SUCCESS, ares_dns_write(dnsrec, &msg, &msglen));
 
+  /* Arena-backed parse must produce the same record */
+  {
+    ares_dns_record_t *arenarec  = NULL;
+    unsigned char     *arenamsg  = NULL;
+    size_t             arenalen  = 0;
+
+    EXPECT_EQ(ARES_SUCCESS,
+      ares_dns_parse(msg, msglen, ARES_DNS_PARSE_ARENA, &arenarec));
+    EXPECT_EQ(ARES_SUCCESS, ares_dns_write(arenarec, &arenamsg, &arenalen));
+    EXPECT_EQ(msglen, arenalen);
+    EXPECT_EQ(0, memcmp(msg, arenamsg, msglen));
+    ares_free_string(arenamsg);
+    ares_dns_record_destroy(arenarec);
+  }
+
   EXPECT_EQ(qdcount, ares_dns_record_query_cnt(dnsrec));
   EXPECT_EQ(ancount, ares_dns_record_rr_cnt(dnsrec, ARES_SECTION_ANSWER));
   EXPECT_EQ(nscount, ares_dns_record_rr_cnt(dnsrec, ARES_SECTION_AUTHORITY));
@@ -2356,6 +3016,343 @@ TEST_F(LibraryTest, DNSNameCompression14Bit) {
   ares_dns_record_destroy(dnsrec);
 }
 
+// An option value from the heap handed to an arena record is copied into the
+// arena.  A failure must leave the value to the caller, so nothing is freed
+// twice.
+TEST_F(LibraryTest, DNSRecordArenaSetOptOwnAllocFail) {
+  ares_dns_record_t   *dnsrec = NULL;
+  ares_dns_rr_t       *rr     = NULL;
+  unsigned char       *msg    = NULL;
+  size_t               msglen = 0;
+  const unsigned char  val[]  = { 'v', 'a', 'l', 'u', 'e' };
+
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_create(&dnsrec, 0x1234, ARES_FLAG_QR,
+      ARES_OPCODE_QUERY, ARES_RCODE_NOERROR));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_query_add(dnsrec, "example.com", ARES_REC_TYPE_A,
+      ARES_CLASS_IN));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_rr_add(&rr, dnsrec, ARES_SECTION_ADDITIONAL, "",
+      ARES_REC_TYPE_OPT, ARES_CLASS_IN, 0));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_rr_set_u16(rr, ARES_RR_OPT_UDP_SIZE, 1232));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_rr_set_opt(rr, ARES_RR_OPT_OPTIONS, 1, val, sizeof(val)));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_write(dnsrec, &msg, &msglen));
+  ares_dns_record_destroy(dnsrec);
+  dnsrec = NULL;
+
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_parse(msg, msglen, ARES_DNS_PARSE_ARENA, &dnsrec));
+  ares_free_string(msg);
+  rr = ares_dns_record_rr_get(dnsrec, ARES_SECTION_ADDITIONAL, 0);
+  ASSERT_NE(nullptr, rr);
+
+  // Enough new options that copying the value and growing the option list
+  // each need more arena blocks at some point
+  size_t expected = 1;
+  for (unsigned short opt = 2; opt < 200; opt++) {
+    ares_status_t  status;
+    unsigned char *heapval = (unsigned char *)ares_malloc(sizeof(val));
+    ASSERT_NE(nullptr, heapval);
+    memcpy(heapval, val, sizeof(val));
+
+    ClearFails();
+    SetAllocFail(1);
+    status = ares_dns_rr_set_opt_own(rr, ARES_RR_OPT_OPTIONS, opt, heapval,
+                                     sizeof(val));
+    ClearFails();
+    if (status == ARES_SUCCESS) {
+      expected++;
+    } else {
+      EXPECT_EQ(ARES_ENOMEM, status);
+      ares_free(heapval);
+    }
+    EXPECT_EQ(expected, ares_dns_rr_get_opt_cnt(rr, ARES_RR_OPT_OPTIONS));
+  }
+  EXPECT_LT(expected, 199U);
+
+  ares_dns_record_destroy(dnsrec);
+}
+
+TEST_F(LibraryTest, DNSRecordCompactRR) {
+  ares_dns_record_t *dnsrec = NULL;
+  ares_dns_rr_t     *rr     = NULL;
+  unsigned char     *msg    = NULL;
+  size_t             msglen = 0;
+  struct in_addr     addr;
+  unsigned int       flags[] = { 0, ARES_DNS_PARSE_ARENA,
+                                 ARES_DNS_PARSE_ARENA | ARES_DNS_PARSE_LAZY };
+
+  /* Larger types are out of line, so no RR is more than a few words */
+  EXPECT_LE(sizeof(ares_dns_rr_t), 2 * sizeof(void *) +
+                                     4 * sizeof(unsigned int) +
+                                     3 * sizeof(size_t));
+
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_create(&dnsrec, 0x1234, ARES_FLAG_QR,
+      ARES_OPCODE_QUERY, ARES_RCODE_NOERROR));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_query_add(dnsrec, "example.com", ARES_REC_TYPE_A,
+      ARES_CLASS_IN));
+  memset(&addr, 0, sizeof(addr));
+  for (size_t i = 0; i < 4; i++) {
+    EXPECT_EQ(ARES_SUCCESS,
+      ares_dns_record_rr_add(&rr, dnsrec, ARES_SECTION_ANSWER,
+        (i == 2) ? "other.example.com" : "example.com", ARES_REC_TYPE_A,
+        ARES_CLASS_IN, 300));
+    addr.s_addr = htonl(0x01020300 + (unsigned int)i);
+    EXPECT_EQ(ARES_SUCCESS, ares_dns_rr_set_addr(rr, ARES_RR_A_ADDR, &addr));
+  }
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_rr_add(&rr, dnsrec, ARES_SECTION_AUTHORITY,
+      "example.com", ARES_REC_TYPE_SOA, ARES_CLASS_IN, 300));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_rr_set_str(rr, ARES_RR_SOA_MNAME, "ns1.example.com"));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_rr_set_str(rr, ARES_RR_SOA_RNAME, "admin.example.com"));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_rr_set_u32(rr, ARES_RR_SOA_SERIAL, 99));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_write(dnsrec, &msg, &msglen));
+  ares_dns_record_destroy(dnsrec);
+
+  for (size_t f = 0; f < sizeof(flags) / sizeof(*flags); f++) {
+    const ares_dns_rr_t *rrs[4];
+
+    dnsrec = NULL;
+    EXPECT_EQ(ARES_SUCCESS, ares_dns_parse(msg, msglen, flags[f], &dnsrec));
+    for (size_t i = 0; i < 4; i++) {
+      rrs[i] = ares_dns_record_rr_get_const(dnsrec, ARES_SECTION_ANSWER, i);
+      EXPECT_EQ(htonl(0x01020300 + (unsigned int)i),
+                ares_dns_rr_get_addr(rrs[i], ARES_RR_A_ADDR)->s_addr);
+    }
+    /* Owner names are shared */
+    EXPECT_EQ(ares_dns_rr_get_name(rrs[0]), ares_dns_rr_get_name(rrs[1]));
+    EXPECT_EQ(ares_dns_rr_get_name(rrs[0]), ares_dns_rr_get_name(rrs[3]));
+    EXPECT_STREQ("other.example.com", ares_dns_rr_get_name(rrs[2]));
+
+    rr = ares_dns_record_rr_get(dnsrec, ARES_SECTION_AUTHORITY, 0);
+    EXPECT_EQ(ares_dns_rr_get_name(rrs[0]), ares_dns_rr_get_name(rr));
+    EXPECT_STREQ("ns1.example.com", ares_dns_rr_get_str(rr, ARES_RR_SOA_MNAME));
+    EXPECT_EQ(99U, ares_dns_rr_get_u32(rr, ARES_RR_SOA_SERIAL));
+    EXPECT_EQ(ARES_SUCCESS,
+      ares_dns_rr_set_str(rr, ARES_RR_SOA_MNAME, "ns2.example.com"));
+    EXPECT_STREQ("ns2.example.com", ares_dns_rr_get_str(rr, ARES_RR_SOA_MNAME));
+
+    /* Deleting an RR leaves the names of others sharing it intact */
+    EXPECT_EQ(ARES_SUCCESS,
+      ares_dns_record_rr_del(dnsrec, ARES_SECTION_ANSWER, 0));
+    EXPECT_STREQ("example.com",
+      ares_dns_rr_get_name(
+        ares_dns_record_rr_get_const(dnsrec, ARES_SECTION_ANSWER, 0)));
+    ares_dns_record_destroy(dnsrec);
+  }
+
+  ares_free_string(msg);
+}
+
+TEST_F(LibraryTest, DNSRecordSchema) {
+  static const struct {
+    ares_dns_datatype_t datatype;
+    size_t              size;
+  } sizes[] = {
+    { ARES_DATATYPE_INADDR,  sizeof(struct in_addr)          },
+    { ARES_DATATYPE_INADDR6, sizeof(struct ares_in6_addr)    },
+    { ARES_DATATYPE_U8,      sizeof(unsigned char)           },
+    { ARES_DATATYPE_U16,     sizeof(unsigned short)          },
+    { ARES_DATATYPE_U32,     sizeof(unsigned int)            },
+    { ARES_DATATYPE_NAME,    sizeof(char *)                  },
+    { ARES_DATATYPE_STR,     sizeof(char *)                  },
+    { ARES_DATATYPE_BIN,     sizeof(unsigned char *)         },
+    { ARES_DATATYPE_BINP,    sizeof(unsigned char *)         },
+    { ARES_DATATYPE_ABINP,   sizeof(ares_dns_multistring_t *) },
+    { ARES_DATATYPE_OPT,     sizeof(ares_array_t *)          }
+  };
+  ares_dns_rr_t rr;
+  unsigned int  type;
+
+  for (type = 0; type <= ARES_REC_TYPE_RAW_RR; type++) {
+    ares_dns_rec_type_t         rtype  = (ares_dns_rec_type_t)type;
+    const ares_dns_rr_schema_t *schema = ares_dns_rr_get_schema(rtype);
+    size_t                      i;
+
+    if (!ares_dns_rec_type_isvalid(rtype, ARES_FALSE) ||
+        rtype == ARES_REC_TYPE_ANY) {
+      EXPECT_EQ(nullptr, schema);
+      continue;
+    }
+    ASSERT_NE(nullptr, schema);
+    if (!schema->out_of_line) {
+      EXPECT_LE(schema->size, sizeof(rr.r));
+    }
+
+    for (i = 0; i < schema->cnt; i++) {
+      ares_dns_rr_key_t          key   = schema->keys[i];
+      const ares_dns_rr_field_t *field = ares_dns_rr_schema_field(schema, key);
+      size_t                     size  = 0;
+      size_t                     j;
+
+      EXPECT_EQ(rtype, ares_dns_rr_key_to_rec_type(key));
+      ASSERT_EQ(&schema->fields[i], field);
+      EXPECT_EQ(field->datatype, ares_dns_rr_key_datatype(key));
+
+      for (j = 0; j < sizeof(sizes) / sizeof(*sizes); j++) {
+        if (sizes[j].datatype == field->datatype) {
+          size = sizes[j].size;
+        }
+      }
+      ASSERT_NE(0, size);
+      EXPECT_LE(field->offset + size, schema->size);
+      if (field->datatype == ARES_DATATYPE_BIN ||
+          field->datatype == ARES_DATATYPE_BINP) {
+        EXPECT_LE(field->len_offset + sizeof(size_t), schema->size);
+      }
+    }
+
+    /* Keys of other types aren't found */
+    EXPECT_EQ(nullptr, ares_dns_rr_schema_field(schema,
+                         rtype == ARES_REC_TYPE_A ? ARES_RR_NS_NSDNAME
+                                                  : ARES_RR_A_ADDR));
+  }
+}
+
+TEST_F(LibraryTest, DNSNameParseMemo) {
+  std::vector<unsigned char> msg(12, 0);
+  std::vector<size_t>        offsets;
+  ares_dns_name_memo_t      *memo = NULL;
+  size_t                     i;
+
+  /* 203 character name */
+  offsets.push_back(msg.size());
+  for (i = 0; i < 4; i++) {
+    msg.push_back(50);
+    msg.insert(msg.end(), 50, 'a');
+  }
+  msg.push_back(0);
+  /* Pointer only */
+  offsets.push_back(msg.size());
+  msg.insert(msg.end(), { 0xC0, 0x0C });
+  /* Would exceed 255 characters once the pointer is followed */
+  offsets.push_back(msg.size());
+  msg.push_back(60);
+  msg.insert(msg.end(), 60, 'b');
+  msg.insert(msg.end(), { 0xC0, 0x0C });
+  /* Label then pointer, then pointers to that */
+  size_t xoff = msg.size();
+  offsets.push_back(xoff);
+  msg.insert(msg.end(), { 1, 'x', 0xC0, 0x0C });
+  offsets.push_back(msg.size());
+  msg.insert(msg.end(), { 0xC0, (unsigned char)xoff });
+  offsets.push_back(msg.size());
+  msg.insert(msg.end(), { 1, 'y', 0xC0, (unsigned char)xoff });
+  /* Not a valid hostname, referenced before being used as one */
+  size_t boff = msg.size();
+  msg.insert(msg.end(), { 3, 'a', '!', 'b', 0 });
+  offsets.push_back(msg.size());
+  msg.insert(msg.end(), { 0xC0, (unsigned char)boff });
+  /* Root */
+  size_t roff = msg.size();
+  msg.push_back(0);
+  offsets.push_back(msg.size());
+  msg.insert(msg.end(), { 0xC0, (unsigned char)roff });
+  offsets.push_back(msg.size());
+  msg.insert(msg.end(), { 1, 'z', 0xC0, (unsigned char)roff });
+
+  /* Twice, the second time everything pointed to is already known */
+  for (size_t pass = 0; pass < 2; pass++) {
+    for (size_t hostname = 0; hostname < 2; hostname++) {
+      for (i = 0; i < offsets.size(); i++) {
+        ares_buf_t   *buf     = ares_buf_create_const(msg.data(), msg.size());
+        ares_buf_t   *namebuf = ares_buf_create();
+        const char   *name    = NULL;
+        char         *expect  = NULL;
+        ares_status_t status;
+        ares_status_t expect_status;
+
+        ares_buf_set_position(buf, offsets[i]);
+        expect_status = ares_dns_name_parse(buf, &expect,
+                                            hostname ? ARES_TRUE : ARES_FALSE,
+                                            ARES_TRUE);
+        size_t expect_pos = ares_buf_get_position(buf);
+
+        ares_buf_set_position(buf, offsets[i]);
+        status = ares_dns_name_parse_into(buf, namebuf, &memo, &name,
+                                          hostname ? ARES_TRUE : ARES_FALSE,
+                                          ARES_TRUE);
+        EXPECT_EQ(expect_status, status) << pass << " " << hostname << " "
+                                         << i;
+        if (status == ARES_SUCCESS && expect_status == ARES_SUCCESS) {
+          EXPECT_STREQ(expect, name) << pass << " " << hostname << " " << i;
+          EXPECT_EQ(expect_pos, ares_buf_get_position(buf));
+        }
+
+        ares_free(expect);
+        ares_buf_destroy(namebuf);
+        ares_buf_destroy(buf);
+      }
+    }
+  }
+
+  ares_dns_name_memo_destroy(memo);
+  ares_dns_name_memo_destroy(NULL);
+}
+
+TEST_F(LibraryTest, DNSNameCompressionManyNames) {
+  ares_dns_record_t *dnsrec = NULL;
+  ares_dns_record_t *parsed = NULL;
+  ares_dns_rr_t     *rr     = NULL;
+  unsigned char     *msg    = NULL;
+  size_t             msglen = 0;
+  struct in_addr     addr;
+  /* 12 hdr + 21 question */
+  size_t             expected = 33;
+
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_create(&dnsrec, 0x1234, ARES_FLAG_QR,
+      ARES_OPCODE_QUERY, ARES_RCODE_NOERROR));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_query_add(dnsrec, "sub.example.com", ARES_REC_TYPE_A,
+      ARES_CLASS_IN));
+
+  /* Each owner name is written twice.  The first occurrence is a single label
+   * plus a pointer to the question, the second a pointer to the first. */
+  memset(&addr, 0, sizeof(addr));
+  for (size_t i = 0; i < 300; i++) {
+    std::string name = "host" + std::to_string(i) + ".sub.example.com";
+    for (size_t j = 0; j < 2; j++) {
+      EXPECT_EQ(ARES_SUCCESS,
+        ares_dns_record_rr_add(&rr, dnsrec, ARES_SECTION_ANSWER, name.c_str(),
+          ARES_REC_TYPE_A, ARES_CLASS_IN, 300));
+      EXPECT_EQ(ARES_SUCCESS, ares_dns_rr_set_addr(rr, ARES_RR_A_ADDR, &addr));
+    }
+    expected += (1 + 4 + std::to_string(i).size() + 2) + 14 + 16;
+  }
+
+  /* An escaped separator is not a label boundary, so this must not be
+   * compressed against "sub.example.com" */
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_rr_add(&rr, dnsrec, ARES_SECTION_ANSWER,
+      "a\\.sub.example.com", ARES_REC_TYPE_A, ARES_CLASS_IN, 300));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_rr_set_addr(rr, ARES_RR_A_ADDR, &addr));
+  expected += 1 + 5 + 1 + 7 + 1 + 3 + 1 + 14;
+
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_write(dnsrec, &msg, &msglen));
+  EXPECT_EQ(expected, msglen);
+
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_parse(msg, msglen, 0, &parsed));
+  ASSERT_NE(nullptr, parsed);
+  EXPECT_EQ(601U, ares_dns_record_rr_cnt(parsed, ARES_SECTION_ANSWER));
+  EXPECT_STREQ("host299.sub.example.com",
+    ares_dns_rr_get_name(
+      ares_dns_record_rr_get_const(parsed, ARES_SECTION_ANSWER, 599)));
+  EXPECT_STREQ("a\\.sub.example.com",
+    ares_dns_rr_get_name(
+      ares_dns_record_rr_get_const(parsed, ARES_SECTION_ANSWER, 600)));
+
+  ares_dns_record_destroy(parsed);
+  ares_free_string(msg);
+  ares_dns_record_destroy(dnsrec);
+}
+
 #ifndef CARES_SYMBOL_HIDING
 /* Regression coverage for the zero-length salt/type-bitmap code paths in
 * NSEC3 and NSEC3PARAM (empty non-terminal / opt-out per RFC 5155 7.1),
@@ -2598,6 +3595,422 @@ TEST_F(LibraryTest, DNSParseFlags) {
   ares_free_string(msg); msg = NULL;
 }
 
+TEST_F(LibraryTest, DNSParseArenaModify) {
+  ares_dns_record_t      *dnsrec = NULL;
+  ares_dns_rr_t          *rr     = NULL;
+  ares_dns_multistring_t *strs   = NULL;
+  struct in_addr          addr;
+  unsigned char          *msg    = NULL;
+  size_t                  msglen = 0;
+  const unsigned char    *bin;
+  const unsigned char    *val;
+  size_t                  len;
+  const unsigned char     nsid[] = { 'n', 's', 'i', 'd' };
+  const unsigned char     data[] = { 0x01, 0x02, 0x03 };
+
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_create(&dnsrec, 0x1234, ARES_FLAG_QR|ARES_FLAG_RD,
+      ARES_OPCODE_QUERY, ARES_RCODE_NOERROR));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_query_add(dnsrec, "example.com", ARES_REC_TYPE_ANY,
+      ARES_CLASS_IN));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_rr_add(&rr, dnsrec, ARES_SECTION_ANSWER, "example.com",
+      ARES_REC_TYPE_A, ARES_CLASS_IN, 300));
+  EXPECT_LT(0, ares_inet_pton(AF_INET, "1.1.1.1", &addr));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_rr_set_addr(rr, ARES_RR_A_ADDR, &addr));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_rr_add(&rr, dnsrec, ARES_SECTION_ANSWER, "example.com",
+      ARES_REC_TYPE_TXT, ARES_CLASS_IN, 300));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_rr_add_abin(rr, ARES_RR_TXT_DATA, (const unsigned char *)"txt",
+      3));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_rr_add(&rr, dnsrec, ARES_SECTION_AUTHORITY,
+      "example.com", ARES_REC_TYPE_NS, ARES_CLASS_IN, 38400));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_rr_set_str(rr, ARES_RR_NS_NSDNAME, "ns1.example.com"));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_rr_add(&rr, dnsrec, ARES_SECTION_ADDITIONAL, "",
+      ARES_REC_TYPE_OPT, ARES_CLASS_IN, 0));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_rr_set_u16(rr, ARES_RR_OPT_UDP_SIZE, 1232));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_rr_set_opt(rr, ARES_RR_OPT_OPTIONS, 3, nsid, sizeof(nsid)));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_write(dnsrec, &msg, &msglen));
+  ares_dns_record_destroy(dnsrec);
+  dnsrec = NULL;
+
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_parse(msg, msglen, ARES_DNS_PARSE_ARENA, &dnsrec));
+  ares_free_string(msg);
+  msg = NULL;
+
+  /* Replace values with both copied and caller-allocated data */
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_query_set_name(dnsrec, 0, "www.example.com"));
+
+  rr = ares_dns_record_rr_get(dnsrec, ARES_SECTION_ANSWER, 1);
+  EXPECT_EQ(ARES_REC_TYPE_TXT, ares_dns_rr_get_type(rr));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_rr_add_abin(rr, ARES_RR_TXT_DATA, data, sizeof(data)));
+  EXPECT_EQ(2, ares_dns_rr_get_abin_cnt(rr, ARES_RR_TXT_DATA));
+  strs = ares_dns_multistring_create();
+  EXPECT_NE(nullptr, strs);
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_multistring_add_own(strs,
+      (unsigned char *)ares_strdup("replaced"), 8));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_rr_set_abin_own(rr, ARES_RR_TXT_DATA, strs));
+  EXPECT_EQ(1, ares_dns_rr_get_abin_cnt(rr, ARES_RR_TXT_DATA));
+  bin = ares_dns_rr_get_abin(rr, ARES_RR_TXT_DATA, 0, &len);
+  EXPECT_EQ(8, len);
+  EXPECT_EQ(0, memcmp(bin, "replaced", 8));
+
+  rr = ares_dns_record_rr_get(dnsrec, ARES_SECTION_AUTHORITY, 0);
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_rr_set_str_own(rr, ARES_RR_NS_NSDNAME,
+      ares_strdup("ns2.example.com")));
+  EXPECT_EQ(std::string("ns2.example.com"),
+    std::string(ares_dns_rr_get_str(rr, ARES_RR_NS_NSDNAME)));
+
+  rr = ares_dns_record_rr_get(dnsrec, ARES_SECTION_ADDITIONAL, 0);
+  EXPECT_EQ(ARES_REC_TYPE_OPT, ares_dns_rr_get_type(rr));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_rr_set_opt(rr, ARES_RR_OPT_OPTIONS, 3, data, sizeof(data)));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_rr_set_opt_own(rr, ARES_RR_OPT_OPTIONS, 10,
+      (unsigned char *)ares_strdup("cookie"), 6));
+  EXPECT_EQ(2, ares_dns_rr_get_opt_cnt(rr, ARES_RR_OPT_OPTIONS));
+  EXPECT_TRUE(ares_dns_rr_get_opt_byid(rr, ARES_RR_OPT_OPTIONS, 3, &val,
+    &len));
+  EXPECT_EQ(sizeof(data), len);
+  EXPECT_EQ(0, memcmp(val, data, sizeof(data)));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_rr_del_opt_byid(rr, ARES_RR_OPT_OPTIONS, 3));
+
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_rr_add(&rr, dnsrec, ARES_SECTION_ANSWER,
+      "www.example.com", ARES_REC_TYPE_PTR, ARES_CLASS_IN, 60));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_rr_set_str(rr, ARES_RR_PTR_DNAME, "ptr.example.com"));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_rr_del(dnsrec, ARES_SECTION_ANSWER, 0));
+
+  /* Writing and reparsing sees all modifications */
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_write(dnsrec, &msg, &msglen));
+  ares_dns_record_destroy(dnsrec);
+  dnsrec = NULL;
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_parse(msg, msglen, 0, &dnsrec));
+  ares_free_string(msg);
+
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_query_get(dnsrec, 0, (const char **)&val, NULL, NULL));
+  EXPECT_EQ(std::string("www.example.com"), std::string((const char *)val));
+  EXPECT_EQ(2, ares_dns_record_rr_cnt(dnsrec, ARES_SECTION_ANSWER));
+  rr = ares_dns_record_rr_get(dnsrec, ARES_SECTION_ANSWER, 1);
+  EXPECT_EQ(std::string("ptr.example.com"),
+    std::string(ares_dns_rr_get_str(rr, ARES_RR_PTR_DNAME)));
+  rr = ares_dns_record_rr_get(dnsrec, ARES_SECTION_ADDITIONAL, 0);
+  EXPECT_EQ(1, ares_dns_rr_get_opt_cnt(rr, ARES_RR_OPT_OPTIONS));
+  EXPECT_TRUE(ares_dns_rr_get_opt_byid(rr, ARES_RR_OPT_OPTIONS, 10, &val,
+    &len));
+  EXPECT_EQ(6, len);
+  ares_dns_record_destroy(dnsrec);
+}
+
+TEST_F(LibraryTest, DNSParseLazy) {
+  ares_dns_record_t   *dnsrec  = NULL;
+  ares_dns_record_t   *lazyrec = NULL;
+  ares_dns_rr_t       *rr      = NULL;
+  struct in_addr       addr;
+  unsigned char       *msg     = NULL;
+  size_t               msglen  = 0;
+  unsigned char       *lazymsg = NULL;
+  size_t               lazylen = 0;
+
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_create(&dnsrec, 0x1234, ARES_FLAG_QR|ARES_FLAG_RD,
+      ARES_OPCODE_QUERY, ARES_RCODE_BADCOOKIE));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_query_add(dnsrec, "example.com", ARES_REC_TYPE_A,
+      ARES_CLASS_IN));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_rr_add(&rr, dnsrec, ARES_SECTION_ANSWER, "example.com",
+      ARES_REC_TYPE_A, ARES_CLASS_IN, 300));
+  EXPECT_LT(0, ares_inet_pton(AF_INET, "1.2.3.4", &addr));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_rr_set_addr(rr, ARES_RR_A_ADDR, &addr));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_rr_add(&rr, dnsrec, ARES_SECTION_AUTHORITY,
+      "example.com", ARES_REC_TYPE_SOA, ARES_CLASS_IN, 3600));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_rr_set_str(rr, ARES_RR_SOA_MNAME, "ns1.example.com"));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_rr_set_str(rr, ARES_RR_SOA_RNAME, "admin.example.com"));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_rr_set_u32(rr, ARES_RR_SOA_MINIMUM, 60));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_rr_add(&rr, dnsrec, ARES_SECTION_ADDITIONAL,
+      "ns1.example.com", ARES_REC_TYPE_MX, ARES_CLASS_IN, 300));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_rr_set_str(rr, ARES_RR_MX_EXCHANGE, "mx.example.com"));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_record_rr_add(&rr, dnsrec, ARES_SECTION_ADDITIONAL, "",
+      ARES_REC_TYPE_OPT, ARES_CLASS_IN, 0));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_rr_set_u16(rr, ARES_RR_OPT_UDP_SIZE, 1232));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_write(dnsrec, &msg, &msglen));
+  ares_dns_record_destroy(dnsrec);
+
+  /* The extended rcode from the still undecoded OPT RR is available */
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_parse(msg, msglen, ARES_DNS_PARSE_LAZY, &lazyrec));
+  EXPECT_EQ(ARES_RCODE_BADCOOKIE, ares_dns_record_get_rcode(lazyrec));
+  EXPECT_EQ(1, ares_dns_record_rr_cnt(lazyrec, ARES_SECTION_ANSWER));
+  EXPECT_EQ(1, ares_dns_record_rr_cnt(lazyrec, ARES_SECTION_AUTHORITY));
+  EXPECT_EQ(2, ares_dns_record_rr_cnt(lazyrec, ARES_SECTION_ADDITIONAL));
+
+  rr = ares_dns_record_rr_get(lazyrec, ARES_SECTION_AUTHORITY, 0);
+  EXPECT_EQ(std::string("example.com"), std::string(ares_dns_rr_get_name(rr)));
+  EXPECT_EQ(std::string("admin.example.com"),
+    std::string(ares_dns_rr_get_str(rr, ARES_RR_SOA_RNAME)));
+  EXPECT_EQ(60, ares_dns_rr_get_u32(rr, ARES_RR_SOA_MINIMUM));
+
+  /* Writing decodes the rest and yields the same message as eager parsing */
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_write(lazyrec, &lazymsg, &lazylen));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_parse(msg, msglen, 0, &dnsrec));
+  ares_free_string(msg);
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_write(dnsrec, &msg, &msglen));
+  EXPECT_EQ(msglen, lazylen);
+  EXPECT_EQ(0, memcmp(msg, lazymsg, msglen));
+  ares_free_string(lazymsg);
+  ares_free_string(msg);
+  ares_dns_record_destroy(dnsrec);
+  ares_dns_record_destroy(lazyrec);
+
+  /* NS record whose target is a forward compression pointer */
+  const unsigned char badrdata[] = {
+    0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+    0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+    0x00, 0x01, 0x00, 0x01,
+    0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c, 0x00, 0x04,
+    0x01, 0x02, 0x03, 0x04,
+    0xc0, 0x0c, 0x00, 0x02, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c, 0x00, 0x02,
+    0xc0, 0xff };
+
+  EXPECT_NE(ARES_SUCCESS,
+    ares_dns_parse(badrdata, sizeof(badrdata), 0, &dnsrec));
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_parse(badrdata, sizeof(badrdata),
+      ARES_DNS_PARSE_LAZY | ARES_DNS_PARSE_ARENA, &lazyrec));
+  rr = ares_dns_record_rr_get(lazyrec, ARES_SECTION_ANSWER, 0);
+  EXPECT_EQ(ARES_REC_TYPE_A, ares_dns_rr_get_type(rr));
+  EXPECT_EQ(nullptr, ares_dns_record_rr_get(lazyrec, ARES_SECTION_ANSWER, 1));
+  EXPECT_EQ(nullptr,
+    ares_dns_record_rr_get_const(lazyrec, ARES_SECTION_ANSWER, 1));
+  /* Counting drops it, so everything counted can be retrieved */
+  EXPECT_EQ(1, ares_dns_record_rr_cnt(lazyrec, ARES_SECTION_ANSWER));
+  EXPECT_EQ(nullptr, ares_dns_record_rr_get(lazyrec, ARES_SECTION_ANSWER, 1));
+  ares_dns_record_destroy(lazyrec);
+
+  EXPECT_EQ(ARES_SUCCESS,
+    ares_dns_parse(badrdata, sizeof(badrdata), ARES_DNS_PARSE_LAZY, &lazyrec));
+  EXPECT_EQ(1, ares_dns_record_rr_cnt(lazyrec, ARES_SECTION_ANSWER));
+  rr = ares_dns_record_rr_get(lazyrec, ARES_SECTION_ANSWER, 0);
+  EXPECT_EQ(ARES_REC_TYPE_A, ares_dns_rr_get_type(rr));
+  ares_dns_record_destroy(lazyrec);
+
+  /* Structural errors are still caught up front */
+  EXPECT_NE(ARES_SUCCESS,
+    ares_dns_parse(badrdata, sizeof(badrdata) - 1, ARES_DNS_PARSE_LAZY,
+      &lazyrec));
+}
+
+// ares_scan_addrttl() must match parsing the response into an addrinfo, for
+// every truncation of it too, whenever it doesn't defer to that.
+TEST_F(LibraryTest, ScanAddrttlMatchesParse) {
+  std::vector<std::vector<byte>> msgs;
+  DNSPacket                      pkt1;
+  DNSPacket                      pkt2;
+  DNSPacket                      pkt3;
+
+  pkt1.set_qid(0x1234).set_response().set_rd().set_ra()
+    .add_question(new DNSQuestion("www.example.com", T_A))
+    .add_answer(new DNSCnameRR("www.example.com", 300, "a.example.com"))
+    .add_answer(new DNSCnameRR("a.example.com", 60, "b.example.com"))
+    .add_answer(new DNSARR("b.example.com", 500, {1, 2, 3, 4}))
+    .add_answer(new DNSARR("b.example.com", 30, {1, 2, 3, 5}))
+    .add_answer(new DNSAaaaRR("b.example.com", 30,
+                              {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+                               0, 0, 0, 0, 0, 0, 0, 0x01}))
+    .add_additional(new DNSOptRR(0, 0, 0, 1280, { }, { }, false));
+  msgs.push_back(pkt1.data());
+
+  pkt2.set_qid(0x1234).set_response()
+    .add_question(new DNSQuestion("example.com", T_AAAA))
+    .add_answer(new DNSAaaaRR("example.com", 100,
+                              {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+                               0, 0, 0, 0, 0, 0, 0, 0x02}))
+    .add_answer(new DNSARR("example.com", 100, {5, 6, 7, 8}))
+    .add_additional(new DNSARR("other.example.com", 100, {9, 9, 9, 9}));
+  msgs.push_back(pkt2.data());
+
+  pkt3.set_qid(0x1234).set_response()
+    .add_question(new DNSQuestion("mit.edu", T_A))
+    .add_answer(new DNSARR("mit.edu", 52, {18, 7, 22, 69}))
+    .add_auth(new DNSNsRR("mit.edu", 292, "W20NS.mit.edu"));
+  msgs.push_back(pkt3.data());
+
+  for (size_t m = 0; m < msgs.size(); m++) {
+    const std::vector<byte> &data = msgs[m];
+    for (size_t len = 1; len <= data.size(); len++) {
+      int families[] = { AF_INET, AF_INET6 };
+      for (int family : families) {
+        struct ares_addrttl  info[4];
+        struct ares_addrttl  fullinfo[4];
+        struct ares_addr6ttl info6[4];
+        struct ares_addr6ttl fullinfo6[4];
+        size_t               count     = 0;
+        size_t               fullcount = 0;
+        struct ares_addrinfo ai;
+        ares_arena_t        *arena  = ares_arena_create(0);
+        ares_dns_record_t   *dnsrec = NULL;
+        ares_status_t        status;
+        ares_status_t        fullstatus;
+
+        memset(&ai, 0, sizeof(ai));
+        status = ares_scan_addrttl(data.data(), len, family, 4, info, info6,
+                                   &count);
+        fullstatus = ares_dns_parse(data.data(), len, 0, &dnsrec);
+        if (fullstatus == ARES_SUCCESS) {
+          fullstatus =
+            ares_parse_into_addrinfo(dnsrec, ARES_FALSE, 0, arena, &ai);
+        }
+        if (fullstatus == ARES_SUCCESS) {
+          ares_addrinfo2addrttl(&ai, family, 4, fullinfo, fullinfo6,
+                                &fullcount);
+        }
+        ares_arena_destroy(arena);
+        ares_dns_record_destroy(dnsrec);
+
+        /* Only the last message needs a full parse, and only when whole */
+        if (len == data.size()) {
+          EXPECT_EQ(m == 2, status == ARES_ENOTIMP) << m;
+          if (m == 2) {
+            continue;
+          }
+        }
+        if (status == ARES_ENOTIMP) {
+          EXPECT_NE(ARES_SUCCESS, fullstatus) << m << " " << len;
+          EXPECT_NE(ARES_ENODATA, fullstatus) << m << " " << len;
+          continue;
+        }
+        EXPECT_EQ(fullstatus, status) << m << " " << len;
+        EXPECT_EQ(fullcount, count) << m << " " << len;
+        if (family == AF_INET) {
+          EXPECT_EQ(0, memcmp(info, fullinfo, sizeof(*info) * count));
+        } else {
+          EXPECT_EQ(0, memcmp(info6, fullinfo6, sizeof(*info6) * count));
+        }
+      }
+    }
+  }
+}
+
+TEST_F(LibraryTest, Arena) {
+  ares_arena_t *arena = ares_arena_create(0);
+  void         *ptrs[64];
+  size_t        i;
+
+  EXPECT_NE(nullptr, arena);
+  for (i = 0; i < 64; i++) {
+    ptrs[i] = ares_arena_alloc_zero(arena, 100 + i);
+    EXPECT_NE(nullptr, ptrs[i]);
+    EXPECT_EQ(0, ((size_t)ptrs[i]) % sizeof(void *));
+    EXPECT_TRUE(ares_arena_owns(arena, ptrs[i]));
+    memset(ptrs[i], (int)i, 100 + i);
+  }
+  for (i = 0; i < 64; i++) {
+    EXPECT_EQ((unsigned char)i, ((unsigned char *)ptrs[i])[99 + i]);
+  }
+
+  char *str = ares_arena_strdup(arena, "hello");
+  EXPECT_EQ(std::string("hello"), std::string(str));
+  EXPECT_FALSE(ares_arena_owns(arena, &i));
+  EXPECT_EQ(nullptr, ares_arena_alloc(NULL, 1));
+  EXPECT_EQ(nullptr, ares_arena_strdup(arena, NULL));
+  ares_arena_destroy(arena);
+  ares_arena_destroy(NULL);
+}
+
+TEST_F(LibraryTest, AddrinfoPack) {
+  ares_arena_t               *arena = ares_arena_create(0);
+  struct ares_addrinfo       *ai    = ares_addrinfo_create(arena);
+  struct ares_addrinfo       *packed;
+  struct ares_addrinfo_cname *cname;
+  struct ares_addrinfo_node  *node;
+  struct in_addr              addr4;
+  struct ares_in6_addr        addr6;
+
+  EXPECT_NE(nullptr, ai);
+  ai->name = ares_arena_strdup(arena, "www.example.com");
+
+  memset(&addr4, 0, sizeof(addr4));
+  memset(&addr6, 0, sizeof(addr6));
+  addr4.s_addr            = htonl(0x01020304);
+  addr6._S6_un._S6_u8[15] = 1;
+  EXPECT_EQ(ARES_SUCCESS, ares_append_ai_node(AF_INET, 80, 100, &addr4, arena,
+                                              &ai->nodes));
+  EXPECT_EQ(ARES_SUCCESS, ares_append_ai_node(AF_INET6, 80, 200, &addr6,
+                                              arena, &ai->nodes));
+  cname        = ares_append_addrinfo_cname(arena, &ai->cnames);
+  cname->ttl   = 50;
+  cname->alias = ares_arena_strdup(arena, "www.example.com");
+  cname->name  = ares_arena_strdup(arena, "example.com");
+  cname        = ares_append_addrinfo_cname(arena, &ai->cnames);
+  cname->name  = ares_arena_strdup(arena, "example.com");
+
+  packed = ares_addrinfo_pack(ai);
+  EXPECT_NE(nullptr, packed);
+  /* The packed copy doesn't depend on the arena */
+  ares_arena_destroy(arena);
+  EXPECT_EQ(std::string("www.example.com"), std::string(packed->name));
+
+  node = packed->nodes;
+  EXPECT_EQ(AF_INET, node->ai_family);
+  EXPECT_EQ(100, node->ai_ttl);
+  EXPECT_EQ(0, ((size_t)node->ai_addr) % sizeof(void *));
+  EXPECT_EQ(htonl(0x01020304),
+            ((struct sockaddr_in *)((void *)node->ai_addr))->sin_addr.s_addr);
+  EXPECT_EQ(htons(80),
+            ((struct sockaddr_in *)((void *)node->ai_addr))->sin_port);
+  node = node->ai_next;
+  EXPECT_EQ(AF_INET6, node->ai_family);
+  EXPECT_EQ(200, node->ai_ttl);
+  EXPECT_EQ(0, ((size_t)node->ai_addr) % sizeof(void *));
+  EXPECT_EQ(0, memcmp(&addr6,
+                      &((struct sockaddr_in6 *)((void *)node->ai_addr))
+                         ->sin6_addr,
+                      sizeof(addr6)));
+  EXPECT_EQ(nullptr, node->ai_next);
+
+  cname = packed->cnames;
+  EXPECT_EQ(50, cname->ttl);
+  EXPECT_EQ(std::string("www.example.com"), std::string(cname->alias));
+  EXPECT_EQ(std::string("example.com"), std::string(cname->name));
+  cname = cname->next;
+  EXPECT_EQ(nullptr, cname->alias);
+  EXPECT_EQ(std::string("example.com"), std::string(cname->name));
+  EXPECT_EQ(nullptr, cname->next);
+  ares_freeaddrinfo(packed);
+
+  /* Empty results pack too */
+  arena  = ares_arena_create(0);
+  packed = ares_addrinfo_pack(ares_addrinfo_create(arena));
+  ares_arena_destroy(arena);
+  EXPECT_EQ(nullptr, packed->nodes);
+  EXPECT_EQ(nullptr, packed->cnames);
+  EXPECT_EQ(nullptr, packed->name);
+  ares_freeaddrinfo(packed);
+  EXPECT_EQ(nullptr, ares_addrinfo_pack(NULL));
+  EXPECT_EQ(nullptr, ares_addrinfo_create(NULL));
+}
+
 TEST_F(LibraryTest, ArrayMisuse) {
   EXPECT_EQ(NULL, ares_array_create(0, NULL));
   ares_array_destroy(NULL);
@@ -169,6 +169,14 @@ TEST_F(DefaultChannelTest, SetServersCSV) {
   EXPECT_EQ(expected2, GetNameServers(channel2));
   ares_destroy(channel2);
 
+  // Including differing udp and tcp ports
+  std::string expected3 = {"dns://1.2.3.4:54?tcpport=55,2.3.4.5:55"};
+  EXPECT_EQ(ARES_SUCCESS, ares_set_servers_ports_csv(channel_, expected3.c_str()));
+  EXPECT_EQ(expected3, GetNameServers(channel_));
+  EXPECT_EQ(ARES_SUCCESS, ares_dup(&channel2, channel_));
+  EXPECT_EQ(expected3, GetNameServers(channel2));
+  ares_destroy(channel2);
+
   // Allocation failure cases
   for (int fail = 1; fail <= 5; fail++) {
     SetAllocFail(fail);
@@ -719,6 +727,53 @@ TEST_F(LibraryTest, DNSMapping) {
   }
 }
 
+TEST_F(LibraryTest, DNSMappingFromStr) {
+  ares_dns_class_t classes[] = {
+    ARES_CLASS_IN, ARES_CLASS_CHAOS, ARES_CLASS_HESIOD, ARES_CLASS_NONE,
+    ARES_CLASS_ANY
+  };
+  const char *bogus[] = {
+    "", "B", "AAAAA", "NSEC4", "NSEC3PARAMS", "RAW-RR", "RAWRR", "SVC", "CH3",
+    "IM", "NON", "XANY"
+  };
+  ares_dns_rec_type_t type;
+  ares_dns_class_t    qclass;
+
+  for (unsigned int t = 0; t <= ARES_REC_TYPE_RAW_RR; t++) {
+    ares_dns_rec_type_t qtype = (ares_dns_rec_type_t)t;
+    const char         *name  = ares_dns_rec_type_tostr(qtype);
+
+    if (std::string(name) == "UNKNOWN") {
+      continue;
+    }
+    EXPECT_TRUE(ares_dns_rec_type_fromstr(&type, name)) << name;
+    EXPECT_EQ(qtype, type);
+
+    /* Case insensitive */
+    std::string lower(name);
+    for (size_t i = 0; i < lower.size(); i++) {
+      lower[i] = (char)tolower((unsigned char)lower[i]);
+    }
+    EXPECT_TRUE(ares_dns_rec_type_fromstr(&type, lower.c_str())) << lower;
+    EXPECT_EQ(qtype, type);
+  }
+
+  for (size_t i = 0; i < sizeof(classes) / sizeof(*classes); i++) {
+    const char *name = ares_dns_class_tostr(classes[i]);
+    EXPECT_TRUE(ares_dns_class_fromstr(&qclass, name)) << name;
+    EXPECT_EQ(classes[i], qclass);
+  }
+  EXPECT_TRUE(ares_dns_class_fromstr(&qclass, "hs"));
+  EXPECT_EQ(ARES_CLASS_HESIOD, qclass);
+
+  for (size_t i = 0; i < sizeof(bogus) / sizeof(*bogus); i++) {
+    EXPECT_FALSE(ares_dns_rec_type_fromstr(&type, bogus[i])) << bogus[i];
+    EXPECT_FALSE(ares_dns_class_fromstr(&qclass, bogus[i])) << bogus[i];
+  }
+  EXPECT_FALSE(ares_dns_rec_type_fromstr(&type, NULL));
+  EXPECT_FALSE(ares_dns_class_fromstr(&qclass, NULL));
+}
+
 TEST_F(LibraryTest, StrError) {
   ares_status_t status[] = {
     ARES_SUCCESS, ARES_ENODATA, ARES_EFORMERR, ARES_ESERVFAIL, ARES_ENOTFOUND,
@@ -26,6 +26,10 @@
 #include "ares-test-ai.h"
 #include "dns-proto.h"
 
+extern "C" {
+  #include "ares_private.h"
+}
+
 #ifdef HAVE_NETINET_IN_H
 #include <netinet/in.h>
 #endif
@@ -645,6 +649,86 @@ TEST_P(MockChannelTestAI, PartialQueryCancel) {
   EXPECT_EQ(ARES_ECANCELLED, result.status_);
 }
 
+struct AddrInfoStreamResult {
+  AddrInfoStreamResult() : calls_(0) {}
+  int            calls_;
+  // Last invocation with more set, and the final invocation.
+  AddrInfoResult partial_;
+  AddrInfoResult final_;
+};
+
+static void AddrInfoStreamCallback(void *data, int status, int timeouts,
+                                   struct ares_addrinfo *res, ares_bool_t more) {
+  AddrInfoStreamResult *result = reinterpret_cast<AddrInfoStreamResult*>(data);
+  result->calls_++;
+  EXPECT_FALSE(result->final_.done_);
+  AddrInfoCallback(more ? &result->partial_ : &result->final_, status,
+                   timeouts, res);
+}
+
+TEST_P(MockChannelTestAI, StreamPartialResult) {
+  std::vector<byte> nothing;
+  DNSPacket reply;
+  reply.set_response().set_aa()
+    .add_question(new DNSQuestion("example.com", T_A))
+    .add_answer(new DNSARR("example.com", 0x0100, {0x01, 0x02, 0x03, 0x04}));
+
+  ON_CALL(server_, OnRequest("example.com", T_A))
+    .WillByDefault(SetReply(&server_, &reply));
+
+  ON_CALL(server_, OnRequest("example.com", T_AAAA))
+    .WillByDefault(SetReplyData(&server_, nothing));
+
+  AddrInfoStreamResult result;
+  struct ares_addrinfo_hints hints = {0, 0, 0, 0};
+  hints.ai_family = AF_UNSPEC;
+  ares_getaddrinfo_stream(channel_, "example.com.", NULL, &hints,
+                          AddrInfoStreamCallback, &result);
+
+  // The A answer must be delivered without waiting for the AAAA timeout,
+  // the final result is then the cancellation.
+  Process(100);
+  EXPECT_TRUE(result.partial_.done_);
+  EXPECT_EQ(ARES_SUCCESS, result.partial_.status_);
+  EXPECT_THAT(result.partial_.ai_, IncludesNumAddresses(1));
+  EXPECT_THAT(result.partial_.ai_, IncludesV4Address("1.2.3.4"));
+  EXPECT_TRUE(result.final_.done_);
+  EXPECT_EQ(ARES_ECANCELLED, result.final_.status_);
+  EXPECT_EQ(2, result.calls_);
+}
+
+TEST_P(MockChannelTestAI, StreamBothFamilies) {
+  DNSPacket rsp6;
+  rsp6.set_response().set_aa()
+    .add_question(new DNSQuestion("example.com", T_AAAA))
+    .add_answer(new DNSAaaaRR("example.com", 100,
+                              {0x21, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                               0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x03}));
+  ON_CALL(server_, OnRequest("example.com", T_AAAA))
+    .WillByDefault(SetReply(&server_, &rsp6));
+  DNSPacket rsp4;
+  rsp4.set_response().set_aa()
+    .add_question(new DNSQuestion("example.com", T_A))
+    .add_answer(new DNSARR("example.com", 100, {2, 3, 4, 5}));
+  ON_CALL(server_, OnRequest("example.com", T_A))
+    .WillByDefault(SetReply(&server_, &rsp4));
+
+  AddrInfoStreamResult result;
+  struct ares_addrinfo_hints hints = {0, 0, 0, 0};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_flags = ARES_AI_NOSORT;
+  ares_getaddrinfo_stream(channel_, "example.com.", NULL, &hints,
+                          AddrInfoStreamCallback, &result);
+  Process();
+  EXPECT_EQ(2, result.calls_);
+  EXPECT_TRUE(result.partial_.done_);
+  EXPECT_TRUE(result.final_.done_);
+  EXPECT_EQ(ARES_SUCCESS, result.final_.status_);
+  // Each address is delivered exactly once
+  EXPECT_THAT(result.partial_.ai_, IncludesNumAddresses(1));
+  EXPECT_THAT(result.final_.ai_, IncludesNumAddresses(1));
+}
+
 TEST_P(MockChannelTestAI, FamilyV4) {
   DNSPacket rsp4;
   rsp4.set_response().set_aa()
@@ -713,6 +797,39 @@ TEST_P(MockChannelTestAI, FamilyUnspecified) {
   EXPECT_THAT(result.ai_, IncludesV6Address("2121:0000:0000:0000:0000:0000:0000:0303"));
 }
 
+TEST_P(MockChannelTestAI, AddrConfigNoIPv6) {
+  DNSPacket rsp4;
+  rsp4.set_response().set_aa()
+    .add_question(new DNSQuestion("example.com", T_A))
+    .add_answer(new DNSARR("example.com", 100, {2, 3, 4, 5}));
+  EXPECT_CALL(server_, OnRequest("example.com", T_A))
+    .WillOnce(SetReply(&server_, &rsp4));
+  EXPECT_CALL(server_, OnRequest("example.com", T_AAAA)).Times(0);
+
+  // The host only has an IPv4 address, and an IPv6 link-local one which isn't
+  // enough to reach anything, so no AAAA query is worth sending
+  struct ares_addr addrs[2];
+  memset(addrs, 0, sizeof(addrs));
+  addrs[0].family = AF_INET;
+  ares_inet_pton(AF_INET, "192.0.2.1", &addrs[0].addr.addr4);
+  addrs[1].family = AF_INET6;
+  ares_inet_pton(AF_INET6, "fe80::1", &addrs[1].addr.addr6);
+  EXPECT_EQ(ARES_SUCCESS, ares_iface_ips_cache_set("eth0", addrs, 2));
+
+  AddrInfoResult result;
+  struct ares_addrinfo_hints hints = {0, 0, 0, 0};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_flags = ARES_AI_NOSORT | ARES_AI_ADDRCONFIG;
+  ares_getaddrinfo(channel_, "example.com.", NULL, &hints,
+                   AddrInfoCallback, &result);
+  Process();
+  ares_iface_ips_cache_invalidate();
+  EXPECT_TRUE(result.done_);
+  EXPECT_EQ(ARES_SUCCESS, result.status_);
+  std::stringstream ss;
+  ss << result.ai_;
+  EXPECT_EQ("{addr=[2.3.4.5]}", ss.str());
+}
 
 TEST_P(MockChannelTestAI, TriggerResendThenConnFailSERVFAIL) {
   // Set up the server response. The server always returns SERVFAIL.
@@ -867,6 +984,134 @@ TEST_P(MockEDNSChannelTestAI, RetryWithoutEDNS) {
   EXPECT_THAT(result.ai_, IncludesV4Address("1.2.3.4"));
 }
 
+class MockParallelSearchChannelTestAI : public MockFlagsChannelOptsTestAI {
+ public:
+  MockParallelSearchChannelTestAI()
+    : MockFlagsChannelOptsTestAI(ARES_FLAG_PARALLEL_SEARCH) {}
+};
+
+TEST_P(MockParallelSearchChannelTestAI, HighestPriorityAnswer) {
+  DNSPacket nofirst4;
+  nofirst4.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www.first.com", T_A));
+  DNSPacket nofirst6;
+  nofirst6.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www.first.com", T_AAAA));
+  DNSPacket yessecond4;
+  yessecond4.set_response().set_aa()
+    .add_question(new DNSQuestion("www.second.org", T_A))
+    .add_answer(new DNSARR("www.second.org", 0x0200, {2, 3, 4, 5}));
+  DNSPacket nodatasecond6;
+  nodatasecond6.set_response().set_aa()
+    .add_question(new DNSQuestion("www.second.org", T_AAAA));
+  DNSPacket yesthird4;
+  yesthird4.set_response().set_aa()
+    .add_question(new DNSQuestion("www.third.gov", T_A))
+    .add_answer(new DNSARR("www.third.gov", 0x0200, {3, 4, 5, 6}));
+  DNSPacket nodatathird6;
+  nodatathird6.set_response().set_aa()
+    .add_question(new DNSQuestion("www.third.gov", T_AAAA));
+  DNSPacket nobare4;
+  nobare4.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www", T_A));
+  DNSPacket nobare6;
+  nobare6.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www", T_AAAA));
+
+  // Every candidate is queried, even though a sequential lookup would have
+  // stopped at the second one.
+  EXPECT_CALL(server_, OnRequest("www.first.com", T_A))
+    .WillOnce(SetReply(&server_, &nofirst4));
+  EXPECT_CALL(server_, OnRequest("www.first.com", T_AAAA))
+    .WillOnce(SetReply(&server_, &nofirst6));
+  EXPECT_CALL(server_, OnRequest("www.second.org", T_A))
+    .WillOnce(SetReply(&server_, &yessecond4));
+  EXPECT_CALL(server_, OnRequest("www.second.org", T_AAAA))
+    .WillOnce(SetReply(&server_, &nodatasecond6));
+  EXPECT_CALL(server_, OnRequest("www.third.gov", T_A))
+    .WillOnce(SetReply(&server_, &yesthird4));
+  EXPECT_CALL(server_, OnRequest("www.third.gov", T_AAAA))
+    .WillOnce(SetReply(&server_, &nodatathird6));
+  EXPECT_CALL(server_, OnRequest("www", T_A))
+    .WillOnce(SetReply(&server_, &nobare4));
+  EXPECT_CALL(server_, OnRequest("www", T_AAAA))
+    .WillOnce(SetReply(&server_, &nobare6));
+
+  AddrInfoResult result;
+  struct ares_addrinfo_hints hints = {0, 0, 0, 0};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_flags = ARES_AI_NOSORT;
+  ares_getaddrinfo(channel_, "www", NULL, &hints, AddrInfoCallback, &result);
+  Process();
+  EXPECT_TRUE(result.done_);
+  EXPECT_EQ(ARES_SUCCESS, result.status_);
+  std::stringstream ss;
+  ss << result.ai_;
+  EXPECT_EQ("{addr=[2.3.4.5]}", ss.str());
+}
+
+TEST_P(MockParallelSearchChannelTestAI, StreamPartialResult) {
+  std::vector<byte> nothing;
+  DNSPacket nofirst4;
+  nofirst4.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www.first.com", T_A));
+  DNSPacket nofirst6;
+  nofirst6.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www.first.com", T_AAAA));
+  DNSPacket yessecond4;
+  yessecond4.set_response().set_aa()
+    .add_question(new DNSQuestion("www.second.org", T_A))
+    .add_answer(new DNSARR("www.second.org", 0x0200, {2, 3, 4, 5}));
+  DNSPacket yesthird4;
+  yesthird4.set_response().set_aa()
+    .add_question(new DNSQuestion("www.third.gov", T_A))
+    .add_answer(new DNSARR("www.third.gov", 0x0200, {3, 4, 5, 6}));
+  DNSPacket nodatathird6;
+  nodatathird6.set_response().set_aa()
+    .add_question(new DNSQuestion("www.third.gov", T_AAAA));
+  DNSPacket nobare4;
+  nobare4.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www", T_A));
+  DNSPacket nobare6;
+  nobare6.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www", T_AAAA));
+
+  ON_CALL(server_, OnRequest("www.first.com", T_A))
+    .WillByDefault(SetReply(&server_, &nofirst4));
+  ON_CALL(server_, OnRequest("www.first.com", T_AAAA))
+    .WillByDefault(SetReply(&server_, &nofirst6));
+  ON_CALL(server_, OnRequest("www.second.org", T_A))
+    .WillByDefault(SetReply(&server_, &yessecond4));
+  ON_CALL(server_, OnRequest("www.second.org", T_AAAA))
+    .WillByDefault(SetReplyData(&server_, nothing));
+  ON_CALL(server_, OnRequest("www.third.gov", T_A))
+    .WillByDefault(SetReply(&server_, &yesthird4));
+  ON_CALL(server_, OnRequest("www.third.gov", T_AAAA))
+    .WillByDefault(SetReply(&server_, &nodatathird6));
+  ON_CALL(server_, OnRequest("www", T_A))
+    .WillByDefault(SetReply(&server_, &nobare4));
+  ON_CALL(server_, OnRequest("www", T_AAAA))
+    .WillByDefault(SetReply(&server_, &nobare6));
+
+  AddrInfoStreamResult result;
+  struct ares_addrinfo_hints hints = {0, 0, 0, 0};
+  hints.ai_family = AF_UNSPEC;
+  ares_getaddrinfo_stream(channel_, "www", NULL, &hints,
+                          AddrInfoStreamCallback, &result);
+
+  // The highest priority name with an answer is streamed while its AAAA
+  // query is outstanding, the lower priority answer is never delivered.
+  Process(100);
+  EXPECT_TRUE(result.partial_.done_);
+  EXPECT_EQ(ARES_SUCCESS, result.partial_.status_);
+  std::stringstream ss;
+  ss << result.partial_.ai_;
+  EXPECT_EQ("{addr=[2.3.4.5]}", ss.str());
+  EXPECT_TRUE(result.final_.done_);
+  EXPECT_EQ(ARES_ECANCELLED, result.final_.status_);
+  EXPECT_EQ(2, result.calls_);
+}
+
 TEST_P(MockChannelTestAI, SearchDomains) {
   DNSPacket nofirst;
   nofirst.set_response().set_aa().set_rcode(NXDOMAIN)
@@ -1305,6 +1550,9 @@ INSTANTIATE_TEST_SUITE_P(AddressFamiliesAI, MockNoCheckRespChannelTestAI,
 INSTANTIATE_TEST_SUITE_P(AddressFamiliesAI, MockEDNSChannelTestAI,
 			::testing::ValuesIn(ares::test::families_modes), PrintFamilyMode);
 
+INSTANTIATE_TEST_SUITE_P(AddressFamiliesAI, MockParallelSearchChannelTestAI,
+			::testing::ValuesIn(ares::test::families_modes), PrintFamilyMode);
+
 INSTANTIATE_TEST_SUITE_P(TransportModesAI, NoRotateMultiMockTestAI,
 			::testing::ValuesIn(ares::test::families_modes), PrintFamilyMode);
 
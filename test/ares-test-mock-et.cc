@@ -35,6 +35,7 @@
 
 #include <sstream>
 #include <vector>
+#include <condition_variable>
 
 using testing::InvokeWithoutArgs;
 using testing::DoAll;
@@ -357,6 +358,225 @@ TEST_P(MockUDPEventThreadMaxQueriesTest, GetHostByNameParallelLookups) {
   }
 }
 
+#define MULTITHREAD_EVTHREADS 4
+#define MULTITHREAD_QUERIES   32
+
+class MockUDPEventThreadMultiTest
+    : public MockEventThreadOptsTest,
+      public ::testing::WithParamInterface<std::tuple<ares_evsys_t,int>> {
+ public:
+  MockUDPEventThreadMultiTest()
+    : MockEventThreadOptsTest(1, std::get<0>(GetParam()), std::get<1>(GetParam()), false,
+                          FillOptions(&opts_),
+                          ARES_OPT_UDP_MAX_QUERIES|ARES_OPT_EVENT_THREAD_CNT) {}
+  static struct ares_options* FillOptions(struct ares_options * opts) {
+    memset(opts, 0, sizeof(struct ares_options));
+    /* One query per connection so sockets get spread across all threads */
+    opts->udp_max_queries = 1;
+    opts->event_thread_cnt = MULTITHREAD_EVTHREADS;
+    return opts;
+  }
+ private:
+  struct ares_options opts_;
+};
+
+TEST_P(MockUDPEventThreadMultiTest, GetHostByNameParallelLookups) {
+  DNSPacket rsp;
+  rsp.set_response().set_aa()
+    .add_question(new DNSQuestion("www.google.com", T_A))
+    .add_answer(new DNSARR("www.google.com", 100, {2, 3, 4, 5}));
+  ON_CALL(server_, OnRequest("www.google.com", T_A))
+    .WillByDefault(SetReply(&server_, &rsp));
+
+  HostResult result[MULTITHREAD_QUERIES];
+  for (size_t i=0; i<MULTITHREAD_QUERIES; i++) {
+    ares_gethostbyname(channel_, "www.google.com.", AF_INET, HostCallback, &result[i]);
+  }
+
+  Process();
+
+  for (size_t i=0; i<MULTITHREAD_QUERIES; i++) {
+    std::stringstream ss;
+    EXPECT_TRUE(result[i].done_);
+    ss << result[i].host_;
+    EXPECT_EQ("{'www.google.com' aliases=[] addrs=[2.3.4.5]}", ss.str());
+  }
+
+  struct ares_options opts;
+  int optmask = 0;
+  memset(&opts, 0, sizeof(opts));
+  EXPECT_EQ(ARES_SUCCESS, ares_save_options(channel_, &opts, &optmask));
+  EXPECT_TRUE(optmask & ARES_OPT_EVENT_THREAD_CNT);
+  EXPECT_EQ((size_t)MULTITHREAD_EVTHREADS, opts.event_thread_cnt);
+  ares_destroy_options(&opts);
+}
+
+class MockEventThreadCallbackWorkersTest
+    : public MockEventThreadOptsTest,
+      public ::testing::WithParamInterface<std::tuple<ares_evsys_t,int>> {
+ public:
+  MockEventThreadCallbackWorkersTest()
+    : MockEventThreadOptsTest(1, std::get<0>(GetParam()), std::get<1>(GetParam()), false,
+                          FillOptions(&opts_),
+                          ARES_OPT_CALLBACK_WORKERS) {}
+  static struct ares_options* FillOptions(struct ares_options * opts) {
+    memset(opts, 0, sizeof(struct ares_options));
+    opts->callback_worker_opts.num_workers = 2;
+    return opts;
+  }
+ private:
+  struct ares_options opts_;
+};
+
+TEST_P(MockEventThreadCallbackWorkersTest, GetHostByNameParallelLookups) {
+  DNSPacket rsp;
+  rsp.set_response().set_aa()
+    .add_question(new DNSQuestion("www.google.com", T_A))
+    .add_answer(new DNSARR("www.google.com", 100, {2, 3, 4, 5}));
+  ON_CALL(server_, OnRequest("www.google.com", T_A))
+    .WillByDefault(SetReply(&server_, &rsp));
+
+  HostResult result[8];
+  for (size_t i=0; i<8; i++) {
+    ares_gethostbyname(channel_, "www.google.com.", AF_INET, HostCallback, &result[i]);
+  }
+
+  AddrInfoResult airesult;
+  struct ares_addrinfo_hints hints = {0, 0, 0, 0};
+  hints.ai_family = AF_INET;
+  ares_getaddrinfo(channel_, "www.google.com.", NULL, &hints, AddrInfoCallback, &airesult);
+
+  SearchResult sresult;
+  ares_search(channel_, "www.google.com.", C_IN, T_A, SearchCallback, &sresult);
+
+  /* Must wait for offloaded callbacks to be delivered too */
+  Process();
+
+  for (size_t i=0; i<8; i++) {
+    std::stringstream ss;
+    EXPECT_TRUE(result[i].done_);
+    ss << result[i].host_;
+    EXPECT_EQ("{'www.google.com' aliases=[] addrs=[2.3.4.5]}", ss.str());
+  }
+  EXPECT_TRUE(airesult.done_);
+  EXPECT_EQ(ARES_SUCCESS, airesult.status_);
+  std::stringstream ss;
+  ss << airesult.ai_;
+  EXPECT_EQ("{addr=[2.3.4.5]}", ss.str());
+  EXPECT_TRUE(sresult.done_);
+  EXPECT_EQ(ARES_SUCCESS, sresult.status_);
+}
+
+struct SlowCallbackState {
+  std::mutex              lock;
+  std::condition_variable cond;
+  bool                    fast_done = false;
+  bool                    slow_saw_fast = false;
+};
+
+static void SlowDnsrecCallback(void *arg, ares_status_t status, size_t timeouts,
+                               const ares_dns_record_t *dnsrec) {
+  SlowCallbackState *state = (SlowCallbackState *)arg;
+  (void)status;
+  (void)timeouts;
+  (void)dnsrec;
+  std::unique_lock<std::mutex> lk(state->lock);
+  state->cond.wait_for(lk, std::chrono::seconds(5),
+                       [state] { return state->fast_done; });
+  state->slow_saw_fast = state->fast_done;
+}
+
+static void FastDnsrecCallback(void *arg, ares_status_t status, size_t timeouts,
+                               const ares_dns_record_t *dnsrec) {
+  SlowCallbackState *state = (SlowCallbackState *)arg;
+  (void)status;
+  (void)timeouts;
+  (void)dnsrec;
+  std::lock_guard<std::mutex> lk(state->lock);
+  state->fast_done = true;
+  state->cond.notify_all();
+}
+
+TEST_P(MockEventThreadCallbackWorkersTest, SlowCallbackDoesNotStall) {
+  DNSPacket rsp1;
+  rsp1.set_response().set_aa()
+    .add_question(new DNSQuestion("www.slow.com", T_A))
+    .add_answer(new DNSARR("www.slow.com", 100, {2, 3, 4, 5}));
+  ON_CALL(server_, OnRequest("www.slow.com", T_A))
+    .WillByDefault(SetReply(&server_, &rsp1));
+  DNSPacket rsp2;
+  rsp2.set_response().set_aa()
+    .add_question(new DNSQuestion("www.fast.com", T_A))
+    .add_answer(new DNSARR("www.fast.com", 100, {1, 2, 3, 4}));
+  ON_CALL(server_, OnRequest("www.fast.com", T_A))
+    .WillByDefault(SetReply(&server_, &rsp2));
+
+  /* The slow callback blocks until the fast callback has been delivered,
+   * which can only happen if I/O keeps being processed while it runs */
+  SlowCallbackState state;
+  EXPECT_EQ(ARES_SUCCESS, ares_query_dnsrec(channel_, "www.slow.com", ARES_CLASS_IN,
+                                            ARES_REC_TYPE_A, SlowDnsrecCallback,
+                                            &state, NULL));
+  EXPECT_EQ(ARES_SUCCESS, ares_query_dnsrec(channel_, "www.fast.com", ARES_CLASS_IN,
+                                            ARES_REC_TYPE_A, FastDnsrecCallback,
+                                            &state, NULL));
+  Process();
+
+  EXPECT_TRUE(state.fast_done);
+  EXPECT_TRUE(state.slow_saw_fast);
+}
+
+struct RequeryState {
+  ares_channel_t *channel;
+  ares_status_t   first_status   = ARES_SUCCESS;
+  ares_status_t   requery_status = ARES_SUCCESS;
+  bool            requery_done   = false;
+};
+
+static void RequeryResultCallback(void *arg, ares_status_t status,
+                                  size_t timeouts,
+                                  const ares_dns_record_t *dnsrec) {
+  RequeryState *state = (RequeryState *)arg;
+  (void)timeouts;
+  (void)dnsrec;
+  state->requery_status = status;
+  state->requery_done   = true;
+}
+
+static void RequeryOnFailureCallback(void *arg, ares_status_t status,
+                                     size_t timeouts,
+                                     const ares_dns_record_t *dnsrec) {
+  RequeryState *state = (RequeryState *)arg;
+  (void)timeouts;
+  (void)dnsrec;
+  state->first_status = status;
+  ares_query_dnsrec(state->channel, "www.google.com", ARES_CLASS_IN,
+                    ARES_REC_TYPE_A, RequeryResultCallback, state, NULL);
+}
+
+TEST_P(MockEventThreadCallbackWorkersTest, RequeryDuringDestroy) {
+  std::vector<byte> nothing;
+  ON_CALL(server_, OnRequest("www.google.com", T_A))
+    .WillByDefault(SetReplyData(&server_, nothing));
+
+  /* The query is still outstanding when the channel is destroyed, and its
+   * callback runs on a worker and queries again while the servers and event
+   * thread still exist.  That query is failed as well rather than being left
+   * behind on a torn down channel. */
+  RequeryState state;
+  state.channel = channel_;
+  EXPECT_EQ(ARES_SUCCESS, ares_query_dnsrec(channel_, "www.google.com",
+                                            ARES_CLASS_IN, ARES_REC_TYPE_A,
+                                            RequeryOnFailureCallback, &state,
+                                            NULL));
+  ares_destroy(channel_);
+  channel_ = nullptr;
+
+  EXPECT_EQ(ARES_EDESTRUCTION, state.first_status);
+  EXPECT_TRUE(state.requery_done);
+  EXPECT_EQ(ARES_EDESTRUCTION, state.requery_status);
+}
+
 /* This test case is likely to fail in heavily loaded environments, it was
  * there to stress the windows event system.  Not needed to be on normally */
 #if 0
@@ -461,6 +681,56 @@ TEST_P(CacheQueriesEventThreadTest, GetHostByNameCache) {
   EXPECT_EQ(1, sock_cb_count);
 }
 
+TEST_P(CacheQueriesEventThreadTest, CacheHitsAreIndependentCopies) {
+  DNSPacket rsp;
+  rsp.set_response().set_aa()
+    .add_question(new DNSQuestion("www.google.com", T_A))
+    .add_answer(new DNSARR("www.google.com", 100, {2, 3, 4, 5}));
+  EXPECT_CALL(server_, OnRequest("www.google.com", T_A))
+    .WillOnce(SetReply(&server_, &rsp));
+
+  ares_dns_record_t *query = NULL;
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_record_create(&query, 0, ARES_FLAG_RD,
+                                                 ARES_OPCODE_QUERY,
+                                                 ARES_RCODE_NOERROR));
+  EXPECT_EQ(ARES_SUCCESS, ares_dns_record_query_add(query, "www.google.com",
+                                                    ARES_REC_TYPE_A,
+                                                    ARES_CLASS_IN));
+
+  /* Prime the cache, then hit it twice.  Only the first goes to the server,
+   * and each hit gets its own record decoded from the cached response. */
+  QueryResult result1;
+  EXPECT_EQ(ARES_SUCCESS, ares_send_dnsrec(channel_, query, QueryCallback,
+                                           &result1, NULL));
+  Process();
+  EXPECT_TRUE(result1.done_);
+  EXPECT_EQ(ARES_SUCCESS, result1.status_);
+
+  QueryResult result2;
+  QueryResult result3;
+  EXPECT_EQ(ARES_SUCCESS, ares_send_dnsrec(channel_, query, QueryCallback,
+                                           &result2, NULL));
+  EXPECT_EQ(ARES_SUCCESS, ares_send_dnsrec(channel_, query, QueryCallback,
+                                           &result3, NULL));
+  Process();
+  EXPECT_TRUE(result2.done_);
+  EXPECT_TRUE(result3.done_);
+  EXPECT_EQ(ARES_SUCCESS, result2.status_);
+  EXPECT_EQ(ARES_SUCCESS, result3.status_);
+  for (const QueryResult *result : { &result1, &result2, &result3 }) {
+    const ares_dns_record_t *dnsrec = result->dnsrec_.dnsrec_;
+    ASSERT_NE(nullptr, dnsrec);
+    ASSERT_EQ(1, (int)ares_dns_record_rr_cnt(dnsrec, ARES_SECTION_ANSWER));
+    const ares_dns_rr_t *rr =
+      ares_dns_record_rr_get_const(dnsrec, ARES_SECTION_ANSWER, 0);
+    const struct in_addr *addr = ares_dns_rr_get_addr(rr, ARES_RR_A_ADDR);
+    ASSERT_NE(nullptr, addr);
+    EXPECT_EQ(0, memcmp(addr, "\x02\x03\x04\x05", 4));
+  }
+
+  ares_dns_record_destroy(query);
+}
+
 #define TCPPARALLELLOOKUPS 32
 
 class MockTCPEventThreadStayOpenTest
@@ -1758,6 +2028,10 @@ INSTANTIATE_TEST_SUITE_P(AddressFamilies, MockUDPEventThreadTest, ::testing::Val
 
 INSTANTIATE_TEST_SUITE_P(AddressFamilies, MockUDPEventThreadMaxQueriesTest, ::testing::ValuesIn(ares::test::evsys_families), ares::test::PrintEvsysFamily);
 
+INSTANTIATE_TEST_SUITE_P(AddressFamilies, MockUDPEventThreadMultiTest, ::testing::ValuesIn(ares::test::evsys_families), ares::test::PrintEvsysFamily);
+
+INSTANTIATE_TEST_SUITE_P(AddressFamilies, MockEventThreadCallbackWorkersTest, ::testing::ValuesIn(ares::test::evsys_families), ares::test::PrintEvsysFamily);
+
 INSTANTIATE_TEST_SUITE_P(AddressFamilies, CacheQueriesEventThreadTest, ::testing::ValuesIn(ares::test::evsys_families), ares::test::PrintEvsysFamily);
 
 INSTANTIATE_TEST_SUITE_P(AddressFamilies, MockTCPEventThreadTest, ::testing::ValuesIn(ares::test::evsys_families), ares::test::PrintEvsysFamily);
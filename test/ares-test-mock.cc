@@ -31,6 +31,7 @@
 #include <sys/stat.h>
 #endif
 
+#include <fstream>
 #include <sstream>
 #include <vector>
 
@@ -252,6 +253,13 @@ static int SocketConnectCallback(ares_socket_t fd, int type, void *data) {
   return rc;
 }
 
+TEST_P(MockChannelTest, CacheSnapshotDisabled) {
+  /* Mock channels are created with qcache_max_ttl = 0 */
+  TempFile snapshot("");
+  EXPECT_EQ(ARES_ENOTIMP, ares_query_cache_save(channel_, snapshot.filename()));
+  EXPECT_EQ(ARES_ENOTIMP, ares_query_cache_load(channel_, snapshot.filename()));
+}
+
 TEST_P(MockChannelTest, SockCallback) {
   DNSPacket rsp;
   rsp.set_response().set_aa()
@@ -641,6 +649,267 @@ TEST_P(CacheQueriesTest, GetHostByNameCache) {
   EXPECT_EQ(1, sock_cb_count);
 }
 
+TEST_P(CacheQueriesTest, SaveLoad) {
+  DNSPacket rsp;
+  rsp.set_response().set_aa()
+    .add_question(new DNSQuestion("www.google.com", T_A))
+    .add_answer(new DNSARR("www.google.com", 100, {2, 3, 4, 5}));
+  EXPECT_CALL(server_, OnRequest("www.google.com", T_A))
+    .WillOnce(SetReply(&server_, &rsp));
+
+  HostResult result1;
+  ares_gethostbyname(channel_, "www.google.com.", AF_INET, HostCallback,
+                     &result1);
+  Process();
+  EXPECT_TRUE(result1.done_);
+
+  TempFile snapshot("");
+  EXPECT_EQ(ARES_SUCCESS, ares_query_cache_save(channel_, snapshot.filename()));
+
+  /* A fresh channel, as after a restart, starts out with an empty cache */
+  ares_channel_t *copy = nullptr;
+  EXPECT_EQ(ARES_SUCCESS, ares_dup(&copy, channel_));
+  EXPECT_EQ(ARES_SUCCESS, ares_query_cache_load(copy, snapshot.filename()));
+
+  /* Served from the loaded cache, the server only expects a single request */
+  HostResult result2;
+  ares_gethostbyname(copy, "www.google.com.", AF_INET, HostCallback, &result2);
+  ProcessAltChannel(copy);
+  EXPECT_TRUE(result2.done_);
+  std::stringstream ss;
+  ss << result2.host_;
+  EXPECT_EQ("{'www.google.com' aliases=[] addrs=[2.3.4.5]}", ss.str());
+
+  /* Loading again doesn't disturb existing entries */
+  EXPECT_EQ(ARES_SUCCESS, ares_query_cache_load(copy, snapshot.filename()));
+  ares_destroy(copy);
+
+  TempFile badfile("not a cache snapshot");
+  EXPECT_EQ(ARES_EFILE, ares_query_cache_load(channel_, badfile.filename()));
+  EXPECT_EQ(ARES_ENOTFOUND,
+            ares_query_cache_load(channel_, "/nonexistent/snapshot"));
+}
+
+#ifdef __linux__
+TEST_P(CacheQueriesTest, SharedCache) {
+  DNSPacket rsp;
+  rsp.set_response().set_aa()
+    .add_question(new DNSQuestion("www.google.com", T_A))
+    .add_answer(new DNSARR("www.google.com", 100, {2, 3, 4, 5}));
+  EXPECT_CALL(server_, OnRequest("www.google.com", T_A))
+    .WillOnce(SetReply(&server_, &rsp));
+
+  /* Two independent channels backed by the same shared cache file, as two
+   * processes would be */
+  TempFile shmfile("");
+  EXPECT_EQ(ARES_SUCCESS,
+            ares_set_query_cache_shm(channel_, shmfile.filename(), 64 * 1024));
+
+  ares_channel_t *copy = nullptr;
+  EXPECT_EQ(ARES_SUCCESS, ares_dup(&copy, channel_));
+
+  HostResult result1;
+  ares_gethostbyname(channel_, "www.google.com.", AF_INET, HostCallback,
+                     &result1);
+  Process();
+  std::stringstream ss1;
+  EXPECT_TRUE(result1.done_);
+  ss1 << result1.host_;
+  EXPECT_EQ("{'www.google.com' aliases=[] addrs=[2.3.4.5]}", ss1.str());
+
+  /* Served from the shared cache, the server only expects a single request */
+  HostResult result2;
+  ares_gethostbyname(copy, "www.google.com.", AF_INET, HostCallback, &result2);
+  ProcessAltChannel(copy);
+  EXPECT_TRUE(result2.done_);
+  std::stringstream ss2;
+  ss2 << result2.host_;
+  EXPECT_EQ("{'www.google.com' aliases=[] addrs=[2.3.4.5]}", ss2.str());
+
+  ares_destroy(copy);
+
+  /* Garbage file is rejected */
+  TempFile badfile("not a cache file");
+  EXPECT_EQ(ARES_EFILE,
+            ares_set_query_cache_shm(channel_, badfile.filename(), 0));
+
+  /* Entries that only live in the shared cache are part of a snapshot, and
+   * the snapshot is replaced atomically */
+  TempFile snapshot("stale contents");
+  EXPECT_EQ(ARES_SUCCESS, ares_query_cache_save(channel_, snapshot.filename()));
+  struct stat st;
+  EXPECT_NE(0, stat((std::string(snapshot.filename()) + ".tmp").c_str(), &st));
+  EXPECT_EQ(ARES_SUCCESS, ares_set_query_cache_shm(channel_, NULL, 0));
+  EXPECT_EQ(ARES_SUCCESS, ares_dup(&copy, channel_));
+  EXPECT_EQ(ARES_SUCCESS, ares_query_cache_load(copy, snapshot.filename()));
+  HostResult result3;
+  ares_gethostbyname(copy, "www.google.com.", AF_INET, HostCallback, &result3);
+  ProcessAltChannel(copy);
+  EXPECT_TRUE(result3.done_);
+  std::stringstream ss3;
+  ss3 << result3.host_;
+  EXPECT_EQ("{'www.google.com' aliases=[] addrs=[2.3.4.5]}", ss3.str());
+  ares_destroy(copy);
+
+  /* Right size, but not a cache file */
+  TempFile zerofile(std::string(64 * 1024, '\0'));
+  EXPECT_EQ(ARES_EFILE,
+            ares_set_query_cache_shm(channel_, zerofile.filename(), 0));
+
+  EXPECT_EQ(ARES_SUCCESS, ares_set_query_cache_shm(channel_, NULL, 0));
+}
+
+TEST_P(CacheQueriesTest, SharedCacheCorruptSlot) {
+  DNSPacket rsp;
+  rsp.set_response().set_aa()
+    .add_question(new DNSQuestion("www.google.com", T_A))
+    .add_answer(new DNSARR("www.google.com", 100, {2, 3, 4, 5}));
+  EXPECT_CALL(server_, OnRequest("www.google.com", T_A))
+    .Times(2)
+    .WillRepeatedly(SetReply(&server_, &rsp));
+
+  TempFile shmfile("");
+  EXPECT_EQ(ARES_SUCCESS,
+            ares_set_query_cache_shm(channel_, shmfile.filename(), 64 * 1024));
+
+  HostResult result1;
+  ares_gethostbyname(channel_, "www.google.com.", AF_INET, HostCallback,
+                     &result1);
+  Process();
+  EXPECT_TRUE(result1.done_);
+
+  /* Another writer scribbles an impossible data length over the cached slot.
+   * Slots follow a 64 byte header, 1280 bytes each, with the 16bit key and
+   * data lengths at offsets 24 and 26. */
+  std::fstream fs(shmfile.filename(),
+                  std::ios::in | std::ios::out | std::ios::binary);
+  ASSERT_TRUE(fs.good());
+  size_t corrupted = 0;
+  for (size_t offset = 64; offset + 1280 <= 64 * 1024; offset += 1280) {
+    unsigned short key_len  = 0;
+    unsigned short data_len = 0xFFFF;
+    fs.seekg((std::streamoff)(offset + 24));
+    fs.read(reinterpret_cast<char *>(&key_len), sizeof(key_len));
+    if (key_len == 0) {
+      continue;
+    }
+    fs.seekp((std::streamoff)(offset + 26));
+    fs.write(reinterpret_cast<const char *>(&data_len), sizeof(data_len));
+    corrupted++;
+  }
+  fs.close();
+  EXPECT_EQ(1, (int)corrupted);
+
+  /* Treated as a miss rather than read out of bounds */
+  HostResult result2;
+  ares_gethostbyname(channel_, "www.google.com.", AF_INET, HostCallback,
+                     &result2);
+  Process();
+  EXPECT_TRUE(result2.done_);
+  std::stringstream ss;
+  ss << result2.host_;
+  EXPECT_EQ("{'www.google.com' aliases=[] addrs=[2.3.4.5]}", ss.str());
+}
+
+TEST_P(CacheQueriesTest, SharedCacheSlotBeingWritten) {
+  DNSPacket rsp;
+  rsp.set_response().set_aa()
+    .add_question(new DNSQuestion("www.google.com", T_A))
+    .add_answer(new DNSARR("www.google.com", 100, {2, 3, 4, 5}));
+  EXPECT_CALL(server_, OnRequest("www.google.com", T_A))
+    .Times(2)
+    .WillRepeatedly(SetReply(&server_, &rsp));
+
+  TempFile shmfile("");
+  EXPECT_EQ(ARES_SUCCESS,
+            ares_set_query_cache_shm(channel_, shmfile.filename(), 64 * 1024));
+
+  HostResult result1;
+  ares_gethostbyname(channel_, "www.google.com.", AF_INET, HostCallback,
+                     &result1);
+  Process();
+  EXPECT_TRUE(result1.done_);
+
+  /* Leave the cached slot's sequence number odd, as a writer that died
+   * mid-write would.  The sequence number is at offset 0 of the slot. */
+  std::fstream fs(shmfile.filename(),
+                  std::ios::in | std::ios::out | std::ios::binary);
+  ASSERT_TRUE(fs.good());
+  size_t stuck = 0;
+  for (size_t offset = 64; offset + 1280 <= 64 * 1024; offset += 1280) {
+    unsigned short key_len = 0;
+    unsigned int   seq     = 0;
+    fs.seekg((std::streamoff)(offset + 24));
+    fs.read(reinterpret_cast<char *>(&key_len), sizeof(key_len));
+    if (key_len == 0) {
+      continue;
+    }
+    fs.seekg((std::streamoff)offset);
+    fs.read(reinterpret_cast<char *>(&seq), sizeof(seq));
+    seq |= 1;
+    fs.seekp((std::streamoff)offset);
+    fs.write(reinterpret_cast<const char *>(&seq), sizeof(seq));
+    stuck++;
+  }
+  fs.close();
+  EXPECT_EQ(1, (int)stuck);
+
+  /* The slot is skipped, so this goes to the server and is cached in another
+   * slot, from where the third lookup is served */
+  for (int i = 0; i < 2; i++) {
+    HostResult result;
+    ares_gethostbyname(channel_, "www.google.com.", AF_INET, HostCallback,
+                       &result);
+    Process();
+    EXPECT_TRUE(result.done_);
+    std::stringstream ss;
+    ss << result.host_;
+    EXPECT_EQ("{'www.google.com' aliases=[] addrs=[2.3.4.5]}", ss.str());
+  }
+}
+
+TEST_P(CacheQueriesTest, SharedCacheTruncated) {
+  DNSPacket rsp;
+  rsp.set_response().set_aa()
+    .add_question(new DNSQuestion("www.google.com", T_A))
+    .add_answer(new DNSARR("www.google.com", 100, {2, 3, 4, 5}));
+  EXPECT_CALL(server_, OnRequest("www.google.com", T_A))
+    .Times(2)
+    .WillRepeatedly(SetReply(&server_, &rsp));
+
+  TempFile shmfile("");
+  EXPECT_EQ(ARES_SUCCESS,
+            ares_set_query_cache_shm(channel_, shmfile.filename(), 64 * 1024));
+
+  HostResult result1;
+  ares_gethostbyname(channel_, "www.google.com.", AF_INET, HostCallback,
+                     &result1);
+  Process();
+  EXPECT_TRUE(result1.done_);
+
+  /* A peer truncates the file, accessing the mapping would now fault.  The
+   * cached answer is gone with it. */
+  EXPECT_EQ(0, truncate(shmfile.filename(), 64));
+
+  HostResult result2;
+  ares_gethostbyname(channel_, "www.google.com.", AF_INET, HostCallback,
+                     &result2);
+  Process();
+  EXPECT_TRUE(result2.done_);
+  std::stringstream ss;
+  ss << result2.host_;
+  EXPECT_EQ("{'www.google.com' aliases=[] addrs=[2.3.4.5]}", ss.str());
+
+  /* Snapshots skip the unusable shared cache */
+  TempFile snapshot("");
+  EXPECT_EQ(ARES_SUCCESS, ares_query_cache_save(channel_, snapshot.filename()));
+
+  /* Reattaching to the truncated file is refused */
+  EXPECT_EQ(ARES_EFILE,
+            ares_set_query_cache_shm(channel_, shmfile.filename(), 0));
+}
+#endif
+
 #define TCPPARALLELLOOKUPS 32
 TEST_P(MockTCPChannelTest, GetHostByNameParallelLookups) {
   DNSPacket rsp;
@@ -955,6 +1224,259 @@ TEST_P(MockChannelTest, SearchDomains) {
   EXPECT_EQ("{'www.third.gov' aliases=[] addrs=[2.3.4.5]}", ss.str());
 }
 
+class MockParallelSearchChannelTest : public MockFlagsChannelOptsTest {
+ public:
+  MockParallelSearchChannelTest()
+    : MockFlagsChannelOptsTest(ARES_FLAG_PARALLEL_SEARCH) {}
+};
+
+TEST_P(MockParallelSearchChannelTest, HighestPriorityAnswer) {
+  DNSPacket nofirst;
+  nofirst.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www.first.com", T_A));
+  DNSPacket yessecond;
+  yessecond.set_response().set_aa()
+    .add_question(new DNSQuestion("www.second.org", T_A))
+    .add_answer(new DNSARR("www.second.org", 0x0200, {2, 3, 4, 5}));
+  DNSPacket yesthird;
+  yesthird.set_response().set_aa()
+    .add_question(new DNSQuestion("www.third.gov", T_A))
+    .add_answer(new DNSARR("www.third.gov", 0x0200, {3, 4, 5, 6}));
+  DNSPacket nobare;
+  nobare.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www", T_A));
+
+  // All candidates are queried up front, even though a sequential search
+  // would have stopped at the second one.
+  EXPECT_CALL(server_, OnRequest("www.first.com", T_A))
+    .WillOnce(SetReply(&server_, &nofirst));
+  EXPECT_CALL(server_, OnRequest("www.second.org", T_A))
+    .WillOnce(SetReply(&server_, &yessecond));
+  EXPECT_CALL(server_, OnRequest("www.third.gov", T_A))
+    .WillOnce(SetReply(&server_, &yesthird));
+  EXPECT_CALL(server_, OnRequest("www", T_A))
+    .WillOnce(SetReply(&server_, &nobare));
+
+  SearchResult result;
+  ares_search(channel_, "www", C_IN, T_A, SearchCallback, &result);
+  Process();
+  EXPECT_TRUE(result.done_);
+  EXPECT_EQ(ARES_SUCCESS, result.status_);
+  std::stringstream ss;
+  ss << PacketToString(result.data_);
+  EXPECT_EQ("RSP QRY AA NOERROR Q:{'www.second.org' IN A} "
+            "A:{'www.second.org' IN A TTL=512 2.3.4.5}",
+            ss.str());
+}
+
+TEST_P(MockParallelSearchChannelTest, WaitsForHigherPriority) {
+  std::vector<byte> nothing;
+  DNSPacket yessecond;
+  yessecond.set_response().set_aa()
+    .add_question(new DNSQuestion("www.second.org", T_A))
+    .add_answer(new DNSARR("www.second.org", 0x0200, {2, 3, 4, 5}));
+  DNSPacket nobare;
+  nobare.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www", T_A));
+  ON_CALL(server_, OnRequest("www.first.com", T_A))
+    .WillByDefault(SetReplyData(&server_, nothing));
+  ON_CALL(server_, OnRequest("www.second.org", T_A))
+    .WillByDefault(SetReply(&server_, &yessecond));
+  ON_CALL(server_, OnRequest("www.third.gov", T_A))
+    .WillByDefault(SetReplyData(&server_, nothing));
+  ON_CALL(server_, OnRequest("www", T_A))
+    .WillByDefault(SetReply(&server_, &nobare));
+
+  // The second candidate has answered, but the first has not, so the search
+  // must not complete until it is cancelled.
+  SearchResult result;
+  ares_search(channel_, "www", C_IN, T_A, SearchCallback, &result);
+  Process(100);
+  EXPECT_TRUE(result.done_);
+  EXPECT_EQ(ARES_ECANCELLED, result.status_);
+}
+
+TEST_P(MockParallelSearchChannelTest, AllFail) {
+  DNSPacket nofirst;
+  nofirst.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www.first.com", T_A));
+  ON_CALL(server_, OnRequest("www.first.com", T_A))
+    .WillByDefault(SetReply(&server_, &nofirst));
+  DNSPacket nodatasecond;
+  nodatasecond.set_response().set_aa()
+    .add_question(new DNSQuestion("www.second.org", T_A));
+  ON_CALL(server_, OnRequest("www.second.org", T_A))
+    .WillByDefault(SetReply(&server_, &nodatasecond));
+  DNSPacket nothird;
+  nothird.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www.third.gov", T_A));
+  ON_CALL(server_, OnRequest("www.third.gov", T_A))
+    .WillByDefault(SetReply(&server_, &nothird));
+  DNSPacket nobare;
+  nobare.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www", T_A));
+  ON_CALL(server_, OnRequest("www", T_A))
+    .WillByDefault(SetReply(&server_, &nobare));
+
+  SearchResult result;
+  ares_search(channel_, "www", C_IN, T_A, SearchCallback, &result);
+  Process();
+  EXPECT_TRUE(result.done_);
+  EXPECT_EQ(ARES_ENODATA, result.status_);
+}
+
+TEST_P(MockParallelSearchChannelTest, GetHostByName) {
+  DNSPacket nofirst;
+  nofirst.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www.first.com", T_A));
+  ON_CALL(server_, OnRequest("www.first.com", T_A))
+    .WillByDefault(SetReply(&server_, &nofirst));
+  DNSPacket nosecond;
+  nosecond.set_response().set_aa().set_rcode(NXDOMAIN)
+    .add_question(new DNSQuestion("www.second.org", T_A));
+  ON_CALL(server_, OnRequest("www.second.org", T_A))
+    .WillByDefault(SetReply(&server_, &nosecond));
+  DNSPacket yesthird;
+  yesthird.set_response().set_aa()
+    .add_question(new DNSQuestion("www.third.gov", T_A))
+    .add_answer(new DNSARR("www.third.gov", 0x0200, {2, 3, 4, 5}));
+  ON_CALL(server_, OnRequest("www.third.gov", T_A))
+    .WillByDefault(SetReply(&server_, &yesthird));
+  DNSPacket yesbare;
+  yesbare.set_response().set_aa()
+    .add_question(new DNSQuestion("www", T_A))
+    .add_answer(new DNSARR("www", 0x0200, {3, 4, 5, 6}));
+  ON_CALL(server_, OnRequest("www", T_A))
+    .WillByDefault(SetReply(&server_, &yesbare));
+
+  HostResult result;
+  ares_gethostbyname(channel_, "www", AF_INET, HostCallback, &result);
+  Process();
+  EXPECT_TRUE(result.done_);
+  std::stringstream ss;
+  ss << result.host_;
+  EXPECT_EQ("{'www.third.gov' aliases=[] addrs=[2.3.4.5]}", ss.str());
+}
+
+class MockSearchNegCacheTest
+    : public MockChannelOptsTest,
+      public ::testing::WithParamInterface< std::pair<int, bool> > {
+ public:
+  MockSearchNegCacheTest()
+    : MockChannelOptsTest(1, GetParam().first, GetParam().second, false,
+                          FillOptions(&opts_),
+                          ARES_OPT_FLAGS | ARES_OPT_NDOTS) {}
+  static struct ares_options* FillOptions(struct ares_options * opts) {
+    memset(opts, 0, sizeof(struct ares_options));
+    opts->flags = ARES_FLAG_SEARCH_NEGCACHE;
+    opts->ndots = 5;
+    return opts;
+  }
+
+  // Reply NXDOMAIN, optionally with an SOA for negative caching
+  void SetNXDomain(const std::string &name, bool with_soa) {
+    DNSPacket *rsp = new DNSPacket();
+    rsp->set_response().set_aa().set_rcode(NXDOMAIN)
+      .add_question(new DNSQuestion(name, T_A));
+    if (with_soa) {
+      rsp->add_auth(new DNSSoaRR("first.com", 300, "ns.first.com",
+                                 "hostmaster.first.com", 1, 3600, 600, 86400,
+                                 300));
+    }
+    replies_.push_back(std::unique_ptr<DNSPacket>(rsp));
+    ON_CALL(server_, OnRequest(name, T_A))
+      .WillByDefault(SetReply(&server_, rsp));
+  }
+
+  void SetAddress(const std::string &name) {
+    DNSPacket *rsp = new DNSPacket();
+    rsp->set_response().set_aa()
+      .add_question(new DNSQuestion(name, T_A))
+      .add_answer(new DNSARR(name, 0x0200, {2, 3, 4, 5}));
+    replies_.push_back(std::unique_ptr<DNSPacket>(rsp));
+    ON_CALL(server_, OnRequest(name, T_A))
+      .WillByDefault(SetReply(&server_, rsp));
+  }
+
+  void Search(const std::string &name) {
+    SearchResult result;
+    ares_search(channel_, name.c_str(), C_IN, T_A, SearchCallback, &result);
+    Process();
+    EXPECT_TRUE(result.done_);
+    EXPECT_EQ(ARES_SUCCESS, result.status_);
+  }
+
+ private:
+  struct ares_options                     opts_;
+  std::vector<std::unique_ptr<DNSPacket>> replies_;
+};
+
+TEST_P(MockSearchNegCacheTest, LearnsSuffixMisses) {
+  const char *names[] = { "a.example.com", "b.example.com", "c.example.com",
+                          "d.example.com" };
+  for (const char *name : names) {
+    std::string n(name);
+    SetNXDomain(n + ".first.com", false);
+    SetNXDomain(n + ".second.org", false);
+    SetNXDomain(n + ".third.gov", false);
+    SetAddress(n);
+  }
+
+  for (size_t i = 0; i < 3; i++) {
+    std::string n(names[i]);
+    EXPECT_CALL(server_, OnRequest(n + ".first.com", T_A));
+    EXPECT_CALL(server_, OnRequest(n + ".second.org", T_A));
+    EXPECT_CALL(server_, OnRequest(n + ".third.gov", T_A));
+    EXPECT_CALL(server_, OnRequest(n, T_A));
+    Search(n);
+  }
+
+  // Every search domain has failed for every 3 label name so far, so only
+  // the name as-is is looked up.
+  EXPECT_CALL(server_, OnRequest("d.example.com.first.com", T_A)).Times(0);
+  EXPECT_CALL(server_, OnRequest("d.example.com.second.org", T_A)).Times(0);
+  EXPECT_CALL(server_, OnRequest("d.example.com.third.gov", T_A)).Times(0);
+  EXPECT_CALL(server_, OnRequest("d.example.com", T_A));
+  Search("d.example.com");
+}
+
+TEST_P(MockSearchNegCacheTest, SingleLabelNotLearned) {
+  // Short service names that only exist under the last search domain
+  const char *names[] = { "a", "b", "c" };
+  for (const char *name : names) {
+    std::string n(name);
+    SetNXDomain(n + ".first.com", false);
+    SetNXDomain(n + ".second.org", false);
+    SetAddress(n + ".third.gov");
+    EXPECT_CALL(server_, OnRequest(n + ".first.com", T_A));
+    EXPECT_CALL(server_, OnRequest(n + ".second.org", T_A));
+    EXPECT_CALL(server_, OnRequest(n + ".third.gov", T_A));
+    Search(n);
+  }
+
+  // Three misses under first.com don't stop a service that exists there from
+  // being found
+  SetAddress("d.first.com");
+  EXPECT_CALL(server_, OnRequest("d.first.com", T_A));
+  Search("d");
+}
+
+TEST_P(MockSearchNegCacheTest, NothingBelowNXDomain) {
+  SetNXDomain("x.test.first.com", true);
+  SetAddress("x.test.second.org");
+  SetNXDomain("a.x.test.first.com", false);
+  SetAddress("a.x.test.second.org");
+
+  EXPECT_CALL(server_, OnRequest("x.test.first.com", T_A));
+  EXPECT_CALL(server_, OnRequest("x.test.second.org", T_A));
+  Search("x.test");
+
+  // RFC 8020, nothing can exist below x.test.first.com
+  EXPECT_CALL(server_, OnRequest("a.x.test.first.com", T_A)).Times(0);
+  EXPECT_CALL(server_, OnRequest("a.x.test.second.org", T_A));
+  Search("a.x.test");
+}
+
 #ifdef HAVE_CONTAINER
 // Issue #852
 class ContainedMockChannelSysConfig
@@ -2500,6 +3022,25 @@ TEST_P(NoRotateMultiMockTest, ThirdServer) {
   CheckExample();
 }
 
+TEST_P(NoRotateMultiMockTest, BadRdataFailover) {
+  // A 3 byte A record is structurally fine but its rdata is malformed, so the
+  // whole reply must be rejected and the next server asked
+  DNSPacket badrsp;
+  badrsp.set_response().set_aa()
+    .add_question(new DNSQuestion("www.example.com", T_A))
+    .add_answer(new DNSARR("www.example.com", 100, {2,3,4}));
+  DNSPacket okrsp;
+  okrsp.set_response().set_aa()
+    .add_question(new DNSQuestion("www.example.com", T_A))
+    .add_answer(new DNSARR("www.example.com", 100, {2,3,4,5}));
+
+  EXPECT_CALL(*servers_[0], OnRequest("www.example.com", T_A))
+    .WillOnce(SetReply(servers_[0].get(), &badrsp));
+  EXPECT_CALL(*servers_[1], OnRequest("www.example.com", T_A))
+    .WillOnce(SetReply(servers_[1].get(), &okrsp));
+  CheckExample();
+}
+
 TEST_P(NoRotateMultiMockTest, ServerNoResponseFailover) {
   std::vector<byte> nothing;
   DNSPacket okrsp;
@@ -3049,6 +3590,10 @@ INSTANTIATE_TEST_SUITE_P(AddressFamilies, MockNoCheckRespChannelTest, ::testing:
 
 INSTANTIATE_TEST_SUITE_P(AddressFamilies, MockEDNSChannelTest, ::testing::ValuesIn(ares::test::families_modes), PrintFamilyMode);
 
+INSTANTIATE_TEST_SUITE_P(AddressFamilies, MockParallelSearchChannelTest, ::testing::ValuesIn(ares::test::families_modes), PrintFamilyMode);
+
+INSTANTIATE_TEST_SUITE_P(AddressFamilies, MockSearchNegCacheTest, ::testing::ValuesIn(ares::test::families_modes), PrintFamilyMode);
+
 INSTANTIATE_TEST_SUITE_P(TransportModes, NoRotateMultiMockTest, ::testing::ValuesIn(ares::test::families_modes), PrintFamilyMode);
 
 INSTANTIATE_TEST_SUITE_P(TransportModes, ServerFailoverOptsMultiMockTest, ::testing::ValuesIn(ares::test::families_modes), PrintFamilyMode);
@@ -360,6 +360,27 @@ TEST_F(LibraryTest, ParseAReplyErrors) {
   }
 }
 
+// Without a hostent, addresses are scanned straight from the response
+TEST_F(LibraryTest, ParseAReplyNoHostCnameTTL) {
+  DNSPacket pkt;
+  pkt.set_qid(0x1234).set_response()
+    .add_question(new DNSQuestion("www.example.com", T_A))
+    .add_answer(new DNSCnameRR("www.example.com", 60, "a.example.com"))
+    .add_answer(new DNSARR("a.example.com", 500, {1, 2, 3, 4}))
+    .add_answer(new DNSARR("a.example.com", 30, {1, 2, 3, 5}))
+    .add_additional(new DNSOptRR(0, 0, 0, 1280, { }, { }, false));
+  std::vector<byte> data = pkt.data();
+  struct ares_addrttl info[4];
+  int count = 4;
+  EXPECT_EQ(ARES_SUCCESS, ares_parse_a_reply(data.data(), (int)data.size(),
+                                             nullptr, info, &count));
+  EXPECT_EQ(2, count);
+  EXPECT_EQ(60, info[0].ttl);
+  EXPECT_EQ("1.2.3.4", AddressToString(&(info[0].ipaddr), 4));
+  EXPECT_EQ(30, info[1].ttl);
+  EXPECT_EQ("1.2.3.5", AddressToString(&(info[1].ipaddr), 4));
+}
+
 TEST_F(LibraryTest, ParseAReplyAllocFail) {
   DNSPacket pkt;
   pkt.set_qid(0x1234).set_response().set_aa()